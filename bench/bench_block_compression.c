@@ -0,0 +1,280 @@
+// Benchmark of the block compression (util/io/block_compression.c) and check of the frame validation against corrupt input.
+//
+// usage:   bench_block_compression [--size 16777216] [--repeat 3] [--fuzz 100000]
+//
+// Results are printed to stdout as one JSON object per line:
+//   speed:       {"bench":"block_compression","test":"compress","bytes":16777216,"ratio":0.21,"gb_per_s":0.9}
+//   validation:  {"bench":"block_compression","test":"crafted","case":"block_count_overflow","result":"rejected"}
+//                {"bench":"block_compression","test":"fuzz","cases":100000,"opened":1234,"read_ok":1200}
+// Crafted frames have to be rejected by bc_frame_open(), fuzzed frames (mutated or truncated valid frames) are opened and read
+// completely, which has to fail cleanly or succeed. Run it under AddressSanitizer to catch reads outside of the frame.
+// Exits with EXIT_FAILURE if a crafted frame is accepted.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/io/block_compression.h"
+#include "util/system.h"
+
+
+#define DEFAULT_SIZE            (16 * 1024 * 1024)
+#define DEFAULT_REPEAT          3
+#define DEFAULT_FUZZ            100000
+#define FUZZ_RAW_SIZE           (8 * 1024)
+#define FUZZ_BLOCK_SIZE         1024
+
+
+static volatile u64 s_sink;                                 // keeps the results alive
+
+
+static inline u64 xorshift(u64* state) {
+
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+// YAML like text similar to an exported library
+static void generate_text(u8* out, const size_t size) {
+
+    static const char* words[] = { "title", "visual", "novel", "rating", "progress", "release", "developer", "tags", "true", "false",
+        "notes", "chapter", "route", "complete", "library", "entry", "0.75", "2024", "1337", "  - " };
+    u64 state = 0x2545F4914F6CDD1DULL;
+    size_t len = 0;
+    while (len < size) {
+        const char* word = words[xorshift(&state) % (sizeof(words) / sizeof(words[0]))];
+        for (; *word && len < size; word++)
+            out[len++] = (u8)*word;
+        if (len < size)
+            out[len++] = (state & 0x700) ? ' ' : '\n';
+    }
+}
+
+// frame of [raw] in [out] (needs bc_compress_bound() per block plus header, index and footer)
+// @return size of the frame
+static size_t build_frame(const u8* raw, const size_t raw_size, const u32 block_size, u8* out) {
+
+    const u32 block_count = (u32)((raw_size + block_size - 1) / block_size);
+    bc_block_entry* entries = malloc(sizeof(bc_block_entry) * (block_count ? block_count : 1));
+    if (!entries) return 0;
+
+    bc_encode_header(out, block_size);
+    size_t pos = BC_HEADER_SIZE;
+    for (u32 x = 0; x < block_count; x++) {
+        const size_t len = (raw_size - (size_t)x * block_size < block_size) ? raw_size - (size_t)x * block_size : block_size;
+        const u8* src = raw + (size_t)x * block_size;
+        size_t stored = bc_compress(src, len, out + pos, len);
+        if (stored == 0 || stored >= len) {                                 // incompressible, keep it raw
+            memcpy(out + pos, src, len);
+            stored = len;
+        }
+        entries[x] = (bc_block_entry){ .offset = pos, .stored_size = (u32)stored, .raw_size = (u32)len };
+        pos += stored;
+    }
+
+    const u64 index_offset = pos;
+    for (u32 x = 0; x < block_count; x++, pos += BC_INDEX_ENTRY_SIZE)
+        bc_encode_index_entry(out + pos, &entries[x]);
+    bc_encode_footer(out + pos, index_offset, block_count);
+    free(entries);
+    return pos + BC_FOOTER_SIZE;
+}
+
+static size_t frame_capacity(const size_t raw_size, const u32 block_size) {
+
+    const size_t block_count = (raw_size + block_size - 1) / block_size;
+    return bc_compress_bound(raw_size) + block_count * (16 + BC_INDEX_ENTRY_SIZE) + BC_HEADER_SIZE + BC_FOOTER_SIZE;
+}
+
+
+// ============================================================================================================================================
+// speed
+// ============================================================================================================================================
+
+static void bench_speed(const size_t size, const u32 repeat) {
+
+    u8* raw = malloc(size);
+    u8* frame_data = malloc(frame_capacity(size, BC_DEFAULT_BLOCK_SIZE));
+    u8* decoded = malloc(size);
+    if (!raw || !frame_data || !decoded) {
+        fprintf(stderr, "out of memory\n");
+        free(raw); free(frame_data); free(decoded);
+        return;
+    }
+    generate_text(raw, size);
+
+    f64 best_compress = 0, best_read = 0;
+    size_t frame_size = 0;
+    for (u32 r = 0; r < repeat; r++) {
+        f64 start = get_precise_time();
+        frame_size = build_frame(raw, size, BC_DEFAULT_BLOCK_SIZE, frame_data);
+        f64 seconds = get_precise_time() - start;
+        best_compress = (r == 0 || seconds < best_compress) ? seconds : best_compress;
+
+        bc_frame frame;
+        start = get_precise_time();
+        const i32 result = bc_frame_open(&frame, frame_data, frame_size) == AT_SUCCESS ? bc_frame_read_all(&frame, decoded) : AT_FORMAT_ERROR;
+        seconds = get_precise_time() - start;
+        best_read = (r == 0 || seconds < best_read) ? seconds : best_read;
+
+        if (result != AT_SUCCESS || memcmp(raw, decoded, size) != 0)
+            fprintf(stderr, "round trip failed\n");
+        s_sink += decoded[size / 2];
+    }
+
+    printf("{\"bench\":\"block_compression\",\"test\":\"compress\",\"bytes\":%zu,\"ratio\":%.3f,\"gb_per_s\":%.2f}\n",
+        size, (f64)frame_size / (f64)size, (f64)size / best_compress * 1e-9);
+    printf("{\"bench\":\"block_compression\",\"test\":\"read_all\",\"bytes\":%zu,\"gb_per_s\":%.2f}\n", size, (f64)size / best_read * 1e-9);
+    fflush(stdout);
+    free(raw);
+    free(frame_data);
+    free(decoded);
+}
+
+
+// ============================================================================================================================================
+// validation
+// ============================================================================================================================================
+
+// opens [data] and reads every block, a frame that opens has to be readable without touching memory outside of it
+static i32 open_and_read(const u8* data, const size_t size, b8* opened) {
+
+    bc_frame frame;
+    *opened = (bc_frame_open(&frame, data, size) == AT_SUCCESS);
+    if (!*opened) return AT_FORMAT_ERROR;
+
+    u8* raw = malloc(frame.raw_size ? frame.raw_size : 1);
+    if (!raw) return AT_MEMORY_ERROR;
+    const i32 result = bc_frame_read_all(&frame, raw);
+    free(raw);
+    return result;
+}
+
+static void store_u64(u8* pos, const u64 value) {
+
+    for (u32 x = 0; x < 8; x++)
+        pos[x] = (u8)(value >> (x * 8));
+}
+
+// frames with an index that only passes size checks if they overflow
+static b8 check_crafted(void) {
+
+    b8 all_rejected = true;
+    u8 data[64];
+
+    // header, an empty block area and a footer whose block count * entry size wraps the index offset back to the header
+    {
+        const u32 block_count = 0x10000000;
+        memset(data, 0, sizeof(data));
+        bc_encode_header(data, BC_DEFAULT_BLOCK_SIZE);
+        bc_encode_footer(data + sizeof(data) - BC_FOOTER_SIZE, (u64)sizeof(data) - BC_FOOTER_SIZE - (u64)block_count * BC_INDEX_ENTRY_SIZE, block_count);
+
+        b8 opened;
+        open_and_read(data, sizeof(data), &opened);
+        printf("{\"bench\":\"block_compression\",\"test\":\"crafted\",\"case\":\"block_count_overflow\",\"result\":\"%s\"}\n", opened ? "accepted" : "rejected");
+        all_rejected &= !opened;
+    }
+
+    // valid index position, but offset + stored_size of the entry wraps around
+    {
+        memset(data, 0, sizeof(data));
+        bc_encode_header(data, BC_DEFAULT_BLOCK_SIZE);
+        const u64 index_offset = sizeof(data) - BC_FOOTER_SIZE - BC_INDEX_ENTRY_SIZE;
+        const bc_block_entry entry = { .offset = UINT64_MAX - 7, .stored_size = 16, .raw_size = 16 };
+        bc_encode_index_entry(data + index_offset, &entry);
+        bc_encode_footer(data + sizeof(data) - BC_FOOTER_SIZE, index_offset, 1);
+
+        b8 opened;
+        open_and_read(data, sizeof(data), &opened);
+        printf("{\"bench\":\"block_compression\",\"test\":\"crafted\",\"case\":\"entry_offset_overflow\",\"result\":\"%s\"}\n", opened ? "accepted" : "rejected");
+        all_rejected &= !opened;
+
+        // same entry with an offset behind the index
+        store_u64(data + index_offset, index_offset + 8);
+        open_and_read(data, sizeof(data), &opened);
+        printf("{\"bench\":\"block_compression\",\"test\":\"crafted\",\"case\":\"entry_behind_index\",\"result\":\"%s\"}\n", opened ? "accepted" : "rejected");
+        all_rejected &= !opened;
+    }
+
+    fflush(stdout);
+    return all_rejected;
+}
+
+// mutated and truncated copies of a valid frame with several small blocks
+static void fuzz_frames(const u32 cases) {
+
+    u8* raw = malloc(FUZZ_RAW_SIZE);
+    const size_t capacity = frame_capacity(FUZZ_RAW_SIZE, FUZZ_BLOCK_SIZE);
+    u8* valid = malloc(capacity);
+    if (!raw || !valid) {
+        free(raw);
+        free(valid);
+        return;
+    }
+    generate_text(raw, FUZZ_RAW_SIZE);
+    const size_t valid_size = build_frame(raw, FUZZ_RAW_SIZE, FUZZ_BLOCK_SIZE, valid);
+
+    u64 state = 0x9E3779B97F4A7C15ULL;
+    u32 opened_count = 0, read_count = 0;
+    for (u32 c = 0; c < cases; c++) {
+
+        // exact size copy, so ASan sees every read past the end
+        size_t size = valid_size;
+        if (xorshift(&state) % 4 == 0)
+            size = BC_HEADER_SIZE + BC_FOOTER_SIZE + xorshift(&state) % (valid_size - BC_HEADER_SIZE - BC_FOOTER_SIZE);
+        u8* data = malloc(size);
+        if (!data) break;
+        memcpy(data, valid, size);
+        if (size < valid_size)                                              // keep a footer, otherwise nearly every case is rejected early
+            memcpy(data + size - BC_FOOTER_SIZE, valid + valid_size - BC_FOOTER_SIZE, BC_FOOTER_SIZE);
+
+        // flip bytes, mostly in the index and footer where the sizes are
+        const u32 flips = 1 + (u32)(xorshift(&state) % 8);
+        for (u32 x = 0; x < flips; x++) {
+            const u64 value = xorshift(&state);
+            const size_t tail = (size < 256) ? size : 256;
+            const size_t pos = (value & 1) ? size - 1 - (size_t)((value >> 8) % tail) : (size_t)((value >> 8) % size);
+            data[pos] = (value & 2) ? (u8)(value >> 32) : (u8)(data[pos] ^ (1u << ((value >> 40) & 7)));
+        }
+
+        b8 opened;
+        const i32 result = open_and_read(data, size, &opened);
+        opened_count += opened;
+        read_count += (result == AT_SUCCESS);
+        free(data);
+    }
+
+    printf("{\"bench\":\"block_compression\",\"test\":\"fuzz\",\"cases\":%u,\"opened\":%u,\"read_ok\":%u}\n", cases, opened_count, read_count);
+    fflush(stdout);
+    free(raw);
+    free(valid);
+}
+
+
+int main(int argc, char* argv[]) {
+
+    size_t size = DEFAULT_SIZE;
+    u32 repeat = DEFAULT_REPEAT;
+    u32 fuzz = DEFAULT_FUZZ;
+    for (int x = 1; x < argc; x++) {
+        if (strcmp(argv[x], "--size") == 0 && x + 1 < argc)
+            size = strtoull(argv[++x], NULL, 10);
+        else if (strcmp(argv[x], "--repeat") == 0 && x + 1 < argc)
+            repeat = (u32)atoi(argv[++x]);
+        else if (strcmp(argv[x], "--fuzz") == 0 && x + 1 < argc)
+            fuzz = (u32)atoi(argv[++x]);
+        else {
+            fprintf(stderr, "usage: %s [--size %d] [--repeat %d] [--fuzz %d]\n", argv[0], DEFAULT_SIZE, DEFAULT_REPEAT, DEFAULT_FUZZ);
+            return EXIT_FAILURE;
+        }
+    }
+    if (repeat == 0) repeat = 1;
+    if (size == 0) size = 1;
+
+    const b8 crafted_rejected = check_crafted();
+    fuzz_frames(fuzz);
+    bench_speed(size, repeat);
+    return crafted_rejected ? EXIT_SUCCESS : EXIT_FAILURE;
+}
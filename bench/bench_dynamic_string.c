@@ -0,0 +1,241 @@
+
+// Benchmark of the search and replace functions of util/data_structure/dynamic_string.c against the implementations they replaced:
+// byte loops for ds_find_last_char() and ds_find_last_str() and the ds_replace() that rebuilt the string with ds_append_fmt("%.*s").
+// ds_find_str() still uses strstr() of the C library, its results are the baseline the vectorized kernels were measured against.
+//
+// usage:   bench_dynamic_string [--size 1048576] [--repeat 3]
+//
+// Results are printed to stdout as one JSON object per line:
+//   {"bench":"dynamic_string","impl":"current","test":"find_str","needle":"absent","bytes":4096,"ns_per_call":110.5,"gb_per_s":37.1}
+// The haystack is generated English-like text. "absent" needles scan the whole string, "present" needles are found near the end
+// (near the start for the reverse searches). Replace tests run on a copy of the text, [bytes] is the size before replacing.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/data_structure/dynamic_string.h"
+#include "util/system.h"
+
+
+#define DEFAULT_SIZE            (1024 * 1024)
+#define DEFAULT_REPEAT          3
+#define MIN_BENCH_BYTES         (256ULL * 1024 * 1024)      // bytes searched per measurement, small inputs are repeated
+
+
+// ============================================================================================================================================
+// previous implementations
+// ============================================================================================================================================
+
+static ssize_t previous_find_str(const dyn_str* s, const char* substr, size_t start_pos) {
+
+    if (start_pos >= s->len) return -1;
+    const char* found = strstr(s->data + start_pos, substr);
+    return found ? (ssize_t)(found - s->data) : -1;
+}
+
+static ssize_t previous_find_last_char(const dyn_str* s, char c) {
+
+    for (ssize_t i = s->len - 1; i >= 0; i--)
+        if (s->data[i] == c) return i;
+    return -1;
+}
+
+static ssize_t previous_find_last_str(const dyn_str* s, const char* substr) {
+
+    const size_t substr_len = strlen(substr);
+    if (substr_len == 0 || substr_len > s->len) return -1;
+
+    for (ssize_t i = s->len - substr_len; i >= 0; i--)
+        if (strncmp(s->data + i, substr, substr_len) == 0) return i;
+    return -1;
+}
+
+static i32 previous_replace(dyn_str* s, const char* old_str, const char* new_str) {
+
+    const size_t old_len = strlen(old_str);
+    if (old_len == 0) return AT_SUCCESS;
+
+    dyn_str result = {0};
+    ds_init(&result);
+    size_t pos = 0;
+    ssize_t found_pos;
+    while ((found_pos = previous_find_str(s, old_str, pos)) != -1) {
+        ds_append_fmt(&result, NULL, "%.*s", (i32)(found_pos - pos), s->data + pos);
+        ds_append_str(&result, new_str);
+        pos = found_pos + old_len;
+    }
+    ds_append_str(&result, s->data + pos);
+
+    // the result has to stay in [s], copy it back (the old version swapped the structs)
+    ds_clear(s);
+    ds_append_str_n(s, result.data, result.len);
+    ds_free(&result);
+    return AT_SUCCESS;
+}
+
+
+// ============================================================================================================================================
+// implementations under test
+// ============================================================================================================================================
+
+typedef struct {
+    const char*     name;
+    ssize_t         (*find_str)(const dyn_str* s, const char* substr, size_t start_pos);
+    ssize_t         (*find_last_char)(const dyn_str* s, char c);
+    ssize_t         (*find_last_str)(const dyn_str* s, const char* substr);
+    i32             (*replace)(dyn_str* s, const char* old_str, const char* new_str);
+} implementation;
+
+static const implementation s_implementations[] = {
+    { "previous",   previous_find_str,  previous_find_last_char,    previous_find_last_str, previous_replace },
+    { "current",    ds_find_str,        ds_find_last_char,          ds_find_last_str,       ds_replace },
+};
+
+#define IMPLEMENTATION_COUNT    (sizeof(s_implementations) / sizeof(s_implementations[0]))
+
+
+// ============================================================================================================================================
+// bench
+// ============================================================================================================================================
+
+static volatile i64 s_sink;                                 // keeps the results alive
+
+// words of a fixed pseudo random sequence, never contains '#', 'Z' or "needle"
+static void generate_text(dyn_str* text, const size_t size) {
+
+    static const char* words[] = { "the", "visual", "novel", "library", "reads", "and", "writes", "its", "entries", "to", "a", "file",
+        "with", "sections", "of", "key", "value", "pairs", "while", "the", "dashboard", "draws", "them", "every", "frame" };
+    u64 state = 0x2545F4914F6CDD1DULL;
+    while (text->len < size) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        ds_append_str(text, words[state % (sizeof(words) / sizeof(words[0]))]);
+        ds_append_char(text, (state & 0xF00) ? ' ' : '\n');
+    }
+    text->len = size;
+    text->data[size] = '\0';
+}
+
+static void print_result(const char* impl, const char* test, const char* needle, const size_t bytes, const f64 seconds) {
+
+    printf("{\"bench\":\"dynamic_string\",\"impl\":\"%s\",\"test\":\"%s\",\"needle\":\"%s\",\"bytes\":%zu,\"ns_per_call\":%.1f,\"gb_per_s\":%.2f}\n",
+        impl, test, needle, bytes, seconds * 1e9, (f64)bytes / seconds * 1e-9);
+}
+
+// [kind]: 0 find_str, 1 find_last_char, 2 find_last_str
+static f64 time_search(const implementation* impl, const u32 kind, const dyn_str* text, const char* needle, const u32 repeat) {
+
+    const u64 rounds = MIN_BENCH_BYTES / text->len + 1;
+    f64 best = 0;
+    for (u32 r = 0; r < repeat; r++) {
+        i64 sum = 0;
+        const f64 start = get_precise_time();
+        for (u64 x = 0; x < rounds; x++) {
+            switch (kind) {
+                case 0:     sum += impl->find_str(text, needle, 0); break;
+                case 1:     sum += impl->find_last_char(text, needle[0]); break;
+                default:    sum += impl->find_last_str(text, needle); break;
+            }
+        }
+        const f64 seconds = (get_precise_time() - start) / (f64)rounds;
+        s_sink += sum;
+        best = (r == 0 || seconds < best) ? seconds : best;
+    }
+    return best;
+}
+
+static void bench_search(const size_t size, const u32 repeat) {
+
+    static const char* tests[] = { "find_str", "find_last_char", "find_last_str" };
+    const size_t lengths[] = { 64, 4096, size };
+
+    for (u32 l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        const size_t len = lengths[l];
+        dyn_str text = {0};
+        ds_init(&text);
+        generate_text(&text, len);
+
+        for (u32 kind = 0; kind < 3; kind++) {
+            for (u32 present = 0; present < 2; present++) {
+
+                // present needles are planted where the search direction reaches them last
+                const char* needle = (kind == 1) ? "#" : "needle";
+                const size_t needle_len = strlen(needle);
+                const size_t plant = (kind == 0) ? len - 8 : 2;
+                char saved[8];
+                memcpy(saved, text.data + plant, needle_len);
+                if (present)
+                    memcpy(text.data + plant, needle, needle_len);
+
+                for (u32 i = 0; i < IMPLEMENTATION_COUNT; i++)
+                    print_result(s_implementations[i].name, tests[kind], present ? "present" : "absent", len,
+                        time_search(&s_implementations[i], kind, &text, needle, repeat));
+
+                memcpy(text.data + plant, saved, needle_len);
+                fflush(stdout);
+            }
+        }
+        ds_free(&text);
+    }
+}
+
+static void bench_replace(const size_t size, const u32 repeat) {
+
+    static const char* cases[][3] = {               // name, old, new
+        { "shrink", "the", "a" },
+        { "equal",  "key", "KEY" },
+        { "grow",   "the", "these" },
+    };
+
+    dyn_str text = {0};
+    ds_init(&text);
+    generate_text(&text, size);
+
+    for (u32 c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        for (u32 i = 0; i < IMPLEMENTATION_COUNT; i++) {
+
+            f64 best = 0;
+            for (u32 r = 0; r < repeat; r++) {
+                dyn_str copy = {0};
+                ds_init_s(&copy, text.len);
+                ds_append_str_n(&copy, text.data, text.len);
+
+                const f64 start = get_precise_time();
+                s_implementations[i].replace(&copy, cases[c][1], cases[c][2]);
+                const f64 seconds = get_precise_time() - start;
+
+                s_sink += (i64)copy.len;
+                ds_free(&copy);
+                best = (r == 0 || seconds < best) ? seconds : best;
+            }
+            print_result(s_implementations[i].name, "replace", cases[c][0], size, best);
+        }
+        fflush(stdout);
+    }
+    ds_free(&text);
+}
+
+
+int main(int argc, char* argv[]) {
+
+    size_t size = DEFAULT_SIZE;
+    u32 repeat = DEFAULT_REPEAT;
+    for (int x = 1; x < argc; x++) {
+        if (strcmp(argv[x], "--size") == 0 && x + 1 < argc)
+            size = strtoull(argv[++x], NULL, 10);
+        else if (strcmp(argv[x], "--repeat") == 0 && x + 1 < argc)
+            repeat = (u32)atoi(argv[++x]);
+        else {
+            fprintf(stderr, "usage: %s [--size %d] [--repeat %d]\n", argv[0], DEFAULT_SIZE, DEFAULT_REPEAT);
+            return EXIT_FAILURE;
+        }
+    }
+    if (repeat == 0) repeat = 1;
+    if (size < 64) size = 64;
+
+    bench_search(size, repeat);
+    bench_replace(size, repeat);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,252 @@
+
+// Benchmark of the hash functions (util/data_structure/hash.c) against the ones they replaced: djb2 for strings and the
+// identity for integers and pointers.
+//
+// usage:   bench_hash [--keys 1000000] [--repeat 3]
+//
+// Results are printed to stdout as one JSON object per line:
+//   speed:     {"bench":"hash","hash":"hash","test":"speed","bytes":32,"ns_per_hash":4.4,"gb_per_s":7.2}
+//   quality:   {"bench":"hash","hash":"previous","test":"quality","keys":"ptr_stride_64","slots":65536,"used_slots":0.016,
+//               "max_load":64,"chi_square":63.0,"avalanche_bias":0.500}
+// [used_slots] is the fraction of slots hit when as many keys as slots are masked into a power of two table (0.632 is ideal),
+// [chi_square] is the chi square of the slot loads divided by the number of slots (about 1 is ideal), [avalanche_bias] is
+// the largest deviation from 0.5 of the probability that an output bit flips when one input bit flips (0 is ideal).
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/data_structure/hash.h"
+#include "util/system.h"
+
+
+#define DEFAULT_KEYS            1000000
+#define DEFAULT_REPEAT          3
+#define MAX_BYTES               4096
+#define AVALANCHE_SAMPLES       2000
+#define STRING_KEY_SIZE         32
+
+
+// ============================================================================================================================================
+// hash functions under test
+// ============================================================================================================================================
+
+typedef u64 (*bytes_hash_fn)(const void* data, const size_t len);
+typedef u64 (*int_hash_fn)(const u64 value);
+
+static u64 djb2(const void* data, const size_t len) {
+
+    const u8* bytes = (const u8*)data;
+    u64 hash = 5381;
+    for (size_t x = 0; x < len; x++)
+        hash = ((hash << 5) + hash) + bytes[x];
+    return hash;
+}
+
+static u64 bytes_default(const void* data, const size_t len)       { return hash_bytes(data, len, HASH_DEFAULT_SEED); }
+
+static u64 identity(const u64 value)                                { return value; }
+
+static u64 int_default(const u64 value)                             { return hash_u64(value, HASH_DEFAULT_SEED); }
+
+
+typedef struct {
+    const char*         name;
+    bytes_hash_fn       bytes;
+    int_hash_fn         integer;
+} hash_entry;
+
+static const hash_entry s_hashes[] = {
+    { "previous",           djb2,           identity },         // string_hash() and u64_hash() before hash.h
+    { "hash",               bytes_default,  int_default },
+};
+#define HASH_COUNT              (sizeof(s_hashes) / sizeof(s_hashes[0]))
+
+
+// ============================================================================================================================================
+// speed
+// ============================================================================================================================================
+
+static volatile u64 s_sink;                                     // keeps the results alive
+
+static void bench_speed(const u32 repeat) {
+
+    static u8 buffer[MAX_BYTES + 64];
+    for (u32 x = 0; x < sizeof(buffer); x++)
+        buffer[x] = (u8)(x * 131 + 7);
+
+    static const size_t lengths[] = { 4, 8, 16, 32, 64, 256, 4096 };
+    for (u32 h = 0; h < HASH_COUNT; h++) {
+        for (u32 l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+
+            const size_t len = lengths[l];
+            const u64 rounds = (64ULL * 1024 * 1024) / (len + 32);
+            f64 best = 0;
+            for (u32 r = 0; r < repeat; r++) {
+                u64 sum = 0;
+                const f64 start = get_precise_time();
+                for (u64 x = 0; x < rounds; x++)
+                    sum += s_hashes[h].bytes(buffer + (x & 63), len);           // varying alignment
+                const f64 seconds = (get_precise_time() - start) / (f64)rounds;
+                s_sink += sum;
+                best = (r == 0 || seconds < best) ? seconds : best;
+            }
+            printf("{\"bench\":\"hash\",\"hash\":\"%s\",\"test\":\"speed\",\"bytes\":%zu,\"ns_per_hash\":%.2f,\"gb_per_s\":%.2f}\n",
+                s_hashes[h].name, len, best * 1e9, (f64)len / best * 1e-9);
+        }
+
+        const u64 rounds = 32ULL * 1024 * 1024;
+        f64 best = 0;
+        for (u32 r = 0; r < repeat; r++) {
+            u64 sum = 0;
+            const f64 start = get_precise_time();
+            for (u64 x = 0; x < rounds; x++)
+                sum += s_hashes[h].integer(x * 64);
+            const f64 seconds = (get_precise_time() - start) / (f64)rounds;
+            s_sink += sum;
+            best = (r == 0 || seconds < best) ? seconds : best;
+        }
+        printf("{\"bench\":\"hash\",\"hash\":\"%s\",\"test\":\"speed\",\"bytes\":\"u64\",\"ns_per_hash\":%.2f}\n", s_hashes[h].name, best * 1e9);
+        fflush(stdout);
+    }
+}
+
+
+// ============================================================================================================================================
+// quality
+// ============================================================================================================================================
+
+typedef enum {
+    KEYS_SEQUENTIAL = 0,
+    KEYS_PTR_STRIDE_16,
+    KEYS_PTR_STRIDE_64,
+    KEYS_PTR_STRIDE_4096,
+    KEYS_STRING,
+    KEYS_COUNT,
+} key_kind;
+
+static const char* s_key_names[KEYS_COUNT] = { "sequential", "ptr_stride_16", "ptr_stride_64", "ptr_stride_4096", "string" };
+
+
+static inline u64 xorshift(u64* state) {
+
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static u64 hash_key(const hash_entry* hash, const key_kind kind, const u64 index) {
+
+    switch (kind) {
+        case KEYS_SEQUENTIAL:       return hash->integer(index);
+        case KEYS_PTR_STRIDE_16:    return hash->integer(0x7F0000001000ULL + index * 16);
+        case KEYS_PTR_STRIDE_64:    return hash->integer(0x7F0000001000ULL + index * 64);
+        case KEYS_PTR_STRIDE_4096:  return hash->integer(0x7F0000001000ULL + index * 4096);
+        default: {
+            char key[STRING_KEY_SIZE];
+            const int len = snprintf(key, sizeof(key), "visual_novel_%llu", (unsigned long long)index);
+            return hash->bytes(key, (size_t)len);
+        }
+    }
+}
+
+
+// @brief Largest deviation from 0.5 of the flip probability of an output bit, over all single bit flips of random keys
+static f64 avalanche_bias(const hash_entry* hash, const key_kind kind) {
+
+    u64 state = 0x2545F4914F6CDD1DULL;
+    f64 worst = 0;
+    const u32 input_bits = (kind == KEYS_STRING) ? 16 * 8 : 64;
+    for (u32 bit = 0; bit < input_bits; bit++) {
+
+        u32 flips[64] = {0};
+        for (u32 sample = 0; sample < AVALANCHE_SAMPLES; sample++) {
+            u64 difference;
+            if (kind == KEYS_STRING) {
+                u8 key[16];
+                for (u32 x = 0; x < sizeof(key); x += 8) {
+                    const u64 random = xorshift(&state);
+                    memcpy(key + x, &random, 8);
+                }
+                const u64 before = hash->bytes(key, sizeof(key));
+                key[bit / 8] ^= (u8)(1u << (bit % 8));
+                difference = before ^ hash->bytes(key, sizeof(key));
+            } else {
+                const u64 key = xorshift(&state);
+                difference = hash->integer(key) ^ hash->integer(key ^ (1ULL << bit));
+            }
+            for (u32 out = 0; out < 64; out++)
+                flips[out] += (difference >> out) & 1;
+        }
+
+        for (u32 out = 0; out < 64; out++) {
+            f64 bias = (f64)flips[out] / AVALANCHE_SAMPLES - 0.5;
+            bias = (bias < 0) ? -bias : bias;
+            worst = (bias > worst) ? bias : worst;
+        }
+    }
+    return worst;
+}
+
+
+static b8 bench_quality(const u64 key_count) {
+
+    u64 slots = 1;
+    while (slots < key_count)
+        slots <<= 1;
+
+    u32* loads = malloc(slots * sizeof(u32));
+    if (!loads) {
+        fprintf(stderr, "failed to allocate [%llu] slots\n", (unsigned long long)slots);
+        return false;
+    }
+
+    for (u32 h = 0; h < HASH_COUNT; h++) {
+        for (u32 kind = 0; kind < KEYS_COUNT; kind++) {
+
+            memset(loads, 0, slots * sizeof(u32));
+            for (u64 x = 0; x < slots; x++)
+                loads[hash_key(&s_hashes[h], (key_kind)kind, x) & (slots - 1)]++;
+
+            u64 used = 0, max_load = 0;
+            f64 chi_square = 0;
+            for (u64 x = 0; x < slots; x++) {
+                used += (loads[x] != 0);
+                max_load = (loads[x] > max_load) ? loads[x] : max_load;
+                chi_square += ((f64)loads[x] - 1.0) * ((f64)loads[x] - 1.0);
+            }
+
+            printf("{\"bench\":\"hash\",\"hash\":\"%s\",\"test\":\"quality\",\"keys\":\"%s\",\"slots\":%llu,\"used_slots\":%.3f,\"max_load\":%llu,\"chi_square\":%.2f,\"avalanche_bias\":%.3f}\n",
+                s_hashes[h].name, s_key_names[kind], (unsigned long long)slots, (f64)used / (f64)slots, (unsigned long long)max_load,
+                chi_square / (f64)slots, avalanche_bias(&s_hashes[h], (key_kind)kind));
+            fflush(stdout);
+        }
+    }
+
+    free(loads);
+    return true;
+}
+
+
+int main(int argc, char* argv[]) {
+
+    u64 key_count = DEFAULT_KEYS;
+    u32 repeat = DEFAULT_REPEAT;
+    for (int x = 1; x < argc; x++) {
+        if (strcmp(argv[x], "--keys") == 0 && x + 1 < argc)
+            key_count = strtoull(argv[++x], NULL, 10);
+        else if (strcmp(argv[x], "--repeat") == 0 && x + 1 < argc)
+            repeat = (u32)atoi(argv[++x]);
+        else {
+            fprintf(stderr, "usage: %s [--keys %d] [--repeat %d]\n", argv[0], DEFAULT_KEYS, DEFAULT_REPEAT);
+            return EXIT_FAILURE;
+        }
+    }
+    if (repeat == 0) repeat = 1;
+    if (key_count == 0) key_count = 1;
+
+    bench_speed(repeat);
+    return bench_quality(key_count) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
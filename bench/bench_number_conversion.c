@@ -0,0 +1,462 @@
+
+// Round-trip check and benchmark of the number conversion (util/io/number_conversion.c) against the C library functions it
+// replaced in the serializer: snprintf() for formatting and strtoull()/strtoll()/strtod()/strtof() for parsing.
+//
+// usage:   bench_number_conversion [--values 1000000] [--repeat 3]
+//
+// Results are printed to stdout as one JSON object per line:
+//   check:     {"bench":"number_conversion","test":"roundtrip","type":"f64","values":1000042,"failures":0,"longer_than_shortest":12}
+//   speed:     {"bench":"number_conversion","test":"format","type":"f64","impl":"num","ns_per_value":45.1}
+// [roundtrip] formats edge cases and random bit patterns, parses the text again and requires the identical value (bit exact for
+// floats, NaN only has to stay NaN). Parsed floats are also compared with strtod()/strtof() of the same text, which are correctly
+// rounded. [longer_than_shortest] counts formatted floats with more digits than the shortest "%.<n>g" that round-trips (Grisu2
+// is not always shortest, this is not a failure).
+// Exits with EXIT_FAILURE if any value does not round-trip.
+
+#include <float.h>
+#include <locale.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/io/number_conversion.h"
+#include "util/system.h"
+
+
+#define DEFAULT_VALUES          1000000
+#define DEFAULT_REPEAT          3
+#define SHORTEST_SAMPLE_STRIDE  16              // the shortest "%.<n>g" search is slow, only every n-th value is measured
+
+
+static volatile u64 s_sink;                     // keeps the results alive
+
+
+static inline u64 xorshift(u64* state) {
+
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static u64 f64_bits(const f64 value) { u64 bits; memcpy(&bits, &value, sizeof(bits)); return bits; }
+static u32 f32_bits(const f32 value) { u32 bits; memcpy(&bits, &value, sizeof(bits)); return bits; }
+static f64 f64_from_bits(const u64 bits) { f64 value; memcpy(&value, &bits, sizeof(value)); return value; }
+static f32 f32_from_bits(const u32 bits) { f32 value; memcpy(&value, &bits, sizeof(value)); return value; }
+
+// random value, 1 in 8 with a random bit pattern of all exponents, otherwise of a more common magnitude
+static f64 random_f64(u64* state) {
+
+    const u64 bits = xorshift(state);
+    if ((bits & 7) == 0)
+        return f64_from_bits(xorshift(state));
+    return (f64)(i64)(xorshift(state) >> 11) * pow(10.0, (f64)((i32)(bits >> 8) % 40 - 20)) * ((bits & 8) ? -1.0 : 1.0);
+}
+
+static f32 random_f32(u64* state) {
+
+    const u64 bits = xorshift(state);
+    if ((bits & 7) == 0)
+        return f32_from_bits((u32)xorshift(state));
+    return (f32)random_f64(state);
+}
+
+// number of significant digits of a formatted float ("-1.2500e+03" has 5)
+static u32 significant_digits(const char* text) {
+
+    u32 digits = 0, pending_zeros = 0;
+    b8 leading = true;
+    for (; *text && *text != 'e' && *text != 'E'; text++) {
+        if (*text < '0' || *text > '9') continue;
+        if (*text == '0') {
+            if (!leading) pending_zeros++;
+            continue;
+        }
+        leading = false;
+        digits += pending_zeros + 1;
+        pending_zeros = 0;
+    }
+    return digits;
+}
+
+// digits of the shortest "%.<n>g" that parses back to [value]
+static u32 shortest_digits_f64(const f64 value) {
+
+    char buffer[64];
+    for (i32 precision = 1; precision < 17; precision++) {
+        snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+        if (strtod(buffer, NULL) == value) return significant_digits(buffer);
+    }
+    return 17;
+}
+
+static u32 shortest_digits_f32(const f32 value) {
+
+    char buffer[64];
+    for (i32 precision = 1; precision < 9; precision++) {
+        snprintf(buffer, sizeof(buffer), "%.*g", precision, (f64)value);
+        if (strtof(buffer, NULL) == value) return significant_digits(buffer);
+    }
+    return 9;
+}
+
+
+// ============================================================================================================================================
+// round-trip
+// ============================================================================================================================================
+
+typedef struct {
+    u64         values;
+    u64         failures;
+    u64         longer_than_shortest;
+} check_result;
+
+static void report(const char* type, const check_result* result) {
+
+    printf("{\"bench\":\"number_conversion\",\"test\":\"roundtrip\",\"type\":\"%s\",\"values\":%llu,\"failures\":%llu,\"longer_than_shortest\":%llu}\n",
+        type, (unsigned long long)result->values, (unsigned long long)result->failures, (unsigned long long)result->longer_than_shortest);
+    fflush(stdout);
+}
+
+static void fail(check_result* result, const char* type, const char* text, const char* reason) {
+
+    if (result->failures++ < 10)
+        fprintf(stderr, "%s [%s]: %s\n", type, text, reason);
+}
+
+
+static void check_u64(check_result* result, const u64 value) {
+
+    char buffer[NUM_BUFFER_SIZE];
+    const size_t len = num_format_u64(buffer, value);
+    u64 parsed = 0;
+    result->values++;
+    if (num_parse_u64(buffer, len, &parsed) != len || parsed != value || strtoull(buffer, NULL, 10) != value)
+        fail(result, "u64", buffer, "does not round-trip");
+}
+
+static void check_i64(check_result* result, const i64 value) {
+
+    char buffer[NUM_BUFFER_SIZE];
+    const size_t len = num_format_i64(buffer, value);
+    i64 parsed = 0;
+    result->values++;
+    if (num_parse_i64(buffer, len, &parsed) != len || parsed != value || strtoll(buffer, NULL, 10) != value)
+        fail(result, "i64", buffer, "does not round-trip");
+}
+
+static void check_f64(check_result* result, const f64 value, const b8 measure_length) {
+
+    char buffer[NUM_BUFFER_SIZE];
+    const size_t len = num_format_f64(buffer, value);
+    f64 parsed = 0;
+    result->values++;
+    if (num_parse_f64(buffer, len, &parsed) != len) {
+        fail(result, "f64", buffer, "not parsed completely");
+        return;
+    }
+    if (isnan(value)) {
+        if (!isnan(parsed)) fail(result, "f64", buffer, "NaN does not stay NaN");
+        return;
+    }
+    if (f64_bits(parsed) != f64_bits(value))
+        fail(result, "f64", buffer, "does not round-trip");
+    else if (isfinite(value) && f64_bits(strtod(buffer, NULL)) != f64_bits(parsed))
+        fail(result, "f64", buffer, "parsed differently than strtod()");
+
+    if (measure_length && isfinite(value) && value != 0 && significant_digits(buffer) > shortest_digits_f64(value))
+        result->longer_than_shortest++;
+}
+
+static void check_f32(check_result* result, const f32 value, const b8 measure_length) {
+
+    char buffer[NUM_BUFFER_SIZE];
+    const size_t len = num_format_f32(buffer, value);
+    f32 parsed = 0;
+    result->values++;
+    if (num_parse_f32(buffer, len, &parsed) != len) {
+        fail(result, "f32", buffer, "not parsed completely");
+        return;
+    }
+    if (isnan(value)) {
+        if (!isnan(parsed)) fail(result, "f32", buffer, "NaN does not stay NaN");
+        return;
+    }
+    if (f32_bits(parsed) != f32_bits(value))
+        fail(result, "f32", buffer, "does not round-trip");
+    else if (isfinite(value) && f32_bits(strtof(buffer, NULL)) != f32_bits(parsed))
+        fail(result, "f32", buffer, "parsed differently than strtof()");
+
+    if (measure_length && isfinite(value) && value != 0 && significant_digits(buffer) > shortest_digits_f32(value))
+        result->longer_than_shortest++;
+}
+
+// random decimal of 1 to 28 digits with a '.' somewhere and an exponent in [min_exponent, max_exponent), more than 19 digits need
+// the libc fallback if they are close to the middle of two floats
+static void random_decimal(u64* state, char* buffer, const i32 min_exponent, const i32 max_exponent) {
+
+    const u32 digits = 1 + (u32)(xorshift(state) % 28);
+    const u32 dot = (u32)(xorshift(state) % (digits + 1));
+    char* pos = buffer;
+    if (xorshift(state) & 1) *pos++ = '-';
+    for (u32 x = 0; x < digits; x++) {
+        if (x == dot) *pos++ = '.';
+        *pos++ = (char)('0' + xorshift(state) % 10);
+    }
+    sprintf(pos, "e%d", min_exponent + (i32)(xorshift(state) % (u64)(max_exponent - min_exponent)));
+}
+
+// integer exactly in the middle of two doubles / floats, rounded to even by the parser
+static u64 random_halfway(u64* state, const u32 mantissa_bits) {
+
+    // a value in [2^(mantissa_bits - 1 + spacing_bits), 2^(mantissa_bits + spacing_bits)) is a multiple of 2^spacing_bits
+    const u32 spacing_bits = 1 + (u32)(xorshift(state) % (64 - mantissa_bits));
+    const u64 value = ((xorshift(state) | (1ULL << 63)) >> (64 - mantissa_bits - spacing_bits)) & ~((1ULL << spacing_bits) - 1);
+    return value + (1ULL << (spacing_bits - 1));
+}
+
+// decimal text that was not produced by the formatter ("%.17g" of random values, short and long decimals, values in the middle of
+// two floats) has to be parsed like strtod()
+static void check_parse_f64(check_result* result, u64* state) {
+
+    char buffer[64];
+    switch (xorshift(state) % 4) {
+        case 0:     snprintf(buffer, sizeof(buffer), "%.17g", random_f64(state)); break;
+        case 1:     snprintf(buffer, sizeof(buffer), "%lld.%llue%d", (long long)(i64)(xorshift(state) % 2000000) - 1000000,
+                        (unsigned long long)(xorshift(state) % 100000), (i32)(xorshift(state) % 60) - 30); break;
+        case 2:     random_decimal(state, buffer, -360, 330); break;
+        default:    snprintf(buffer, sizeof(buffer), "%llu", (unsigned long long)random_halfway(state, 53)); break;
+    }
+
+    const size_t len = strlen(buffer);
+    f64 parsed = 0;
+    result->values++;
+    if (num_parse_f64(buffer, len, &parsed) != len || f64_bits(parsed) != f64_bits(strtod(buffer, NULL)))
+        fail(result, "parse_f64", buffer, "parsed differently than strtod()");
+}
+
+static void check_parse_f32(check_result* result, u64* state) {
+
+    char buffer[64];
+    switch (xorshift(state) % 3) {
+        case 0:     snprintf(buffer, sizeof(buffer), "%.9g", (f64)random_f32(state)); break;
+        case 1:     random_decimal(state, buffer, -75, 50); break;
+        default:    snprintf(buffer, sizeof(buffer), "%llu", (unsigned long long)random_halfway(state, 24)); break;
+    }
+
+    const size_t len = strlen(buffer);
+    f32 parsed = 0;
+    result->values++;
+    if (num_parse_f32(buffer, len, &parsed) != len || f32_bits(parsed) != f32_bits(strtof(buffer, NULL)))
+        fail(result, "parse_f32", buffer, "parsed differently than strtof()");
+}
+
+
+static b8 check_roundtrip(const u32 count) {
+
+    u64 state = 0x2545F4914F6CDD1DULL;
+    u64 failures = 0;
+
+    check_result result = {0};
+    for (u64 power = 1, x = 0; x < 20; x++, power *= 10) {
+        check_u64(&result, power);
+        check_u64(&result, power - 1);
+        check_u64(&result, power + 1);
+    }
+    check_u64(&result, UINT64_MAX);
+    check_u64(&result, UINT64_MAX - 1);
+    for (u32 x = 0; x < count; x++)
+        check_u64(&result, xorshift(&state) >> (xorshift(&state) % 64));
+    report("u64", &result);
+    failures += result.failures;
+
+    result = (check_result){0};
+    static const i64 i64_edges[] = { 0, 1, -1, 9, -9, 10, -10, INT64_MAX, INT64_MIN, INT64_MAX - 1, INT64_MIN + 1, INT32_MAX, INT32_MIN };
+    for (u32 x = 0; x < sizeof(i64_edges) / sizeof(i64_edges[0]); x++)
+        check_i64(&result, i64_edges[x]);
+    for (u32 x = 0; x < count; x++)
+        check_i64(&result, (i64)(xorshift(&state) >> (xorshift(&state) % 64)) * ((x & 1) ? -1 : 1));
+    report("i64", &result);
+    failures += result.failures;
+
+    result = (check_result){0};
+    static const f64 f64_edges[] = { 0.0, -0.0, 1.0, -1.0, 0.1, 0.2, 0.3, 1.0 / 3.0, 2.5, 1e23, 9007199254740991.0, 9007199254740993.0,
+        5e-324, 2.2250738585072009e-308, DBL_MIN, DBL_MAX, -DBL_MAX, DBL_EPSILON, 1e-7, 1e21, 1e22, 123456789012345678.0, 0.000001,
+        INFINITY, -INFINITY, NAN };
+    for (u32 x = 0; x < sizeof(f64_edges) / sizeof(f64_edges[0]); x++)
+        check_f64(&result, f64_edges[x], true);
+    for (i32 exponent = -1074; exponent <= 1023; exponent++)                // every power of two, the boundaries are asymmetric there
+        check_f64(&result, ldexp(1.0, exponent), false);
+    for (u32 x = 0; x < count; x++)
+        check_f64(&result, random_f64(&state), x % SHORTEST_SAMPLE_STRIDE == 0);
+    report("f64", &result);
+    failures += result.failures;
+
+    result = (check_result){0};
+    static const f32 f32_edges[] = { 0.0f, -0.0f, 1.0f, -1.0f, 0.1f, 0.2f, 0.3f, 1.0f / 3.0f, 16777215.0f, 16777217.0f, 1e-45f, FLT_MIN,
+        FLT_MAX, -FLT_MAX, FLT_EPSILON, 3.4028234e38f, 1e10f, 7.038531e-26f, INFINITY, -INFINITY, NAN };
+    for (u32 x = 0; x < sizeof(f32_edges) / sizeof(f32_edges[0]); x++)
+        check_f32(&result, f32_edges[x], true);
+    for (i32 exponent = -149; exponent <= 127; exponent++)
+        check_f32(&result, ldexpf(1.0f, exponent), false);
+    for (u32 x = 0; x < count; x++)
+        check_f32(&result, random_f32(&state), x % SHORTEST_SAMPLE_STRIDE == 0);
+    report("f32", &result);
+    failures += result.failures;
+
+    result = (check_result){0};
+    for (u32 x = 0; x < count; x++)
+        check_parse_f64(&result, &state);
+    report("parse_f64", &result);
+    failures += result.failures;
+
+    result = (check_result){0};
+    for (u32 x = 0; x < count; x++)
+        check_parse_f32(&result, &state);
+    report("parse_f32", &result);
+    failures += result.failures;
+
+    return failures == 0;
+}
+
+
+// ============================================================================================================================================
+// speed
+// ============================================================================================================================================
+
+typedef enum {
+    TYPE_U64 = 0,
+    TYPE_I64,
+    TYPE_F64,
+    TYPE_F32,
+    TYPE_COUNT,
+} value_type;
+
+static const char* s_type_names[TYPE_COUNT] = { "u64", "i64", "f64", "f32" };
+
+typedef union {
+    u64         u;
+    i64         i;
+    f64         d;
+    f32         f;
+} value;
+
+// formats [values] into [texts] (NUM_BUFFER_SIZE per value)
+static void format_values(const value_type type, const b8 use_libc, const value* values, const u32 count, char* texts) {
+
+    for (u32 x = 0; x < count; x++) {
+        char* text = texts + (size_t)x * NUM_BUFFER_SIZE;
+        switch (type) {
+            case TYPE_U64:  use_libc ? snprintf(text, NUM_BUFFER_SIZE, "%llu", (unsigned long long)values[x].u) : (int)num_format_u64(text, values[x].u); break;
+            case TYPE_I64:  use_libc ? snprintf(text, NUM_BUFFER_SIZE, "%lld", (long long)values[x].i) : (int)num_format_i64(text, values[x].i); break;
+            case TYPE_F64:  use_libc ? snprintf(text, NUM_BUFFER_SIZE, "%.17g", values[x].d) : (int)num_format_f64(text, values[x].d); break;
+            default:        use_libc ? snprintf(text, NUM_BUFFER_SIZE, "%.9g", (f64)values[x].f) : (int)num_format_f32(text, values[x].f); break;
+        }
+    }
+}
+
+static u64 parse_values(const value_type type, const b8 use_libc, const char* texts, const u32 count) {
+
+    u64 sum = 0;
+    for (u32 x = 0; x < count; x++) {
+        const char* text = texts + (size_t)x * NUM_BUFFER_SIZE;
+        value parsed = {0};
+        if (use_libc) {
+            switch (type) {
+                case TYPE_U64:  parsed.u = strtoull(text, NULL, 10); break;
+                case TYPE_I64:  parsed.i = strtoll(text, NULL, 10); break;
+                case TYPE_F64:  parsed.d = strtod(text, NULL); break;
+                default:        parsed.f = strtof(text, NULL); break;
+            }
+        } else {
+            const size_t len = strlen(text);                        // the serializer knows the length, strtod() has to search the end too
+            switch (type) {
+                case TYPE_U64:  num_parse_u64(text, len, &parsed.u); break;
+                case TYPE_I64:  num_parse_i64(text, len, &parsed.i); break;
+                case TYPE_F64:  num_parse_f64(text, len, &parsed.d); break;
+                default:        num_parse_f32(text, len, &parsed.f); break;
+            }
+        }
+        sum += parsed.u;
+    }
+    return sum;
+}
+
+static void print_speed(const char* test, const value_type type, const char* impl, const f64 seconds_per_value) {
+
+    printf("{\"bench\":\"number_conversion\",\"test\":\"%s\",\"type\":\"%s\",\"impl\":\"%s\",\"ns_per_value\":%.1f}\n",
+        test, s_type_names[type], impl, seconds_per_value * 1e9);
+}
+
+static void bench_speed(const u32 count, const u32 repeat) {
+
+    value* values = malloc(sizeof(value) * count);
+    char* texts = malloc((size_t)count * NUM_BUFFER_SIZE);
+    if (!values || !texts) {
+        fprintf(stderr, "out of memory\n");
+        free(values);
+        free(texts);
+        return;
+    }
+
+    u64 state = 0x9E3779B97F4A7C15ULL;
+    for (u32 type = 0; type < TYPE_COUNT; type++) {
+
+        // values like the ones in project files: counters, ids, ratings, progress
+        for (u32 x = 0; x < count; x++) {
+            switch (type) {
+                case TYPE_U64:  values[x].u = xorshift(&state) >> (xorshift(&state) % 64); break;
+                case TYPE_I64:  values[x].i = (i64)(xorshift(&state) >> (xorshift(&state) % 64)) * ((x & 1) ? -1 : 1); break;
+                case TYPE_F64:  values[x].d = random_f64(&state); break;
+                default:        values[x].f = random_f32(&state); break;
+            }
+        }
+
+        for (u32 use_libc = 0; use_libc < 2; use_libc++) {
+            const char* impl = use_libc ? "libc" : "num";
+            f64 best_format = 0, best_parse = 0;
+            for (u32 r = 0; r < repeat; r++) {
+                f64 start = get_precise_time();
+                format_values(type, use_libc, values, count, texts);
+                f64 seconds = get_precise_time() - start;
+                best_format = (r == 0 || seconds < best_format) ? seconds : best_format;
+
+                start = get_precise_time();
+                s_sink += parse_values(type, use_libc, texts, count);
+                seconds = get_precise_time() - start;
+                best_parse = (r == 0 || seconds < best_parse) ? seconds : best_parse;
+            }
+            print_speed("format", type, impl, best_format / count);
+            print_speed("parse", type, impl, best_parse / count);
+            fflush(stdout);
+        }
+    }
+    free(values);
+    free(texts);
+}
+
+
+int main(int argc, char* argv[]) {
+
+    u32 count = DEFAULT_VALUES;
+    u32 repeat = DEFAULT_REPEAT;
+    for (int x = 1; x < argc; x++) {
+        if (strcmp(argv[x], "--values") == 0 && x + 1 < argc)
+            count = (u32)strtoul(argv[++x], NULL, 10);
+        else if (strcmp(argv[x], "--repeat") == 0 && x + 1 < argc)
+            repeat = (u32)atoi(argv[++x]);
+        else {
+            fprintf(stderr, "usage: %s [--values %d] [--repeat %d]\n", argv[0], DEFAULT_VALUES, DEFAULT_REPEAT);
+            return EXIT_FAILURE;
+        }
+    }
+    if (repeat == 0) repeat = 1;
+    if (count == 0) count = 1;
+
+    setlocale(LC_NUMERIC, "C");                                     // the libc side in the "C" locale, like the serializer used it
+    const b8 passed = check_roundtrip(count);
+    bench_speed(count, repeat);
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,423 @@
+
+// Benchmark of the YAML serializer (util/io/serializer_yaml.c) on synthetic project_data.yml files.
+//
+// usage:   bench_serializer [--sizes 1000,10000,100000,1000000] [--repeat 3] [--dir <path>]
+//
+// Every size runs in its own process so [peak_rss_kb] belongs to that size only. Results are printed to stdout as one
+// JSON object per line, e.g.
+//   {"bench":"serializer","entries":1000,"phase":"save","op":"sy_loop_fields","seconds":0.0123,"bytes":254321,
+//    "mb_per_s":19.72,"entries_per_s":81300.8,"allocations":1234,"allocated_bytes":567890,"peak_rss_kb":5120,"verified":true}
+// [seconds] is the fastest of [--repeat] runs, allocations are counted for that run (only with BENCH_COUNT_ALLOCATIONS).
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "util/io/logger.h"
+#include "util/io/serializer_yaml.h"
+#include "util/system.h"
+#include "dashboard/visual_novel.h"
+
+
+#define DEFAULT_SIZES           "1000,10000,100000,1000000"
+#define DEFAULT_REPEAT          3
+#define MAX_SIZES               16
+#define SETTINGS_ENTRY_COUNT    16
+#define SUBSECTION_DEPTH        3
+
+
+// ============================================================================================================================================
+// allocation counting
+// ============================================================================================================================================
+
+// the build wraps the allocator of all project code with -Wl,--wrap (see CMakeLists.txt), allocations inside libc are not counted
+static u64 s_allocations = 0;
+static u64 s_allocated_bytes = 0;
+
+#if defined(BENCH_COUNT_ALLOCATIONS)
+
+    void* __real_malloc(size_t size);
+    void* __real_calloc(size_t count, size_t size);
+    void* __real_realloc(void* ptr, size_t size);
+
+    void* __wrap_malloc(size_t size)                { s_allocations++; s_allocated_bytes += size; return __real_malloc(size); }
+    void* __wrap_calloc(size_t count, size_t size)  { s_allocations++; s_allocated_bytes += count * size; return __real_calloc(count, size); }
+    void* __wrap_realloc(void* ptr, size_t size)    { s_allocations++; s_allocated_bytes += size; return __real_realloc(ptr, size); }
+
+    #define ALLOCATIONS_COUNTED     true
+#else
+    #define ALLOCATIONS_COUNTED     false
+#endif
+
+
+// ============================================================================================================================================
+// synthetic data
+// ============================================================================================================================================
+
+// entries are generated on access and checked on append instead of being stored, 1M [visual_novel] would need ~9 GB
+typedef struct {
+    u64             count;          // entries the accessor provides
+    u64             loaded;         // entries received by the append callback
+    b8              valid;          // every loaded entry matched the generated one
+} synthetic_library;
+
+
+static inline u64 mix(u64 value) {
+
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    return value;
+}
+
+static void generate_entry(const u64 index, visual_novel* vn) {
+
+    const u64 random = mix(index + 1);
+    memset(vn, 0, sizeof(*vn));
+    snprintf(vn->name, sizeof(vn->name), "Synthetic Visual Novel %llu: Volume %llu", (unsigned long long)index, (unsigned long long)(random % 12));
+    snprintf(vn->link, sizeof(vn->link), "https://example.com/novels/%llu/%016llx", (unsigned long long)index, (unsigned long long)random);
+    snprintf(vn->image_path, sizeof(vn->image_path), "/images/covers/%llu.png", (unsigned long long)index);
+    vn->chapters_total = (u16)(random % 500);
+    vn->chapters_read = (u16)((random >> 16) % (vn->chapters_total + 1u));
+    vn->rating = (u8)((random >> 32) % 11);
+    vn->disc_reason = (discontinue_reason)((random >> 40) % DR_COUNT);
+    vn->flags_lo = mix(random);
+    vn->flags_hi = mix(random + 1) & ((1ULL << (GT_HI_COUNT)) - 1);
+}
+
+static i32 synthetic_get(void* data_structure, const u64 index, void* element) {
+
+    if (index >= ((synthetic_library*)data_structure)->count) return AT_RANGE_ERROR;
+    generate_entry(index, (visual_novel*)element);
+    return AT_SUCCESS;
+}
+
+static i32 synthetic_append(void* data_structure, void* element) {
+
+    synthetic_library* library = (synthetic_library*)data_structure;
+    visual_novel expected;
+    generate_entry(library->loaded++, &expected);
+    if (memcmp(&expected, element, sizeof(expected)) != 0)
+        library->valid = false;
+    return AT_SUCCESS;
+}
+
+static size_t synthetic_size(void* data_structure) { return (size_t)((synthetic_library*)data_structure)->count; }
+
+// per field callback for sy_loop(), the way most callers still serialize their structs
+static bool visual_novel_callback(SY* serializer, void* element) {
+
+    visual_novel* vn = (visual_novel*)element;
+    sy_entry_str(serializer, "name", vn->name, sizeof(vn->name));
+    sy_entry_str(serializer, "link", vn->link, sizeof(vn->link));
+    sy_entry_str(serializer, "image_path", vn->image_path, sizeof(vn->image_path));
+    sy_entry(serializer, "chapters_total", &vn->chapters_total, SY_TYPE_U16);
+    sy_entry(serializer, "chapters_read", &vn->chapters_read, SY_TYPE_U16);
+    sy_entry(serializer, "rating", &vn->rating, SY_TYPE_U8);
+    sy_entry(serializer, "disc_reason", &vn->disc_reason, SY_TYPE_U32);
+    sy_entry(serializer, "flags_lo", &vn->flags_lo, SY_TYPE_U64);
+    sy_entry(serializer, "flags_hi", &vn->flags_hi, SY_TYPE_U64);
+    return true;
+}
+
+
+// ============================================================================================================================================
+// measurement
+// ============================================================================================================================================
+
+typedef enum {
+    OP_INIT = 0,
+    OP_ENTRY,
+    OP_SUBSECTION,
+    OP_LOOP_FIELDS,
+    OP_LOOP_CALLBACK,
+    OP_SHUTDOWN,
+    OP_COUNT,
+} bench_op;
+
+static const char* const s_op_names[OP_COUNT] = { "sy_init", "sy_entry", "sy_subsection", "sy_loop_fields", "sy_loop", "sy_shutdown" };
+
+typedef struct {
+    f64             seconds;
+    u64             allocations;
+    u64             allocated_bytes;
+    b8              measured;
+} op_result;
+
+typedef struct {
+    f64             start;
+    u64             allocations;
+    u64             allocated_bytes;
+} op_timer;
+
+
+static inline void timer_start(op_timer* timer) {
+
+    timer->allocations = s_allocations;
+    timer->allocated_bytes = s_allocated_bytes;
+    timer->start = get_precise_time();
+}
+
+// keeps the fastest run of every operation
+static inline void timer_stop(const op_timer* timer, op_result* result) {
+
+    const f64 seconds = get_precise_time() - timer->start;
+    if (result->measured && seconds >= result->seconds)
+        return;
+
+    result->seconds = seconds;
+    result->allocations = s_allocations - timer->allocations;
+    result->allocated_bytes = s_allocated_bytes - timer->allocated_bytes;
+    result->measured = true;
+}
+
+
+static u64 get_peak_rss_kb(void) {
+
+    struct rusage usage;
+    return (getrusage(RUSAGE_SELF, &usage) == 0) ? (u64)usage.ru_maxrss : 0;
+}
+
+static u64 get_file_size(const char* path) {
+
+    struct stat file_stat;
+    return (stat(path, &file_stat) == 0) ? (u64)file_stat.st_size : 0;
+}
+
+
+static void print_result(const u64 entries, const char* phase, const bench_op op, const op_result* result, const u64 bytes, const b8 verified) {
+
+    if (!result->measured) return;
+
+    const f64 seconds = (result->seconds > 0) ? result->seconds : 1e-9;
+    const b8 per_entry = (op == OP_LOOP_FIELDS || op == OP_LOOP_CALLBACK);
+    printf("{\"bench\":\"serializer\",\"entries\":%llu,\"phase\":\"%s\",\"op\":\"%s\",\"seconds\":%.6f,\"bytes\":%llu,\"mb_per_s\":%.2f,\"entries_per_s\":%.1f,",
+        (unsigned long long)entries, phase, s_op_names[op], result->seconds, (unsigned long long)bytes,
+        per_entry ? (f64)bytes / seconds / (1024.0 * 1024.0) : 0.0, per_entry ? (f64)entries / seconds : 0.0);
+    if (ALLOCATIONS_COUNTED)
+        printf("\"allocations\":%llu,\"allocated_bytes\":%llu,", (unsigned long long)result->allocations, (unsigned long long)result->allocated_bytes);
+    else
+        printf("\"allocations\":null,\"allocated_bytes\":null,");
+    printf("\"peak_rss_kb\":%llu,\"verified\":%s}\n", (unsigned long long)get_peak_rss_kb(), verified ? "true" : "false");
+    fflush(stdout);
+}
+
+
+// ============================================================================================================================================
+// benchmark
+// ============================================================================================================================================
+
+// settings with nested subsections as in the real project_data.yml, followed by the library sequence
+static void run_save(const char* dir, const char* file_name, synthetic_library* library, const b8 use_callback, op_result* results) {
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", dir, file_name);
+    unlink(path);
+
+    op_timer timer;
+    SY sy = {0};
+    timer_start(&timer);
+    const b8 initialized = sy_init(&sy, dir, file_name, "general_data", SERIALIZER_OPTION_SAVE);
+    timer_stop(&timer, &results[OP_INIT]);
+    if (!initialized) return;
+
+    timer_start(&timer);
+    for (u32 x = 0; x < SETTINGS_ENTRY_COUNT; x++) {
+        char key[32];
+        snprintf(key, sizeof(key), "setting_%02u", x);
+        f64 value = x * 1.25;
+        sy_entry(&sy, key, &value, SY_TYPE_F64);
+    }
+    timer_stop(&timer, &results[OP_ENTRY]);
+
+    timer_start(&timer);
+    for (u32 depth = 0; depth < SUBSECTION_DEPTH; depth++) {
+        char name[32];
+        snprintf(name, sizeof(name), "nested_%u", depth);
+        sy_subsection_begin(&sy, name);
+        u32 value = depth;
+        sy_entry(&sy, "depth", &value, SY_TYPE_U32);
+    }
+    for (u32 depth = 0; depth < SUBSECTION_DEPTH; depth++)
+        sy_subsection_end(&sy);
+    timer_stop(&timer, &results[OP_SUBSECTION]);
+
+    timer_start(&timer);
+    if (use_callback)
+        sy_loop(&sy, "visual_novels", library, sizeof(visual_novel), visual_novel_callback, synthetic_get, synthetic_append, synthetic_size);
+    else
+        sy_loop_fields(&sy, "visual_novels", library, sizeof(visual_novel), visual_novel_fields, SY_FIELD_COUNT(visual_novel_fields), synthetic_get, synthetic_append, synthetic_size);
+    timer_stop(&timer, &results[use_callback ? OP_LOOP_CALLBACK : OP_LOOP_FIELDS]);
+
+    timer_start(&timer);
+    sy_shutdown(&sy);
+    timer_stop(&timer, &results[OP_SHUTDOWN]);
+}
+
+
+static b8 run_load(const char* dir, const char* file_name, synthetic_library* library, const b8 use_callback, op_result* results) {
+
+    op_timer timer;
+    SY sy = {0};
+    timer_start(&timer);
+    const b8 initialized = sy_init(&sy, dir, file_name, "general_data", SERIALIZER_OPTION_LOAD);
+    timer_stop(&timer, &results[OP_INIT]);
+    if (!initialized) return false;
+
+    b8 valid = true;
+    timer_start(&timer);
+    for (u32 x = 0; x < SETTINGS_ENTRY_COUNT; x++) {
+        char key[32];
+        snprintf(key, sizeof(key), "setting_%02u", x);
+        f64 value = 0;
+        sy_entry(&sy, key, &value, SY_TYPE_F64);
+        valid &= (value == x * 1.25);
+    }
+    timer_stop(&timer, &results[OP_ENTRY]);
+
+    timer_start(&timer);
+    for (u32 depth = 0; depth < SUBSECTION_DEPTH; depth++) {
+        char name[32];
+        snprintf(name, sizeof(name), "nested_%u", depth);
+        sy_subsection_begin(&sy, name);
+        u32 value = UINT32_MAX;
+        sy_entry(&sy, "depth", &value, SY_TYPE_U32);
+        valid &= (value == depth);
+    }
+    for (u32 depth = 0; depth < SUBSECTION_DEPTH; depth++)
+        sy_subsection_end(&sy);
+    timer_stop(&timer, &results[OP_SUBSECTION]);
+
+    library->loaded = 0;
+    library->valid = true;
+    timer_start(&timer);
+    if (use_callback)
+        sy_loop(&sy, "visual_novels", library, sizeof(visual_novel), visual_novel_callback, synthetic_get, synthetic_append, synthetic_size);
+    else
+        sy_loop_fields(&sy, "visual_novels", library, sizeof(visual_novel), visual_novel_fields, SY_FIELD_COUNT(visual_novel_fields), synthetic_get, synthetic_append, synthetic_size);
+    timer_stop(&timer, &results[use_callback ? OP_LOOP_CALLBACK : OP_LOOP_FIELDS]);
+
+    timer_start(&timer);
+    sy_shutdown(&sy);
+    timer_stop(&timer, &results[OP_SHUTDOWN]);
+
+    return valid && library->valid && library->loaded == library->count;
+}
+
+
+static void run_size(const char* dir, const u64 entries, const u32 repeat) {
+
+    synthetic_library library = { .count = entries, .valid = true };
+    char file_name[64];
+
+    for (u32 variant = 0; variant < 2; variant++) {                 // 0: field table, 1: per field callback
+
+        const b8 use_callback = (variant == 1);
+        snprintf(file_name, sizeof(file_name), "bench_%llu_%s.yml", (unsigned long long)entries, use_callback ? "callback" : "fields");
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s", dir, file_name);
+
+        op_result save[OP_COUNT] = {0};
+        op_result load[OP_COUNT] = {0};
+        b8 verified = true;
+        for (u32 x = 0; x < repeat; x++) {
+            run_save(dir, file_name, &library, use_callback, save);
+            verified &= run_load(dir, file_name, &library, use_callback, load);
+        }
+
+        const u64 bytes = get_file_size(path);
+        for (u32 op = 0; op < OP_COUNT; op++) {
+            if (use_callback && op != OP_LOOP_CALLBACK) continue;  // the other operations do not depend on the variant
+            print_result(entries, "save", (bench_op)op, &save[op], bytes, true);
+            print_result(entries, "load", (bench_op)op, &load[op], bytes, verified);
+        }
+        unlink(path);
+    }
+}
+
+
+// the logger runs a background thread that does not survive fork(), so every process starts its own
+static int run_process(const char* dir, const u64 entries, const u32 repeat) {
+
+    logger_init("[$L] $C", false, "logs", "bench_serializer", false);
+    if (!system_ensure_directory_exists(dir)) {
+        fprintf(stderr, "failed to create [%s]: %s\n", dir, strerror(errno));
+        logger_shutdown();
+        return EXIT_FAILURE;
+    }
+
+    run_size(dir, entries, repeat);
+    logger_shutdown();
+    return EXIT_SUCCESS;
+}
+
+
+static u32 parse_sizes(const char* list, u64* sizes) {
+
+    u32 count = 0;
+    const char* pos = list;
+    while (*pos && count < MAX_SIZES) {
+        char* end = NULL;
+        const unsigned long long value = strtoull(pos, &end, 10);
+        if (end == pos) break;
+        if (value > 0)
+            sizes[count++] = (u64)value;
+        pos = (*end == ',') ? end + 1 : end;
+    }
+    return count;
+}
+
+
+int main(int argc, char* argv[]) {
+
+    const char* size_list = DEFAULT_SIZES;
+    u32 repeat = DEFAULT_REPEAT;
+    const char* dir = "bench_data";
+    for (int x = 1; x < argc; x++) {
+        if (strcmp(argv[x], "--sizes") == 0 && x + 1 < argc)
+            size_list = argv[++x];
+        else if (strcmp(argv[x], "--repeat") == 0 && x + 1 < argc)
+            repeat = (u32)atoi(argv[++x]);
+        else if (strcmp(argv[x], "--dir") == 0 && x + 1 < argc)
+            dir = argv[++x];
+        else {
+            fprintf(stderr, "usage: %s [--sizes " DEFAULT_SIZES "] [--repeat %d] [--dir <path>]\n", argv[0], DEFAULT_REPEAT);
+            return EXIT_FAILURE;
+        }
+    }
+    if (repeat == 0) repeat = 1;
+
+    u64 sizes[MAX_SIZES];
+    const u32 size_count = parse_sizes(size_list, sizes);
+    if (size_count == 0) {
+        fprintf(stderr, "no valid size in [%s]\n", size_list);
+        return EXIT_FAILURE;
+    }
+
+    int exit_code = EXIT_SUCCESS;
+    for (u32 x = 0; x < size_count; x++) {
+
+        fflush(stdout);
+        const pid_t pid = fork();                                   // separate process per size for a meaningful peak RSS
+        if (pid == 0) {
+            const int child_exit_code = run_process(dir, sizes[x], repeat);
+            fflush(stdout);
+            _exit(child_exit_code);
+        }
+
+        int status = 0;
+        if (pid < 0) {
+            exit_code = run_process(dir, sizes[x], repeat);
+        } else if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+            fprintf(stderr, "benchmark for [%llu] entries failed\n", (unsigned long long)sizes[x]);
+            exit_code = EXIT_FAILURE;
+        }
+    }
+
+    return exit_code;
+}
@@ -0,0 +1,373 @@
+
+// Benchmark of the hash map (util/data_structure/unordered_map.c) against the chained map it replaced.
+//
+// usage:   bench_unordered_map [--sizes 1000,100000,1000000] [--repeat 3]
+//
+// Keys are owned by the benchmark and stored by pointer, as in the real callers. Results are printed to stdout as one
+// JSON object per line, e.g.
+//   {"bench":"unordered_map","map":"open_addressing","keys":"string","entries":100000,"op":"find_hit","ns_per_op":95.3,
+//    "table_bytes":3670032,"verified":true}
+// [ns_per_op] is the fastest of [--repeat] runs, [table_bytes] is the memory of the map without the keys.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/data_structure/unordered_map.h"
+#include "util/system.h"
+
+
+#define DEFAULT_SIZES           "1000,100000,1000000"
+#define DEFAULT_REPEAT          3
+#define MAX_SIZES               16
+#define STRING_KEY_SIZE         32
+#define FIND_ROUNDS             4               // lookups per entry for [find_hit]
+
+
+// ============================================================================================================================================
+// chained map (the previous implementation, for comparison)
+// ============================================================================================================================================
+
+typedef struct chained_node {
+    void*                   key;
+    void*                   value;
+    struct chained_node*    next;
+} chained_node;
+
+typedef struct {
+    chained_node**          buckets;
+    size_t                  size;
+    size_t                  cap;
+    hash_func               hash_fn;
+    key_compare_func        key_cmp_fn;
+} chained_map;
+
+
+static b8 chained_init(chained_map* map, const size_t capacity, hash_func hash_fn, key_compare_func key_cmp_fn) {
+
+    *map = (chained_map){ .buckets = calloc(capacity, sizeof(chained_node*)), .cap = capacity, .hash_fn = hash_fn, .key_cmp_fn = key_cmp_fn };
+    return map->buckets != NULL;
+}
+
+static void chained_free(chained_map* map) {
+
+    for (size_t x = 0; x < map->cap; x++) {
+        chained_node* current = map->buckets[x];
+        while (current) {
+            chained_node* next = current->next;
+            free(current);
+            current = next;
+        }
+    }
+    free(map->buckets);
+}
+
+static b8 chained_resize(chained_map* map) {
+
+    const size_t new_capacity = map->cap * 2;
+    chained_node** new_buckets = calloc(new_capacity, sizeof(chained_node*));
+    if (!new_buckets) return false;
+
+    for (size_t x = 0; x < map->cap; x++) {
+        chained_node* current = map->buckets[x];
+        while (current) {
+            chained_node* next = current->next;
+            const size_t index = map->hash_fn(current->key) % new_capacity;
+            current->next = new_buckets[index];
+            new_buckets[index] = current;
+            current = next;
+        }
+    }
+    free(map->buckets);
+    map->buckets = new_buckets;
+    map->cap = new_capacity;
+    return true;
+}
+
+static b8 chained_insert(chained_map* map, void* key, void* value) {
+
+    if ((double)map->size / map->cap > 0.75 && !chained_resize(map)) return false;
+
+    const size_t index = map->hash_fn(key) % map->cap;
+    for (chained_node* current = map->buckets[index]; current; current = current->next) {
+        if (map->key_cmp_fn(current->key, key) == 0) {
+            current->value = value;
+            return true;
+        }
+    }
+
+    chained_node* node = malloc(sizeof(chained_node));
+    if (!node) return false;
+    *node = (chained_node){ key, value, map->buckets[index] };
+    map->buckets[index] = node;
+    map->size++;
+    return true;
+}
+
+static b8 chained_find(const chained_map* map, const void* key, void** value) {
+
+    for (chained_node* current = map->buckets[map->hash_fn(key) % map->cap]; current; current = current->next) {
+        if (map->key_cmp_fn(current->key, key) == 0) {
+            *value = current->value;
+            return true;
+        }
+    }
+    return false;
+}
+
+static b8 chained_erase(chained_map* map, const void* key) {
+
+    chained_node** link = &map->buckets[map->hash_fn(key) % map->cap];
+    for (; *link; link = &(*link)->next) {
+        if (map->key_cmp_fn((*link)->key, key) == 0) {
+            chained_node* node = *link;
+            *link = node->next;
+            free(node);
+            map->size--;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// ============================================================================================================================================
+// maps under test
+// ============================================================================================================================================
+
+typedef enum {
+    MAP_OPEN_ADDRESSING = 0,
+    MAP_CHAINED,
+    MAP_COUNT,
+} map_kind;
+
+typedef enum {
+    OP_INSERT = 0,
+    OP_FIND_HIT,
+    OP_FIND_MISS,
+    OP_ERASE,
+    OP_COUNT,
+} bench_op;
+
+static const char* s_map_names[MAP_COUNT] = { "open_addressing", "chained" };
+static const char* s_op_names[OP_COUNT] = { "insert", "find_hit", "find_miss", "erase" };
+
+typedef struct {
+    map_kind                kind;
+    unordered_map           open;
+    chained_map             chained;
+} bench_map;
+
+
+static b8 map_init(bench_map* map, const map_kind kind, const b8 string_keys) {
+
+    memset(map, 0, sizeof(*map));
+    map->kind = kind;
+    const hash_func hash_fn = string_keys ? string_hash : u64_hash;
+    const key_compare_func key_cmp_fn = string_keys ? string_compare : u64_compare;
+    if (kind == MAP_CHAINED)
+        return chained_init(&map->chained, 16, hash_fn, key_cmp_fn);
+    return u_map_init(&map->open, 16, hash_fn, key_cmp_fn) == AT_SUCCESS;
+}
+
+static void map_free(bench_map* map) {
+
+    if (map->kind == MAP_CHAINED)
+        chained_free(&map->chained);
+    else
+        u_map_free(&map->open);
+}
+
+static inline b8 map_insert(bench_map* map, void* key, void* value) {
+
+    return (map->kind == MAP_CHAINED) ? chained_insert(&map->chained, key, value) : u_map_insert(&map->open, key, value) == AT_SUCCESS;
+}
+
+static inline b8 map_find(bench_map* map, const void* key, void** value) {
+
+    return (map->kind == MAP_CHAINED) ? chained_find(&map->chained, key, value) : u_map_find(&map->open, key, value) == AT_SUCCESS;
+}
+
+static inline b8 map_erase(bench_map* map, const void* key) {
+
+    return (map->kind == MAP_CHAINED) ? chained_erase(&map->chained, key) : u_map_erase(&map->open, key) == AT_SUCCESS;
+}
+
+static u64 map_table_bytes(const bench_map* map) {
+
+    if (map->kind == MAP_CHAINED)
+        return map->chained.cap * sizeof(chained_node*) + map->chained.size * sizeof(chained_node);
+    return map->open.cap * (sizeof(u_map_slot) + 1) + U_MAP_GROUP_WIDTH;
+}
+
+
+// ============================================================================================================================================
+// benchmark
+// ============================================================================================================================================
+
+// the first [entries] keys are inserted, the second half is only used for lookups that miss
+typedef struct {
+    u64*                    numbers;
+    char                    (*strings)[STRING_KEY_SIZE];
+    u64                     count;
+} key_set;
+
+
+static inline u64 mix(u64 value) {
+
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    return value;
+}
+
+static b8 key_set_create(key_set* keys, const u64 entries) {
+
+    keys->count = entries * 2;
+    keys->numbers = malloc(keys->count * sizeof(u64));
+    keys->strings = malloc(keys->count * STRING_KEY_SIZE);
+    if (!keys->numbers || !keys->strings) return false;
+
+    for (u64 x = 0; x < keys->count; x++) {
+        keys->numbers[x] = mix(x + 1);
+        snprintf(keys->strings[x], STRING_KEY_SIZE, "vn_%016llx", (unsigned long long)keys->numbers[x]);
+    }
+    return true;
+}
+
+static void key_set_free(key_set* keys) {
+
+    free(keys->numbers);
+    free(keys->strings);
+}
+
+static inline void* key_at(const key_set* keys, const b8 string_keys, const u64 index) {
+
+    return string_keys ? (void*)keys->strings[index] : (void*)&keys->numbers[index];
+}
+
+
+// @return false if the map returned a wrong result
+static b8 run_once(const map_kind kind, const b8 string_keys, const key_set* keys, const u64 entries, f64* seconds, u64* table_bytes) {
+
+    bench_map map;
+    if (!map_init(&map, kind, string_keys)) return false;
+
+    b8 valid = true;
+    f64 start = get_precise_time();
+    for (u64 x = 0; x < entries; x++)
+        valid &= map_insert(&map, key_at(keys, string_keys, x), (void*)(uintptr_t)(x + 1));
+    seconds[OP_INSERT] = (get_precise_time() - start) / (f64)entries;
+    *table_bytes = map_table_bytes(&map);
+
+    start = get_precise_time();
+    for (u64 round = 0; round < FIND_ROUNDS; round++) {
+        for (u64 x = 0; x < entries; x++) {
+            const u64 index = (x * 7919 + round) % entries;             // not in insertion order
+            void* value = NULL;
+            valid &= map_find(&map, key_at(keys, string_keys, index), &value) && value == (void*)(uintptr_t)(index + 1);
+        }
+    }
+    seconds[OP_FIND_HIT] = (get_precise_time() - start) / (f64)(entries * FIND_ROUNDS);
+
+    start = get_precise_time();
+    for (u64 x = entries; x < 2 * entries; x++) {
+        void* value = NULL;
+        valid &= !map_find(&map, key_at(keys, string_keys, x), &value);
+    }
+    seconds[OP_FIND_MISS] = (get_precise_time() - start) / (f64)entries;
+
+    start = get_precise_time();
+    for (u64 x = 0; x < entries; x++)
+        valid &= map_erase(&map, key_at(keys, string_keys, x));
+    seconds[OP_ERASE] = (get_precise_time() - start) / (f64)entries;
+
+    map_free(&map);
+    return valid;
+}
+
+
+static b8 run_size(const u64 entries, const u32 repeat) {
+
+    key_set keys = {0};
+    if (!key_set_create(&keys, entries)) {
+        key_set_free(&keys);
+        fprintf(stderr, "failed to allocate keys for [%llu] entries\n", (unsigned long long)entries);
+        return false;
+    }
+
+    b8 all_valid = true;
+    for (u32 key_type = 0; key_type < 2; key_type++) {
+        const b8 string_keys = (key_type == 1);
+        for (u32 kind = 0; kind < MAP_COUNT; kind++) {
+
+            f64 best[OP_COUNT];
+            u64 table_bytes = 0;
+            b8 verified = true;
+            for (u32 x = 0; x < repeat; x++) {
+                f64 seconds[OP_COUNT];
+                verified &= run_once((map_kind)kind, string_keys, &keys, entries, seconds, &table_bytes);
+                for (u32 op = 0; op < OP_COUNT; op++)
+                    best[op] = (x == 0 || seconds[op] < best[op]) ? seconds[op] : best[op];
+            }
+
+            for (u32 op = 0; op < OP_COUNT; op++)
+                printf("{\"bench\":\"unordered_map\",\"map\":\"%s\",\"keys\":\"%s\",\"entries\":%llu,\"op\":\"%s\",\"ns_per_op\":%.1f,\"table_bytes\":%llu,\"verified\":%s}\n",
+                    s_map_names[kind], string_keys ? "string" : "u64", (unsigned long long)entries, s_op_names[op], best[op] * 1e9,
+                    (unsigned long long)table_bytes, verified ? "true" : "false");
+            fflush(stdout);
+            all_valid &= verified;
+        }
+    }
+
+    key_set_free(&keys);
+    return all_valid;
+}
+
+
+static u32 parse_sizes(const char* list, u64* sizes) {
+
+    u32 count = 0;
+    const char* pos = list;
+    while (*pos && count < MAX_SIZES) {
+        char* end = NULL;
+        const unsigned long long value = strtoull(pos, &end, 10);
+        if (end == pos) break;
+        if (value > 0)
+            sizes[count++] = (u64)value;
+        pos = (*end == ',') ? end + 1 : end;
+    }
+    return count;
+}
+
+
+int main(int argc, char* argv[]) {
+
+    const char* size_list = DEFAULT_SIZES;
+    u32 repeat = DEFAULT_REPEAT;
+    for (int x = 1; x < argc; x++) {
+        if (strcmp(argv[x], "--sizes") == 0 && x + 1 < argc)
+            size_list = argv[++x];
+        else if (strcmp(argv[x], "--repeat") == 0 && x + 1 < argc)
+            repeat = (u32)atoi(argv[++x]);
+        else {
+            fprintf(stderr, "usage: %s [--sizes " DEFAULT_SIZES "] [--repeat %d]\n", argv[0], DEFAULT_REPEAT);
+            return EXIT_FAILURE;
+        }
+    }
+    if (repeat == 0) repeat = 1;
+
+    u64 sizes[MAX_SIZES];
+    const u32 size_count = parse_sizes(size_list, sizes);
+    if (size_count == 0) {
+        fprintf(stderr, "no valid size in [%s]\n", size_list);
+        return EXIT_FAILURE;
+    }
+
+    int exit_code = EXIT_SUCCESS;
+    for (u32 x = 0; x < size_count; x++)
+        if (!run_size(sizes[x], repeat))
+            exit_code = EXIT_FAILURE;
+    return exit_code;
+}
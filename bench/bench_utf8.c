@@ -0,0 +1,347 @@
+// Check and benchmark of the UTF-8 validation (util/io/utf8.c). utf8_valid_length() uses the SSSE3 lookup algorithm for inputs
+// of 16 bytes and more and finishes with the scalar check, utf8_repair() builds on it. Both are compared with a byte wise
+// reference that decodes every code point and checks its range.
+//
+// usage:   bench_utf8 [--cases 200000] [--bytes 16777216] [--repeat 3]
+//
+// Results are printed to stdout as one JSON object per line:
+//   check:     {"bench":"utf8","test":"check","input":"cjk","cases":200000,"invalid":120000,"failures":0}
+//   speed:     {"bench":"utf8","test":"valid_length","input":"cjk","impl":"utf8","path":"ssse3","gb_per_s":8.1}
+// [check] generates random Latin, CJK, 4 byte and mixed text and mutates most cases: random bytes, stray continuations, overlong
+// and surrogate sequences, code points above U+10FFFF and truncated sequences, placed around the 16 byte block boundaries. Every
+// case is validated at the first 4 offsets and repaired. [invalid] counts the cases that are not valid UTF-8 after mutation.
+// [speed] measures valid text, [impl] "reference" is the byte wise reference.
+// Exits with EXIT_FAILURE if a result differs from the reference.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/io/utf8.h"
+#include "util/system.h"
+
+
+#define DEFAULT_CASES           200000
+#define DEFAULT_BYTES           (16 * 1024 * 1024)
+#define DEFAULT_REPEAT          3
+#define MAX_CASE_LENGTH         256
+#define MAX_REPORTED_FAILURES   10
+
+typedef enum {
+    INPUT_LATIN = 0,
+    INPUT_CJK,
+    INPUT_EMOJI,
+    INPUT_MIXED,
+    INPUT_COUNT,
+} input_type;
+
+static const char* s_input_names[INPUT_COUNT] = { "latin", "cjk", "emoji", "mixed" };
+
+// invalid sequences inserted by the mutation, the last three are cut off valid sequences
+static const struct { u8 bytes[4]; u8 length; } s_invalid[] = {
+    { { 0xC0, 0x80 }, 2 },                                  // overlong 2 byte
+    { { 0xC1, 0xBF }, 2 },
+    { { 0xE0, 0x80, 0x80 }, 3 },                            // overlong 3 byte
+    { { 0xE0, 0x9F, 0xBF }, 3 },
+    { { 0xED, 0xA0, 0x80 }, 3 },                            // surrogates
+    { { 0xED, 0xBF, 0xBF }, 3 },
+    { { 0xF0, 0x80, 0x80, 0x80 }, 4 },                      // overlong 4 byte
+    { { 0xF0, 0x8F, 0xBF, 0xBF }, 4 },
+    { { 0xF4, 0x90, 0x80, 0x80 }, 4 },                      // above U+10FFFF
+    { { 0xF5, 0x80, 0x80, 0x80 }, 4 },
+    { { 0xFE }, 1 },
+    { { 0xFF }, 1 },
+    { { 0xC3 }, 1 },
+    { { 0xE4, 0xB8 }, 2 },
+    { { 0xF0, 0x9F, 0x98 }, 3 },
+};
+#define INVALID_COUNT           (sizeof(s_invalid) / sizeof(s_invalid[0]))
+
+static volatile u64 s_sink;                                 // keeps the results alive
+
+
+static inline u64 xorshift(u64* state) {
+
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+
+// ============================================================================================================================================
+// reference
+// ============================================================================================================================================
+
+// @return length of the well formed sequence at [str], 0 if it is invalid or truncated
+static size_t reference_sequence_length(const u8* str, const size_t len) {
+
+    u32 code_point, length, min;
+    if (str[0] < 0x80)              return 1;
+    else if (str[0] < 0xC0)         return 0;
+    else if (str[0] < 0xE0)         { code_point = str[0] & 0x1F; length = 2; min = 0x80; }
+    else if (str[0] < 0xF0)         { code_point = str[0] & 0x0F; length = 3; min = 0x800; }
+    else if (str[0] < 0xF8)         { code_point = str[0] & 0x07; length = 4; min = 0x10000; }
+    else                            return 0;
+
+    if (len < length) return 0;
+    for (u32 x = 1; x < length; x++) {
+        if ((str[x] & 0xC0) != 0x80) return 0;
+        code_point = (code_point << 6) | (str[x] & 0x3F);
+    }
+    if (code_point < min || code_point > 0x10FFFF || (code_point >= 0xD800 && code_point <= 0xDFFF)) return 0;
+    return length;
+}
+
+static size_t reference_valid_length(const u8* str, const size_t len) {
+
+    size_t x = 0;
+    while (x < len) {
+        const size_t length = reference_sequence_length(str + x, len - x);
+        if (length == 0) return x;
+        x += length;
+    }
+    return len;
+}
+
+static size_t reference_repair(u8* str, const size_t len) {
+
+    size_t replaced = 0;
+    for (size_t x = 0; x < len; ) {
+        const size_t length = reference_sequence_length(str + x, len - x);
+        if (length > 0) {
+            x += length;
+            continue;
+        }
+        str[x++] = '?';
+        replaced++;
+    }
+    return replaced;
+}
+
+
+// ============================================================================================================================================
+// input
+// ============================================================================================================================================
+
+static size_t encode(u8* out, const u32 code_point) {
+
+    if (code_point < 0x80) {
+        out[0] = (u8)code_point;
+        return 1;
+    }
+    if (code_point < 0x800) {
+        out[0] = (u8)(0xC0 | (code_point >> 6));
+        out[1] = (u8)(0x80 | (code_point & 0x3F));
+        return 2;
+    }
+    if (code_point < 0x10000) {
+        out[0] = (u8)(0xE0 | (code_point >> 12));
+        out[1] = (u8)(0x80 | ((code_point >> 6) & 0x3F));
+        out[2] = (u8)(0x80 | (code_point & 0x3F));
+        return 3;
+    }
+    out[0] = (u8)(0xF0 | (code_point >> 18));
+    out[1] = (u8)(0x80 | ((code_point >> 12) & 0x3F));
+    out[2] = (u8)(0x80 | ((code_point >> 6) & 0x3F));
+    out[3] = (u8)(0x80 | (code_point & 0x3F));
+    return 4;
+}
+
+static u32 random_code_point(const input_type type, u64* state) {
+
+    // limits of the encoded lengths and the surrogate range
+    static const u32 s_edges[] = { 0x00, 0x7F, 0x80, 0x7FF, 0x800, 0xD7FF, 0xE000, 0xFFFD, 0xFFFF, 0x10000, 0x10FFFF };
+
+    const u64 r = xorshift(state);
+    switch (type) {
+        case INPUT_LATIN:   return (r % 8 == 0) ? 0xA0 + (u32)((r >> 8) % (0x250 - 0xA0)) : 0x20 + (u32)((r >> 8) % 0x5F);
+        case INPUT_CJK:     return (r % 8 == 0) ? 0x3000 + (u32)((r >> 8) % 0x40) : 0x4E00 + (u32)((r >> 8) % (0xA000 - 0x4E00));
+        case INPUT_EMOJI:   return (r % 4 == 0) ? 0x20 : 0x1F300 + (u32)((r >> 8) % (0x1FB00 - 0x1F300));
+        default:
+            switch (r % 5) {
+                case 0:     return s_edges[(r >> 8) % (sizeof(s_edges) / sizeof(s_edges[0]))];
+                case 1:     return random_code_point(INPUT_LATIN, state);
+                case 2:     return random_code_point(INPUT_CJK, state);
+                case 3:     return random_code_point(INPUT_EMOJI, state);
+                default: {
+                    const u32 code_point = (u32)((r >> 8) % 0x110000);
+                    return (code_point >= 0xD800 && code_point <= 0xDFFF) ? code_point - 0x800 : code_point;
+                }
+            }
+    }
+}
+
+// fills [out] with valid text, the remainder that no code point fits into is padded with spaces
+static void generate_text(u8* out, const size_t size, const input_type type, u64* state) {
+
+    u8 encoded[4];
+    size_t x = 0;
+    while (x < size) {
+        const size_t length = encode(encoded, random_code_point(type, state));
+        if (x + length > size) {
+            memset(out + x, ' ', size - x);
+            break;
+        }
+        memcpy(out + x, encoded, length);
+        x += length;
+    }
+}
+
+// position close to a 16 byte block boundary most of the time
+static size_t random_position(const size_t len, u64* state) {
+
+    const u64 r = xorshift(state);
+    if (r % 4 == 0) return (size_t)((r >> 8) % len);
+    const i64 position = (i64)((r >> 8) % (len / 16 + 1)) * 16 + (i64)((r >> 32) % 7) - 3;
+    return (position < 0) ? 0 : (position >= (i64)len) ? len - 1 : (size_t)position;
+}
+
+// @return new length of [buffer]
+static size_t mutate(u8* buffer, size_t len, u64* state) {
+
+    if (len == 0) return 0;
+    const size_t position = random_position(len, state);
+    switch (xorshift(state) % 5) {
+        case 0:     buffer[position] = (u8)xorshift(state); break;
+        case 1:     buffer[position] = (u8)(0x80 | (xorshift(state) & 0x3F)); break;
+        case 2:     buffer[position] = (u8)(0xC0 | (xorshift(state) & 0x3F)); break;             // lead byte without its continuations
+        case 3:     return position;                                                                // may cut a sequence
+        default: {
+            const u32 index = (u32)(xorshift(state) % INVALID_COUNT);
+            for (u32 x = 0; x < s_invalid[index].length && position + x < len; x++)
+                buffer[position + x] = s_invalid[index].bytes[x];
+            break;
+        }
+    }
+    return len;
+}
+
+
+// ============================================================================================================================================
+// check
+// ============================================================================================================================================
+
+static void report_failure(u64* failures, const char* what, const u8* str, const size_t len, const size_t got, const size_t expected) {
+
+    if (++(*failures) > MAX_REPORTED_FAILURES) return;
+
+    fprintf(stderr, "%s: got %zu expected %zu for %zu bytes:", what, got, expected, len);
+    for (size_t x = 0; x < len; x++)
+        fprintf(stderr, " %02X", str[x]);
+    fprintf(stderr, "\n");
+}
+
+static b8 check(const u32 cases) {
+
+    u8 buffer[MAX_CASE_LENGTH];
+    u8 repaired[MAX_CASE_LENGTH];
+    u8 expected_repair[MAX_CASE_LENGTH];
+    u64 state = 0x2545F4914F6CDD1DULL;
+    u64 total_failures = 0;
+    for (u32 type = 0; type < INPUT_COUNT; type++) {
+
+        u64 failures = 0;
+        u64 invalid = 0;
+        for (u32 c = 0; c < cases; c++) {
+
+            size_t len = (size_t)(xorshift(&state) % (MAX_CASE_LENGTH + 1));
+            generate_text(buffer, len, (input_type)type, &state);
+            const u32 mutations = (c % 4 == 0) ? 0 : 1 + (u32)(xorshift(&state) % 3);
+            for (u32 m = 0; m < mutations; m++)
+                len = mutate(buffer, len, &state);
+
+            const size_t expected = reference_valid_length(buffer, len);
+            invalid += (expected != len);
+            for (size_t offset = 0; offset < 4 && offset <= len; offset++) {                    // unaligned loads and short tails
+                const size_t got = utf8_valid_length((const char*)buffer + offset, len - offset);
+                const size_t want = (offset == 0) ? expected : reference_valid_length(buffer + offset, len - offset);
+                if (got != want)
+                    report_failure(&failures, "utf8_valid_length", buffer + offset, len - offset, got, want);
+            }
+
+            memcpy(repaired, buffer, len);
+            memcpy(expected_repair, buffer, len);
+            const size_t replaced = utf8_repair((char*)repaired, len);
+            const size_t expected_replaced = reference_repair(expected_repair, len);
+            if (replaced != expected_replaced || memcmp(repaired, expected_repair, len) != 0)
+                report_failure(&failures, "utf8_repair", buffer, len, replaced, expected_replaced);
+            else if (utf8_valid_length((const char*)repaired, len) != len)
+                report_failure(&failures, "utf8_repair result", repaired, len, utf8_valid_length((const char*)repaired, len), len);
+        }
+
+        printf("{\"bench\":\"utf8\",\"test\":\"check\",\"input\":\"%s\",\"cases\":%u,\"invalid\":%llu,\"failures\":%llu}\n",
+            s_input_names[type], cases, (unsigned long long)invalid, (unsigned long long)failures);
+        fflush(stdout);
+        total_failures += failures;
+    }
+    return total_failures == 0;
+}
+
+
+// ============================================================================================================================================
+// speed
+// ============================================================================================================================================
+
+static const char* simd_path(void) {
+
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_cpu_supports("ssse3") ? "ssse3" : "scalar";
+#else
+    return "scalar";
+#endif
+}
+
+static void bench_speed(const size_t size, const u32 repeat) {
+
+    u8* text = malloc(size);
+    if (!text) {
+        fprintf(stderr, "out of memory\n");
+        return;
+    }
+
+    u64 state = 0x9E3779B97F4A7C15ULL;
+    for (u32 type = 0; type < INPUT_COUNT; type++) {
+
+        generate_text(text, size, (input_type)type, &state);
+        for (u32 use_reference = 0; use_reference < 2; use_reference++) {
+            f64 best = 0;
+            for (u32 r = 0; r < repeat; r++) {
+                const f64 start = get_precise_time();
+                s_sink += use_reference ? reference_valid_length(text, size) : utf8_valid_length((const char*)text, size);
+                const f64 seconds = get_precise_time() - start;
+                best = (r == 0 || seconds < best) ? seconds : best;
+            }
+            printf("{\"bench\":\"utf8\",\"test\":\"valid_length\",\"input\":\"%s\",\"impl\":\"%s\",\"path\":\"%s\",\"gb_per_s\":%.2f}\n",
+                s_input_names[type], use_reference ? "reference" : "utf8", use_reference ? "scalar" : simd_path(), (f64)size / best / 1e9);
+            fflush(stdout);
+        }
+    }
+    free(text);
+}
+
+
+int main(int argc, char* argv[]) {
+
+    u32 cases = DEFAULT_CASES;
+    size_t bytes = DEFAULT_BYTES;
+    u32 repeat = DEFAULT_REPEAT;
+    for (int x = 1; x < argc; x++) {
+        if (strcmp(argv[x], "--cases") == 0 && x + 1 < argc)
+            cases = (u32)strtoul(argv[++x], NULL, 10);
+        else if (strcmp(argv[x], "--bytes") == 0 && x + 1 < argc)
+            bytes = (size_t)strtoull(argv[++x], NULL, 10);
+        else if (strcmp(argv[x], "--repeat") == 0 && x + 1 < argc)
+            repeat = (u32)atoi(argv[++x]);
+        else {
+            fprintf(stderr, "usage: %s [--cases %d] [--bytes %d] [--repeat %d]\n", argv[0], DEFAULT_CASES, DEFAULT_BYTES, DEFAULT_REPEAT);
+            return EXIT_FAILURE;
+        }
+    }
+    if (repeat == 0) repeat = 1;
+    if (bytes == 0) bytes = 1;
+
+    const b8 passed = check(cases);
+    bench_speed(bytes, repeat);
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,10 +1,13 @@
 
 #include "util/io/logger.h"
+#include "util/io/file_watcher.h"
 #include "util/io/serializer_yaml.h"
 #include "util/crash_handler.h"
 #include "util/system.h"
+#include "util/memory/arena.h"
 #include "imgui_config/imgui_config.h"
 #include "dashboard/dashboard.h"
+#include "dashboard/library.h"
 
 #include "application.h"
 
@@ -17,6 +20,7 @@
 
 
 static application_state app_state;
+static arena s_frame_arena = ARENA_INITIALIZER;                // reset after every frame, only used by the main thread
 
 
 // ============================================================================================================================================
@@ -27,6 +31,30 @@ renderer_state* application_get_renderer()          { return &app_state.renderer
 
 window_info* application_get_window()               { return &app_state.window; }
 
+arena* application_get_frame_arena()                { return &s_frame_arena; }
+
+
+// ============================================================================================================================================
+// command line
+// ============================================================================================================================================
+
+static const char* s_import_path = NULL;            // --import <file>
+static const char* s_export_path = NULL;            // --export <file>
+
+// runs the import and export of the command line once the library is loaded, the import first so both together convert a file
+static void run_library_commands(void) {
+
+    if (s_import_path) {
+        const i32 result = library_import_file(s_import_path, library_format_from_path(s_import_path), NULL, NULL);
+        VALIDATE(result == AT_SUCCESS, , "", "Failed to import [%s] (expected a .csv or .json file): %s", s_import_path, error_to_str(result))
+    }
+
+    if (s_export_path) {
+        const i32 result = library_export_file(s_export_path, library_format_from_path(s_export_path));
+        VALIDATE(result == AT_SUCCESS, , "", "Failed to export the library to [%s] (expected a .csv or .json file): %s", s_export_path, error_to_str(result))
+    }
+}
+
 
 // ============================================================================================================================================
 // long client init
@@ -39,6 +67,7 @@ int init_thread(__attribute_maybe_unused__ void* arg) {
 
     LOGGER_REGISTER_THREAD_LABEL("client init")
     dashboard_init();
+    run_library_commands();
     init_complete = true;
     logger_remove_thread_label_by_id((u64)pthread_self());
     return 0;
@@ -75,35 +104,89 @@ void limit_fps() {
     s_loop_start_time = get_precise_time();                     // as this is the last function call before next loop iteration
 }
 
+// ============================================================================================================================================
+// settings reload
+// ============================================================================================================================================
+
+static char s_config_dir[PATH_MAX] = {0};
+static char s_display_name[PATH_MAX] = {0};                 // referenced by the window as its title
+
+// runs on the UI thread
+static void apply_display_name(void* data) {
+
+    strcpy(s_display_name, (const char*)data);
+    window_set_title(&app_state.window, s_display_name);
+    free(data);
+}
+
+static void on_settings_section_changed(const char* section_name, void* user_data) {
+
+    if (strcmp(section_name, "general_settings") == 0)
+        *(b8*)user_data = true;
+}
+
+// runs on the file watcher thread, [long_startup_process] only matters at startup and is not reloaded
+static void on_settings_file_changed(const char* dir_path, const char* file_name, __attribute_maybe_unused__ void* user_data) {
+
+    b8 changed = false;
+    if (sy_reload(dir_path, file_name, on_settings_section_changed, &changed) < 0 || !changed)
+        return;
+
+    char* display_name = calloc(1, PATH_MAX);
+    VALIDATE(display_name, return, "", "Failed to allocate display name")
+
+    SY sy = {0};
+    VALIDATE(sy_init(&sy, dir_path, file_name, "general_settings", SERIALIZER_OPTION_LOAD), free(display_name); return, "", "Failed to reload app settings");
+    sy_entry_str(&sy, "display_name", display_name, PATH_MAX);
+    sy_shutdown(&sy);
+    if (display_name[0] == '\0') {                            // key was removed, keep the current title
+        free(display_name);
+        return;
+    }
+
+    VALIDATE(file_watcher_post(apply_display_name, free, display_name), free(display_name), "", "Failed to queue reloaded app settings")
+}
+
+
 // ============================================================================================================================================
 // application
 // ============================================================================================================================================
 
 
-b8 application_init(__attribute_maybe_unused__ int argc, __attribute_maybe_unused__ char *argv[]) {
+b8 application_init(int argc, char *argv[]) {
+
+    strcpy(s_display_name, "Application Template");    // set default string incase title cant be loaded from app_settings
 
-    char display_name[PATH_MAX] = {0};
-    strcpy(display_name, "Application Template");      // set default string incase title cant be loaded from app_settings
+    for (int x = 1; x < argc; x++) {
+        if (strcmp(argv[x], "--import") == 0 && x + 1 < argc)
+            s_import_path = argv[++x];
+        else if (strcmp(argv[x], "--export") == 0 && x + 1 < argc)
+            s_export_path = argv[++x];
+        else
+            LOG(Warn, "Ignoring unknown command line argument [%s]", argv[x])
+    }
 
     do {        // load app settings
     
         char exec_path[PATH_MAX] = {0};
         get_executable_path_buf(exec_path, sizeof(exec_path));
 
-        char loc_file_path[PATH_MAX] = {0};
-        memset(loc_file_path, '\0', sizeof(loc_file_path));
-        const int written = snprintf(loc_file_path, sizeof(loc_file_path), "%s/%s", exec_path, "config");
-        VALIDATE(written >= 0 && (size_t)written < sizeof(loc_file_path), return false, "", "Path too long: %s/%s\n", exec_path, "config");
+        const int written = snprintf(s_config_dir, sizeof(s_config_dir), "%s/%s", exec_path, "config");
+        VALIDATE(written >= 0 && (size_t)written < sizeof(s_config_dir), return false, "", "Path too long: %s/%s\n", exec_path, "config");
 
         SY sy = {0};
-        VALIDATE(sy_init(&sy, loc_file_path, "app_settings.yml", "general_settings", SERIALIZER_OPTION_LOAD), break, "", "Failed to load app settings");
-        sy_entry_str(&sy, "display_name", display_name, sizeof(display_name));
-        sy_entry(&sy, "long_startup_process", &long_init, "%d");
+        VALIDATE(sy_init(&sy, s_config_dir, "app_settings.yml", "general_settings", SERIALIZER_OPTION_LOAD), break, "", "Failed to load app settings");
+        sy_entry_str(&sy, "display_name", s_display_name, sizeof(s_display_name));
+        sy_entry(&sy, "long_startup_process", &long_init, SY_TYPE_B8);
         sy_shutdown(&sy);
         
     } while (0);
 
-    ASSERT(create_window(&app_state.window, 800, 600, display_name), "", "Failed to create window")
+    // hot reload is optional, without the watcher external edits are only picked up on restart
+    if (file_watcher_init())
+        file_watcher_add(s_config_dir, "app_settings.yml", on_settings_file_changed, NULL);
+
+    ASSERT(create_window(&app_state.window, 800, 600, s_display_name), "", "Failed to create window")
     ASSERT(renderer_init(&app_state.renderer), "", "Failed to initialize renderer")
     imgui_init(&app_state.window);
 
@@ -117,10 +200,13 @@ b8 application_init(__attribute_maybe_unused__ int argc, __attribute_maybe_unuse
 void application_shutdown() {
 
     crash_handler_unsubscribe_callback(dashboard_crash_callback);
+    file_watcher_remove(s_config_dir, "app_settings.yml");
+    file_watcher_shutdown();
 
     imgui_shutdown();
     renderer_shutdown(&app_state.renderer);
     destroy_window(&app_state.window);
+    arena_free(&s_frame_arena);
     
     LOG_SHUTDOWN
 }
@@ -140,25 +226,30 @@ void application_run() {
         // Main loop
         while (!init_complete) {                    // separate loop without the update and real draw
             window_poll_events();
+            file_watcher_dispatch();
             imgui_begin_frame();
             dashboard_draw_init_UI(s_delta_time);
             imgui_end_frame(&app_state.window);
+            arena_reset(&s_frame_arena);
             limit_fps();
         }
 
     } else {
 
         dashboard_init();
+        run_library_commands();
     }
     
     while (!window_should_close(&app_state.window) && app_state.is_running) {
         window_poll_events();
+        file_watcher_dispatch();            // changes of watched files
         
         dashboard_update(s_delta_time);
         
         renderer_begin_frame(&app_state.renderer);
         dashboard_draw(s_delta_time);        
         renderer_end_frame(&app_state.window);
+        arena_reset(&s_frame_arena);        // memory of this frame is not needed anymore
         
         limit_fps();                        // sets [s_delta_time]
     }
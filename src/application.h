@@ -2,6 +2,7 @@
 
 #include "platform/window.h"
 #include "render/renderer.h"
+#include "util/memory/arena.h"
 
 
 typedef struct {
@@ -11,7 +12,8 @@ typedef struct {
 } application_state;
 
 
-//
+// command line: --import <file> appends the entries of a CSV or JSON file to the library, --export <file> writes the library into one
+// (see dashboard/library_io.h for the formats)
 b8 application_init(int argc, char *argv[]);
 
 //
@@ -31,3 +33,6 @@ renderer_state* application_get_renderer();
 
 // get main window
 window_info* application_get_window();
+
+// get arena for memory that is only needed during the current frame (main thread only), it is reset after every frame
+arena* application_get_frame_arena();
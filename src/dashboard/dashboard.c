@@ -7,242 +7,36 @@
 #include <limits.h>
 
 #include "util/io/logger.h"
+#include "util/io/file_watcher.h"
 #include "util/UI/pannel_collection.h"
-#include "util/data_structure/darray.h"
-#include "util/io/serializer_yaml.h"
 #include "util/system.h"
 #include "imgui_config/imgui_config.h"
 #include "render/image.h"
+#include "dashboard/visual_novel.h"
+#include "dashboard/library.h"
+#include "util/memory/arena.h"
+#include "application.h"
 
 #include "dashboard.h"
 
 
 // ========================================================================================================================================
-// visual novel
+// dashboard
 // ========================================================================================================================================
 
+#define CARD_WIDTH              300.0f
+#define CARD_HEIGHT             300.0f
+#define CARD_SPACING            16.0f               // ItemSpacing of the content panel
 
-// currently contains 104 tags (128 possible)
-typedef enum {
-GT_ACTION, GT_ADVENTURE, GT_ARTBOOK, GT_CARTOON, GT_COMIC, GT_DOUJINSHI, GT_IMAGESET, GT_MANGA,
-GT_MANHUA, GT_MANHWA, GT_WESTERN, GT_ONESHOT, GT_FOURKOMA, GT_SHOUJO, GT_SHOUNEN, GT_JOSEI, 
-GT_SEINEN, GT_COMEDY, GT_COOKING, GT_CRIME, GT_CROSS_DRESSING, GT_CULTIVATION, GT_DEATH_GAME,
-GT_OP_MC, GT_DEGENERATE_MC, GT_DELINQUENTS, GT_DEMENTIA, GT_DEMONS, GT_DRAMA, GT_FANTASY,
-GT_FETISH, GT_GAME, GT_GENDER_BENDER, GT_GENDER_SWAP, GT_GHOST, GT_GYARU, GT_HAREM, GT_HATLEQUIN, 
-GT_HISTORY, GT_HORROR, GT_ISEKAI, GT_KIDS, GT_MAGIC, GT_MARTIAL_ARTS, GT_MASTER_SERVANT, GT_MECHS,
-GT_MEDICAL, GT_MILF, GT_MILITARY, GT_MONSTER_GIRL, GT_MONSTERS, GT_MUSIC, GT_MYSTERY, GT_NINJA, 
-GT_OFFICE_WORKERS, GT_OMEGAVERSE, GT_PARODY, GT_PHILOSOPHICAL, GT_POLICE, GT_POST_APOCALYPTIC,
-GT_PSYCHOLOGICAL, GT_REINCARNATION, GT_REVERSE_HAREM, GT_ROMANCE,
-} genre_tag_lo;
-
-typedef enum {
-GT_SAMURAI, GT_SCHOOL_LIFE, GT_SCI_FI, GT_SHOUJOAI, GT_SHOUNENAI, GT_SHOWBIZ, GT_SLICE_OF_LIFE, GT_SPACE, 
-GT_SPORTS, GT_STEPFAMILY, GT_SUPERPOWER, GT_SUPERHERO, GT_SUPERNATURAL, GT_SURVIVAL, GT_TEACHER_STUDENTS,
-GT_THRILLER, GT_TIME_TRAVEL, GT_TRAGEDY, GT_VAMPIRES, GT_VILLAINESS, GT_VIRTUAL_REALITY, 
-GT_WUXIA, GT_XIANXIA, GT_XUANHUAN, GT_ZOMBIES, 
-
-// NSFW tags
-GT_GORE, GT_BLOODY, GT_VIOLENCE, GT_ADULT, GT_MATURE, GT_SMUT, GT_ECCHI, GT_NTR, GT_INCEST, 
-GT_LOLI, GT_SHOTA, GT_FUTA, GT_BARA, GT_YAOI, GT_YURI
-} genre_tag_hi;
-
-const char* genre_tag_lo_to_str(const genre_tag_lo type) {
-
-    switch (type) {
-        case GT_ACTION:                 return "action";
-        case GT_ADVENTURE:              return "adventure";
-        case GT_ARTBOOK:                return "artbook";
-        case GT_CARTOON:                return "cartoon";
-        case GT_COMIC:                  return "comic";
-        case GT_DOUJINSHI:              return "doujinshi";
-        case GT_IMAGESET:               return "imageset";
-        case GT_MANGA:                  return "manga";
-        case GT_MANHUA:                 return "manhua";
-        case GT_MANHWA:                 return "manhwa";
-        case GT_WESTERN:                return "western";
-        case GT_ONESHOT:                return "oneshot";
-        case GT_FOURKOMA:               return "fourkoma";
-        case GT_SHOUJO:                 return "shoujo";
-        case GT_SHOUNEN:                return "shounen";
-        case GT_JOSEI:                  return "josei";
-        case GT_SEINEN:                 return "seinen";
-        case GT_COMEDY:                 return "comedy";
-        case GT_COOKING:                return "cooking";
-        case GT_CRIME:                  return "crime";
-        case GT_CROSS_DRESSING:         return "cross dressing";
-        case GT_CULTIVATION:            return "cultivation";
-        case GT_DEATH_GAME:             return "death game";
-        case GT_OP_MC:                  return "op_mc";
-        case GT_DEGENERATE_MC:          return "degenerate mc";
-        case GT_DELINQUENTS:            return "delinquents";
-        case GT_DEMENTIA:               return "dementia";
-        case GT_DEMONS:                 return "demons";
-        case GT_DRAMA:                  return "drama";
-        case GT_FANTASY:                return "fantasy";
-        case GT_FETISH:                 return "fetish";
-        case GT_GAME:                   return "game";
-        case GT_GENDER_BENDER:          return "gender bender";
-        case GT_GENDER_SWAP:            return "gender swap";
-        case GT_GHOST:                  return "ghost";
-        case GT_GYARU:                  return "gyaru";
-        case GT_HAREM:                  return "harem";
-        case GT_HATLEQUIN:              return "hatlequin";
-        case GT_HISTORY:                return "history";
-        case GT_HORROR:                 return "horror";
-        case GT_ISEKAI:                 return "isekai";
-        case GT_KIDS:                   return "kids";
-        case GT_MAGIC:                  return "magic";
-        case GT_MARTIAL_ARTS:           return "martial arts";
-        case GT_MASTER_SERVANT:         return "master servant";
-        case GT_MECHS:                  return "mechs";
-        case GT_MEDICAL:                return "medical";
-        case GT_MILF:                   return "milf";
-        case GT_MILITARY:               return "military";
-        case GT_MONSTER_GIRL:           return "monster girl";
-        case GT_MONSTERS:               return "monsters";
-        case GT_MUSIC:                  return "music";
-        case GT_MYSTERY:                return "mystery";
-        case GT_NINJA:                  return "ninja";
-        case GT_OFFICE_WORKERS:         return "office workers";
-        case GT_OMEGAVERSE:             return "omegaverse";
-        case GT_PARODY:                 return "parody";
-        case GT_PHILOSOPHICAL:          return "philosophical";
-        case GT_POLICE:                 return "police";
-        case GT_POST_APOCALYPTIC:       return "post apocalyptic";
-        case GT_PSYCHOLOGICAL:          return "psychological";
-        case GT_REINCARNATION:          return "reincarnation";
-        case GT_REVERSE_HAREM:          return "revers eharem";
-        case GT_ROMANCE:                return "romance";
-        default:                        return "unknown";
-    }
-}
-
-const char* genre_tag_hi_to_str(const genre_tag_hi type) {
-
-    switch (type) {
-        case GT_SAMURAI:                return "samurai";
-        case GT_SCHOOL_LIFE:            return "school life";
-        case GT_SCI_FI:                 return "sci-fi";
-        case GT_SHOUJOAI:               return "shoujoai";
-        case GT_SHOUNENAI:              return "shounenai";
-        case GT_SHOWBIZ:                return "showbiz";
-        case GT_SLICE_OF_LIFE:          return "slice of life";
-        case GT_SPACE:                  return "space";
-        case GT_SPORTS:                 return "sports";
-        case GT_STEPFAMILY:             return "stepfamily";
-        case GT_SUPERPOWER:             return "superpower";
-        case GT_SUPERHERO:              return "superhero";
-        case GT_SUPERNATURAL:           return "supernatural";
-        case GT_SURVIVAL:               return "survival";
-        case GT_TEACHER_STUDENTS:       return "teacher students";
-        case GT_THRILLER:               return "thriller";
-        case GT_TIME_TRAVEL:            return "time travel";
-        case GT_TRAGEDY:                return "tragedy";
-        case GT_VAMPIRES:               return "vampires";
-        case GT_VILLAINESS:             return "villainess";
-        case GT_VIRTUAL_REALITY:        return "virtual reality";
-        case GT_WUXIA:                  return "wuxia";
-        case GT_XIANXIA:                return "xianxia";
-        case GT_XUANHUAN:               return "xuanhuan";
-        case GT_ZOMBIES:                return "zombies";
-        case GT_GORE:                   return "gore";
-        case GT_BLOODY:                 return "bloody";
-        case GT_VIOLENCE:               return "violence";
-        case GT_ADULT:                  return "adult";
-        case GT_MATURE:                 return "mature";
-        case GT_SMUT:                   return "smut";
-        case GT_ECCHI:                  return "ecchi";
-        case GT_NTR:                    return "ntr";
-        case GT_INCEST:                 return "incest";
-        case GT_LOLI:                   return "loli";
-        case GT_SHOTA:                  return "shota";
-        case GT_FUTA:                   return "futa";
-        case GT_BARA:                   return "bara";
-        case GT_YAOI:                   return "yaoi";
-        case GT_YURI:                   return "yuri";
-        default:                        return "unknown";
-    }
-}
-
-#define GENRE_BIT(tag) (((u64)1) << (tag))
-
-// set a genre
-static inline void add_genre_lo(u64 *flags, genre_tag_lo tag)        { *flags |= GENRE_BIT(tag); }
-static inline void add_genre_hi(u64 *flags, genre_tag_hi tag)        { *flags |= GENRE_BIT(tag); }
-
-// clear a genre
-static inline void remove_genre_lo(u64 *flags, genre_tag_lo tag)     { *flags &= ~GENRE_BIT(tag); }
-static inline void remove_genre_hi(u64 *flags, genre_tag_hi tag)     { *flags &= ~GENRE_BIT(tag); }
-
-// test a genre
-static inline bool has_genre_lo(u64 flags, genre_tag_lo tag)         { return (flags & GENRE_BIT(tag)) != 0; }
-static inline bool has_genre_hi(u64 flags, genre_tag_hi tag)         { return (flags & GENRE_BIT(tag)) != 0; }
-
-
-typedef enum {
-    DR_READ_ALL_CHAPTERS,
-    DR_FINISHED,
-    DR_GOT_BORED,
-    DR_AUTHOR_HIATUS,
-    DR_DROPPED_BY_TRANSLATOR,
-    DR_POOR_TRANSLATION,
-    DR_DECLINE_IN_QUALITY,
-} discontinue_reason;
-
-const char* discontinue_reason_to_str(const discontinue_reason type) {
-
-    switch (type) {
-        case DR_READ_ALL_CHAPTERS:      { return "read all chapters"; }
-        case DR_FINISHED:               { return "finished"; }
-        case DR_GOT_BORED:              { return "got bored"; }
-        case DR_AUTHOR_HIATUS:          { return "author hiatus"; }
-        case DR_DROPPED_BY_TRANSLATOR:  { return "dropped by translator"; }
-        case DR_POOR_TRANSLATION:       { return "poor translation"; }
-        case DR_DECLINE_IN_QUALITY:     { return "decline in quality"; }
-        default:                        { return "unknown"; }
-    }
-}
-
-
-typedef struct {
-    char                name[512];
-    char                link[PATH_MAX];
-    char                image_path[PATH_MAX];
-    u16                 chapters_total;
-    u16                 chapters_read;
-    u8                  rating;                          // from 0 to 10
-    discontinue_reason  disc_reason;
-    u64                 flags_lo;                       // enum values from 65-128
-    u64                 flags_hi;                       // enum values from 65-128
-} visual_novel;
-
-static darray visual_novels = {0};
-
-
-bool visual_novels_serializer_cb(SY* serializer, void* element) {
-
-    visual_novel* vs = (visual_novel*)element;
-    sy_entry_str(serializer, S_KEY_VALUE(*vs->name), sizeof(vs->name));
-    sy_entry_str(serializer, S_KEY_VALUE(*vs->link), sizeof(vs->link));
-    sy_entry_str(serializer, S_KEY_VALUE(*vs->image_path), sizeof(vs->image_path));
-    sy_entry(serializer, S_KEY_VALUE_FORMAT(vs->chapters_total));
-    sy_entry(serializer, S_KEY_VALUE_FORMAT(vs->chapters_read));
-    sy_entry(serializer, S_KEY_VALUE_FORMAT(vs->rating));
-    sy_entry(serializer, S_KEY_VALUE_FORMAT(vs->disc_reason));
-    sy_entry(serializer, S_KEY_VALUE_FORMAT(vs->flags_lo));
-    sy_entry(serializer, S_KEY_VALUE_FORMAT(vs->flags_hi));
-    return true;
-}
 
-// ========================================================================================================================================
-// dashboard
-// ========================================================================================================================================
+static char s_config_dir[PATH_MAX] = {0};
+static darray s_display_order = {0};                        // u32, library index of the entry at every position of the card grid
+static u64 s_display_order_revision = UINT64_MAX;           // library_revision() the order was computed for, UINT64_MAX to sort again
+static library_sort_key s_sort_key = { .field = LIBRARY_SORT_TITLE, .descending = false };
 
 //
 b8 dashboard_init() {
 
-    darray_init(&visual_novels, sizeof(visual_novels));
-
     char exec_path[PATH_MAX] = {0};
     get_executable_path_buf(exec_path, sizeof(exec_path));
     char loc_file_path[PATH_MAX] = {0};
@@ -250,72 +44,70 @@ b8 dashboard_init() {
     const int written = snprintf(loc_file_path, sizeof(loc_file_path), "%s/%s", exec_path, "config");
     VALIDATE(written >= 0 && (size_t)written < sizeof(loc_file_path), return false, "", "Path too long: %s/%s\n", exec_path, "config");
 
-    SY sy = {0};
-    VALIDATE(sy_init(&sy, loc_file_path, "project_data.yml", "general_data", SERIALIZER_OPTION_LOAD), return false, "", "Failed to load project data");
-    
-#if 0       // use dummy values
-    sy_loop(&sy, S_KEY_VALUE(visual_novels), sizeof(visual_novel), visual_novels_serializer_cb, 
-        (sy_loop_callback_at_t)darray_get,
-        (sy_loop_callback_append_t)darray_push_back,
-        (sy_loop_DS_size_callback_t)darray_size);
-#else
-    // Create some dummy visual novels
-    visual_novel vn0 = {
-        .name = "Eternal Sakura",
-        .link = "https://example.com/eternal-sakura",
-        .image_path = "/eternal_sakura.jpg",
-        .chapters_total = 24,
-        .chapters_read = 24,
-        .rating = 9,
-        .disc_reason = DR_FINISHED,
-        .flags_lo = (1ULL << GT_ROMANCE) | (1ULL << GT_SCHOOL_LIFE) | (1ULL << GT_DRAMA),
-        .flags_hi = (1ULL << GT_YURI)  // Assuming 64 is the cutoff between flags_lo and flags_hi
-    };
-
-    visual_novel vn1 = {
-        .name = "Cyber Nexus Reborn",
-        .link = "https://example.com/cyber-nexus",
-        .image_path = "/cyber_nexus.png",
-        .chapters_total = 48,
-        .chapters_read = 15,
-        .rating = 7,
-        .disc_reason = DR_GOT_BORED,
-        .flags_lo = (1ULL << GT_SCI_FI) | (1ULL << GT_ACTION) | (1ULL << GT_PSYCHOLOGICAL),
-        .flags_hi = (1ULL << GT_GORE) | (1ULL << GT_VIOLENCE)
-    };
-
-    visual_novel vn2 = {
-        .name = "Crimson Moon Chronicles",
-        .link = "https://example.com/crimson-moon",
-        .image_path = "/crimson_moon.jpg",
-        .chapters_total = 36,
-        .chapters_read = 36,
-        .rating = 10,
-        .disc_reason = DR_FINISHED,
-        .flags_lo = (1ULL << GT_FANTASY) | (1ULL << GT_SUPERNATURAL) | (1ULL << GT_VAMPIRES) | (1ULL << GT_ROMANCE),
-        .flags_hi = (1ULL << GT_ADULT) | (1ULL << GT_MATURE)
-    };
-
-    visual_novel vn3 = {
-        .name = "Starlight Academy",
-        .link = "https://example.com/starlight-academy",
-        .image_path = "/starlight_academy.png",
-        .chapters_total = 18,
-        .chapters_read = 5,
-        .rating = 6,
-        .disc_reason = DR_POOR_TRANSLATION,
-        .flags_lo = (1ULL << GT_SCHOOL_LIFE) | (1ULL << GT_COMEDY) | (1ULL << GT_SLICE_OF_LIFE) | (1ULL << GT_HAREM),
-        .flags_hi = (1ULL << GT_ECCHI)
-    };
-
-    // Add them to the array
-    darray_push_back(&visual_novels, &vn0);
-    darray_push_back(&visual_novels, &vn1);
-    darray_push_back(&visual_novels, &vn2);
-    darray_push_back(&visual_novels, &vn3);
-#endif
-
-    sy_shutdown(&sy);
+    // the dummy entries are saved like user entries, only seed a library that has no file yet (not one the user emptied)
+    char data_file_path[PATH_MAX] = {0};
+    const int data_written = snprintf(data_file_path, sizeof(data_file_path), "%s/%s", loc_file_path, "project_data.yml");
+    const b8 first_start = (data_written >= 0 && (size_t)data_written < sizeof(data_file_path) && access(data_file_path, F_OK) != 0);
+
+    VALIDATE(library_init(loc_file_path, "project_data.yml"), return false, "", "Failed to load project data");
+    darray_init(&s_display_order, sizeof(u32));
+    strcpy(s_config_dir, loc_file_path);
+    file_watcher_add(s_config_dir, "project_data.yml", library_on_file_changed, NULL);       // not fatal, external edits are only picked up on restart
+
+    if (first_start && library_size() == 0) {      // seed a new library with dummy values
+        visual_novel vn0 = {
+            .name = "Eternal Sakura",
+            .link = "https://example.com/eternal-sakura",
+            .image_path = "/eternal_sakura.jpg",
+            .chapters_total = 24,
+            .chapters_read = 24,
+            .rating = 9,
+            .disc_reason = DR_FINISHED,
+            .flags_lo = (1ULL << GT_ROMANCE) | (1ULL << GT_SCHOOL_LIFE) | (1ULL << GT_DRAMA),
+            .flags_hi = (1ULL << GT_YURI)  // Assuming 64 is the cutoff between flags_lo and flags_hi
+        };
+
+        visual_novel vn1 = {
+            .name = "Cyber Nexus Reborn",
+            .link = "https://example.com/cyber-nexus",
+            .image_path = "/cyber_nexus.png",
+            .chapters_total = 48,
+            .chapters_read = 15,
+            .rating = 7,
+            .disc_reason = DR_GOT_BORED,
+            .flags_lo = (1ULL << GT_SCI_FI) | (1ULL << GT_ACTION) | (1ULL << GT_PSYCHOLOGICAL),
+            .flags_hi = (1ULL << GT_GORE) | (1ULL << GT_VIOLENCE)
+        };
+
+        visual_novel vn2 = {
+            .name = "Crimson Moon Chronicles",
+            .link = "https://example.com/crimson-moon",
+            .image_path = "/crimson_moon.jpg",
+            .chapters_total = 36,
+            .chapters_read = 36,
+            .rating = 10,
+            .disc_reason = DR_FINISHED,
+            .flags_lo = (1ULL << GT_FANTASY) | (1ULL << GT_SUPERNATURAL) | (1ULL << GT_VAMPIRES) | (1ULL << GT_ROMANCE),
+            .flags_hi = (1ULL << GT_ADULT) | (1ULL << GT_MATURE)
+        };
+
+        visual_novel vn3 = {
+            .name = "Starlight Academy",
+            .link = "https://example.com/starlight-academy",
+            .image_path = "/starlight_academy.png",
+            .chapters_total = 18,
+            .chapters_read = 5,
+            .rating = 6,
+            .disc_reason = DR_POOR_TRANSLATION,
+            .flags_lo = (1ULL << GT_SCHOOL_LIFE) | (1ULL << GT_COMEDY) | (1ULL << GT_SLICE_OF_LIFE) | (1ULL << GT_HAREM),
+            .flags_hi = (1ULL << GT_ECCHI)
+        };
+
+        library_add(&vn0);
+        library_add(&vn1);
+        library_add(&vn2);
+        library_add(&vn3);
+    }
 
     // sleep(3);
     return true;
@@ -324,7 +116,9 @@ b8 dashboard_init() {
 //
 void dashboard_shutdown() {
 
-    darray_free(&visual_novels);
+    file_watcher_remove(s_config_dir, "project_data.yml");
+    library_shutdown();
+    darray_free(&s_display_order);
     LOG_SHUTDOWN
 }
 
@@ -343,11 +137,7 @@ void draw_card(visual_novel* vn) {
     igPushStyleColor_U32(ImGuiCol_Border, igColorConvertFloat4ToU32((ImVec4){0.3f, 0.3f, 0.3f, 1.0f}));
     igPushStyleVar_Float(ImGuiStyleVar_ChildBorderSize, 1.0f);
     
-    // Calculate card size
-    float card_width = 300.0f;
-    float card_height = 300.0f;
-    
-    igBeginChild_Str(vn->name, (ImVec2){card_width, card_height}, true, ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoScrollWithMouse);
+    igBeginChild_Str(vn->name, (ImVec2){CARD_WIDTH, CARD_HEIGHT}, true, ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoScrollWithMouse);
     {
         // Card header with title
         igPushFont(imgui_config_get_font(FT_HEADER_2), g_font_size_header_2);
@@ -400,6 +190,90 @@ void draw_card(visual_novel* vn) {
     igPopStyleColor(2);
 }
 
+// selection of [s_sort_key], the order is computed again when it changes
+static void draw_sort_selection(void) {
+
+    static const char* field_names[] = { "Title", "Rating", "Progress", "Chapters" };
+    int field = (int)s_sort_key.field;
+    igSetNextItemWidth(150.0f);
+    if (igCombo_Str_arr("Sort by", &field, field_names, (int)(sizeof(field_names) / sizeof(field_names[0])), -1)) {
+        s_sort_key.field = (library_sort_field)field;
+        s_display_order_revision = UINT64_MAX;
+    }
+    igSameLine(0, -1.0f);
+    bool descending = s_sort_key.descending;
+    if (igCheckbox("Descending", &descending)) {
+        s_sort_key.descending = descending;
+        s_display_order_revision = UINT64_MAX;
+    }
+}
+
+// sorts again if the library or [s_sort_key] changed since the last frame
+static void update_display_order(void) {
+
+    const u64 revision = library_revision();                        // read before sorting, a change during the sort is picked up next frame
+    if (revision == s_display_order_revision) return;
+
+    // entries with an equal key are ordered by title
+    const library_sort_key keys[] = { s_sort_key, { .field = LIBRARY_SORT_TITLE, .descending = false } };
+    const u32 key_count = (s_sort_key.field == LIBRARY_SORT_TITLE) ? 1 : 2;
+    VALIDATE(library_sort(keys, key_count, &s_display_order) == AT_SUCCESS, , "", "Failed to sort the library, showing it unsorted")
+    s_display_order_revision = revision;
+}
+
+// draws the cards of the rows in the scrolled region in the display order, their entries are copied into the frame arena (reset after the frame)
+static void draw_card_grid(void) {
+
+    update_display_order();
+    const size_t novel_count = library_size();
+    if (novel_count == 0) {
+        igText("No visual novels added yet.");
+        return;
+    }
+
+    // Calculate how many cards per row based on available width
+    size_t cards_per_row = (size_t)(igGetWindowWidth() / (CARD_WIDTH + CARD_SPACING));
+    if (cards_per_row < 1) cards_per_row = 1;
+    const size_t row_count = (novel_count + cards_per_row - 1) / cards_per_row;
+
+    // rows outside of the window are not drawn, only their space is reserved
+    const float row_height = CARD_HEIGHT + CARD_SPACING;
+    const float grid_top = igGetCursorPosY();
+    const float visible_top = igGetScrollY() - grid_top;
+    const float visible_bottom = visible_top + igGetWindowHeight();
+    size_t first_row = (visible_top > 0) ? (size_t)(visible_top / row_height) : 0;
+    size_t end_row = (visible_bottom > 0) ? (size_t)(visible_bottom / row_height) + 1 : 0;
+    if (end_row > row_count) end_row = row_count;
+    if (first_row > end_row) first_row = end_row;
+
+    const size_t first = first_row * cards_per_row;
+    size_t count = end_row * cards_per_row - first;
+    if (count > novel_count - first) count = novel_count - first;
+
+    if (count > 0) {
+        arena* frame_arena = application_get_frame_arena();
+        u32* indices = arena_alloc(frame_arena, count * sizeof(u32));
+        visual_novel* cards = arena_alloc(frame_arena, count * sizeof(visual_novel));
+        const b8 sorted = (darray_size(&s_display_order) == novel_count);        // library order if sorting failed or the library just changed
+        if (indices && cards) {
+            for (size_t x = 0; x < count; x++)
+                indices[x] = sorted ? darray_at(&s_display_order, u32, first + x) : (u32)(first + x);
+        }
+        if (!indices || !cards || library_get_many(indices, count, cards) != AT_SUCCESS)
+            count = 0;
+
+        igSetCursorPosY(grid_top + (float)first_row * row_height);
+        for (size_t x = 0; x < count; x++) {
+            if (x % cards_per_row != 0)
+                igSameLine(0, CARD_SPACING);
+            draw_card(&cards[x]);
+        }
+    }
+
+    igSetCursorPosY(grid_top + (float)row_count * row_height);
+    igDummy((ImVec2){0, 0});                                        // extends the scroll region to the last row
+}
+
 //
 void dashboard_draw(__attribute_maybe_unused__ const f32 delta_time) {
 
@@ -445,35 +319,15 @@ void dashboard_draw(__attribute_maybe_unused__ const f32 delta_time) {
         igPushFont(imgui_config_get_font(FT_GIANT), g_font_size_giant);
         igText("Visual Novels Collection");
         igPopFont();
+
+        if (library_is_read_only())
+            igTextColored((ImVec4){1.0f, 0.6f, 0.2f, 1.0f}, "The library file was written by a newer version, changes are not saved");
         
+        draw_sort_selection();
+
         igSeparator();
         igSpacing();
 
-    #if 0
-        // Cards grid
-        size_t novel_count = darray_size(&visual_novels);
-        if (novel_count > 0) {
-            // Calculate how many cards per row based on available width
-            float available_width = igGetWindowWidth();
-            float card_width = 300.0f;
-            float spacing = 16.0f;
-            int cards_per_row = (int)(available_width / (card_width + spacing));
-            if (cards_per_row < 1) cards_per_row = 1;
-            
-            int current_card = 0;
-            for (size_t i = 0; i < novel_count; i++) {
-                visual_novel vn = {0};
-                darray_get(&visual_novels, i, &vn);
-                    if (current_card > 0 && current_card % cards_per_row != 0) {
-                        igSameLine(0, spacing);
-                    }
-                    draw_card(&vn);
-                    current_card++;
-            }
-        } else
-            igText("No visual novels added yet.");
-    #else
-        
         // TODO: display a test image at [<get_executable_path()>/images/test_image.png]
 
         ImVec2 image_size = {80, 120};
@@ -490,8 +344,7 @@ void dashboard_draw(__attribute_maybe_unused__ const f32 delta_time) {
         
         igImage(image_get_texture_id(&test_image), image_size, (ImVec2){0,0}, (ImVec2){1,1});
 
-
-    #endif
+        draw_card_grid();
         
         igPopStyleVar(2);
     }
@@ -0,0 +1,1346 @@
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#include "util/io/logger.h"
+#include "util/io/file_watcher.h"
+#include "util/io/serializer_yaml.h"
+#include "util/data_structure/darray.h"
+#include "util/data_structure/small_vector.h"
+#include "util/data_structure/sort.h"
+#include "util/system.h"
+
+#include "library.h"
+
+
+#define SECTION_NAME        "general_data"
+#define SEQUENCE_NAME       "visual_novels"
+#define SCHEMA_KEY          "schema_version"
+
+
+// ============================================================================================================================================
+// pages
+// ============================================================================================================================================
+
+// record loaded from a file of an older schema version, kept as text until the entry is accessed the first time
+typedef struct {
+    size_t              offset;                 // into [s_library.raw_records]
+    u32                 len;
+    u32                 version;
+} pending_record;
+
+typedef struct {
+    atomic_uint         ref_count;              // the store and every snapshot that contains this page
+    u32                 count;
+    u64                 pending_entries;        // bit per entry that is still stored in [pending] instead of [entries]
+    pending_record      pending[LIBRARY_PAGE_SIZE];
+    visual_novel        entries[LIBRARY_PAGE_SIZE];
+} library_page;
+
+typedef struct {
+    library_page*       page;
+    u64                 dirty_entries;          // bit per entry, set by mutations and cleared when a snapshot is taken
+} page_slot;
+
+STATIC_ASSERT(LIBRARY_PAGE_SIZE <= 64, "dirty entries of a page are tracked in a u64");
+
+
+static library_page* page_create(void) {
+
+    library_page* page = malloc(sizeof(library_page));
+    if (!page) return NULL;
+
+    atomic_init(&page->ref_count, 1);
+    page->count = 0;
+    page->pending_entries = 0;
+    return page;
+}
+
+static void page_release(library_page* page) {
+
+    if (atomic_fetch_sub_explicit(&page->ref_count, 1, memory_order_acq_rel) == 1)
+        free(page);
+}
+
+// returns the page of [slot] for modification, duplicates it first if a snapshot still references it
+// snapshots are only taken with the library mutex held, so the reference count can not grow while it is checked
+static library_page* page_writable(page_slot* slot) {
+
+    if (atomic_load_explicit(&slot->page->ref_count, memory_order_acquire) == 1)
+        return slot->page;
+
+    library_page* copy = page_create();
+    if (!copy) return NULL;
+
+    copy->count = slot->page->count;
+    copy->pending_entries = slot->page->pending_entries;
+    memcpy(copy->pending, slot->page->pending, copy->count * sizeof(pending_record));
+    memcpy(copy->entries, slot->page->entries, copy->count * sizeof(visual_novel));
+    page_release(slot->page);
+    slot->page = copy;
+    return copy;
+}
+
+// bits [first, first + count) of a page dirty mask
+static inline u64 entry_mask(const u32 first, const u32 count) {
+
+    const u64 bits = (count >= 64) ? ~0ULL : ((1ULL << count) - 1);
+    return bits << first;
+}
+
+
+// ============================================================================================================================================
+// schema migration
+// ============================================================================================================================================
+
+// upgrades the "key: value\n" lines of one record from schema version [index] to [index + 1] in place.
+// Migrations work on the text, so they do not depend on struct layouts that no longer exist.
+// NULL if the record layout did not change between the two versions.
+typedef void (*record_migration)(dyn_str* record);
+
+static const record_migration s_migrations[LIBRARY_SCHEMA_VERSION] = {
+    [0] = NULL,                                 // files before schema versioning, only the [schema_version] header was added
+};
+
+static struct {
+    pthread_mutex_t     mutex;                  // protects all members below except [save_mutex]
+    pthread_cond_t      cond;                   // signaled by mutations and shutdown
+    darray              slots;                  // [page_slot], all pages except the last one are full
+    size_t              count;
+    b8                  section_dirty;          // entries were added/removed or a save failed, the section has to be written
+    b8                  file_outdated;          // the file has an older schema or external changes that are not applied, every entry has to be written
+    b8                  has_unsaved;            // any mutation since the last snapshot
+    u64                 generation;             // incremented by every mutation through the public functions
+    u64                 revision;               // incremented by every change of the entries, including applied reloads
+    b8                  read_only;              // the file has a newer schema version, saving would drop the keys this version does not know
+    b8                  resolving;              // the autosave thread decodes the pending entries, library_sort() keeps the library order until then
+    f64                 dirty_since;            // get_precise_time() of the first unsaved mutation
+    b8                  running;
+    b8                  thread_started;
+    pthread_t           thread;
+    pthread_mutex_t     save_mutex;             // serializes file writes, always taken before [mutex]
+    char                dir_path[PATH_MAX];
+    char                file_name[PATH_MAX];
+    char*               raw_records;            // text of all [pending_record]s, only written while loading
+    u64                 next_reload_id;         // incremented by every external change of the section
+    u64                 reload_id;              // reload staged in [reload_slots], 0 if none
+    u64                 dropped_reload_id;      // reload whose diffs could not all be posted, its diffs are skipped
+    darray              reload_slots;           // [page_slot], copy of the library with the diffs of [reload_id] applied so far
+    size_t              reload_count;
+    size_t              raw_records_len;
+    size_t              raw_records_cap;
+} s_library = { .mutex = PTHREAD_MUTEX_INITIALIZER, .save_mutex = PTHREAD_MUTEX_INITIALIZER };
+
+
+// migrates the "key: value\n" lines of a record of schema [version] and decodes them into [out]
+static void decode_record_text(const char* text, size_t text_len, const u32 version, visual_novel* out) {
+
+    dyn_str migrated = {0};
+    b8 migrated_used = false;
+    for (u32 loc_version = version; loc_version < LIBRARY_SCHEMA_VERSION; loc_version++) {
+        if (!s_migrations[loc_version]) continue;
+
+        if (!migrated_used) {
+            ds_init(&migrated);
+            ds_append_str_n(&migrated, text, text_len);
+            migrated_used = true;
+        }
+        s_migrations[loc_version](&migrated);
+    }
+    if (migrated_used) {
+        text = migrated.data;
+        text_len = migrated.len;
+    }
+
+    memset(out, 0, sizeof(*out));
+    sy_decode_fields(text, text_len, out, visual_novel_fields, SY_FIELD_COUNT(visual_novel_fields));
+    if (migrated_used)
+        ds_free(&migrated);
+}
+
+// decodes a pending record, does not need the library mutex because [raw_records] does not change after loading
+static void decode_record(const pending_record* record, visual_novel* out) { decode_record_text(s_library.raw_records + record->offset, record->len, record->version, out); }
+
+// [s_library.mutex] has to be held, returns the entry at [index] and decodes it first if it is still pending
+static const visual_novel* entry_resolve_locked(const size_t index) {
+
+    page_slot* slot = &darray_at(&s_library.slots, page_slot, index / LIBRARY_PAGE_SIZE);
+    const u32 entry = (u32)(index % LIBRARY_PAGE_SIZE);
+    if (!(slot->page->pending_entries & entry_mask(entry, 1)))
+        return &slot->page->entries[entry];
+
+    library_page* page = page_writable(slot);
+    if (!page) return NULL;
+
+    decode_record(&page->pending[entry], &page->entries[entry]);
+    page->pending_entries &= ~entry_mask(entry, 1);
+    return &page->entries[entry];
+}
+
+// true if a record of schema [version] has to be migrated before it can be decoded
+static b8 migration_needed(const u32 version) {
+
+    for (u32 loc_version = version; loc_version < LIBRARY_SCHEMA_VERSION; loc_version++)
+        if (s_migrations[loc_version]) return true;
+    return false;
+}
+
+// [s_library.mutex] has to be held, the library is not saved anymore in this session if [schema_version] is newer than supported
+static void check_schema_version_locked(const u32 schema_version) {
+
+    if (schema_version <= LIBRARY_SCHEMA_VERSION || s_library.read_only) return;
+
+    s_library.read_only = true;
+    LOG(Error, "Library file [%s/%s] has a newer schema version [%u] than supported [%u], it is opened read only and changes are not saved",
+        s_library.dir_path, s_library.file_name, schema_version, LIBRARY_SCHEMA_VERSION)
+}
+
+// [s_library.mutex] has to be held
+static void mark_unsaved(void) {
+
+    if (!s_library.has_unsaved) {
+        s_library.has_unsaved = true;
+        s_library.dirty_since = get_precise_time();
+        pthread_cond_signal(&s_library.cond);
+    }
+}
+
+// [s_library.mutex] has to be held, returns the writable last page after making sure it has space for at least one entry
+static library_page* last_page_with_space_locked(page_slot** out_slot) {
+
+    const size_t slot_count = darray_size(&s_library.slots);
+    if (slot_count == 0 || darray_at(&s_library.slots, page_slot, slot_count - 1).page->count == LIBRARY_PAGE_SIZE) {
+        page_slot new_slot = { page_create(), 0 };
+        if (!new_slot.page) return NULL;
+        if (darray_push_back(&s_library.slots, &new_slot) != AT_SUCCESS) {
+            page_release(new_slot.page);
+            return NULL;
+        }
+    }
+
+    *out_slot = &darray_at(&s_library.slots, page_slot, darray_size(&s_library.slots) - 1);
+    return page_writable(*out_slot);
+}
+
+// [s_library.mutex] has to be held, marks the new entries dirty but not the library as unsaved
+static i32 append_locked(const visual_novel* entries, const size_t count) {
+
+    size_t done = 0;
+    while (done < count) {
+
+        page_slot* slot = NULL;
+        library_page* page = last_page_with_space_locked(&slot);
+        if (!page) return AT_MEMORY_ERROR;
+
+        const size_t remaining = count - done;
+        const u32 copy_count = (remaining < LIBRARY_PAGE_SIZE - page->count) ? (u32)remaining : LIBRARY_PAGE_SIZE - page->count;
+        memcpy(&page->entries[page->count], entries + done, copy_count * sizeof(visual_novel));
+        page->pending_entries &= ~entry_mask(page->count, copy_count);
+        slot->dirty_entries |= entry_mask(page->count, copy_count);
+        page->count += copy_count;
+        s_library.count += copy_count;
+        done += copy_count;
+    }
+
+    s_library.section_dirty = true;
+    return AT_SUCCESS;
+}
+
+// append callback for sy_loop_fields() while loading
+static i32 load_append(__attribute_maybe_unused__ void* data_structure, void* element) { return append_locked((const visual_novel*)element, 1); }
+
+// record callback for sy_loop_records() while loading a file of an older schema version [*data_structure]
+static void load_pending(void* data_structure, const char* record, const size_t record_len) {
+
+    if (s_library.raw_records_len + record_len > s_library.raw_records_cap) {
+        size_t new_cap = (s_library.raw_records_cap > 0) ? s_library.raw_records_cap * 2 : 64 * 1024;
+        while (new_cap < s_library.raw_records_len + record_len)
+            new_cap *= 2;
+
+        char* new_records = realloc(s_library.raw_records, new_cap);
+        VALIDATE(new_records, return, "", "Failed to allocate [%zu] bytes for pending records", new_cap)
+        s_library.raw_records = new_records;
+        s_library.raw_records_cap = new_cap;
+    }
+
+    page_slot* slot = NULL;
+    library_page* page = last_page_with_space_locked(&slot);
+    VALIDATE(page, return, "", "Failed to allocate library page")
+
+    page->pending[page->count] = (pending_record){ s_library.raw_records_len, (u32)record_len, *(const u32*)data_structure };
+    page->pending_entries |= entry_mask(page->count, 1);
+    page->count++;
+    s_library.count++;
+
+    memcpy(s_library.raw_records + s_library.raw_records_len, record, record_len);
+    s_library.raw_records_len += record_len;
+}
+
+
+// [s_library.mutex] has to be held and [index] valid, marks the moved entries dirty but not the library as unsaved
+static i32 remove_locked(const size_t index) {
+
+    // close the gap page by page, every full page pulls in the first entry of the next one
+    size_t page_index = index / LIBRARY_PAGE_SIZE;
+    u32 entry_index = (u32)(index % LIBRARY_PAGE_SIZE);
+    for (;;) {
+        page_slot* slot = &darray_at(&s_library.slots, page_slot, page_index);
+        library_page* page = page_writable(slot);
+        if (!page) return AT_MEMORY_ERROR;
+
+        memmove(&page->entries[entry_index], &page->entries[entry_index + 1], (page->count - entry_index - 1) * sizeof(visual_novel));
+        memmove(&page->pending[entry_index], &page->pending[entry_index + 1], (page->count - entry_index - 1) * sizeof(pending_record));
+        page->pending_entries = (page->pending_entries & entry_mask(0, entry_index)) | ((page->pending_entries >> 1) & ~entry_mask(0, entry_index));
+        slot->dirty_entries |= entry_mask(entry_index, page->count - entry_index);
+
+        if (page_index + 1 < darray_size(&s_library.slots)) {
+            const library_page* next = darray_at(&s_library.slots, page_slot, page_index + 1).page;
+            memcpy(&page->entries[page->count - 1], &next->entries[0], sizeof(visual_novel));
+            page->pending[page->count - 1] = next->pending[0];
+            if (next->pending_entries & 1)
+                page->pending_entries |= entry_mask(page->count - 1, 1);
+            page_index++;
+            entry_index = 0;
+            continue;
+        }
+
+        page->count--;
+        if (page->count == 0) {
+            page_release(page);
+            darray_pop_back(&s_library.slots, NULL);
+        }
+        break;
+    }
+
+    s_library.count--;
+    return AT_SUCCESS;
+}
+
+// [s_library.mutex] has to be held and [index] <= count, marks the moved entries dirty but not the library as unsaved
+static i32 insert_locked(const size_t index, const visual_novel* vn) {
+
+    if (index == s_library.count)
+        return append_locked(vn, 1);
+
+    // open a gap page by page, every full page pushes its last entry to the front of the next one
+    visual_novel carry = *vn;
+    pending_record carry_pending = {0};
+    b8 carry_is_pending = false;
+    size_t page_index = index / LIBRARY_PAGE_SIZE;
+    u32 entry_index = (u32)(index % LIBRARY_PAGE_SIZE);
+    for (;;) {
+        page_slot* slot = NULL;
+        library_page* page = NULL;
+        if (page_index < darray_size(&s_library.slots)) {
+            slot = &darray_at(&s_library.slots, page_slot, page_index);
+            page = page_writable(slot);
+        } else
+            page = last_page_with_space_locked(&slot);                  // the last page was full
+        if (!page) return AT_MEMORY_ERROR;
+
+        const b8 full = (page->count == LIBRARY_PAGE_SIZE);
+        visual_novel last = {0};
+        pending_record last_pending = {0};
+        const b8 last_is_pending = full && (page->pending_entries & entry_mask(LIBRARY_PAGE_SIZE - 1, 1));
+        if (full) {
+            last = page->entries[LIBRARY_PAGE_SIZE - 1];
+            last_pending = page->pending[LIBRARY_PAGE_SIZE - 1];
+        }
+
+        const u32 move_count = (full ? LIBRARY_PAGE_SIZE - 1 : page->count) - entry_index;
+        memmove(&page->entries[entry_index + 1], &page->entries[entry_index], move_count * sizeof(visual_novel));
+        memmove(&page->pending[entry_index + 1], &page->pending[entry_index], move_count * sizeof(pending_record));
+        page->pending_entries = (page->pending_entries & entry_mask(0, entry_index)) | ((page->pending_entries << 1) & ~entry_mask(0, entry_index + 1));
+        page->pending_entries &= entry_mask(0, LIBRARY_PAGE_SIZE);
+        page->entries[entry_index] = carry;
+        page->pending[entry_index] = carry_pending;
+        if (carry_is_pending)
+            page->pending_entries |= entry_mask(entry_index, 1);
+
+        if (!full) {
+            page->count++;
+            slot->dirty_entries |= entry_mask(entry_index, page->count - entry_index);
+            break;
+        }
+
+        slot->dirty_entries |= entry_mask(entry_index, LIBRARY_PAGE_SIZE - entry_index);
+        carry = last;
+        carry_pending = last_pending;
+        carry_is_pending = last_is_pending;
+        page_index++;
+        entry_index = 0;
+    }
+
+    s_library.count++;
+    return AT_SUCCESS;
+}
+
+
+// ============================================================================================================================================
+// snapshot
+// ============================================================================================================================================
+
+// read only state of the library at one point in time, shares its pages with the store
+typedef struct {
+    library_page**      pages;
+    size_t              page_count;
+    size_t              count;
+    u64*                dirty_entries;          // [page_count] masks of the entries changed since the previous snapshot, only set by snapshot_take_locked()
+    b8                  full;                   // every entry has to be written, not only the dirty ones
+    u64                 reload_id;              // [s_library.next_reload_id] when the snapshot was taken
+} library_snapshot;
+
+
+// [s_library.mutex] has to be held, the dirty state stays in the store
+static b8 snapshot_share_locked(library_snapshot* snapshot) {
+
+    memset(snapshot, 0, sizeof(*snapshot));
+    snapshot->page_count = darray_size(&s_library.slots);
+    snapshot->pages = malloc((snapshot->page_count > 0 ? snapshot->page_count : 1) * sizeof(library_page*));
+    if (!snapshot->pages) return false;
+
+    for (size_t x = 0; x < snapshot->page_count; x++) {
+        page_slot* slot = &darray_at(&s_library.slots, page_slot, x);
+        atomic_fetch_add_explicit(&slot->page->ref_count, 1, memory_order_relaxed);
+        snapshot->pages[x] = slot->page;
+    }
+    snapshot->count = s_library.count;
+    return true;
+}
+
+// [s_library.mutex] has to be held, takes the dirty state over into the snapshot
+static b8 snapshot_take_locked(library_snapshot* snapshot) {
+
+    if (!snapshot_share_locked(snapshot)) return false;
+
+    snapshot->dirty_entries = malloc((snapshot->page_count > 0 ? snapshot->page_count : 1) * sizeof(u64));
+    if (!snapshot->dirty_entries) {
+        for (size_t x = 0; x < snapshot->page_count; x++)
+            page_release(snapshot->pages[x]);
+        free(snapshot->pages);
+        return false;
+    }
+
+    for (size_t x = 0; x < snapshot->page_count; x++) {
+        page_slot* slot = &darray_at(&s_library.slots, page_slot, x);
+        snapshot->dirty_entries[x] = slot->dirty_entries;
+        slot->dirty_entries = 0;
+    }
+    snapshot->full = s_library.section_dirty || s_library.file_outdated;
+    snapshot->reload_id = s_library.next_reload_id;
+
+    s_library.has_unsaved = false;
+    s_library.section_dirty = false;
+    return true;
+}
+
+static void snapshot_release(library_snapshot* snapshot) {
+
+    for (size_t x = 0; x < snapshot->page_count; x++)
+        page_release(snapshot->pages[x]);
+    free(snapshot->pages);
+    free(snapshot->dirty_entries);
+    memset(snapshot, 0, sizeof(*snapshot));
+}
+
+static i32 snapshot_get(void* data_structure, const u64 index, void* element) {
+
+    const library_snapshot* snapshot = (const library_snapshot*)data_structure;
+    if (index >= snapshot->count) return AT_RANGE_ERROR;
+
+    // pages of a snapshot are shared and read only, pending entries are decoded into [element] without resolving them
+    const library_page* page = snapshot->pages[index / LIBRARY_PAGE_SIZE];
+    const u32 entry = (u32)(index % LIBRARY_PAGE_SIZE);
+    if (page->pending_entries & entry_mask(entry, 1))
+        decode_record(&page->pending[entry], (visual_novel*)element);
+    else
+        memcpy(element, &page->entries[entry], sizeof(visual_novel));
+    return AT_SUCCESS;
+}
+
+static size_t snapshot_size(void* data_structure) { return ((const library_snapshot*)data_structure)->count; }
+
+static b8 snapshot_changed(void* data_structure, const u64 index) {
+
+    const library_snapshot* snapshot = (const library_snapshot*)data_structure;
+    return (snapshot->dirty_entries[index / LIBRARY_PAGE_SIZE] & entry_mask((u32)(index % LIBRARY_PAGE_SIZE), 1)) != 0;
+}
+
+static size_t snapshot_changed_count(const library_snapshot* snapshot) {
+
+    size_t count = 0;
+    for (size_t x = 0; x < snapshot->page_count; x++)
+        count += (size_t)__builtin_popcountll(snapshot->dirty_entries[x]);
+    return count;
+}
+
+
+// snapshots the unsaved state and writes it without holding the library mutex, mutations can continue meanwhile.
+// Only the changed entries are formatted unless entries were added/removed or the file is outdated, the others are copied from the file
+// @return true if nothing was unsaved or the save succeeded
+static b8 save_unsaved(void) {
+
+    pthread_mutex_lock(&s_library.save_mutex);
+    pthread_mutex_lock(&s_library.mutex);
+
+    if (!s_library.has_unsaved && !s_library.section_dirty) {
+        pthread_mutex_unlock(&s_library.mutex);
+        pthread_mutex_unlock(&s_library.save_mutex);
+        return true;
+    }
+
+    // the autosave thread waits for the next mutation instead of retrying
+    if (s_library.read_only) {
+        s_library.has_unsaved = false;
+        pthread_mutex_unlock(&s_library.mutex);
+        pthread_mutex_unlock(&s_library.save_mutex);
+        LOG(Warn, "Library is read only (the file has a newer schema version), changes are not saved to [%s/%s]", s_library.dir_path, s_library.file_name)
+        return false;
+    }
+
+    library_snapshot snapshot;
+    b8 success = snapshot_take_locked(&snapshot);
+    pthread_mutex_unlock(&s_library.mutex);
+
+    if (success) {
+        const f64 start = get_precise_time();
+        SY sy = {0};
+        success = sy_init(&sy, s_library.dir_path, s_library.file_name, SECTION_NAME, SERIALIZER_OPTION_SAVE);
+        if (success) {
+            u32 schema_version = LIBRARY_SCHEMA_VERSION;
+            sy_entry(&sy, SCHEMA_KEY, &schema_version, SY_TYPE_U32);
+            if (snapshot.full)
+                sy_loop_fields(&sy, SEQUENCE_NAME, &snapshot, sizeof(visual_novel), visual_novel_fields, SY_FIELD_COUNT(visual_novel_fields),
+                    snapshot_get, load_append, snapshot_size);
+            else
+                sy_loop_fields_changed(&sy, SEQUENCE_NAME, &snapshot, sizeof(visual_novel), visual_novel_fields, SY_FIELD_COUNT(visual_novel_fields),
+                    snapshot_get, snapshot_changed, snapshot_size);
+            sy_shutdown(&sy);
+            LOG(Trace, "Saved library [%zu entries, %zu changed%s] in [%.2f ms]", snapshot.count, snapshot_changed_count(&snapshot),
+                snapshot.full ? ", all written" : "", (get_precise_time() - start) * 1000.0)
+        }
+
+        pthread_mutex_lock(&s_library.mutex);                       // the file matches the store unless it was changed externally meanwhile
+        if (success && snapshot.full && s_library.next_reload_id == snapshot.reload_id)
+            s_library.file_outdated = false;
+        pthread_mutex_unlock(&s_library.mutex);
+        snapshot_release(&snapshot);
+    }
+
+    if (!success) {                                                 // write everything again on the next attempt
+        LOG(Warn, "Failed to save library to [%s/%s], retrying in [%.1f s]", s_library.dir_path, s_library.file_name, LIBRARY_AUTOSAVE_DELAY)
+        pthread_mutex_lock(&s_library.mutex);
+        s_library.section_dirty = true;
+        mark_unsaved();
+        pthread_mutex_unlock(&s_library.mutex);
+    }
+
+    pthread_mutex_unlock(&s_library.save_mutex);
+    return success;
+}
+
+
+// ============================================================================================================================================
+// autosave
+// ============================================================================================================================================
+
+// [s_library.mutex] has to be held and is released while the pending entries of the first page that has any are decoded into [decoded]
+// (LIBRARY_PAGE_SIZE entries). Entries can be removed, updated or moved meanwhile, only the ones that still hold the same record are replaced.
+// @return true if entries may still be pending, false when all are resolved or a page could not be copied
+static b8 resolve_step_locked(visual_novel* decoded) {
+
+    size_t page_index = 0;
+    while (page_index < darray_size(&s_library.slots) && !darray_at(&s_library.slots, page_slot, page_index).page->pending_entries)
+        page_index++;
+    if (page_index == darray_size(&s_library.slots)) return false;
+
+    const library_page* page = darray_at(&s_library.slots, page_slot, page_index).page;
+    const u64 pending = page->pending_entries;
+    pending_record records[LIBRARY_PAGE_SIZE];
+    memcpy(records, page->pending, page->count * sizeof(pending_record));
+
+    pthread_mutex_unlock(&s_library.mutex);
+    for (u32 entry = 0; entry < LIBRARY_PAGE_SIZE; entry++)
+        if (pending & entry_mask(entry, 1))
+            decode_record(&records[entry], &decoded[entry]);
+    pthread_mutex_lock(&s_library.mutex);
+
+    if (page_index >= darray_size(&s_library.slots)) return true;
+    page_slot* slot = &darray_at(&s_library.slots, page_slot, page_index);
+    for (u32 entry = 0; entry < LIBRARY_PAGE_SIZE; entry++) {
+        const u64 mask = entry_mask(entry, 1);
+        if (!(pending & mask) || !(slot->page->pending_entries & mask) || slot->page->pending[entry].offset != records[entry].offset)
+            continue;
+
+        library_page* writable = page_writable(slot);
+        VALIDATE(writable, return false, "", "Failed to copy a library page, the remaining entries are decoded on access")
+        writable->entries[entry] = decoded[entry];
+        writable->pending_entries &= ~mask;
+    }
+    return true;
+}
+
+static void* autosave_thread(__attribute_maybe_unused__ void* arg) {
+
+    LOGGER_REGISTER_THREAD_LABEL("autosave")
+
+    visual_novel* decoded = NULL;
+    pthread_mutex_lock(&s_library.mutex);
+    while (s_library.running) {
+
+        // pending entries are resolved page by page unless a save is due
+        if (s_library.resolving && (!s_library.has_unsaved || get_precise_time() < s_library.dirty_since + LIBRARY_AUTOSAVE_DELAY)) {
+            if (!decoded)
+                decoded = malloc(LIBRARY_PAGE_SIZE * sizeof(visual_novel));
+            s_library.resolving = decoded && resolve_step_locked(decoded);
+            if (!s_library.resolving)
+                s_library.revision++;                               // lets the dashboard sort the library
+            continue;
+        }
+
+        if (!s_library.has_unsaved) {
+            pthread_cond_wait(&s_library.cond, &s_library.mutex);
+            continue;
+        }
+
+        // the deadline is not moved by further mutations, this bounds the time until a change is saved
+        const f64 deadline = s_library.dirty_since + LIBRARY_AUTOSAVE_DELAY;
+        if (get_precise_time() < deadline) {
+            struct timespec wake_time;
+            wake_time.tv_sec = (time_t)deadline;
+            wake_time.tv_nsec = (long)((deadline - floor(deadline)) * 1e9);
+            pthread_cond_timedwait(&s_library.cond, &s_library.mutex, &wake_time);
+            continue;
+        }
+
+        pthread_mutex_unlock(&s_library.mutex);                     // [save_mutex] has to be taken first
+        save_unsaved();
+        pthread_mutex_lock(&s_library.mutex);
+    }
+    pthread_mutex_unlock(&s_library.mutex);
+    free(decoded);
+
+    logger_remove_thread_label_by_id((u64)pthread_self());
+    return NULL;
+}
+
+
+// ============================================================================================================================================
+// init
+// ============================================================================================================================================
+
+static void reload_discard_locked(void);                            // see hot reload
+
+b8 library_init(const char* dir_path, const char* file_name) {
+
+    VALIDATE(dir_path && file_name && strlen(dir_path) < PATH_MAX && strlen(file_name) < PATH_MAX, return false, "", "Invalid library path")
+
+    pthread_mutex_lock(&s_library.mutex);
+    VALIDATE(!s_library.running, pthread_mutex_unlock(&s_library.mutex); return false, "", "Library is already initialized")
+
+    strcpy(s_library.dir_path, dir_path);
+    strcpy(s_library.file_name, file_name);
+    darray_init(&s_library.slots, sizeof(page_slot));
+
+    pthread_condattr_t cond_attr;                                   // deadlines are based on get_precise_time()
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&s_library.cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+
+    SY sy = {0};
+    u32 schema_version = 0;                                         // files without the header predate schema versioning
+    if (sy_init(&sy, dir_path, file_name, SECTION_NAME, SERIALIZER_OPTION_LOAD)) {
+        sy_entry(&sy, SCHEMA_KEY, &schema_version, SY_TYPE_U32);
+        check_schema_version_locked(schema_version);                // unknown keys are ignored while decoding
+
+        // decoded and migrated by the autosave thread or on first access, rewritten by the next save
+        s_library.resolving = migration_needed(schema_version);
+        if (s_library.resolving)
+            sy_loop_records(&sy, SEQUENCE_NAME, &schema_version, load_pending);
+        else
+            sy_loop_fields(&sy, SEQUENCE_NAME, NULL, sizeof(visual_novel), visual_novel_fields, SY_FIELD_COUNT(visual_novel_fields),
+                snapshot_get, load_append, snapshot_size);
+        sy_shutdown(&sy);
+    } else
+        LOG(Warn, "Failed to load library from [%s/%s], starting empty", dir_path, file_name)
+
+    for (size_t x = 0; x < darray_size(&s_library.slots); x++)     // loaded content matches the file
+        darray_at(&s_library.slots, page_slot, x).dirty_entries = 0;
+    s_library.section_dirty = false;
+    s_library.file_outdated = (schema_version != LIBRARY_SCHEMA_VERSION);    // records of an older schema are written again
+    s_library.has_unsaved = false;
+
+    s_library.running = true;
+    s_library.thread_started = (pthread_create(&s_library.thread, NULL, autosave_thread, NULL) == 0);
+    s_library.resolving &= s_library.thread_started;                // without the thread library_sort() resolves the entries
+    const size_t count = s_library.count;
+    pthread_mutex_unlock(&s_library.mutex);
+
+    VALIDATE(s_library.thread_started, , "", "Failed to start autosave thread, changes are only saved on shutdown")
+    LOG(Trace, "Loaded library with [%zu] entries of schema version [%u]", count, schema_version)
+    return true;
+}
+
+
+void library_shutdown(void) {
+
+    pthread_mutex_lock(&s_library.mutex);
+    const b8 was_running = s_library.running;
+    s_library.running = false;
+    pthread_cond_signal(&s_library.cond);
+    pthread_mutex_unlock(&s_library.mutex);
+    if (!was_running) return;
+
+    if (s_library.thread_started)
+        pthread_join(s_library.thread, NULL);
+    s_library.thread_started = false;
+
+    library_flush();
+
+    pthread_mutex_lock(&s_library.mutex);
+    reload_discard_locked();
+    for (size_t x = 0; x < darray_size(&s_library.slots); x++)
+        page_release(darray_at(&s_library.slots, page_slot, x).page);
+    darray_free(&s_library.slots);
+    s_library.count = 0;
+    free(s_library.raw_records);
+    s_library.raw_records = NULL;
+    s_library.raw_records_len = s_library.raw_records_cap = 0;
+    s_library.read_only = false;
+    s_library.resolving = false;
+    pthread_mutex_unlock(&s_library.mutex);
+    pthread_cond_destroy(&s_library.cond);
+}
+
+
+b8 library_flush(void) { return save_unsaved(); }
+
+
+// ============================================================================================================================================
+// access
+// ============================================================================================================================================
+
+b8 library_is_read_only(void) {
+
+    pthread_mutex_lock(&s_library.mutex);
+    const b8 read_only = s_library.read_only;
+    pthread_mutex_unlock(&s_library.mutex);
+    return read_only;
+}
+
+
+size_t library_size(void) {
+
+    pthread_mutex_lock(&s_library.mutex);
+    const size_t count = s_library.count;
+    pthread_mutex_unlock(&s_library.mutex);
+    return count;
+}
+
+
+u64 library_revision(void) {
+
+    pthread_mutex_lock(&s_library.mutex);
+    const u64 revision = s_library.revision;
+    pthread_mutex_unlock(&s_library.mutex);
+    return revision;
+}
+
+
+i32 library_get(const size_t index, visual_novel* out) {
+
+    if (!out) return AT_INVALID_ARGUMENT;
+
+    pthread_mutex_lock(&s_library.mutex);
+    i32 result = AT_RANGE_ERROR;
+    if (index < s_library.count) {
+        const visual_novel* entry = entry_resolve_locked(index);
+        result = AT_MEMORY_ERROR;
+        if (entry) {
+            memcpy(out, entry, sizeof(visual_novel));
+            result = AT_SUCCESS;
+        }
+    }
+    pthread_mutex_unlock(&s_library.mutex);
+    return result;
+}
+
+
+i32 library_get_many(const u32* indices, const size_t count, visual_novel* out) {
+
+    if ((!indices || !out) && count > 0) return AT_INVALID_ARGUMENT;
+
+    pthread_mutex_lock(&s_library.mutex);
+    i32 result = AT_SUCCESS;
+    for (size_t x = 0; x < count && result == AT_SUCCESS; x++) {
+        if (indices[x] >= s_library.count) {
+            result = AT_RANGE_ERROR;
+            break;
+        }
+        const visual_novel* entry = entry_resolve_locked(indices[x]);
+        if (entry)
+            memcpy(&out[x], entry, sizeof(visual_novel));
+        else
+            result = AT_MEMORY_ERROR;
+    }
+    pthread_mutex_unlock(&s_library.mutex);
+    return result;
+}
+
+
+// only called for resolved snapshots, see library_sort()
+static inline const visual_novel* snapshot_entry(const library_snapshot* snapshot, const size_t index)  { return &snapshot->pages[index / LIBRARY_PAGE_SIZE]->entries[index % LIBRARY_PAGE_SIZE]; }
+
+static i32 compare_titles(const u32 a, const u32 b, void* user_data) {
+
+    const library_snapshot* snapshot = (const library_snapshot*)user_data;
+    return strcasecmp(snapshot_entry(snapshot, a)->name, snapshot_entry(snapshot, b)->name);
+}
+
+// first 8 bytes of [name] with ASCII letters in lower case, big endian so that the keys are ordered like strcasecmp()
+static u64 title_prefix(const char* name) {
+
+    u64 key = 0;
+    for (u32 x = 0; x < sizeof(key); x++) {
+        u8 c = (u8)name[x];
+        if (c == '\0')
+            return key << (8 * (sizeof(key) - x));
+        if (c >= 'A' && c <= 'Z')
+            c += 'a' - 'A';
+        key = (key << 8) | c;
+    }
+    return key;
+}
+
+static u64 sort_value(const visual_novel* vn, const library_sort_field field) {
+
+    switch (field) {
+        case LIBRARY_SORT_TITLE:        return title_prefix(vn->name);
+        case LIBRARY_SORT_RATING:       return vn->rating;
+        case LIBRARY_SORT_PROGRESS:     return (vn->chapters_total > 0) ? ((u64)vn->chapters_read << 32) / vn->chapters_total : 0;
+        case LIBRARY_SORT_CHAPTERS:     return vn->chapters_total;
+        default:                        return 0;
+    }
+}
+
+
+i32 library_sort(const library_sort_key* keys, const u32 key_count, darray* order) {
+
+    if (!keys || key_count == 0 || key_count > LIBRARY_SORT_MAX_KEYS || !order || order->element_size != sizeof(u32)) return AT_INVALID_ARGUMENT;
+
+    // every entry is resolved once so the snapshot can be read without decoding, the keys are computed without the mutex.
+    // While the autosave thread resolves the entries of an older file the library order is returned instead of decoding them here
+    library_snapshot snapshot;
+    i32 result = AT_SUCCESS;
+    pthread_mutex_lock(&s_library.mutex);
+    if (s_library.resolving) {
+        const size_t count = s_library.count;
+        pthread_mutex_unlock(&s_library.mutex);
+
+        darray_clear(order);
+        u32* permutation = (count > 0) ? darray_extend_uninit(order, count) : NULL;
+        if (count > 0 && !permutation) return AT_MEMORY_ERROR;
+        if (count > 0)
+            sort_identity(permutation, count);
+        return AT_SUCCESS;
+    }
+    for (size_t x = 0; x < darray_size(&s_library.slots) && result == AT_SUCCESS; x++) {
+        const u64 pending = darray_at(&s_library.slots, page_slot, x).page->pending_entries;
+        for (u32 entry = 0; entry < LIBRARY_PAGE_SIZE && result == AT_SUCCESS; entry++)
+            if ((pending & entry_mask(entry, 1)) && !entry_resolve_locked(x * LIBRARY_PAGE_SIZE + entry))
+                result = AT_MEMORY_ERROR;
+    }
+    if (result == AT_SUCCESS && !snapshot_share_locked(&snapshot))
+        result = AT_MEMORY_ERROR;
+    pthread_mutex_unlock(&s_library.mutex);
+
+    darray_clear(order);
+    if (result != AT_SUCCESS) return result;
+
+    const size_t count = snapshot.count;
+    u32* permutation = (count > 0) ? darray_extend_uninit(order, count) : NULL;
+    u64* values = malloc((count > 0 ? count : 1) * key_count * sizeof(u64));
+    if ((count > 0 && !permutation) || !values)
+        result = AT_MEMORY_ERROR;
+
+    if (result == AT_SUCCESS && count > 0) {
+        sort_key sort_keys[LIBRARY_SORT_MAX_KEYS];
+        for (u32 k = 0; k < key_count; k++) {
+            u64* key_values = values + (size_t)k * count;
+            for (size_t x = 0; x < count; x++)
+                key_values[x] = sort_value(snapshot_entry(&snapshot, x), keys[k].field);
+
+            // titles are sorted by their prefix, only titles with an equal prefix are compared as strings
+            const b8 title = (keys[k].field == LIBRARY_SORT_TITLE);
+            sort_keys[k] = (sort_key){ .keys = key_values, .compare = title ? compare_titles : NULL, .user_data = &snapshot, .descending = keys[k].descending };
+        }
+
+        sort_identity(permutation, count);
+        result = sort_multi(permutation, count, sort_keys, key_count);
+    }
+
+    free(values);
+    snapshot_release(&snapshot);
+    if (result != AT_SUCCESS)
+        darray_clear(order);
+    return result;
+}
+
+
+// ============================================================================================================================================
+// mutation
+// ============================================================================================================================================
+
+i32 library_add(const visual_novel* vn) { return library_append(vn, 1); }
+
+
+i32 library_append(const visual_novel* entries, const size_t count) {
+
+    if (!entries) return AT_INVALID_ARGUMENT;
+    if (count == 0) return AT_SUCCESS;
+
+    pthread_mutex_lock(&s_library.mutex);
+    const i32 result = append_locked(entries, count);
+    s_library.generation++;
+    s_library.revision++;
+    mark_unsaved();                                                 // also after a partial append
+    pthread_mutex_unlock(&s_library.mutex);
+    return result;
+}
+
+
+i32 library_update(const size_t index, const visual_novel* vn) {
+
+    if (!vn) return AT_INVALID_ARGUMENT;
+
+    pthread_mutex_lock(&s_library.mutex);
+    i32 result = AT_RANGE_ERROR;
+    if (index < s_library.count) {
+        page_slot* slot = &darray_at(&s_library.slots, page_slot, index / LIBRARY_PAGE_SIZE);
+        library_page* page = page_writable(slot);
+        result = AT_MEMORY_ERROR;
+        if (page) {
+            memcpy(&page->entries[index % LIBRARY_PAGE_SIZE], vn, sizeof(visual_novel));
+            page->pending_entries &= ~entry_mask(index % LIBRARY_PAGE_SIZE, 1);
+            slot->dirty_entries |= entry_mask(index % LIBRARY_PAGE_SIZE, 1);
+            s_library.generation++;
+            s_library.revision++;
+            mark_unsaved();
+            result = AT_SUCCESS;
+        }
+    }
+    pthread_mutex_unlock(&s_library.mutex);
+    return result;
+}
+
+
+i32 library_remove(const size_t index) {
+
+    pthread_mutex_lock(&s_library.mutex);
+    i32 result = AT_RANGE_ERROR;
+    if (index < s_library.count && (result = remove_locked(index)) == AT_SUCCESS) {
+        s_library.section_dirty = true;
+        s_library.generation++;
+        s_library.revision++;
+        mark_unsaved();
+    }
+    pthread_mutex_unlock(&s_library.mutex);
+    return result;
+}
+
+
+// ============================================================================================================================================
+// import / export
+// ============================================================================================================================================
+
+i32 library_import_file(const char* path, const library_format format, size_t* imported, size_t* skipped) {
+
+    if (imported) *imported = 0;
+
+    darray entries = {0};
+    i32 result = darray_init(&entries, sizeof(visual_novel));
+    if (result != AT_SUCCESS) return result;
+
+    result = library_import(path, format, &entries, skipped);       // parsed without holding the library mutex
+    if (result == AT_SUCCESS)
+        result = library_append((const visual_novel*)entries.data, darray_size(&entries));
+    if (result == AT_SUCCESS && imported)
+        *imported = darray_size(&entries);
+
+    darray_free(&entries);
+    return result;
+}
+
+
+i32 library_export_file(const char* path, const library_format format) {
+
+    library_snapshot snapshot;
+    pthread_mutex_lock(&s_library.mutex);
+    const b8 shared = snapshot_share_locked(&snapshot);
+    pthread_mutex_unlock(&s_library.mutex);
+    if (!shared) return AT_MEMORY_ERROR;
+
+    const i32 result = library_export(path, format, &snapshot, snapshot.count, snapshot_get);
+    snapshot_release(&snapshot);
+    return result;
+}
+
+
+// ============================================================================================================================================
+// hot reload
+// ============================================================================================================================================
+
+#define RELOAD_CHUNK_SIZE   256                 // entries per diff, bounds the time the UI thread spends applying one
+#define RELOAD_POST_TIMEOUT 1.0                 // seconds to wait for space in the task queue of the file watcher
+
+// replaces [old_count] entries at [first] with [new_count] entries, computed on the watcher thread and applied on the UI thread
+typedef struct {
+    u64                 generation;             // of the library the diff was computed against
+    u64                 reload_id;              // all diffs of one reload are applied together, see apply_diff()
+    b8                  migrated;               // the records have an older schema, the file stays outdated after applying them
+    u32                 chunk;                  // index of the diff in its reload
+    u32                 chunk_count;
+    size_t              first;
+    size_t              old_count;
+    size_t              new_count;
+    visual_novel        entries[];
+} library_diff;
+
+SMALL_VECTOR_DEFINE(diff_vector, library_diff*, 4)            // most reloads change a few entries and need one diff
+
+typedef struct {
+    library_snapshot*   old;                    // library content before the reload
+    u32                 schema_version;
+    size_t              index;                  // of the current record
+    size_t              count;                  // records in the file
+    size_t              prefix;                 // leading records equal to the old entries
+    size_t              last_suffix_mismatch;   // 1 + index of the last record that differs from the old entry at the same distance to the end
+    b8                  prefix_done;
+    diff_vector         diffs;
+    library_diff*       diff;                   // currently filled
+    size_t              old_remaining;          // old entries in the changed range that are not covered by a diff yet
+    b8                  failed;                 // a diff could not be stored, the diffs do not cover the changed range
+} reload_state;
+
+
+static b8 entries_equal(const visual_novel* a, const visual_novel* b) {
+
+    return strncmp(a->name, b->name, sizeof(a->name)) == 0 && strncmp(a->link, b->link, sizeof(a->link)) == 0
+        && strncmp(a->image_path, b->image_path, sizeof(a->image_path)) == 0
+        && a->chapters_total == b->chapters_total && a->chapters_read == b->chapters_read && a->rating == b->rating
+        && a->disc_reason == b->disc_reason && a->flags_lo == b->flags_lo && a->flags_hi == b->flags_hi;
+}
+
+static void reload_count(void* data_structure, __attribute_maybe_unused__ const char* record, __attribute_maybe_unused__ const size_t record_len) {
+
+    ((reload_state*)data_structure)->count++;
+}
+
+// finds the common prefix and suffix of the file and the old content in a single pass, the decoded records are not kept
+static void reload_compare(void* data_structure, const char* record, const size_t record_len) {
+
+    reload_state* state = (reload_state*)data_structure;
+    const size_t index = state->index++;
+    const b8 prefix_candidate = !state->prefix_done && index < state->old->count;
+    const b8 suffix_candidate = (index + state->old->count >= state->count);
+    if (!prefix_candidate && !suffix_candidate) {
+        state->prefix_done = true;
+        state->last_suffix_mismatch = index + 1;
+        return;
+    }
+
+    visual_novel new_entry, old_entry;
+    decode_record_text(record, record_len, state->schema_version, &new_entry);
+
+    if (prefix_candidate) {
+        snapshot_get(state->old, index, &old_entry);
+        if (entries_equal(&new_entry, &old_entry))
+            state->prefix++;
+        else
+            state->prefix_done = true;
+    } else
+        state->prefix_done = true;
+
+    if (!suffix_candidate)
+        state->last_suffix_mismatch = index + 1;
+    else {
+        snapshot_get(state->old, index + state->old->count - state->count, &old_entry);
+        if (!entries_equal(&new_entry, &old_entry))
+            state->last_suffix_mismatch = index + 1;
+    }
+}
+
+// [state->diff] is full or the last record was added
+static void reload_finish_diff(reload_state* state, const b8 last) {
+
+    library_diff* diff = state->diff;
+    diff->old_count = (last || state->old_remaining < diff->new_count) ? state->old_remaining : diff->new_count;
+    state->old_remaining -= diff->old_count;
+    if (diff_vector_push_back(&state->diffs, &diff) != AT_SUCCESS) {
+        free(diff);
+        state->failed = true;
+    }
+    state->diff = NULL;
+}
+
+// collects the decoded records of the changed range into diffs of RELOAD_CHUNK_SIZE entries
+static void reload_collect(void* data_structure, const char* record, const size_t record_len) {
+
+    reload_state* state = (reload_state*)data_structure;
+    const size_t index = state->index++;
+    const size_t suffix = state->count - state->last_suffix_mismatch;
+    if (state->failed || index < state->prefix || index >= state->count - suffix) return;
+
+    if (!state->diff) {
+        state->diff = malloc(sizeof(library_diff) + RELOAD_CHUNK_SIZE * sizeof(visual_novel));
+        VALIDATE(state->diff, state->failed = true; return, "", "Failed to allocate library diff")
+        state->diff->first = index;
+        state->diff->new_count = 0;
+    }
+
+    decode_record_text(record, record_len, state->schema_version, &state->diff->entries[state->diff->new_count++]);
+    if (state->diff->new_count == RELOAD_CHUNK_SIZE || index + 1 == state->count - suffix)
+        reload_finish_diff(state, index + 1 == state->count - suffix);
+}
+
+
+// [s_library.mutex] has to be held, replaces entries without marking the library as unsaved because the file already contains them
+static i32 replace_range_locked(const library_diff* diff) {
+
+    const size_t overlap = (diff->old_count < diff->new_count) ? diff->old_count : diff->new_count;
+    for (size_t x = 0; x < overlap; x++) {
+        const size_t index = diff->first + x;
+        page_slot* slot = &darray_at(&s_library.slots, page_slot, index / LIBRARY_PAGE_SIZE);
+        library_page* page = page_writable(slot);
+        if (!page) return AT_MEMORY_ERROR;
+
+        memcpy(&page->entries[index % LIBRARY_PAGE_SIZE], &diff->entries[x], sizeof(visual_novel));
+        page->pending_entries &= ~entry_mask(index % LIBRARY_PAGE_SIZE, 1);
+    }
+
+    for (size_t x = overlap; x < diff->new_count; x++) {
+        const i32 result = insert_locked(diff->first + x, &diff->entries[x]);
+        if (result != AT_SUCCESS) return result;
+    }
+    for (size_t x = overlap; x < diff->old_count; x++) {
+        const i32 result = remove_locked(diff->first + overlap);
+        if (result != AT_SUCCESS) return result;
+    }
+    return AT_SUCCESS;
+}
+
+// [s_library.mutex] has to be held, releases the staged copy of an unfinished reload
+static void reload_discard_locked(void) {
+
+    if (s_library.reload_id == 0) return;
+
+    for (size_t x = 0; x < darray_size(&s_library.reload_slots); x++)
+        page_release(darray_at(&s_library.reload_slots, page_slot, x).page);
+    darray_free(&s_library.reload_slots);
+    s_library.reload_count = 0;
+    s_library.reload_id = 0;
+}
+
+// [s_library.mutex] has to be held, stages reload [reload_id] on a copy of the page table that shares all pages copy-on-write
+static b8 reload_stage_locked(const u64 reload_id) {
+
+    reload_discard_locked();
+    const size_t slot_count = darray_size(&s_library.slots);
+    if (darray_init_with_capacity(&s_library.reload_slots, sizeof(page_slot), slot_count > 0 ? slot_count : 1) != AT_SUCCESS)
+        return false;
+    if (slot_count > 0 && darray_append_n(&s_library.reload_slots, s_library.slots.data, slot_count) != AT_SUCCESS) {
+        darray_free(&s_library.reload_slots);
+        return false;
+    }
+
+    for (size_t x = 0; x < slot_count; x++)
+        atomic_fetch_add_explicit(&darray_at(&s_library.slots, page_slot, x).page->ref_count, 1, memory_order_relaxed);
+    s_library.reload_count = s_library.count;
+    s_library.reload_id = reload_id;
+    return true;
+}
+
+// [s_library.mutex] has to be held, exchanges the library with the staged reload, the store functions then work on the staged copy
+static void reload_swap_locked(void) {
+
+    const darray slots = s_library.slots;
+    s_library.slots = s_library.reload_slots;
+    s_library.reload_slots = slots;
+
+    const size_t count = s_library.count;
+    s_library.count = s_library.reload_count;
+    s_library.reload_count = count;
+}
+
+// runs on the UI thread. The diffs of one reload are applied to a staged copy of the library that replaces it with the last diff,
+// so the library is never partially reloaded: a modification in between or a failure drops the remaining diffs of the reload
+// together and the library keeps its content from before the reload (the next save overwrites the file in that case)
+static void apply_diff(void* data) {
+
+    library_diff* diff = (library_diff*)data;
+    pthread_mutex_lock(&s_library.mutex);
+    const b8 staged = (s_library.reload_id == diff->reload_id);
+    if (!s_library.running || diff->generation != s_library.generation || diff->reload_id == s_library.dropped_reload_id) {
+        if (s_library.running && diff->reload_id != s_library.dropped_reload_id && (diff->chunk == 0 || staged))      // once per reload
+            LOG(Warn, "Library was modified while the reloaded file was applied, the external changes are dropped")
+        if (staged)
+            reload_discard_locked();
+
+    } else if (diff->chunk == 0 || staged) {                        // otherwise an earlier diff of this reload was dropped
+        i32 result = (diff->chunk == 0 && !reload_stage_locked(diff->reload_id)) ? AT_MEMORY_ERROR : AT_SUCCESS;
+        if (result == AT_SUCCESS) {
+            const b8 section_dirty = s_library.section_dirty;      // set by the store functions, the staged copy is not saved
+            reload_swap_locked();
+            result = replace_range_locked(diff);
+            reload_swap_locked();
+            s_library.section_dirty = section_dirty;
+        }
+
+        if (result != AT_SUCCESS) {
+            LOG(Warn, "Failed to apply external changes to the library, they are dropped: %s", error_to_str(result))
+            reload_discard_locked();
+
+        } else if (diff->chunk + 1 == diff->chunk_count) {
+            reload_swap_locked();                                   // the staged copy replaces the library
+            reload_discard_locked();                                // releases the page table from before the reload
+            s_library.revision++;
+            if (!s_library.has_unsaved) {                           // the file already contains the new content
+                for (size_t x = 0; x < darray_size(&s_library.slots); x++)
+                    darray_at(&s_library.slots, page_slot, x).dirty_entries = 0;
+                s_library.section_dirty = false;
+            }
+            if (diff->reload_id == s_library.next_reload_id && !diff->migrated)      // no newer external change is pending
+                s_library.file_outdated = false;
+        }
+    }
+    pthread_mutex_unlock(&s_library.mutex);
+    free(diff);
+}
+
+
+static void on_section_changed(const char* section_name, void* user_data) {
+
+    if (strcmp(section_name, SECTION_NAME) == 0)
+        *(b8*)user_data = true;
+}
+
+
+void library_on_file_changed(const char* dir_path, const char* file_name, __attribute_maybe_unused__ void* user_data) {
+
+    b8 changed = false;
+    if (sy_reload(dir_path, file_name, on_section_changed, &changed) < 0 || !changed)
+        return;                                                     // unreadable or only other sections changed
+
+    pthread_mutex_lock(&s_library.mutex);
+    const u64 reload_id = ++s_library.next_reload_id;
+    s_library.file_outdated = true;                                 // until this reload is applied completely
+    if (!s_library.running || s_library.has_unsaved || s_library.section_dirty) {
+        const b8 running = s_library.running;
+        pthread_mutex_unlock(&s_library.mutex);
+        if (running)
+            LOG(Warn, "[%s/%s] was modified externally while the library has unsaved changes, the next save overwrites them", dir_path, file_name)
+        return;
+    }
+
+    library_snapshot old;
+    const b8 shared = snapshot_share_locked(&old);
+    const u64 generation = s_library.generation;
+    pthread_mutex_unlock(&s_library.mutex);
+    VALIDATE(shared, return, "", "Failed to snapshot library for reload")
+
+    // the session keeps the file version it was opened with, so all passes see the same content
+    const f64 start = get_precise_time();
+    reload_state state = { .old = &old };
+    SY sy = {0};
+    if (!sy_init(&sy, dir_path, file_name, SECTION_NAME, SERIALIZER_OPTION_LOAD)) {
+        snapshot_release(&old);
+        return;
+    }
+
+    sy_entry(&sy, SCHEMA_KEY, &state.schema_version, SY_TYPE_U32);
+    pthread_mutex_lock(&s_library.mutex);
+    check_schema_version_locked(state.schema_version);
+    pthread_mutex_unlock(&s_library.mutex);
+    sy_loop_records(&sy, SEQUENCE_NAME, &state, reload_count);
+    sy_loop_records(&sy, SEQUENCE_NAME, &state, reload_compare);
+
+    // the prefix and suffix can not overlap in the shorter of both sequences
+    const size_t min_count = (state.count < old.count) ? state.count : old.count;
+    size_t suffix = state.count - state.last_suffix_mismatch;
+    if (state.prefix + suffix > min_count) {
+        suffix = min_count - state.prefix;
+        state.last_suffix_mismatch = state.count - suffix;
+    }
+
+    diff_vector_init(&state.diffs);
+    state.old_remaining = old.count - state.prefix - suffix;
+    state.index = 0;
+    if (state.prefix + suffix < state.count)
+        sy_loop_records(&sy, SEQUENCE_NAME, &state, reload_collect);
+    else if (state.old_remaining > 0) {                             // only removed entries
+        library_diff* diff = malloc(sizeof(library_diff));
+        VALIDATE(diff, , "", "Failed to allocate library diff")
+        if (diff) {
+            *diff = (library_diff){ .first = state.prefix, .old_count = state.old_remaining };
+            if (diff_vector_push_back(&state.diffs, &diff) != AT_SUCCESS)
+                free(diff);
+        }
+    }
+    sy_shutdown(&sy);
+    snapshot_release(&old);
+
+    // a partial set of diffs would leave a gap in the changed range, the reload is applied completely or not at all
+    if (state.failed || state.diff) {
+        LOG(Warn, "Failed to collect the external changes to the library, they are dropped")
+        free(state.diff);
+        for (size_t x = 0; x < diff_vector_size(&state.diffs); x++)
+            free(*diff_vector_at(&state.diffs, x));
+        diff_vector_clear(&state.diffs);
+    }
+
+    // diffs are applied in order, every one shifts the following ones by its own size difference which is already accounted for
+    size_t changed_entries = 0;
+    for (size_t x = 0; x < diff_vector_size(&state.diffs); x++) {
+        library_diff* diff = *diff_vector_at(&state.diffs, x);
+        diff->generation = generation;
+        diff->reload_id = reload_id;
+        diff->migrated = migration_needed(state.schema_version);
+        diff->chunk = (u32)x;
+        diff->chunk_count = (u32)diff_vector_size(&state.diffs);
+        changed_entries += (diff->new_count > diff->old_count) ? diff->new_count : diff->old_count;
+
+        const f64 post_start = get_precise_time();
+        while (!file_watcher_post(apply_diff, free, diff)) {          // the UI thread did not catch up yet
+            pthread_mutex_lock(&s_library.mutex);
+            const b8 running = s_library.running;
+            pthread_mutex_unlock(&s_library.mutex);
+
+            // the UI thread might itself wait for this callback (file_watcher_remove), never block it indefinitely
+            if (!running || get_precise_time() - post_start > RELOAD_POST_TIMEOUT) {
+                if (running)
+                    LOG(Warn, "UI thread does not dispatch, the external changes to the library are dropped")
+                for (size_t y = x; y < diff_vector_size(&state.diffs); y++)
+                    free(*diff_vector_at(&state.diffs, y));
+
+                // the diffs that were already posted are skipped, the reload is applied completely or not at all
+                pthread_mutex_lock(&s_library.mutex);
+                s_library.dropped_reload_id = reload_id;
+                if (s_library.reload_id == reload_id)
+                    reload_discard_locked();
+                pthread_mutex_unlock(&s_library.mutex);
+                x = diff_vector_size(&state.diffs);
+                break;
+            }
+            precise_sleep(0.005);
+        }
+    }
+    diff_vector_free(&state.diffs);
+
+    LOG(Trace, "Reloaded library [%zu entries, %zu changed] in [%.2f ms]", state.count, changed_entries, (get_precise_time() - start) * 1000.0)
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "util/data_structure/data_types.h"
+#include "util/data_structure/darray.h"
+#include "visual_novel.h"
+#include "library_io.h"
+
+
+// The library store owns all visual novels and writes them back to [project_data.yml] in the background.
+//
+// Entries live in fixed size pages that are shared copy-on-write with snapshots: taking a snapshot only copies the
+// page table, a page is duplicated the first time it is mutated while a snapshot still references it.
+// Every mutation marks the entry and the section dirty and wakes the autosave thread, which saves a snapshot at most
+// LIBRARY_AUTOSAVE_DELAY seconds after the first unsaved change, so the UI thread never waits for file I/O.
+// External modifications of the file are picked up by library_on_file_changed(): only the range of entries that differs
+// from the library is decoded and handed to the UI thread in chunks, the rest of the library stays untouched.
+// The file carries a [schema_version] header. Records of older files that need a migration are kept as text on load and migrated
+// and decoded the first time they are accessed, the next save rewrites the file with the current version. A file of a newer
+// version is opened read only, saving it would drop the keys this version does not know.
+// All functions are thread safe.
+
+
+#define LIBRARY_PAGE_SIZE           16          // entries per page, a page is the unit of copy-on-write
+#define LIBRARY_AUTOSAVE_DELAY      2.0         // upper bound in seconds between a mutation and the start of its save
+#define LIBRARY_SCHEMA_VERSION      1           // increase when the saved layout of [visual_novel] changes and add a migration in library.c
+#define LIBRARY_SORT_MAX_KEYS       4
+
+
+typedef enum {
+    LIBRARY_SORT_TITLE = 0,                     // case insensitive for ASCII letters
+    LIBRARY_SORT_RATING,
+    LIBRARY_SORT_PROGRESS,                      // read chapters relative to the total, entries without a total count as 0
+    LIBRARY_SORT_CHAPTERS,                      // total chapters
+} library_sort_field;
+
+typedef struct {
+    library_sort_field  field;
+    b8                  descending;
+} library_sort_key;
+
+
+// ============================================================================================================================================
+// init
+// ============================================================================================================================================
+
+// @brief Loads the library from [dir_path]/[file_name] and starts the autosave thread
+// @return true if the library could be initialized (a missing file results in an empty library)
+b8 library_init(const char* dir_path, const char* file_name);
+
+
+// @brief Stops the autosave thread, saves all unsaved changes and frees the library
+void library_shutdown(void);
+
+
+// @brief Saves all unsaved changes on the calling thread, waits for a save of the autosave thread to finish first.
+//        Not async-signal-safe, do not call it from a signal handler (changes of the last LIBRARY_AUTOSAVE_DELAY seconds are lost on a crash)
+// @return true if nothing was unsaved or the save succeeded
+b8 library_flush(void);
+
+
+// @brief Callback for file_watcher_add(), reloads the entries that were changed in the file by another program.
+//        The changes are handed to file_watcher_dispatch() in chunks and replace the library together with the last one,
+//        a modification of the library meanwhile drops the whole reload.
+//        Skipped while the library has unsaved changes, the next save overwrites the file in that case
+void library_on_file_changed(const char* dir_path, const char* file_name, void* user_data);
+
+
+// ============================================================================================================================================
+// access
+// ============================================================================================================================================
+
+size_t library_size(void);
+
+
+// @brief True if the file has a newer schema version than LIBRARY_SCHEMA_VERSION, changes are not saved in that case
+b8 library_is_read_only(void);
+
+
+// @brief Changes with every modification of the entries (including reloads of the file), used to detect outdated derived data like a display order
+u64 library_revision(void);
+
+
+// @brief Copies the entry at [index] into [out]
+// @return AT_SUCCESS on success, AT_RANGE_ERROR if [index] is out of bounds
+i32 library_get(const size_t index, visual_novel* out);
+
+
+// @brief Copies the entries at [indices] into [out] (room for [count] entries) under one lock, used to draw the visible entries of a frame
+// @return AT_SUCCESS on success, AT_RANGE_ERROR if an index is out of bounds (the entries before it are copied)
+i32 library_get_many(const u32* indices, const size_t count, visual_novel* out);
+
+
+// @brief Computes the display order of all entries without moving them: [keys[0]] decides, the following keys break ties
+//        and entries that are equal in all keys keep their library order. While the entries of an older file are still
+//        decoded in the background [order] is the library order, library_revision() changes once they are decoded
+// @param order darray of u32, initialized by the caller. Replaced by the index of the entry at every position
+// @return AT_SUCCESS on success, error code on failure ([order] is empty in that case)
+i32 library_sort(const library_sort_key* keys, const u32 key_count, darray* order);
+
+
+// ============================================================================================================================================
+// mutation
+// ============================================================================================================================================
+
+i32 library_add(const visual_novel* vn);
+
+
+// @brief Appends [count] entries at once as one mutation, used by library_import_file()
+i32 library_append(const visual_novel* entries, const size_t count);
+
+
+i32 library_update(const size_t index, const visual_novel* vn);
+
+
+// @brief Removes the entry at [index], following entries move down by one
+i32 library_remove(const size_t index);
+
+
+// ============================================================================================================================================
+// import / export
+// ============================================================================================================================================
+
+// @brief Imports the CSV or JSON file at [path] (see library_io.h) and appends its records to the library as one mutation
+// @param imported Optional, receives the number of appended entries
+// @param skipped Optional, receives the number of records that could not be imported
+// @return AT_SUCCESS on success, error code on failure (nothing is appended if the file could not be read)
+i32 library_import_file(const char* path, const library_format format, size_t* imported, size_t* skipped);
+
+
+// @brief Exports all entries into the file at [path] from a snapshot, the library can be modified while the file is written
+// @return AT_SUCCESS on success, error code on failure
+i32 library_export_file(const char* path, const library_format format);
@@ -0,0 +1,1011 @@
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "util/io/logger.h"
+#include "util/io/block_compression.h"
+#include "util/io/buffered_writer.h"
+#include "util/io/number_conversion.h"
+#include "util/io/utf8.h"
+#include "visual_novel.h"
+
+#include "library_io.h"
+
+
+#define IMPORT_MIN_CHUNK_SIZE       (256 * 1024)    // files smaller than two chunks are parsed on the calling thread
+#define IMPORT_MAX_THREADS          16
+#define IMPORT_MAX_COLUMNS          64              // CSV columns after this are ignored
+#define IMPORT_SCRATCH_SIZE         (16 * 1024)     // unescaped string values longer than this are truncated
+#define IMPORT_KEY_LEN              64              // JSON keys longer than this can not match a field
+
+
+// ============================================================================================================================================
+// fields
+// ============================================================================================================================================
+
+typedef enum {
+    IF_IGNORED = 0,
+    IF_NAME,
+    IF_LINK,
+    IF_IMAGE_PATH,
+    IF_CHAPTERS_TOTAL,
+    IF_CHAPTERS_READ,
+    IF_RATING,
+    IF_DISC_REASON,
+    IF_TAGS,
+} import_field;
+
+// names used by the exporter come first, the rest are aliases used by other trackers
+static const struct {
+    const char*     name;
+    import_field    field;
+} s_field_names[] = {
+    { "name",           IF_NAME },
+    { "link",           IF_LINK },
+    { "image_path",     IF_IMAGE_PATH },
+    { "chapters_total", IF_CHAPTERS_TOTAL },
+    { "chapters_read",  IF_CHAPTERS_READ },
+    { "rating",         IF_RATING },
+    { "disc_reason",    IF_DISC_REASON },
+    { "tags",           IF_TAGS },
+    { "title",          IF_NAME },
+    { "url",            IF_LINK },
+    { "image",          IF_IMAGE_PATH },
+    { "cover",          IF_IMAGE_PATH },
+    { "chapters",       IF_CHAPTERS_TOTAL },
+    { "total_chapters", IF_CHAPTERS_TOTAL },
+    { "progress",       IF_CHAPTERS_READ },
+    { "read_chapters",  IF_CHAPTERS_READ },
+    { "score",          IF_RATING },
+    { "status",         IF_DISC_REASON },
+    { "genres",         IF_TAGS },
+};
+
+
+static import_field field_from_name(const char* name, const size_t len) {
+
+    for (size_t x = 0; x < sizeof(s_field_names) / sizeof(s_field_names[0]); x++)
+        if (strncasecmp(s_field_names[x].name, name, len) == 0 && s_field_names[x].name[len] == '\0')
+            return s_field_names[x].field;
+    return IF_IGNORED;
+}
+
+static inline b8 is_space(const char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+static inline void trim(const char** value, size_t* len) {
+
+    while (*len > 0 && is_space(**value)) {
+        (*value)++;
+        (*len)--;
+    }
+    while (*len > 0 && is_space((*value)[*len - 1]))
+        (*len)--;
+}
+
+// truncated at a code point boundary, invalid UTF-8 is repaired
+static inline void copy_string(char* dest, const size_t dest_size, const char* value, const size_t len) {
+
+    if (!utf8_copy(dest, dest_size, value, len))
+        LOG(Warn, "Replaced invalid UTF-8 in imported value [%s]", dest)
+}
+
+// parses a whole number in [0, max], decimals are rounded (other trackers use ratings like "8.5")
+static b8 parse_bounded(const char* value, const size_t len, const u64 max, u64* out) {
+
+    u64 number = 0;
+    if (num_parse_u64(value, len, &number) != len) {
+        f64 decimal = 0;
+        if (num_parse_f64(value, len, &decimal) != len || !(decimal >= 0.0) || decimal >= (f64)max + 0.5)
+            return false;
+        number = (u64)(decimal + 0.5);
+    }
+    if (number > max) return false;
+
+    *out = number;
+    return true;
+}
+
+// tag names are separated by ';' or ',', unknown names are ignored
+static void add_tags(visual_novel* vn, const char* value, const size_t len) {
+
+    const char* end = value + len;
+    while (value < end) {
+
+        const char* separator = value;
+        while (separator < end && *separator != ';' && *separator != ',')
+            separator++;
+
+        const char* name = value;
+        size_t name_len = (size_t)(separator - value);
+        trim(&name, &name_len);
+        const i32 tag = genre_tag_from_str(name, name_len);
+        if (tag >= 0)
+            visual_novel_add_tag(vn, (u32)tag);
+
+        value = separator + 1;
+    }
+}
+
+// applies one trimmed and unescaped value to [vn], empty values keep the default
+// @return false if the value is invalid and the record has to be skipped
+static b8 apply_field(visual_novel* vn, const import_field field, const char* value, const size_t len) {
+
+    if (len == 0) return true;
+
+    u64 number = 0;
+    switch (field) {
+        case IF_NAME:           copy_string(vn->name, sizeof(vn->name), value, len);                   return true;
+        case IF_LINK:           copy_string(vn->link, sizeof(vn->link), value, len);                   return true;
+        case IF_IMAGE_PATH:     copy_string(vn->image_path, sizeof(vn->image_path), value, len);       return true;
+
+        case IF_CHAPTERS_TOTAL:
+            if (!parse_bounded(value, len, UINT16_MAX, &number)) return false;
+            vn->chapters_total = (u16)number;
+            return true;
+
+        case IF_CHAPTERS_READ:
+            if (!parse_bounded(value, len, UINT16_MAX, &number)) return false;
+            vn->chapters_read = (u16)number;
+            return true;
+
+        case IF_RATING:
+            if (!parse_bounded(value, len, 10, &number)) return false;
+            vn->rating = (u8)number;
+            return true;
+
+        case IF_DISC_REASON:                                        // name or numeric value, unknown names keep the default
+            if (!discontinue_reason_from_str(value, len, &vn->disc_reason) && parse_bounded(value, len, DR_COUNT - 1, &number))
+                vn->disc_reason = (discontinue_reason)number;
+            return true;
+
+        case IF_TAGS:           add_tags(vn, value, len);                                               return true;
+        default:                                                                                        return true;
+    }
+}
+
+
+// ============================================================================================================================================
+// chunks
+// ============================================================================================================================================
+
+// a range of complete records that is parsed independently of all other chunks
+typedef struct {
+    const char*             begin;
+    const char*             end;
+    library_format          format;
+    const import_field*     columns;            // CSV only: field of every column
+    u32                     column_count;
+    vn_array                records;            // parsed in file order, the first chunk borrows the destination array
+    size_t                  skipped;
+    i32                     result;
+} import_chunk;
+
+
+// ============================================================================================================================================
+// CSV
+// ============================================================================================================================================
+
+// reads the field at [pos], quoted fields are unescaped into [scratch], unquoted fields point directly into the file
+// @return position after the delimiter, [record_end] is set if the field was the last one of its record
+static const char* csv_read_field(const char* pos, const char* end, char* scratch, const char** value, size_t* len, b8* record_end) {
+
+    *record_end = false;
+    if (pos < end && *pos == '"') {
+
+        pos++;
+        size_t out = 0;
+        for (;;) {
+            const char* quote = memchr(pos, '"', (size_t)(end - pos));
+            const char* run_end = quote ? quote : end;
+            const size_t run_len = (size_t)(run_end - pos);
+            const size_t copy_len = (run_len < IMPORT_SCRATCH_SIZE - out) ? run_len : IMPORT_SCRATCH_SIZE - out;
+            memcpy(scratch + out, pos, copy_len);
+            out += copy_len;
+
+            if (!quote) {                                           // unterminated, take the rest of the chunk
+                pos = end;
+                break;
+            }
+            if (quote + 1 < end && quote[1] == '"') {               // escaped quote
+                if (out < IMPORT_SCRATCH_SIZE)
+                    scratch[out++] = '"';
+                pos = quote + 2;
+                continue;
+            }
+            pos = quote + 1;
+            break;
+        }
+        *value = scratch;
+        *len = out;
+
+        while (pos < end && *pos != ',' && *pos != '\n')            // tolerate text between closing quote and delimiter
+            pos++;
+
+    } else {
+        const char* start = pos;
+        while (pos < end && *pos != ',' && *pos != '\n')
+            pos++;
+        *value = start;
+        *len = (size_t)(pos - start);
+    }
+
+    if (pos >= end) {
+        *record_end = true;
+        return end;
+    }
+    *record_end = (*pos == '\n');
+    return pos + 1;
+}
+
+
+// maps the columns of the header line to fields
+// @return start of the first record
+static const char* csv_read_header(const char* pos, const char* end, char* scratch, import_field* columns, u32* column_count, b8* any_known) {
+
+    *column_count = 0;
+    *any_known = false;
+    b8 record_end = false;
+    while (!record_end) {
+        const char* value;
+        size_t len;
+        pos = csv_read_field(pos, end, scratch, &value, &len, &record_end);
+        trim(&value, &len);
+        if (*column_count < IMPORT_MAX_COLUMNS) {
+            columns[*column_count] = field_from_name(value, len);
+            *any_known |= (columns[*column_count] != IF_IGNORED);
+            (*column_count)++;
+        }
+    }
+    return pos;
+}
+
+
+// [pos] is the start of a record, quotes are tracked with memchr() so newlines inside quoted fields are skipped
+// @return start of the first record at or after [target]
+static const char* csv_find_record_boundary(const char* pos, const char* target, const char* end) {
+
+    if (pos >= target) return pos;
+
+    b8 in_quotes = false;
+    while (pos < target) {
+        const char* quote = memchr(pos, '"', (size_t)(target - pos));
+        if (!quote) {
+            pos = target;
+            break;
+        }
+        in_quotes = !in_quotes;                                     // escaped quotes ("") toggle twice
+        pos = quote + 1;
+    }
+
+    while (pos < end) {
+        if (in_quotes) {
+            const char* quote = memchr(pos, '"', (size_t)(end - pos));
+            if (!quote) return end;
+            in_quotes = false;
+            pos = quote + 1;
+            continue;
+        }
+
+        const char* newline = memchr(pos, '\n', (size_t)(end - pos));
+        const char* line_end = newline ? newline : end;
+        const char* quote = memchr(pos, '"', (size_t)(line_end - pos));
+        if (quote) {
+            in_quotes = true;
+            pos = quote + 1;
+            continue;
+        }
+        return newline ? newline + 1 : end;
+    }
+    return end;
+}
+
+
+static void csv_parse_chunk(import_chunk* chunk, char* scratch) {
+
+    const char* pos = chunk->begin;
+    while (pos < chunk->end) {
+
+        visual_novel* vn = vn_array_emplace_back(&chunk->records);    // capacity is reserved by import_worker()
+        memset(vn, 0, sizeof(*vn));
+        u32 column = 0;
+        b8 valid = true;
+        b8 empty = true;
+        b8 record_end = false;
+        while (!record_end) {
+            const char* value;
+            size_t len;
+            pos = csv_read_field(pos, chunk->end, scratch, &value, &len, &record_end);
+            trim(&value, &len);
+            empty &= (len == 0);
+            if (column < chunk->column_count && !apply_field(vn, chunk->columns[column], value, len))
+                valid = false;
+            column++;
+        }
+
+        if (empty || !valid)
+            vn_array_pop_back(&chunk->records);
+        if (!empty && !valid)                                       // blank lines are not counted
+            chunk->skipped++;
+    }
+}
+
+
+// ============================================================================================================================================
+// JSON
+// ============================================================================================================================================
+
+static inline const char* skip_whitespace(const char* pos, const char* end) {
+
+    while (pos < end && is_space(*pos))
+        pos++;
+    return pos;
+}
+
+static inline void put_char(char* scratch, const size_t cap, size_t* out, const char c) {
+
+    if (*out < cap - 1)
+        scratch[(*out)++] = c;
+}
+
+static inline i32 hex_value(const char c) {
+
+    if (c >= '0' && c <= '9') return c - '0';
+    if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') return (c | 0x20) - 'a' + 10;
+    return -1;
+}
+
+// reads the 4 hex digits of a \u escape at [pos]
+static b8 read_hex4(const char* pos, const char* end, u32* out) {
+
+    if (end - pos < 4) return false;
+    u32 value = 0;
+    for (u32 x = 0; x < 4; x++) {
+        const i32 digit = hex_value(pos[x]);
+        if (digit < 0) return false;
+        value = (value << 4) | (u32)digit;
+    }
+    *out = value;
+    return true;
+}
+
+static void put_utf8(char* scratch, const size_t cap, size_t* out, const u32 codepoint) {
+
+    if (codepoint < 0x80) {
+        put_char(scratch, cap, out, (char)codepoint);
+    } else if (codepoint < 0x800) {
+        put_char(scratch, cap, out, (char)(0xC0 | (codepoint >> 6)));
+        put_char(scratch, cap, out, (char)(0x80 | (codepoint & 0x3F)));
+    } else if (codepoint < 0x10000) {
+        put_char(scratch, cap, out, (char)(0xE0 | (codepoint >> 12)));
+        put_char(scratch, cap, out, (char)(0x80 | ((codepoint >> 6) & 0x3F)));
+        put_char(scratch, cap, out, (char)(0x80 | (codepoint & 0x3F)));
+    } else {
+        put_char(scratch, cap, out, (char)(0xF0 | (codepoint >> 18)));
+        put_char(scratch, cap, out, (char)(0x80 | ((codepoint >> 12) & 0x3F)));
+        put_char(scratch, cap, out, (char)(0x80 | ((codepoint >> 6) & 0x3F)));
+        put_char(scratch, cap, out, (char)(0x80 | (codepoint & 0x3F)));
+    }
+}
+
+// unescapes the string starting at the opening quote [pos] into [scratch] (truncated to [cap] -1 characters)
+// @return position after the closing quote, NULL if the string is malformed
+static const char* json_read_string(const char* pos, const char* end, char* scratch, const size_t cap, size_t* len) {
+
+    size_t out = 0;
+    pos++;
+    while (pos < end) {
+
+        const char* run = pos;                                      // copy plain characters as one run
+        while (pos < end && *pos != '"' && *pos != '\\' && (u8)*pos >= 0x20)
+            pos++;
+        const size_t run_len = (size_t)(pos - run);
+        const size_t copy_len = (run_len < cap - 1 - out) ? run_len : cap - 1 - out;
+        memcpy(scratch + out, run, copy_len);
+        out += copy_len;
+
+        if (pos >= end) return NULL;
+        if (*pos == '"') {
+            *len = out;
+            return pos + 1;
+        }
+        if (*pos != '\\') return NULL;                              // unescaped control character
+        if (pos + 1 >= end) return NULL;
+
+        const char escape = pos[1];
+        pos += 2;
+        switch (escape) {
+            case '"':
+            case '\\':
+            case '/':   put_char(scratch, cap, &out, escape);   break;
+            case 'b':   put_char(scratch, cap, &out, '\b');     break;
+            case 'f':   put_char(scratch, cap, &out, '\f');     break;
+            case 'n':   put_char(scratch, cap, &out, '\n');     break;
+            case 'r':   put_char(scratch, cap, &out, '\r');     break;
+            case 't':   put_char(scratch, cap, &out, '\t');     break;
+            case 'u': {
+                u32 codepoint;
+                if (!read_hex4(pos, end, &codepoint)) return NULL;
+                pos += 4;
+                u32 low;                                            // surrogate pair
+                if (codepoint >= 0xD800 && codepoint < 0xDC00 && end - pos >= 6 && pos[0] == '\\' && pos[1] == 'u'
+                    && read_hex4(pos + 2, end, &low) && low >= 0xDC00 && low < 0xE000) {
+                    codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                    pos += 6;
+                }
+                put_utf8(scratch, cap, &out, codepoint);
+                break;
+            }
+            default:    return NULL;
+        }
+    }
+    return NULL;
+}
+
+// @return position after the number/true/false/null token at [pos]
+static const char* json_read_token(const char* pos, const char* end) {
+
+    while (pos < end && *pos != ',' && *pos != '}' && *pos != ']' && !is_space(*pos))
+        pos++;
+    return pos;
+}
+
+// skips a complete value of any type
+// @return position after the value, NULL if it is malformed
+static const char* json_skip_value(const char* pos, const char* end) {
+
+    if (pos >= end) return NULL;
+
+    if (*pos != '{' && *pos != '[' && *pos != '"') {
+        const char* token_end = json_read_token(pos, end);
+        return (token_end > pos) ? token_end : NULL;
+    }
+
+    u32 depth = 0;
+    b8 in_string = false;
+    for (; pos < end; pos++) {
+        const char c = *pos;
+        if (in_string) {
+            if (c == '\\') pos++;
+            else if (c == '"') {
+                in_string = false;
+                if (depth == 0) return pos + 1;
+            }
+            continue;
+        }
+        switch (c) {
+            case '"':   in_string = true;   break;
+            case '{':
+            case '[':   depth++;            break;
+            case '}':
+            case ']':
+                if (depth == 0) return NULL;
+                if (--depth == 0) return pos + 1;
+                break;
+            default:                        break;
+        }
+    }
+    return NULL;
+}
+
+// reads an array of tag names starting at '['
+static const char* json_read_tags(const char* pos, const char* end, visual_novel* vn, char* scratch) {
+
+    pos = skip_whitespace(pos + 1, end);
+    if (pos < end && *pos == ']') return pos + 1;
+
+    for (;;) {
+        if (pos < end && *pos == '"') {
+            size_t len;
+            if (!(pos = json_read_string(pos, end, scratch, IMPORT_SCRATCH_SIZE, &len))) return NULL;
+            add_tags(vn, scratch, len);
+        } else if (!(pos = json_skip_value(pos, end)))
+            return NULL;
+
+        pos = skip_whitespace(pos, end);
+        if (pos >= end) return NULL;
+        if (*pos == ']') return pos + 1;
+        if (*pos != ',') return NULL;
+        pos = skip_whitespace(pos + 1, end);
+    }
+}
+
+// parses the object starting at '{' into [vn], [valid] is cleared if a value is out of range
+// @return position after the object, NULL if it is malformed
+static const char* json_read_object(const char* pos, const char* end, visual_novel* vn, char* scratch, b8* valid) {
+
+    pos = skip_whitespace(pos + 1, end);
+    if (pos < end && *pos == '}') return pos + 1;
+
+    for (;;) {
+        if (pos >= end || *pos != '"') return NULL;
+        char key[IMPORT_KEY_LEN];
+        size_t key_len;
+        if (!(pos = json_read_string(pos, end, key, sizeof(key), &key_len))) return NULL;
+
+        pos = skip_whitespace(pos, end);
+        if (pos >= end || *pos != ':') return NULL;
+        pos = skip_whitespace(pos + 1, end);
+        if (pos >= end) return NULL;
+
+        const import_field field = field_from_name(key, key_len);
+        if (field == IF_IGNORED || *pos == '{' || (*pos == '[' && field != IF_TAGS)) {
+            pos = json_skip_value(pos, end);
+
+        } else if (*pos == '[') {
+            pos = json_read_tags(pos, end, vn, scratch);
+
+        } else if (*pos == '"') {
+            size_t len;
+            if ((pos = json_read_string(pos, end, scratch, IMPORT_SCRATCH_SIZE, &len))) {
+                const char* value = scratch;
+                trim(&value, &len);
+                *valid &= apply_field(vn, field, value, len);
+            }
+
+        } else {
+            const char* token_end = json_read_token(pos, end);
+            if (token_end == pos) return NULL;
+            const size_t len = (size_t)(token_end - pos);
+            if (!(len == 4 && memcmp(pos, "null", 4) == 0))
+                *valid &= apply_field(vn, field, pos, len);
+            pos = token_end;
+        }
+        if (!pos) return NULL;
+
+        pos = skip_whitespace(pos, end);
+        if (pos >= end) return NULL;
+        if (*pos == '}') return pos + 1;
+        if (*pos != ',') return NULL;
+        pos = skip_whitespace(pos + 1, end);
+    }
+}
+
+
+typedef struct {
+    u32                 depth;                  // nesting level below the top level array
+    b8                  in_string;
+    b8                  escape;
+} json_scan_state;
+
+// structural scan (strings and brackets only) that continues from the previous boundary with [state]
+// @return the first object of the top level array that starts at or after [target]
+static const char* json_find_record_boundary(const char* pos, const char* target, const char* end, json_scan_state* state) {
+
+    for (; pos < end; pos++) {
+        const char c = *pos;
+        if (state->in_string) {
+            if (state->escape)          state->escape = false;
+            else if (c == '\\')         state->escape = true;
+            else if (c == '"')          state->in_string = false;
+            continue;
+        }
+        switch (c) {
+            case '"':   state->in_string = true;    break;
+            case '{':
+                if (state->depth == 0 && pos >= target) return pos;
+                state->depth++;
+                break;
+            case '[':   state->depth++;             break;
+            case '}':
+            case ']':
+                if (state->depth == 0) return end;                  // end of the top level array
+                state->depth--;
+                break;
+            default:                                break;
+        }
+    }
+    return end;
+}
+
+
+static void json_parse_chunk(import_chunk* chunk, char* scratch) {
+
+    const char* pos = chunk->begin;
+    for (;;) {
+        pos = skip_whitespace(pos, chunk->end);
+        if (pos >= chunk->end || *pos == ']') return;               // anything after the top level array is ignored
+        if (*pos == ',') {
+            pos++;
+            continue;
+        }
+        if (*pos != '{') {
+            chunk->result = AT_FORMAT_ERROR;
+            return;
+        }
+
+        visual_novel* vn = vn_array_emplace_back(&chunk->records);    // capacity is reserved by import_worker()
+        memset(vn, 0, sizeof(*vn));
+        b8 valid = true;
+        if (!(pos = json_read_object(pos, chunk->end, vn, scratch, &valid))) {
+            chunk->result = AT_FORMAT_ERROR;
+            return;
+        }
+
+        if (!valid) {
+            vn_array_pop_back(&chunk->records);
+            chunk->skipped++;
+        }
+    }
+}
+
+
+// ============================================================================================================================================
+// import
+// ============================================================================================================================================
+
+static size_t count_char(const char* pos, const char* end, const char c) {
+
+    size_t count = 0;
+    while ((pos = memchr(pos, c, (size_t)(end - pos)))) {
+        count++;
+        pos++;
+    }
+    return count;
+}
+
+static void* import_worker(void* arg) {
+
+    import_chunk* chunk = (import_chunk*)arg;
+    char scratch[IMPORT_SCRATCH_SIZE];
+
+    // upper bound of the record count (every CSV record ends with a newline, every JSON record starts with '{'),
+    // [visual_novel] is large so growing the array would copy a lot. With the capacity reserved the parsers never have to check emplace_back()
+    const size_t max_records = count_char(chunk->begin, chunk->end, (chunk->format == LIBRARY_FORMAT_CSV) ? '\n' : '{') + 1;
+    chunk->result = vn_array_reserve(&chunk->records, vn_array_size(&chunk->records) + max_records);
+    if (chunk->result != AT_SUCCESS)
+        return NULL;
+
+    if (chunk->format == LIBRARY_FORMAT_CSV)
+        csv_parse_chunk(chunk, scratch);
+    else
+        json_parse_chunk(chunk, scratch);
+    return NULL;
+}
+
+
+static u32 get_import_thread_count(const size_t size) {
+
+    const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t count = size / IMPORT_MIN_CHUNK_SIZE;
+    if (count > (size_t)((cores > 0) ? cores : 1)) count = (size_t)((cores > 0) ? cores : 1);
+    if (count > IMPORT_MAX_THREADS) count = IMPORT_MAX_THREADS;
+    return (count > 0) ? (u32)count : 1;
+}
+
+
+i32 library_import(const char* path, const library_format format, darray* visual_novels, size_t* skipped) {
+
+    if (!path || !visual_novels || format >= LIBRARY_FORMAT_UNKNOWN) return AT_INVALID_ARGUMENT;
+    if (skipped) *skipped = 0;
+
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    VALIDATE(fd >= 0, return AT_IO_ERROR, "", "Failed to open [%s] for import", path)
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        return AT_IO_ERROR;
+    }
+    if (file_stat.st_size == 0) {                                   // nothing to import
+        close(fd);
+        return AT_SUCCESS;
+    }
+
+    size_t size = (size_t)file_stat.st_size;
+    char* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);                                                      // the mapping stays valid
+    VALIDATE(data != MAP_FAILED, return AT_IO_ERROR, "", "Failed to map [%s] for import", path)
+    madvise(data, size, MADV_WILLNEED);
+
+    if (bc_is_frame(data, size)) {                                  // block compressed, decompress into an anonymous mapping and parse that
+        bc_frame frame;
+        i32 frame_result = bc_frame_open(&frame, data, size);
+        char* raw = MAP_FAILED;
+        if (frame_result == AT_SUCCESS && frame.raw_size > 0) {
+            raw = mmap(NULL, (size_t)frame.raw_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            frame_result = (raw != MAP_FAILED) ? bc_frame_read_all(&frame, raw) : AT_MEMORY_ERROR;
+        }
+        munmap(data, size);
+
+        if (frame_result == AT_SUCCESS && frame.raw_size == 0)      // nothing to import
+            return AT_SUCCESS;
+        if (frame_result != AT_SUCCESS) {
+            if (raw != MAP_FAILED)
+                munmap(raw, (size_t)frame.raw_size);
+            LOG(Warn, "Import of [%s] failed, compressed content is invalid: %s", path, error_to_str(frame_result))
+            return frame_result;
+        }
+        data = raw;
+        size = (size_t)frame.raw_size;
+    }
+
+    const char* pos = data;
+    const char* end = data + size;
+    if (size >= 3 && memcmp(pos, "\xEF\xBB\xBF", 3) == 0)          // UTF-8 BOM
+        pos += 3;
+
+    i32 result = AT_SUCCESS;
+    import_field columns[IMPORT_MAX_COLUMNS];
+    u32 column_count = 0;
+    if (format == LIBRARY_FORMAT_CSV) {
+        char scratch[IMPORT_SCRATCH_SIZE];
+        b8 any_known = false;
+        pos = csv_read_header(pos, end, scratch, columns, &column_count, &any_known);
+        if (!any_known) result = AT_FORMAT_ERROR;
+
+    } else {
+        pos = skip_whitespace(pos, end);
+        if (pos < end && *pos == '[')
+            pos++;
+        else
+            result = AT_FORMAT_ERROR;
+    }
+    if (result != AT_SUCCESS) {
+        munmap(data, size);
+        LOG(Warn, "Import of [%s] failed, %s", path, (format == LIBRARY_FORMAT_CSV) ? "header has no known column" : "expected a top level array")
+        return result;
+    }
+
+    // split into chunks of roughly equal size that start at a record
+    const u32 chunk_count = get_import_thread_count((size_t)(end - pos));
+    import_chunk chunks[IMPORT_MAX_THREADS];
+    memset(chunks, 0, sizeof(chunks));
+    json_scan_state scan_state = {0};
+    const char* chunk_begin = pos;
+    for (u32 x = 0; x < chunk_count; x++) {
+
+        const char* target = pos + (size_t)(end - pos) * (x + 1) / chunk_count;
+        const char* chunk_end = end;
+        if (x + 1 < chunk_count)
+            chunk_end = (format == LIBRARY_FORMAT_CSV) ? csv_find_record_boundary(chunk_begin, target, end)
+                                                       : json_find_record_boundary(chunk_begin, target, end, &scan_state);
+
+        chunks[x] = (import_chunk){ .begin = chunk_begin, .end = chunk_end, .format = format, .columns = columns, .column_count = column_count };
+        if (x == 0)
+            chunks[x].records = vn_array_borrow(visual_novels);
+        chunk_begin = chunk_end;
+    }
+
+    // parse, the calling thread takes the first chunk
+    const size_t original_size = darray_size(visual_novels);
+    pthread_t threads[IMPORT_MAX_THREADS];
+    b8 started[IMPORT_MAX_THREADS] = {0};
+    for (u32 x = 1; x < chunk_count; x++)
+        started[x] = (pthread_create(&threads[x], NULL, import_worker, &chunks[x]) == 0);
+
+    import_worker(&chunks[0]);
+    for (u32 x = 1; x < chunk_count; x++) {
+        if (started[x])
+            pthread_join(threads[x], NULL);
+        else
+            import_worker(&chunks[x]);                              // could not start a thread, parse here
+    }
+
+    // append the other chunks in file order
+    size_t remaining = 0;
+    size_t total_skipped = 0;
+    for (u32 x = 0; x < chunk_count && result == AT_SUCCESS; x++) {
+        result = chunks[x].result;
+        remaining += (x > 0) ? vn_array_size(&chunks[x].records) : 0;
+        total_skipped += chunks[x].skipped;
+    }
+    vn_array_give_back(&chunks[0].records, visual_novels);
+    if (result == AT_SUCCESS)
+        result = darray_reserve(visual_novels, darray_size(visual_novels) + remaining);
+
+    for (u32 x = 1; x < chunk_count && result == AT_SUCCESS; x++)
+        result = darray_append_n(visual_novels, chunks[x].records.data, vn_array_size(&chunks[x].records));
+
+    for (u32 x = 1; x < chunk_count; x++)
+        vn_array_free(&chunks[x].records);
+    munmap(data, size);
+
+    if (result != AT_SUCCESS)
+        darray_resize(visual_novels, original_size, NULL);          // drop the records of the first chunk
+    VALIDATE(result == AT_SUCCESS, return result, "", "Import of [%s] failed: %s", path, error_to_str(result))
+    const size_t total = darray_size(visual_novels) - original_size;
+    if (skipped) *skipped = total_skipped;
+    LOG(Info, "Imported [%zu] entries from [%s] with [%u] threads, skipped [%zu]", total, path, chunk_count, total_skipped)
+    return AT_SUCCESS;
+}
+
+
+// ============================================================================================================================================
+// export
+// ============================================================================================================================================
+
+static void csv_write_string(buffered_writer* w, const char* str, const size_t max_len) {
+
+    const size_t len = strnlen(str, max_len);
+    b8 needs_quotes = (len > 0) && (str[0] == ' ' || str[len - 1] == ' ');
+    for (size_t x = 0; x < len && !needs_quotes; x++)
+        needs_quotes = (str[x] == ',' || str[x] == '"' || str[x] == '\n' || str[x] == '\r');
+
+    if (!needs_quotes) {
+        bw_write(w, str, len);
+        return;
+    }
+
+    bw_write_char(w, '"');
+    const char* run = str;
+    const char* end = str + len;
+    const char* quote;
+    while ((quote = memchr(run, '"', (size_t)(end - run)))) {
+        bw_write(w, run, (size_t)(quote - run) + 1);
+        bw_write_char(w, '"');                                      // double the quote
+        run = quote + 1;
+    }
+    bw_write(w, run, (size_t)(end - run));
+    bw_write_char(w, '"');
+}
+
+static void json_write_string(buffered_writer* w, const char* str, const size_t max_len) {
+
+    static const char hex[] = "0123456789abcdef";
+    const size_t len = strnlen(str, max_len);
+
+    bw_write_char(w, '"');
+    size_t run = 0;
+    for (size_t x = 0; x < len; x++) {
+
+        const u8 c = (u8)str[x];
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+        bw_write(w, str + run, x - run);
+        run = x + 1;
+        switch (c) {
+            case '"':   bw_write(w, "\\\"", 2);  break;
+            case '\\':  bw_write(w, "\\\\", 2);  break;
+            case '\n':  bw_write(w, "\\n", 2);   break;
+            case '\r':  bw_write(w, "\\r", 2);   break;
+            case '\t':  bw_write(w, "\\t", 2);   break;
+            default: {
+                const char escape[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+                bw_write(w, escape, sizeof(escape));
+                break;
+            }
+        }
+    }
+    bw_write(w, str + run, len - run);
+    bw_write_char(w, '"');
+}
+
+// writes the names of all set tags, [separator] between them, [quote] around each (JSON) or not (CSV)
+static void write_tags(buffered_writer* w, const visual_novel* vn, const char* separator, const b8 quote) {
+
+    b8 first = true;
+    for (u32 half = 0; half < 2; half++) {
+        u64 flags = (half == 0) ? vn->flags_lo : vn->flags_hi;
+        while (flags) {
+            const u32 bit = (u32)__builtin_ctzll(flags);
+            flags &= flags - 1;
+            const u32 tag = bit + ((half == 0) ? 0 : GENRE_TAG_HI_OFFSET);
+            if (tag >= GENRE_TAG_INDEX_MAX || (half == 0 && bit >= GT_LO_COUNT)) continue;
+
+            if (!first) bw_write_str(w, separator);
+            first = false;
+            if (quote) bw_write_char(w, '"');
+            bw_write_str(w, genre_tag_to_str(tag));
+            if (quote) bw_write_char(w, '"');
+        }
+    }
+}
+
+
+// copies the entry at [index] into [vn], a failing accessor fails the export
+static b8 export_entry(buffered_writer* w, void* data_structure, const size_t index, library_entry_at_t entry_at, visual_novel* vn) {
+
+    const i32 result = entry_at(data_structure, index, vn);
+    if (result != AT_SUCCESS)
+        w->error = result;                                          // bw_close() discards the file
+    return result == AT_SUCCESS;
+}
+
+
+static void export_csv(buffered_writer* w, void* data_structure, const size_t count, library_entry_at_t entry_at, visual_novel* vn) {
+
+    bw_write_str(w, "name,link,image_path,chapters_total,chapters_read,rating,disc_reason,tags\n");
+    for (size_t x = 0; x < count && w->error == AT_SUCCESS; x++) {
+
+        if (!export_entry(w, data_structure, x, entry_at, vn)) break;
+        csv_write_string(w, vn->name, sizeof(vn->name));
+        bw_write_char(w, ',');
+        csv_write_string(w, vn->link, sizeof(vn->link));
+        bw_write_char(w, ',');
+        csv_write_string(w, vn->image_path, sizeof(vn->image_path));
+        bw_write_char(w, ',');
+        bw_write_u64(w, vn->chapters_total);
+        bw_write_char(w, ',');
+        bw_write_u64(w, vn->chapters_read);
+        bw_write_char(w, ',');
+        bw_write_u64(w, vn->rating);
+        bw_write_char(w, ',');
+        bw_write_str(w, discontinue_reason_to_str(vn->disc_reason));
+        bw_write_char(w, ',');
+        write_tags(w, vn, ";", false);
+        bw_write_char(w, '\n');
+    }
+}
+
+
+static void export_json(buffered_writer* w, void* data_structure, const size_t count, library_entry_at_t entry_at, visual_novel* vn) {
+
+    bw_write_str(w, "[\n");
+    for (size_t x = 0; x < count && w->error == AT_SUCCESS; x++) {
+
+        if (!export_entry(w, data_structure, x, entry_at, vn)) break;
+        bw_write_str(w, "  {\"name\": ");
+        json_write_string(w, vn->name, sizeof(vn->name));
+        bw_write_str(w, ", \"link\": ");
+        json_write_string(w, vn->link, sizeof(vn->link));
+        bw_write_str(w, ", \"image_path\": ");
+        json_write_string(w, vn->image_path, sizeof(vn->image_path));
+        bw_write_str(w, ", \"chapters_total\": ");
+        bw_write_u64(w, vn->chapters_total);
+        bw_write_str(w, ", \"chapters_read\": ");
+        bw_write_u64(w, vn->chapters_read);
+        bw_write_str(w, ", \"rating\": ");
+        bw_write_u64(w, vn->rating);
+        bw_write_str(w, ", \"disc_reason\": \"");
+        bw_write_str(w, discontinue_reason_to_str(vn->disc_reason));
+        bw_write_str(w, "\", \"tags\": [");
+        write_tags(w, vn, ", ", true);
+        bw_write_str(w, (x + 1 < count) ? "]},\n" : "]}\n");
+    }
+    bw_write_str(w, "]\n");
+}
+
+
+static b8 has_compressed_extension(const char* path) {
+
+    const size_t len = strlen(path);
+    const size_t extension_len = sizeof(BC_FILE_EXTENSION) - 1;
+    return len > extension_len && strcasecmp(path + len - extension_len, BC_FILE_EXTENSION) == 0;
+}
+
+
+library_format library_format_from_path(const char* path) {
+
+    if (!path) return LIBRARY_FORMAT_UNKNOWN;
+
+    size_t len = strlen(path);
+    if (has_compressed_extension(path))                             // "library.csv.rbc" is a compressed CSV file
+        len -= sizeof(BC_FILE_EXTENSION) - 1;
+
+    const char* extension = path + len;
+    while (extension > path && extension[-1] != '.')
+        extension--;
+    if (extension == path) return LIBRARY_FORMAT_UNKNOWN;
+    extension--;
+    const size_t extension_len = (size_t)(path + len - extension);
+    if (extension_len == 4 && strncasecmp(extension, ".csv", 4) == 0) return LIBRARY_FORMAT_CSV;
+    if (extension_len == 5 && strncasecmp(extension, ".json", 5) == 0) return LIBRARY_FORMAT_JSON;
+    return LIBRARY_FORMAT_UNKNOWN;
+}
+
+
+i32 library_export(const char* path, const library_format format, void* data_structure, const size_t count, library_entry_at_t entry_at) {
+
+    if (!path || !entry_at || format >= LIBRARY_FORMAT_UNKNOWN) return AT_INVALID_ARGUMENT;
+
+    buffered_writer writer;
+    const i32 open_result = has_compressed_extension(path) ? bw_open_compressed(&writer, path, 0) : bw_open(&writer, path, 0);
+    VALIDATE(open_result == AT_SUCCESS, return open_result, "", "Failed to open [%s] for export: %s", path, error_to_str(open_result))
+
+    visual_novel vn;
+    if (format == LIBRARY_FORMAT_CSV)
+        export_csv(&writer, data_structure, count, entry_at, &vn);
+    else
+        export_json(&writer, data_structure, count, entry_at, &vn);
+
+    const i32 result = bw_close(&writer);
+    VALIDATE(result == AT_SUCCESS, return result, "", "Export to [%s] failed: %s", path, error_to_str(result))
+    LOG(Info, "Exported [%zu] entries to [%s]", count, path)
+    return AT_SUCCESS;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "util/data_structure/data_types.h"
+#include "util/data_structure/darray.h"
+
+
+// Import and export of the visual novel library as CSV or JSON, used to migrate from other trackers.
+//
+// CSV:  first line is a header, columns are matched by name (case insensitive, unknown columns are ignored)
+//       name,link,image_path,chapters_total,chapters_read,rating,disc_reason,tags
+//       tags are separated by ';' inside their field, e.g. "romance;school life"
+// JSON: an array of objects with the same keys, tags are an array of strings
+//
+// Common aliases used by other trackers are accepted on import (title, url, cover, chapters, progress, score, status, genres).
+// Unknown tags and status names are ignored, records with malformed or out of range numbers are skipped.
+//
+// Both formats can be block compressed (see util/io/block_compression.h): export compresses if the path ends with
+// BC_FILE_EXTENSION ("library.csv.rbc"), import detects compressed files by their content.
+
+
+typedef enum {
+    LIBRARY_FORMAT_CSV = 0,
+    LIBRARY_FORMAT_JSON,
+    LIBRARY_FORMAT_UNKNOWN,
+} library_format;
+
+// copies the entry at [index] of [data_structure] into [out], same form as the accessor of sy_loop()
+typedef i32 (*library_entry_at_t)(void* data_structure, const u64 index, void* out);
+
+
+// @brief Detects the format from the file extension (".csv", ".json", optionally followed by BC_FILE_EXTENSION)
+library_format library_format_from_path(const char* path);
+
+
+// @brief Imports all records of the file at [path] and appends them to [visual_novels] in file order.
+//        The file is memory mapped, split into chunks at record boundaries and large files are parsed on multiple threads.
+// @param visual_novels An initialized darray of [visual_novel]
+// @param skipped Optional, receives the number of records that could not be imported
+// @return AT_SUCCESS on success, error code if the file could not be read or is malformed ([visual_novels] is unchanged in that case)
+i32 library_import(const char* path, const library_format format, darray* visual_novels, size_t* skipped);
+
+
+// @brief Streams [count] entries of [data_structure] into the file at [path] without building the document in memory.
+//        The file is replaced atomically, on failure the previous content stays untouched.
+// @param entry_at Called for every index in order, e.g. (library_entry_at_t)darray_get for a darray of [visual_novel]
+// @return AT_SUCCESS on success, error code on failure
+i32 library_export(const char* path, const library_format format, void* data_structure, const size_t count, library_entry_at_t entry_at);
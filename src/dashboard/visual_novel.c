@@ -0,0 +1,249 @@
+
+#include <pthread.h>
+#include <string.h>
+#include <strings.h>
+
+#include "visual_novel.h"
+
+
+// ========================================================================================================================================
+// genre tags
+// ========================================================================================================================================
+
+const char* genre_tag_lo_to_str(const genre_tag_lo type) {
+
+    switch (type) {
+        case GT_ACTION:                 return "action";
+        case GT_ADVENTURE:              return "adventure";
+        case GT_ARTBOOK:                return "artbook";
+        case GT_CARTOON:                return "cartoon";
+        case GT_COMIC:                  return "comic";
+        case GT_DOUJINSHI:              return "doujinshi";
+        case GT_IMAGESET:               return "imageset";
+        case GT_MANGA:                  return "manga";
+        case GT_MANHUA:                 return "manhua";
+        case GT_MANHWA:                 return "manhwa";
+        case GT_WESTERN:                return "western";
+        case GT_ONESHOT:                return "oneshot";
+        case GT_FOURKOMA:               return "fourkoma";
+        case GT_SHOUJO:                 return "shoujo";
+        case GT_SHOUNEN:                return "shounen";
+        case GT_JOSEI:                  return "josei";
+        case GT_SEINEN:                 return "seinen";
+        case GT_COMEDY:                 return "comedy";
+        case GT_COOKING:                return "cooking";
+        case GT_CRIME:                  return "crime";
+        case GT_CROSS_DRESSING:         return "cross dressing";
+        case GT_CULTIVATION:            return "cultivation";
+        case GT_DEATH_GAME:             return "death game";
+        case GT_OP_MC:                  return "op_mc";
+        case GT_DEGENERATE_MC:          return "degenerate mc";
+        case GT_DELINQUENTS:            return "delinquents";
+        case GT_DEMENTIA:               return "dementia";
+        case GT_DEMONS:                 return "demons";
+        case GT_DRAMA:                  return "drama";
+        case GT_FANTASY:                return "fantasy";
+        case GT_FETISH:                 return "fetish";
+        case GT_GAME:                   return "game";
+        case GT_GENDER_BENDER:          return "gender bender";
+        case GT_GENDER_SWAP:            return "gender swap";
+        case GT_GHOST:                  return "ghost";
+        case GT_GYARU:                  return "gyaru";
+        case GT_HAREM:                  return "harem";
+        case GT_HATLEQUIN:              return "hatlequin";
+        case GT_HISTORY:                return "history";
+        case GT_HORROR:                 return "horror";
+        case GT_ISEKAI:                 return "isekai";
+        case GT_KIDS:                   return "kids";
+        case GT_MAGIC:                  return "magic";
+        case GT_MARTIAL_ARTS:           return "martial arts";
+        case GT_MASTER_SERVANT:         return "master servant";
+        case GT_MECHS:                  return "mechs";
+        case GT_MEDICAL:                return "medical";
+        case GT_MILF:                   return "milf";
+        case GT_MILITARY:               return "military";
+        case GT_MONSTER_GIRL:           return "monster girl";
+        case GT_MONSTERS:               return "monsters";
+        case GT_MUSIC:                  return "music";
+        case GT_MYSTERY:                return "mystery";
+        case GT_NINJA:                  return "ninja";
+        case GT_OFFICE_WORKERS:         return "office workers";
+        case GT_OMEGAVERSE:             return "omegaverse";
+        case GT_PARODY:                 return "parody";
+        case GT_PHILOSOPHICAL:          return "philosophical";
+        case GT_POLICE:                 return "police";
+        case GT_POST_APOCALYPTIC:       return "post apocalyptic";
+        case GT_PSYCHOLOGICAL:          return "psychological";
+        case GT_REINCARNATION:          return "reincarnation";
+        case GT_REVERSE_HAREM:          return "reverse harem";
+        case GT_ROMANCE:                return "romance";
+        default:                        return "unknown";
+    }
+}
+
+const char* genre_tag_hi_to_str(const genre_tag_hi type) {
+
+    switch (type) {
+        case GT_SAMURAI:                return "samurai";
+        case GT_SCHOOL_LIFE:            return "school life";
+        case GT_SCI_FI:                 return "sci-fi";
+        case GT_SHOUJOAI:               return "shoujoai";
+        case GT_SHOUNENAI:              return "shounenai";
+        case GT_SHOWBIZ:                return "showbiz";
+        case GT_SLICE_OF_LIFE:          return "slice of life";
+        case GT_SPACE:                  return "space";
+        case GT_SPORTS:                 return "sports";
+        case GT_STEPFAMILY:             return "stepfamily";
+        case GT_SUPERPOWER:             return "superpower";
+        case GT_SUPERHERO:              return "superhero";
+        case GT_SUPERNATURAL:           return "supernatural";
+        case GT_SURVIVAL:               return "survival";
+        case GT_TEACHER_STUDENTS:       return "teacher students";
+        case GT_THRILLER:               return "thriller";
+        case GT_TIME_TRAVEL:            return "time travel";
+        case GT_TRAGEDY:                return "tragedy";
+        case GT_VAMPIRES:               return "vampires";
+        case GT_VILLAINESS:             return "villainess";
+        case GT_VIRTUAL_REALITY:        return "virtual reality";
+        case GT_WUXIA:                  return "wuxia";
+        case GT_XIANXIA:                return "xianxia";
+        case GT_XUANHUAN:               return "xuanhuan";
+        case GT_ZOMBIES:                return "zombies";
+        case GT_GORE:                   return "gore";
+        case GT_BLOODY:                 return "bloody";
+        case GT_VIOLENCE:               return "violence";
+        case GT_ADULT:                  return "adult";
+        case GT_MATURE:                 return "mature";
+        case GT_SMUT:                   return "smut";
+        case GT_ECCHI:                  return "ecchi";
+        case GT_NTR:                    return "ntr";
+        case GT_INCEST:                 return "incest";
+        case GT_LOLI:                   return "loli";
+        case GT_SHOTA:                  return "shota";
+        case GT_FUTA:                   return "futa";
+        case GT_BARA:                   return "bara";
+        case GT_YAOI:                   return "yaoi";
+        case GT_YURI:                   return "yuri";
+        default:                        return "unknown";
+    }
+}
+
+
+const char* genre_tag_to_str(const u32 tag_index) {
+
+    if (tag_index < GENRE_TAG_HI_OFFSET)
+        return genre_tag_lo_to_str((genre_tag_lo)tag_index);
+    if (tag_index < GENRE_TAG_INDEX_MAX)
+        return genre_tag_hi_to_str((genre_tag_hi)(tag_index - GENRE_TAG_HI_OFFSET));
+    return "unknown";
+}
+
+
+// open addressing table of all tag names, more than twice the tag count keeps probe sequences short
+#define TAG_TABLE_SIZE      256
+#define TAG_TABLE_EMPTY     0xFF
+
+STATIC_ASSERT(GENRE_TAG_INDEX_MAX < TAG_TABLE_EMPTY, "tag index has to fit into the u8 slots of the lookup table");
+STATIC_ASSERT((TAG_TABLE_SIZE & (TAG_TABLE_SIZE - 1)) == 0, "tag table size has to be a power of two");
+
+static u8                   s_tag_table[TAG_TABLE_SIZE];
+static pthread_once_t       s_tag_table_once = PTHREAD_ONCE_INIT;
+
+
+// FNV-1a over the lower case characters, so lookups are case insensitive
+static inline u32 tag_name_hash(const char* name, const size_t len) {
+
+    u32 hash = 2166136261u;
+    for (size_t x = 0; x < len; x++) {
+        hash ^= (u8)((name[x] >= 'A' && name[x] <= 'Z') ? name[x] | 0x20 : name[x]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void build_tag_table(void) {
+
+    memset(s_tag_table, TAG_TABLE_EMPTY, sizeof(s_tag_table));
+    for (u32 tag = 0; tag < GENRE_TAG_INDEX_MAX; tag++) {
+
+        if (tag >= GT_LO_COUNT && tag < GENRE_TAG_HI_OFFSET)
+            continue;                                           // gap between lo and hi tags
+
+        const char* name = genre_tag_to_str(tag);
+        u32 slot = tag_name_hash(name, strlen(name)) & (TAG_TABLE_SIZE - 1);
+        while (s_tag_table[slot] != TAG_TABLE_EMPTY)
+            slot = (slot + 1) & (TAG_TABLE_SIZE - 1);
+        s_tag_table[slot] = (u8)tag;
+    }
+}
+
+
+i32 genre_tag_from_str(const char* name, const size_t len) {
+
+    if (!name || len == 0) return -1;
+
+    pthread_once(&s_tag_table_once, build_tag_table);
+
+    u32 slot = tag_name_hash(name, len) & (TAG_TABLE_SIZE - 1);
+    while (s_tag_table[slot] != TAG_TABLE_EMPTY) {
+
+        const u32 tag = s_tag_table[slot];
+        const char* tag_name = genre_tag_to_str(tag);
+        if (strncasecmp(tag_name, name, len) == 0 && tag_name[len] == '\0')
+            return (i32)tag;
+
+        slot = (slot + 1) & (TAG_TABLE_SIZE - 1);
+    }
+    return -1;
+}
+
+
+// ========================================================================================================================================
+// visual novel
+// ========================================================================================================================================
+
+const char* discontinue_reason_to_str(const discontinue_reason type) {
+
+    switch (type) {
+        case DR_READ_ALL_CHAPTERS:      { return "read all chapters"; }
+        case DR_FINISHED:               { return "finished"; }
+        case DR_GOT_BORED:              { return "got bored"; }
+        case DR_AUTHOR_HIATUS:          { return "author hiatus"; }
+        case DR_DROPPED_BY_TRANSLATOR:  { return "dropped by translator"; }
+        case DR_POOR_TRANSLATION:       { return "poor translation"; }
+        case DR_DECLINE_IN_QUALITY:     { return "decline in quality"; }
+        default:                        { return "unknown"; }
+    }
+}
+
+
+b8 discontinue_reason_from_str(const char* name, const size_t len, discontinue_reason* out) {
+
+    if (!name || !out) return false;
+
+    for (u32 reason = 0; reason < DR_COUNT; reason++) {
+        const char* reason_name = discontinue_reason_to_str((discontinue_reason)reason);
+        if (strncasecmp(reason_name, name, len) == 0 && reason_name[len] == '\0') {
+            *out = (discontinue_reason)reason;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// ========================================================================================================================================
+// visual novel
+// ========================================================================================================================================
+
+const sy_field visual_novel_fields[VISUAL_NOVEL_FIELD_COUNT] = {
+    SY_FIELD(visual_novel, name),
+    SY_FIELD(visual_novel, link),
+    SY_FIELD(visual_novel, image_path),
+    SY_FIELD(visual_novel, chapters_total),
+    SY_FIELD(visual_novel, chapters_read),
+    SY_FIELD(visual_novel, rating),
+    SY_FIELD(visual_novel, disc_reason),
+    SY_FIELD(visual_novel, flags_lo),
+    SY_FIELD(visual_novel, flags_hi),
+};
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <limits.h>
+#include <stddef.h>
+
+#include "util/data_structure/data_types.h"
+#include "util/data_structure/darray.h"
+#include "util/io/serializer_yaml.h"
+
+
+// ========================================================================================================================================
+// genre tags
+// ========================================================================================================================================
+
+// currently contains 104 tags (128 possible)
+typedef enum {
+GT_ACTION, GT_ADVENTURE, GT_ARTBOOK, GT_CARTOON, GT_COMIC, GT_DOUJINSHI, GT_IMAGESET, GT_MANGA,
+GT_MANHUA, GT_MANHWA, GT_WESTERN, GT_ONESHOT, GT_FOURKOMA, GT_SHOUJO, GT_SHOUNEN, GT_JOSEI,
+GT_SEINEN, GT_COMEDY, GT_COOKING, GT_CRIME, GT_CROSS_DRESSING, GT_CULTIVATION, GT_DEATH_GAME,
+GT_OP_MC, GT_DEGENERATE_MC, GT_DELINQUENTS, GT_DEMENTIA, GT_DEMONS, GT_DRAMA, GT_FANTASY,
+GT_FETISH, GT_GAME, GT_GENDER_BENDER, GT_GENDER_SWAP, GT_GHOST, GT_GYARU, GT_HAREM, GT_HATLEQUIN,
+GT_HISTORY, GT_HORROR, GT_ISEKAI, GT_KIDS, GT_MAGIC, GT_MARTIAL_ARTS, GT_MASTER_SERVANT, GT_MECHS,
+GT_MEDICAL, GT_MILF, GT_MILITARY, GT_MONSTER_GIRL, GT_MONSTERS, GT_MUSIC, GT_MYSTERY, GT_NINJA,
+GT_OFFICE_WORKERS, GT_OMEGAVERSE, GT_PARODY, GT_PHILOSOPHICAL, GT_POLICE, GT_POST_APOCALYPTIC,
+GT_PSYCHOLOGICAL, GT_REINCARNATION, GT_REVERSE_HAREM, GT_ROMANCE,
+GT_LO_COUNT
+} genre_tag_lo;
+
+typedef enum {
+GT_SAMURAI, GT_SCHOOL_LIFE, GT_SCI_FI, GT_SHOUJOAI, GT_SHOUNENAI, GT_SHOWBIZ, GT_SLICE_OF_LIFE, GT_SPACE,
+GT_SPORTS, GT_STEPFAMILY, GT_SUPERPOWER, GT_SUPERHERO, GT_SUPERNATURAL, GT_SURVIVAL, GT_TEACHER_STUDENTS,
+GT_THRILLER, GT_TIME_TRAVEL, GT_TRAGEDY, GT_VAMPIRES, GT_VILLAINESS, GT_VIRTUAL_REALITY,
+GT_WUXIA, GT_XIANXIA, GT_XUANHUAN, GT_ZOMBIES,
+
+// NSFW tags
+GT_GORE, GT_BLOODY, GT_VIOLENCE, GT_ADULT, GT_MATURE, GT_SMUT, GT_ECCHI, GT_NTR, GT_INCEST,
+GT_LOLI, GT_SHOTA, GT_FUTA, GT_BARA, GT_YAOI, GT_YURI,
+GT_HI_COUNT
+} genre_tag_hi;
+
+STATIC_ASSERT(GT_LO_COUNT <= 64, "[genre_tag_lo] has to fit into [flags_lo]");
+STATIC_ASSERT(GT_HI_COUNT <= 64, "[genre_tag_hi] has to fit into [flags_hi]");
+
+const char* genre_tag_lo_to_str(const genre_tag_lo type);
+const char* genre_tag_hi_to_str(const genre_tag_hi type);
+
+// A genre tag index combines both enums: [genre_tag_lo] maps to [0, 64), [genre_tag_hi] maps to [64, 128)
+#define GENRE_TAG_HI_OFFSET     64
+#define GENRE_TAG_INDEX_MAX     (GENRE_TAG_HI_OFFSET + GT_HI_COUNT)
+
+// @brief Name of the tag with the combined [tag_index], "unknown" for invalid indices
+const char* genre_tag_to_str(const u32 tag_index);
+
+// @brief Looks up a tag by name (case insensitive, [name] does not need to be null terminated).
+//        Uses a hash table that is built on first use, safe to call from multiple threads.
+// @return The combined tag index or -1 if no tag has this name
+i32 genre_tag_from_str(const char* name, const size_t len);
+
+
+#define GENRE_BIT(tag) (((u64)1) << (tag))
+
+// set a genre
+static inline void add_genre_lo(u64 *flags, genre_tag_lo tag)        { *flags |= GENRE_BIT(tag); }
+static inline void add_genre_hi(u64 *flags, genre_tag_hi tag)        { *flags |= GENRE_BIT(tag); }
+
+// clear a genre
+static inline void remove_genre_lo(u64 *flags, genre_tag_lo tag)     { *flags &= ~GENRE_BIT(tag); }
+static inline void remove_genre_hi(u64 *flags, genre_tag_hi tag)     { *flags &= ~GENRE_BIT(tag); }
+
+// test a genre
+static inline bool has_genre_lo(u64 flags, genre_tag_lo tag)         { return (flags & GENRE_BIT(tag)) != 0; }
+static inline bool has_genre_hi(u64 flags, genre_tag_hi tag)         { return (flags & GENRE_BIT(tag)) != 0; }
+
+
+// ========================================================================================================================================
+// visual novel
+// ========================================================================================================================================
+
+typedef enum {
+    DR_READ_ALL_CHAPTERS,
+    DR_FINISHED,
+    DR_GOT_BORED,
+    DR_AUTHOR_HIATUS,
+    DR_DROPPED_BY_TRANSLATOR,
+    DR_POOR_TRANSLATION,
+    DR_DECLINE_IN_QUALITY,
+    DR_COUNT
+} discontinue_reason;
+
+const char* discontinue_reason_to_str(const discontinue_reason type);
+
+// @brief Looks up a reason by the name returned from discontinue_reason_to_str() (case insensitive)
+// @return true if [name] is a known reason
+b8 discontinue_reason_from_str(const char* name, const size_t len, discontinue_reason* out);
+
+
+typedef struct {
+    char                name[512];
+    char                link[PATH_MAX];
+    char                image_path[PATH_MAX];
+    u16                 chapters_total;
+    u16                 chapters_read;
+    u8                  rating;                          // from 0 to 10
+    discontinue_reason  disc_reason;
+    u64                 flags_lo;                       // enum values from 65-128
+    u64                 flags_hi;                       // enum values from 65-128
+} visual_novel;
+
+DARRAY_DEFINE(vn_array, visual_novel)
+
+#define VISUAL_NOVEL_FIELD_COUNT    9
+
+// fields of [visual_novel] in the order they are saved, for sy_loop_fields() and sy_decode_fields()
+extern const sy_field visual_novel_fields[VISUAL_NOVEL_FIELD_COUNT];
+
+// @brief Sets the tag with the combined [tag_index] in [flags_lo] or [flags_hi]
+static inline void visual_novel_add_tag(visual_novel* vn, const u32 tag_index) {
+
+    if (tag_index < GENRE_TAG_HI_OFFSET)
+        vn->flags_lo |= GENRE_BIT(tag_index);
+    else if (tag_index < GENRE_TAG_INDEX_MAX)
+        vn->flags_hi |= GENRE_BIT(tag_index - GENRE_TAG_HI_OFFSET);
+}
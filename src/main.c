@@ -24,9 +24,9 @@
 
         loop_test_struct* local = (loop_test_struct*)element;
         sy_entry_str(serializer, S_KEY_VALUE(*local->string), sizeof(local->string));
-        sy_entry(serializer, S_KEY_VALUE_FORMAT(local->int_8));
-        sy_entry(serializer, S_KEY_VALUE_FORMAT(local->uint_16));
-        sy_entry(serializer, S_KEY_VALUE_FORMAT(local->uint_8));
+        sy_entry(serializer, S_KEY_VALUE_TYPE(local->int_8));
+        sy_entry(serializer, S_KEY_VALUE_TYPE(local->uint_16));
+        sy_entry(serializer, S_KEY_VALUE_TYPE(local->uint_8));
         return true;
     }
 
@@ -73,10 +73,10 @@ int main(int argc, char *argv[]) {
     SY sy;
     ASSERT(sy_init(&sy, loc_file_path, "test.yml", "main_section", SERIALIZER_OPTION_SAVE), "", "");
 
-    sy_entry(&sy, S_KEY_VALUE_FORMAT(test_i32));
-    sy_entry(&sy, S_KEY_VALUE_FORMAT(test_f32));
-    sy_entry(&sy, S_KEY_VALUE_FORMAT(test_bool));
-    sy_entry(&sy, S_KEY_VALUE_FORMAT(test_long_long));
+    sy_entry(&sy, S_KEY_VALUE_TYPE(test_i32));
+    sy_entry(&sy, S_KEY_VALUE_TYPE(test_f32));
+    sy_entry(&sy, S_KEY_VALUE_TYPE(test_bool));
+    sy_entry(&sy, S_KEY_VALUE_TYPE(test_long_long));
     // sy_loop(&sy, S_KEY_VALUE(loop_test_struct_array), sizeof(loop_test_struct), loop_test_struct_serializer_cb, 
     //     (sy_loop_callback_at_t)darray_get,
     //     (sy_loop_callback_append_t)darray_push_back,
@@ -85,7 +85,7 @@ int main(int argc, char *argv[]) {
     #define USE_SUB_SECTION 0
     #if USE_SUB_SECTION
         sy_subsection_begin(&sy, "sub_section");
-        sy_entry(&sy, S_KEY_VALUE(test_f32_s), "%f");
+        sy_entry(&sy, S_KEY_VALUE_TYPE(test_f32_s));
         sy_subsection_end(&sy);
     #endif
 
@@ -86,3 +86,10 @@ void window_swap_buffers(window_info* window_data)                  { glfwSwapBu
 
 void window_set_should_close(window_info* window_data, b8 value)    { window_data->should_close = value; }
 
+
+void window_set_title(window_info* window_data, const char* title) {
+
+    glfwSetWindowTitle(window_data->window_ptr, title);
+    window_data->title = title;
+}
+
@@ -57,3 +57,9 @@ void window_swap_buffers(window_info* window_data);
 // @param window_data Pointer to the `window_info` struct representing the window.
 // @param value       Boolean value indicating whether the window should close.
 void window_set_should_close(window_info* window_data, b8 value);
+
+
+// @brief Changes the text displayed in the title bar of the window.
+// @param window_data Pointer to the `window_info` struct representing the window.
+// @param title       The new title, has to stay valid as long as the window uses it.
+void window_set_title(window_info* window_data, const char* title);
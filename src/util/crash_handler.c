@@ -109,15 +109,14 @@ static void execute_user_callbacks() {
         u32 max_handle = 0;
         crash_callback_t callback_to_execute = NULL;
 
-        for (size_t i = 0; i < s_user_crash_callbacks.cap; i++) {      // Find the callback with the highest handle
-            node* current = s_user_crash_callbacks.buckets[i];
-            while (current != NULL) {
-                u32 current_handle = *(u32*)current->key;
-                if (current_handle > max_handle) {
-                    max_handle = current_handle;
-                    callback_to_execute = (crash_callback_t)current->value;
-                }
-                current = current->next;
+        size_t cursor = 0;
+        void* key;
+        void* value;
+        while (u_map_next(&s_user_crash_callbacks, &cursor, &key, &value)) {     // Find the callback with the highest handle
+            u32 current_handle = *(u32*)key;
+            if (current_handle > max_handle) {
+                max_handle = current_handle;
+                callback_to_execute = (crash_callback_t)value;
             }
         }
         
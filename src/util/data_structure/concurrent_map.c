@@ -0,0 +1,300 @@
+
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "concurrent_map.h"
+
+
+#define MIN_CAPACITY            8
+#define COUNTER_EPOCH_BIT       0x80000000u         // in [cmap_read_guard.counter], the rest is the stripe
+
+#define VALIDATE(map) \
+    do { \
+        if (!(map)) return AT_INVALID_ARGUMENT; \
+        if ((map)->magic != CMAP_MAGIC || !(map)->hash_fn || !(map)->key_cmp_fn) return AT_NOT_INITIALIZED; \
+    } while (0)
+
+
+typedef struct {
+    void*               key;
+    void*               value;
+    u64                 hash;
+    b8                  used;
+} cmap_slot;
+
+// never changed after it is published, linear probing with at most half of the slots used
+struct cmap_table {
+    size_t              cap;                        // power of two
+    size_t              size;
+    cmap_slot           slots[];
+};
+
+
+// ============================================================================================================================================
+// tables
+// ============================================================================================================================================
+
+static cmap_table* table_create(const size_t min_size) {
+
+    size_t cap = MIN_CAPACITY;
+    while (cap < min_size * 2)
+        cap *= 2;
+
+    cmap_table* table = calloc(1, sizeof(cmap_table) + cap * sizeof(cmap_slot));
+    if (table)
+        table->cap = cap;
+    return table;
+}
+
+static size_t table_find(const cmap_table* table, const concurrent_map* map, const void* key, const u64 hash) {
+
+    const size_t mask = table->cap - 1;
+    for (size_t index = hash & mask; table->slots[index].used; index = (index + 1) & mask)
+        if (table->slots[index].hash == hash && map->key_cmp_fn(table->slots[index].key, key) == 0)
+            return index;
+    return SIZE_MAX;
+}
+
+// [table] is not published yet, the key must not be in it
+static void table_add(cmap_table* table, void* key, void* value, const u64 hash) {
+
+    const size_t mask = table->cap - 1;
+    size_t index = hash & mask;
+    while (table->slots[index].used)
+        index = (index + 1) & mask;
+    table->slots[index] = (cmap_slot){ key, value, hash, true };
+    table->size++;
+}
+
+// copy of [source] with room for [min_size] entries, without the slot [skip] (SIZE_MAX to keep all)
+static cmap_table* table_copy(const cmap_table* source, const size_t min_size, const size_t skip) {
+
+    cmap_table* table = table_create(min_size);
+    if (!table || !source) return table;
+
+    for (size_t x = 0; x < source->cap; x++)
+        if (source->slots[x].used && x != skip)
+            table_add(table, source->slots[x].key, source->slots[x].value, source->slots[x].hash);
+    return table;
+}
+
+
+// ============================================================================================================================================
+// epochs
+// ============================================================================================================================================
+
+// every thread keeps the stripe it got on its first read section
+static u32 reader_stripe(void) {
+
+    static atomic_uint s_next_stripe = 0;
+    static _Thread_local u32 s_stripe = UINT32_MAX;
+    if (s_stripe == UINT32_MAX)
+        s_stripe = atomic_fetch_add_explicit(&s_next_stripe, 1, memory_order_relaxed) % CMAP_READER_STRIPES;
+    return s_stripe;
+}
+
+// publishes [table] and returns once no read section can see the previous table anymore. [map->write_mutex] has to be held
+static cmap_table* publish_locked(concurrent_map* map, cmap_table* table) {
+
+    cmap_table* previous = atomic_exchange(&map->table, table);
+    const u64 epoch = atomic_fetch_add(&map->epoch, 1);
+
+    // read sections that loaded [previous] registered with the old epoch bit before, the new ones use the other bit
+    for (u32 x = 0; x < CMAP_READER_STRIPES; x++)
+        while (atomic_load(&map->readers[epoch & 1][x].count) != 0)
+            sched_yield();
+    return previous;
+}
+
+static void release_entries(const concurrent_map* map, const cmap_table* table, const size_t only) {
+
+    if (!map->release_fn || !table) return;
+
+    if (only != SIZE_MAX) {
+        map->release_fn(table->slots[only].key, table->slots[only].value);
+        return;
+    }
+    for (size_t x = 0; x < table->cap; x++)
+        if (table->slots[x].used)
+            map->release_fn(table->slots[x].key, table->slots[x].value);
+}
+
+
+// ============================================================================================================================================
+// Initialization and cleanup
+// ============================================================================================================================================
+
+i32 cmap_init(concurrent_map* map, hash_func hash_fn, key_compare_func key_cmp_fn, cmap_release_func release_fn) {
+
+    if (!map || !hash_fn || !key_cmp_fn) return AT_INVALID_ARGUMENT;
+    if (map->magic == CMAP_MAGIC) return AT_ALREADY_INITIALIZED;
+
+    memset(map, 0, sizeof(*map));
+    if (pthread_mutex_init(&map->write_mutex, NULL) != 0) return AT_ERROR;
+    atomic_init(&map->table, NULL);
+    atomic_init(&map->epoch, 0);
+    for (u32 x = 0; x < CMAP_READER_STRIPES; x++) {
+        atomic_init(&map->readers[0][x].count, 0);
+        atomic_init(&map->readers[1][x].count, 0);
+    }
+    map->hash_fn = hash_fn;
+    map->key_cmp_fn = key_cmp_fn;
+    map->release_fn = release_fn;
+    map->magic = CMAP_MAGIC;
+    return AT_SUCCESS;
+}
+
+
+i32 cmap_free(concurrent_map* map) {
+
+    VALIDATE(map);
+
+    cmap_table* table = atomic_exchange(&map->table, NULL);
+    release_entries(map, table, SIZE_MAX);
+    free(table);
+    pthread_mutex_destroy(&map->write_mutex);
+    map->magic = 0;
+    return AT_SUCCESS;
+}
+
+
+// ============================================================================================================================================
+// Reading
+// ============================================================================================================================================
+
+cmap_read_guard cmap_read_lock(concurrent_map* map) {
+
+    cmap_read_guard guard = { map, NULL, 0 };
+    if (!map || map->magic != CMAP_MAGIC) return guard;
+
+    const u32 stripe = reader_stripe();
+    for (;;) {
+        const u64 epoch = atomic_load(&map->epoch);
+        atomic_uint* count = &map->readers[epoch & 1][stripe].count;
+        atomic_fetch_add(count, 1);
+
+        // a writer that flipped the epoch in between may already wait for the other bit, register again
+        if (atomic_load(&map->epoch) == epoch) {
+            guard.table = atomic_load(&map->table);
+            guard.counter = stripe | ((epoch & 1) ? COUNTER_EPOCH_BIT : 0);
+            return guard;
+        }
+        atomic_fetch_sub(count, 1);
+    }
+}
+
+
+void cmap_read_unlock(cmap_read_guard* guard) {
+
+    if (!guard || !guard->map || guard->map->magic != CMAP_MAGIC) return;
+
+    const u32 epoch_bit = (guard->counter & COUNTER_EPOCH_BIT) ? 1 : 0;
+    atomic_fetch_sub(&guard->map->readers[epoch_bit][guard->counter & ~COUNTER_EPOCH_BIT].count, 1);
+    guard->map = NULL;
+    guard->table = NULL;
+}
+
+
+i32 cmap_find(const cmap_read_guard* guard, const void* key, void** value) {
+
+    if (!guard || !value) return AT_INVALID_ARGUMENT;
+    VALIDATE(guard->map);
+    if (!guard->table) return AT_ERROR;                                 // empty
+
+    const size_t index = table_find(guard->table, guard->map, key, (u64)guard->map->hash_fn(key));
+    if (index == SIZE_MAX) return AT_ERROR;
+
+    *value = guard->table->slots[index].value;
+    return AT_SUCCESS;
+}
+
+
+b8 cmap_next(const cmap_read_guard* guard, size_t* cursor, void** key, void** value) {
+
+    if (!guard || !guard->table || !cursor) return false;
+
+    for (; *cursor < guard->table->cap; (*cursor)++) {
+        const cmap_slot* slot = &guard->table->slots[*cursor];
+        if (!slot->used) continue;
+
+        if (key)    *key = slot->key;
+        if (value)  *value = slot->value;
+        (*cursor)++;
+        return true;
+    }
+    return false;
+}
+
+
+// ============================================================================================================================================
+// Writing
+// ============================================================================================================================================
+
+i32 cmap_insert(concurrent_map* map, void* key, void* value) {
+
+    VALIDATE(map);
+
+    pthread_mutex_lock(&map->write_mutex);
+    const cmap_table* current = atomic_load(&map->table);
+    const u64 hash = (u64)map->hash_fn(key);
+    const size_t existing = current ? table_find(current, map, key, hash) : SIZE_MAX;
+    const size_t size = current ? current->size : 0;
+
+    cmap_table* table = table_copy(current, size + 1, existing);
+    if (!table) {
+        pthread_mutex_unlock(&map->write_mutex);
+        return AT_MEMORY_ERROR;
+    }
+    table_add(table, key, value, hash);
+
+    cmap_table* previous = publish_locked(map, table);
+    if (existing != SIZE_MAX)
+        release_entries(map, previous, existing);
+    free(previous);
+    pthread_mutex_unlock(&map->write_mutex);
+    return AT_SUCCESS;
+}
+
+
+i32 cmap_erase(concurrent_map* map, const void* key) {
+
+    VALIDATE(map);
+
+    pthread_mutex_lock(&map->write_mutex);
+    const cmap_table* current = atomic_load(&map->table);
+    const size_t existing = current ? table_find(current, map, key, (u64)map->hash_fn(key)) : SIZE_MAX;
+    if (existing == SIZE_MAX) {
+        pthread_mutex_unlock(&map->write_mutex);
+        return AT_ERROR;
+    }
+
+    cmap_table* table = NULL;
+    if (current->size > 1) {
+        table = table_copy(current, current->size - 1, existing);
+        if (!table) {
+            pthread_mutex_unlock(&map->write_mutex);
+            return AT_MEMORY_ERROR;
+        }
+    }
+
+    cmap_table* previous = publish_locked(map, table);
+    release_entries(map, previous, existing);
+    free(previous);
+    pthread_mutex_unlock(&map->write_mutex);
+    return AT_SUCCESS;
+}
+
+
+i32 cmap_clear(concurrent_map* map) {
+
+    VALIDATE(map);
+
+    pthread_mutex_lock(&map->write_mutex);
+    cmap_table* previous = publish_locked(map, NULL);
+    release_entries(map, previous, SIZE_MAX);
+    free(previous);
+    pthread_mutex_unlock(&map->write_mutex);
+    return AT_SUCCESS;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include "util/data_structure/data_types.h"
+#include "util/data_structure/unordered_map.h"
+
+
+// Hash map for registries that are read far more often than written (thread labels, fonts, ...), readers never take a lock.
+// The entries live in an immutable table: a write copies the table, changes the copy and publishes it with one atomic store
+// (read-copy-update). Readers run in read sections between cmap_read_lock() and cmap_read_unlock() and only increment a
+// counter of their epoch, so they never wait for writers or for each other. Writes are serialized by a mutex; after publishing
+// a table the writer flips the epoch and waits until the counters of the previous epoch are zero, then nobody can still see the
+// old table and it is freed together with the replaced entries.
+// Writes copy the whole table, so the map suits up to a few thousand entries that change rarely.
+// Keys and values are stored by pointer, the hash and compare functions of unordered_map.h can be used.
+
+
+#define CMAP_READER_STRIPES     16                  // reader counters per epoch, threads are spread over them to avoid sharing a cache line
+
+// @brief Called for every entry that leaves the map (erased, replaced, cleared or freed), after no reader can see it anymore
+typedef void (*cmap_release_func)(void* key, void* value);
+
+
+typedef struct cmap_table cmap_table;
+
+typedef struct {
+    _Alignas(64) atomic_uint    count;
+} cmap_reader_counter;
+
+typedef struct {
+    _Atomic(cmap_table*)        table;              // NULL while the map is empty
+    atomic_uint_fast64_t        epoch;
+    cmap_reader_counter         readers[2][CMAP_READER_STRIPES];        // by the lowest bit of the epoch
+    pthread_mutex_t             write_mutex;
+    hash_func                   hash_fn;
+    key_compare_func            key_cmp_fn;
+    cmap_release_func           release_fn;         // can be NULL
+    u32                         magic;
+} concurrent_map;
+
+// snapshot of the map for one read section, all lookups with it see the same entries
+typedef struct {
+    concurrent_map*             map;
+    const cmap_table*           table;
+    u32                         counter;            // epoch bit and stripe of the read section
+} cmap_read_guard;
+
+
+#define CMAP_MAGIC              0x434D4150
+
+// static maps can be initialized with this instead of cmap_init()
+#define CMAP_INITIALIZER(hash, compare, release)    { .write_mutex = PTHREAD_MUTEX_INITIALIZER, .hash_fn = (hash), .key_cmp_fn = (compare), .release_fn = (release), .magic = CMAP_MAGIC }
+
+
+// ============================================================================================================================================
+// Initialization and cleanup
+// ============================================================================================================================================
+
+// @brief Initializes an empty map, [release_fn] can be NULL if the map does not own its keys and values
+// @return AT_SUCCESS on success, error code on failure
+i32 cmap_init(concurrent_map* map, hash_func hash_fn, key_compare_func key_cmp_fn, cmap_release_func release_fn);
+
+
+// @brief Releases all entries and the table, no thread may use the map anymore
+// @return AT_SUCCESS on success, error code on failure
+i32 cmap_free(concurrent_map* map);
+
+
+// ============================================================================================================================================
+// Reading
+// ============================================================================================================================================
+
+// @brief Starts a read section, keys and values found with [guard] stay valid until cmap_read_unlock().
+//        Keep read sections short, writers wait for them. Do not write to the map inside a read section of the same thread
+cmap_read_guard cmap_read_lock(concurrent_map* map);
+
+
+// @brief Ends the read section of [guard]
+void cmap_read_unlock(cmap_read_guard* guard);
+
+
+// @brief Looks up [key] in the snapshot of [guard]
+// @return AT_SUCCESS if found, AT_ERROR if not, error code on failure
+i32 cmap_find(const cmap_read_guard* guard, const void* key, void** value);
+
+
+// @brief Iterates the entries of the snapshot of [guard] in no particular order, start with [*cursor] = 0
+// @return false after the last entry
+b8 cmap_next(const cmap_read_guard* guard, size_t* cursor, void** key, void** value);
+
+
+// ============================================================================================================================================
+// Writing
+// ============================================================================================================================================
+
+// @brief Inserts or replaces the entry of [key], a replaced entry is passed to [release_fn]. Blocks until readers of the previous table are done
+// @return AT_SUCCESS on success, error code on failure
+i32 cmap_insert(concurrent_map* map, void* key, void* value);
+
+
+// @brief Removes the entry of [key] and passes it to [release_fn]. Blocks until readers of the previous table are done
+// @return AT_SUCCESS on success, AT_ERROR if there is no entry for [key], error code on failure
+i32 cmap_erase(concurrent_map* map, const void* key);
+
+
+// @brief Removes all entries and passes them to [release_fn]. Blocks until readers of the previous table are done
+// @return AT_SUCCESS on success, error code on failure
+i32 cmap_clear(concurrent_map* map);
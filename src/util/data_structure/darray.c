@@ -1,4 +1,5 @@
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -38,6 +39,7 @@ i32 darray_init_with_capacity(darray* d, size_t element_size, size_t initial_cap
     d->count = 0;
     d->capacity = initial_capacity;
     d->element_size = element_size;
+    d->growth_percent = DARRAY_DEFAULT_GROWTH;
     d->magic = MAGIC;
     
     return AT_SUCCESS;
@@ -51,11 +53,52 @@ i32 darray_free(darray* d) {
     free(d->data);
     d->data = NULL;
     d->count = d->capacity = d->element_size = 0;
+    d->growth_percent = 0;
     d->magic = 0;
     
     return AT_SUCCESS;
 }
 
+i32 darray_set_growth(darray* d, const u32 growth_percent) {
+
+    VALIDATE(d);
+    if (growth_percent == 0) return AT_INVALID_ARGUMENT;
+
+    d->growth_percent = growth_percent;
+    return AT_SUCCESS;
+}
+
+
+// makes room for [needed] elements, grows by [growth_percent] so appending one element at a time is amortized O(1)
+static i32 ensure_capacity(darray* d, const size_t needed) {
+
+    if (needed <= d->capacity) return AT_SUCCESS;
+    return darray_grow(&d->data, &d->capacity, d->element_size, darray_grown_capacity(d->capacity, d->growth_percent, needed));
+}
+
+
+size_t darray_grown_capacity(const size_t capacity, const u32 growth_percent, const size_t needed) {
+
+    const u32 percent = (growth_percent > 0) ? growth_percent : DARRAY_DEFAULT_GROWTH;
+    size_t new_capacity = capacity + capacity / 100 * percent + capacity % 100 * percent / 100;
+    if (new_capacity < DARRAY_MIN_CAPACITY) new_capacity = DARRAY_MIN_CAPACITY;
+    if (new_capacity < needed) new_capacity = needed;
+    return new_capacity;
+}
+
+
+i32 darray_grow(void** data, size_t* capacity, const size_t element_size, const size_t min_capacity) {
+
+    if (min_capacity > SIZE_MAX / element_size) return AT_MEMORY_ERROR;
+
+    void* new_data = realloc(*data, min_capacity * element_size);
+    if (!new_data) return AT_MEMORY_ERROR;
+
+    *data = new_data;
+    *capacity = min_capacity;
+    return AT_SUCCESS;
+}
+
 // ============================================================================================================================================
 // Element access
 // ============================================================================================================================================
@@ -93,13 +136,7 @@ i32 darray_reserve(darray* d, size_t new_capacity) {
     VALIDATE(d);
     if (new_capacity <= d->capacity) return AT_SUCCESS;
     
-    void* new_data = realloc(d->data, new_capacity * d->element_size);
-    if (!new_data) return AT_MEMORY_ERROR;
-    
-    d->data = new_data;
-    d->capacity = new_capacity;
-    
-    return AT_SUCCESS;
+    return darray_grow(&d->data, &d->capacity, d->element_size, new_capacity);
 }
 
 
@@ -127,13 +164,8 @@ i32 darray_push_back(darray* d, const void* element) {
     VALIDATE(d);
     if (!element) return AT_INVALID_ARGUMENT;
     
-    if (d->count >= d->capacity) {
-        size_t new_capacity = d->capacity * 2;
-        if (new_capacity < 8) new_capacity = 8;
-        
-        i32 result = darray_reserve(d, new_capacity);
-        if (result != AT_SUCCESS) return result;
-    }
+    i32 result = ensure_capacity(d, d->count + 1);
+    if (result != AT_SUCCESS) return result;
     
     memcpy((char*)d->data + (d->count * d->element_size), element, d->element_size);
     d->count++;
@@ -142,6 +174,37 @@ i32 darray_push_back(darray* d, const void* element) {
 }
 
 
+void* darray_emplace_back(darray* d) {
+
+    return darray_extend_uninit(d, 1);
+}
+
+
+void* darray_extend_uninit(darray* d, const size_t count) {
+
+    if (!d || d->magic != MAGIC || count > SIZE_MAX - d->count) return NULL;
+    if (ensure_capacity(d, d->count + count) != AT_SUCCESS) return NULL;
+
+    void* first = (char*)d->data + (d->count * d->element_size);
+    d->count += count;
+    return first;
+}
+
+
+i32 darray_append_n(darray* d, const void* elements, const size_t count) {
+
+    VALIDATE(d);
+    if (!elements && count > 0) return AT_INVALID_ARGUMENT;
+    if (count == 0) return AT_SUCCESS;
+
+    void* first = darray_extend_uninit(d, count);
+    if (!first) return AT_MEMORY_ERROR;
+
+    memcpy(first, elements, count * d->element_size);
+    return AT_SUCCESS;
+}
+
+
 i32 darray_pop_back(darray* d, void* out_element) {
 
     VALIDATE(d);
@@ -162,13 +225,8 @@ i32 darray_insert(darray* d, size_t index, const void* element) {
     if (!element) return AT_INVALID_ARGUMENT;
     if (index > d->count) return AT_RANGE_ERROR;
     
-    if (d->count >= d->capacity) {
-        size_t new_capacity = d->capacity * 2;
-        if (new_capacity < 8) new_capacity = 8;
-        
-        i32 result = darray_reserve(d, new_capacity);
-        if (result != AT_SUCCESS) return result;
-    }
+    i32 result = ensure_capacity(d, d->count + 1);
+    if (result != AT_SUCCESS) return result;
     
     // Move elements to make space
     if (index < d->count) {
@@ -186,6 +244,49 @@ i32 darray_insert(darray* d, size_t index, const void* element) {
 }
 
 
+i32 darray_permute(darray* d, const u32* permutation) {
+
+    VALIDATE(d);
+    if (!permutation || d->count > UINT32_MAX) return AT_INVALID_ARGUMENT;
+    if (d->count < 2) return AT_SUCCESS;
+
+    // follow every cycle of the permutation once, the first element of a cycle waits in [saved] until the cycle closes
+    u64* placed = calloc((d->count + 63) / 64, sizeof(u64));
+    char* saved = malloc(d->element_size);
+    if (!placed || !saved) {
+        free(placed);
+        free(saved);
+        return AT_MEMORY_ERROR;
+    }
+
+    char* data = (char*)d->data;
+    const size_t size = d->element_size;
+    i32 result = AT_SUCCESS;
+    for (size_t start = 0; start < d->count && result == AT_SUCCESS; start++) {
+        if ((placed[start / 64] >> (start % 64)) & 1) continue;
+
+        memcpy(saved, data + start * size, size);
+        size_t x = start;
+        for (;;) {
+            placed[x / 64] |= 1ULL << (x % 64);
+            const size_t next = permutation[x];
+            if (next >= d->count || (next != start && ((placed[next / 64] >> (next % 64)) & 1))) {
+                result = AT_INVALID_ARGUMENT;                       // not a permutation, the elements are reordered partially
+                break;
+            }
+            if (next == start) break;
+            memcpy(data + x * size, data + next * size, size);
+            x = next;
+        }
+        memcpy(data + x * size, saved, size);
+    }
+
+    free(placed);
+    free(saved);
+    return result;
+}
+
+
 i32 darray_erase(darray* d, size_t index) {
 
     VALIDATE(d);
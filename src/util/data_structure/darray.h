@@ -9,10 +9,15 @@ typedef struct {
     size_t count;
     size_t capacity;
     size_t element_size;
+    u32 growth_percent;     // capacity added when the array is full, in percent of the current capacity
     u64 magic;
 } darray;
 
 
+#define DARRAY_DEFAULT_GROWTH       100         // double the capacity
+#define DARRAY_MIN_CAPACITY         8           // capacity after the first growth
+
+
 // ============================================================================================================================================
 // Initialization and cleanup
 // ============================================================================================================================================
@@ -38,6 +43,25 @@ i32 darray_init_with_capacity(darray* d, const size_t element_size, const size_t
 i32 darray_free(darray* d);
 
 
+// @brief Sets how much the array grows when an element does not fit anymore. Growing by less than 100% wastes less memory
+//        for large arrays but copies the elements more often, growing by more makes arrays that are filled in many steps faster
+// @param d Pointer to the darray structure
+// @param growth_percent Capacity that is added in percent of the current capacity, DARRAY_DEFAULT_GROWTH after darray_init()
+// @return AT_SUCCESS on success, error code on failure
+i32 darray_set_growth(darray* d, const u32 growth_percent);
+
+
+// @brief Reallocates [*data] (array of [*capacity] elements) to hold at least [min_capacity] elements, shared by darray and DARRAY_DEFINE()
+// @return AT_SUCCESS on success, AT_MEMORY_ERROR if the memory could not be allocated ([*data] and [*capacity] are unchanged in that case)
+i32 darray_grow(void** data, size_t* capacity, const size_t element_size, const size_t min_capacity);
+
+
+// @brief Capacity an array of [capacity] elements grows to when it needs room for [needed] elements, shared by darray and DARRAY_DEFINE()
+// @param growth_percent Capacity that is added in percent of [capacity], 0 for DARRAY_DEFAULT_GROWTH
+// @return At least [needed] and DARRAY_MIN_CAPACITY
+size_t darray_grown_capacity(const size_t capacity, const u32 growth_percent, const size_t needed);
+
+
 // ============================================================================================================================================
 // Element access
 // ============================================================================================================================================
@@ -99,6 +123,27 @@ i32 darray_shrink_to_fit(darray* d);
 i32 darray_push_back(darray* d, const void* element);
 
 
+// @brief Adds an uninitialized element to the end of the array, the caller constructs it in place
+// @param d Pointer to the darray structure
+// @return Pointer to the new element, NULL on failure. Valid until the array grows again
+void* darray_emplace_back(darray* d);
+
+
+// @brief Adds [count] uninitialized elements to the end of the array with a single reallocation at most
+// @param d Pointer to the darray structure
+// @param count Number of elements to add
+// @return Pointer to the first new element, NULL on failure. Valid until the array grows again
+void* darray_extend_uninit(darray* d, const size_t count);
+
+
+// @brief Copies [count] elements from [elements] to the end of the array with a single reallocation at most
+// @param d Pointer to the darray structure
+// @param elements Pointer to the first element to add, must not point into the array itself
+// @param count Number of elements to add
+// @return AT_SUCCESS on success, error code on failure
+i32 darray_append_n(darray* d, const void* elements, const size_t count);
+
+
 // @brief Removes the last element from the array
 // @param d Pointer to the darray structure
 // @param out_element Optional pointer to store the removed element
@@ -114,6 +159,14 @@ i32 darray_pop_back(darray* d, void* out_element);
 i32 darray_insert(darray* d, const size_t index, const void* element);
 
 
+// @brief Reorders the elements so that the element at index [permutation[x]] moves to [x], every element is moved once.
+//        Used to store a collection in the order computed by sort_radix() or sort_merge()
+// @param d Pointer to the darray structure
+// @param permutation [darray_size(d)] indices, each index has to appear exactly once
+// @return AT_SUCCESS on success, error code on failure
+i32 darray_permute(darray* d, const u32* permutation);
+
+
 // @brief Removes the element at the specified position
 // @param d Pointer to the darray structure
 // @param index Position of the element to remove
@@ -138,3 +191,70 @@ i32 darray_clear(darray* d);
 // @return AT_SUCCESS on success, error code on failure
 i32 darray_resize(darray* d, const size_t new_size, const void* default_value);
 
+
+// ============================================================================================================================================
+// Typed arrays
+// ============================================================================================================================================
+
+// @brief Defines the array type [name] for elements of [type] and its functions [name]_<function>, e.g.
+//            DARRAY_DEFINE(vn_array, visual_novel)
+//            vn_array array;
+//            vn_array_init(&array);
+//            visual_novel* vn = vn_array_emplace_back(&array);
+//        The element size is known at compile time, access returns pointers instead of copies and nothing is validated:
+//        an array has to be initialized before use and indices have to be in range (same as darray_at()).
+//        Memory is zero initialized for static arrays, so [name]_init() can be skipped for them.
+//        The arrays grow like a darray, [name]_set_growth() works like darray_set_growth().
+#define DARRAY_DEFINE(name, type)                                                                                                           \
+    typedef type name##_element;                /* "const type*" would not apply const to pointer types */                                  \
+    typedef struct {                                                                                                                        \
+        type*       data;                                                                                                                   \
+        size_t      count;                                                                                                                  \
+        size_t      capacity;                                                                                                               \
+        u32         growth_percent;             /* 0 for DARRAY_DEFAULT_GROWTH */                                                           \
+    } name;                                                                                                                                 \
+                                                                                                                                            \
+    static inline void name##_init(name* a)                     { a->data = NULL; a->count = a->capacity = 0; a->growth_percent = 0; }      \
+    static inline void name##_set_growth(name* a, const u32 growth_percent) { a->growth_percent = growth_percent; }                         \
+    static inline void name##_free(name* a)                                 { free(a->data); name##_init(a); }                              \
+    static inline size_t name##_size(const name* a)                         { return a->count; }                                            \
+    static inline type* name##_at(const name* a, const size_t index)        { return a->data + index; }                                     \
+    static inline type* name##_back(const name* a)                          { return a->data + a->count - 1; }                              \
+    static inline void name##_pop_back(name* a)                             { a->count--; }                                                 \
+    static inline void name##_clear(name* a)                                { a->count = 0; }                                               \
+                                                                                                                                            \
+    /* takes over the storage of [d] (initialized for elements of [type]), [d] must not be used until [name]_give_back() */                \
+    static inline name name##_borrow(darray* d)         { return (name){ (type*)d->data, d->count, d->capacity, d->growth_percent }; }      \
+                                                                                                                                            \
+    static inline void name##_give_back(name* a, darray* d) {                                                                               \
+        d->data = a->data;                                                                                                                  \
+        d->count = a->count;                                                                                                                \
+        d->capacity = a->capacity;                                                                                                          \
+        if (a->growth_percent > 0) d->growth_percent = a->growth_percent;                                                                   \
+        name##_init(a);                                                                                                                     \
+    }                                                                                                                                       \
+                                                                                                                                            \
+    static inline i32 name##_grow(name* a, const size_t capacity) {                                                                         \
+        void* data = a->data;                                                                                                               \
+        const i32 result = darray_grow(&data, &a->capacity, sizeof(type), capacity);                                                        \
+        a->data = (type*)data;                                                                                                              \
+        return result;                                                                                                                      \
+    }                                                                                                                                       \
+                                                                                                                                            \
+    static inline i32 name##_reserve(name* a, const size_t capacity) {                                                                      \
+        return (capacity <= a->capacity) ? AT_SUCCESS : name##_grow(a, capacity);                                                           \
+    }                                                                                                                                       \
+                                                                                                                                            \
+    /* uninitialized storage for a new last element, NULL if the array could not grow */                                                    \
+    static inline type* name##_emplace_back(name* a) {                                                                                      \
+        if (a->count == a->capacity && name##_grow(a, darray_grown_capacity(a->capacity, a->growth_percent, a->count + 1)) != AT_SUCCESS)   \
+            return NULL;                                                                                                                    \
+        return a->data + a->count++;                                                                                                        \
+    }                                                                                                                                       \
+                                                                                                                                            \
+    static inline i32 name##_push_back(name* a, const name##_element* element) {                                                            \
+        type* slot = name##_emplace_back(a);                                                                                                \
+        if (!slot) return AT_MEMORY_ERROR;                                                                                                  \
+        *slot = *element;                                                                                                                   \
+        return AT_SUCCESS;                                                                                                                  \
+    }
@@ -3,6 +3,14 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <limits.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define DS_SIMD
+#endif
+
+#include "util/memory/arena.h"
 
 #include "dynamic_string.h"
 
@@ -17,6 +25,189 @@
     } while (0)
 
 
+// the buffer of an arena string is never freed on its own, it is released with the arena (see ds_init_arena())
+static inline char* buffer_alloc(struct arena* arena, const size_t size)   { return arena ? arena_alloc(arena, size) : malloc(size); }
+
+static inline b8 is_inline(const dyn_str* s)                                { return s->data == s->inline_data; }
+
+static inline void buffer_free(dyn_str* s)                                  { if (!s->arena && !is_inline(s)) free(s->data); }
+
+// uses [inline_data] if [capacity] fits, allocates otherwise
+static i32 buffer_init(dyn_str* s, struct arena* arena, const size_t capacity) {
+
+    s->arena = arena;
+    if (capacity <= DS_INLINE_CAPACITY) {
+        s->data = s->inline_data;
+        s->cap = DS_INLINE_CAPACITY;
+        return AT_SUCCESS;
+    }
+
+    s->data = buffer_alloc(arena, capacity);
+    if (!s->data) return AT_MEMORY_ERROR;
+    s->cap = capacity;
+    return AT_SUCCESS;
+}
+
+static i32 buffer_resize(dyn_str* s, const size_t new_cap) {
+
+    char* new_data = NULL;
+    if (is_inline(s)) {                                                     // first time the string outgrows the struct
+        new_data = buffer_alloc(s->arena, new_cap);
+        if (new_data)
+            memcpy(new_data, s->inline_data, s->len +1);
+    } else
+        new_data = s->arena ? arena_realloc(s->arena, s->data, s->cap, new_cap) : realloc(s->data, new_cap);
+    if (!new_data) return AT_MEMORY_ERROR;
+
+    s->data = new_data;
+    s->cap = new_cap;
+    return AT_SUCCESS;
+}
+
+// moves the content of [src] into the uninitialized [dest], [src] is uninitialized afterwards
+static void take_content(dyn_str* dest, dyn_str* src) {
+
+    *dest = *src;
+    if (is_inline(src))
+        dest->data = dest->inline_data;
+    src->data = NULL;
+    src->magic = 0;
+}
+
+
+// ============================================================================================================================================
+// search kernels
+// ============================================================================================================================================
+
+// Reverse substring search compares the first, the second and the last character of the needle at every position of a block at once
+// (Mula, "SIMD-friendly algorithms for substring searching"). Only positions where all three match are verified with memcmp(), so the
+// verification is rare even for needles that start with a common character. All kernels return an index into [data] or SIZE_MAX and
+// need [needle_len] >= 2. Forward search uses strstr(), the C library version is vectorized already and faster than these kernels.
+
+static size_t rfind_scalar(const char* data, const size_t len, const char* needle, const size_t needle_len) {
+
+    for (size_t x = len - needle_len +1; x > 0; x--)
+        if (data[x -1] == needle[0] && memcmp(data + x, needle +1, needle_len -1) == 0)
+            return x -1;
+    return SIZE_MAX;
+}
+
+static size_t rfind_char_scalar(const char* data, const size_t len, const char c) {
+
+    for (size_t x = len; x > 0; x--)
+        if (data[x -1] == c)
+            return x -1;
+    return SIZE_MAX;
+}
+
+#ifdef DS_SIMD
+
+// blocks are tested from the end, the highest bit of a mask is the last position
+__attribute__((target("sse2")))
+static size_t rfind_sse2(const char* data, const size_t len, const char* needle, const size_t needle_len) {
+
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i second = _mm_set1_epi8(needle[1]);
+    const __m128i last = _mm_set1_epi8(needle[needle_len -1]);
+
+    size_t end = len - needle_len +1;                                      // positions in front of [end] are not tested yet
+    for (; end >= 16; end -= 16) {
+        const size_t x = end - 16;
+        const __m128i block_first = _mm_loadu_si128((const __m128i*)(data + x));
+        const __m128i block_second = _mm_loadu_si128((const __m128i*)(data + x +1));
+        const __m128i block_last = _mm_loadu_si128((const __m128i*)(data + x + needle_len -1));
+        u32 mask = (u32)_mm_movemask_epi8(_mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_second, second)), _mm_cmpeq_epi8(block_last, last)));
+        while (mask) {
+            const u32 bit = 31 - (u32)__builtin_clz(mask);
+            if (memcmp(data + x + bit +1, needle +1, needle_len -2) == 0)
+                return x + bit;
+            mask &= ~(1u << bit);
+        }
+    }
+    return (end == 0) ? SIZE_MAX : rfind_scalar(data, end + needle_len -1, needle, needle_len);
+}
+
+__attribute__((target("sse2")))
+static size_t rfind_char_sse2(const char* data, const size_t len, const char c) {
+
+    const __m128i value = _mm_set1_epi8(c);
+    size_t end = len;
+    for (; end >= 16; end -= 16) {
+        const u32 mask = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + end - 16)), value));
+        if (mask)
+            return end - 16 + 31 - (u32)__builtin_clz(mask);
+    }
+    return rfind_char_scalar(data, end, c);
+}
+
+__attribute__((target("avx2")))
+static size_t rfind_avx2(const char* data, const size_t len, const char* needle, const size_t needle_len) {
+
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i second = _mm256_set1_epi8(needle[1]);
+    const __m256i last = _mm256_set1_epi8(needle[needle_len -1]);
+
+    size_t end = len - needle_len +1;
+    for (; end >= 32; end -= 32) {
+        const size_t x = end - 32;
+        const __m256i block_first = _mm256_loadu_si256((const __m256i*)(data + x));
+        const __m256i block_second = _mm256_loadu_si256((const __m256i*)(data + x +1));
+        const __m256i block_last = _mm256_loadu_si256((const __m256i*)(data + x + needle_len -1));
+        u32 mask = (u32)_mm256_movemask_epi8(_mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(block_first, first), _mm256_cmpeq_epi8(block_second, second)), _mm256_cmpeq_epi8(block_last, last)));
+        while (mask) {
+            const u32 bit = 31 - (u32)__builtin_clz(mask);
+            if (memcmp(data + x + bit +1, needle +1, needle_len -2) == 0)
+                return x + bit;
+            mask &= ~(1u << bit);
+        }
+    }
+    return (end == 0) ? SIZE_MAX : rfind_scalar(data, end + needle_len -1, needle, needle_len);
+}
+
+__attribute__((target("avx2")))
+static size_t rfind_char_avx2(const char* data, const size_t len, const char c) {
+
+    const __m256i value = _mm256_set1_epi8(c);
+    size_t end = len;
+    for (; end >= 32; end -= 32) {
+        const u32 mask = (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(data + end - 32)), value));
+        if (mask)
+            return end - 32 + 31 - (u32)__builtin_clz(mask);
+    }
+    return rfind_char_scalar(data, end, c);
+}
+
+#endif
+
+// first occurrence of [needle] in the null terminated [data], SIZE_MAX if there is none
+static size_t find_substring(const char* data, const char* needle) {
+
+    const char* found = strstr(data, needle);
+    return found ? (size_t)(found - data) : SIZE_MAX;
+}
+
+// last occurrence of [needle] in [data], SIZE_MAX if there is none
+static size_t rfind_substring(const char* data, const size_t len, const char* needle, const size_t needle_len) {
+
+    if (needle_len > len || needle_len == 0) return SIZE_MAX;
+    if (needle_len == 1) {
+#ifdef DS_SIMD
+        if (len >= 32 && __builtin_cpu_supports("avx2"))
+            return rfind_char_avx2(data, len, needle[0]);
+        if (len >= 16 && __builtin_cpu_supports("sse2"))
+            return rfind_char_sse2(data, len, needle[0]);
+#endif
+        return rfind_char_scalar(data, len, needle[0]);
+    }
+
+#ifdef DS_SIMD
+    if (len >= needle_len + 32 && __builtin_cpu_supports("avx2"))
+        return rfind_avx2(data, len, needle, needle_len);
+    if (len >= needle_len + 16 && __builtin_cpu_supports("sse2"))
+        return rfind_sse2(data, len, needle, needle_len);
+#endif
+    return rfind_scalar(data, len, needle, needle_len);
+}
 
 
 // ============================================================================================================================================
@@ -27,9 +218,8 @@ i32 ds_init(dyn_str* s) {
 
     if (s->magic == MAGIC) return AT_ALREADY_INITIALIZED;
 
-    s->cap = 4096;
-    s->data = malloc(s->cap);
-    if (!s->data) return AT_MEMORY_ERROR;
+    const i32 result = buffer_init(s, NULL, DS_INLINE_CAPACITY);            // grows on the first append that does not fit
+    if (result != AT_SUCCESS) return result;
 
     s->len = 0;
     s->data[0] = '\0';
@@ -42,9 +232,8 @@ i32 ds_init_s(dyn_str* s, const size_t needed_size) {
 
     if (s->magic == MAGIC) return AT_ALREADY_INITIALIZED;
 
-    s->cap = needed_size + 64;      // add small buffer
-    s->data = malloc(s->cap);
-    if (!s->data) return AT_MEMORY_ERROR;
+    const i32 result = buffer_init(s, NULL, (needed_size < DS_INLINE_CAPACITY) ? needed_size +1 : needed_size + 64);      // add small buffer
+    if (result != AT_SUCCESS) return result;
 
     s->len = 0;
     s->data[0] = '\0';
@@ -86,7 +275,7 @@ i32 ds_from_file(dyn_str* s, FILE* file) {
     s->len = fread(s->data, 1, (size_t)file_size, file);
     if (s->len != (size_t)file_size) {
         // Handle read error
-        free(s->data);
+        buffer_free(s);
         s->magic = 0;
         return AT_IO_ERROR;
     }
@@ -98,6 +287,21 @@ i32 ds_from_file(dyn_str* s, FILE* file) {
 }
 
 
+i32 ds_init_arena(dyn_str* s, struct arena* arena, const size_t capacity) {
+
+    if (s->magic == MAGIC) return AT_ALREADY_INITIALIZED;
+    if (!arena) return AT_INVALID_ARGUMENT;
+
+    const i32 result = buffer_init(s, arena, capacity);
+    if (result != AT_SUCCESS) return result;
+
+    s->len = 0;
+    s->data[0] = '\0';
+    s->magic = MAGIC;
+    return AT_SUCCESS;
+}
+
+
 
 // ============================================================================================================================================
 // free
@@ -108,8 +312,9 @@ i32 ds_free(dyn_str* s) {
 
     VALIDATE(s);
 
-    free(s->data);
+    buffer_free(s);
     s->data = NULL;
+    s->arena = NULL;
     s->len = s->cap = 0;
     s->magic = 0;
     return AT_SUCCESS;
@@ -142,6 +347,21 @@ i32 ds_append_str(dyn_str* s, const char* text) {
 }
 
 
+i32 ds_append_str_n(dyn_str* s, const char* text, const size_t len) {
+
+    VALIDATE(s);
+    if (!text)    return AT_INVALID_ARGUMENT;
+
+    const i32 result = ds_ensure(s, len);
+    if (result != AT_SUCCESS)   return result;
+
+    memcpy(s->data + s->len, text, len);
+    s->len += len;
+    s->data[s->len] = '\0';
+    return AT_SUCCESS;
+}
+
+
 i32 ds_append_char(dyn_str* s, const char c) {
 
     VALIDATE(s);
@@ -179,7 +399,7 @@ i32 ds_append_fmt(dyn_str* s, i32* needed_space, const char* fmt, ...) {
 
     if (*needed_buffer > 0) {
 
-        const i32 result = ds_ensure(s, (size_t)needed_space);
+        const i32 result = ds_ensure(s, (size_t)*needed_buffer);
         if (result != AT_SUCCESS) {
             va_end(ap);
             return result;
@@ -267,31 +487,23 @@ ssize_t ds_find_str(const dyn_str* s, const char* substr, size_t start_pos) {
     if (!substr) return -1;
     if (start_pos >= s->len) return -1;
     
-    char* found = strstr(s->data + start_pos, substr);
-    return found ? (ssize_t)(found - s->data) : -1;
+    const size_t found = find_substring(s->data + start_pos, substr);
+    return (found == SIZE_MAX) ? -1 : (ssize_t)(start_pos + found);
 }
 
 ssize_t ds_find_last_char(const dyn_str* s, char c) {
     VALIDATE(s);
     
-    for (ssize_t i = s->len - 1; i >= 0; i--) {
-        if (s->data[i] == c) return i;
-    }
-    return -1;
+    const size_t found = rfind_substring(s->data, s->len, &c, 1);
+    return (found == SIZE_MAX) ? -1 : (ssize_t)found;
 }
 
 ssize_t ds_find_last_str(const dyn_str* s, const char* substr) {
     VALIDATE(s);
     if (!substr) return -1;
     
-    size_t substr_len = strlen(substr);
-    if (substr_len == 0) return -1;
-    if (substr_len > s->len) return -1;
-    
-    for (ssize_t i = s->len - substr_len; i >= 0; i--) {
-        if (strncmp(s->data + i, substr, substr_len) == 0) return i;
-    }
-    return -1;
+    const size_t found = rfind_substring(s->data, s->len, substr, strlen(substr));
+    return (found == SIZE_MAX) ? -1 : (ssize_t)found;
 }
 
 // ============================================================================================================================================
@@ -429,25 +641,46 @@ i32 ds_replace(dyn_str* s, const char* old_str, const char* new_str) {
     
     const size_t old_len = strlen(old_str);
     if (old_len == 0) return AT_SUCCESS; // Nothing to replace
-    
-    // Find all occurrences
-    dyn_str result;
-    const i32 init_result = ds_init(&result);
+    const size_t new_len = strlen(new_str);
+
+    // A result that is not longer is written over the string in one pass, the write position never passes the read position
+    if (new_len <= old_len) {
+        size_t read = 0, write = 0, found;
+        while ((found = find_substring(s->data + read, old_str)) != SIZE_MAX) {
+            memmove(s->data + write, s->data + read, found);
+            memcpy(s->data + write + found, new_str, new_len);
+            write += found + new_len;
+            read += found + old_len;
+        }
+        memmove(s->data + write, s->data + read, s->len - read +1);                 // rest incl. null terminator
+        s->len = write + s->len - read;
+        return AT_SUCCESS;
+    }
+
+    // Otherwise count the matches first, so the result is built with exactly one allocation
+    size_t count = 0;
+    for (size_t pos = 0, found; (found = find_substring(s->data + pos, old_str)) != SIZE_MAX; pos += found + old_len)
+        count++;
+    if (count == 0) return AT_SUCCESS;
+
+    const size_t result_len = s->len + count * (new_len - old_len);
+    dyn_str result = {0};
+    const i32 init_result = s->arena ? ds_init_arena(&result, s->arena, result_len +1) : ds_init_s(&result, result_len);
     if (init_result != AT_SUCCESS) return init_result;
-    
-    size_t pos = 0;
-    ssize_t found_pos;
-    
-    while ((found_pos = ds_find_str(s, old_str, pos)) != -1) {
-        ds_append_fmt(&result, NULL, "%.*s", (i32)(found_pos - pos), s->data + pos);      // Append the part before the match
-        ds_append_str(&result, new_str);            // Append the replacement
-        pos = found_pos + old_len;                  // Move position after the match
+
+    size_t read = 0, found;
+    char* write = result.data;
+    while ((found = find_substring(s->data + read, old_str)) != SIZE_MAX) {
+        memcpy(write, s->data + read, found);
+        memcpy(write + found, new_str, new_len);
+        write += found + new_len;
+        read += found + old_len;
     }
-    
-    ds_append_str(&result, s->data + pos);          // Append the remaining part
+    memcpy(write, s->data + read, s->len - read +1);
+    result.len = result_len;
+
     ds_free(s);                                     // Swap the contents
-    *s = result;
-    
+    take_content(s, &result);
     return AT_SUCCESS;
 }
 
@@ -472,10 +705,8 @@ i32 ds_replace_range(dyn_str* s, const size_t start_pos, const size_t length, co
         while (new_cap < new_total_len + 1) {
             new_cap *= 2;
         }
-        char* new_data = realloc(s->data, new_cap);
-        if (!new_data) return AT_MEMORY_ERROR;
-        s->data = new_data;
-        s->cap = new_cap;
+        const i32 result = buffer_resize(s, new_cap);
+        if (result != AT_SUCCESS) return result;
     }
 
     // Move the tail of the string if needed
@@ -591,12 +822,11 @@ i32 ds_ensure(dyn_str* s, const size_t extra) {
 
     const size_t need = s->len + extra + 1;
     if (need > s->cap) {
-        while (s->cap < need)
-            s->cap *= 2;
+        size_t new_cap = s->cap;
+        while (new_cap < need)
+            new_cap *= 2;
 
-        char* new_data = realloc(s->data, s->cap);
-        if (!new_data)  return AT_MEMORY_ERROR;
-        s->data = new_data;
+        return buffer_resize(s, new_cap);
     }
     return AT_SUCCESS;
 }
@@ -1,17 +1,25 @@
 #pragma once
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <sys/types.h>
 
 #include "data_types.h"
    
 
+struct arena;
 
+#define DS_INLINE_CAPACITY      64          // strings up to 63 characters are stored inside the struct without allocating
+
+// Short strings live in [inline_data] and only move to the heap (or the arena) when they grow beyond it.
+// [data] can point into the struct itself, so an initialized dyn_str must not be copied or moved by value.
 typedef struct {
-    char*       data;   // pointer to the dynamically allocated string buffer
-    size_t      len;    // current length of the string (excluding null terminator)
-    size_t      cap;    // allocated capacity of the buffer
-    u32         magic;  // Magic number to verify initialization
+    char*           data;   // pointer to the string buffer, [inline_data] or dynamically allocated
+    size_t          len;    // current length of the string (excluding null terminator)
+    size_t          cap;    // allocated capacity of the buffer
+    struct arena*   arena;  // buffer is allocated from this arena, NULL for the heap
+    u32             magic;  // Magic number to verify initialization
+    char            inline_data[DS_INLINE_CAPACITY];
 } dyn_str;
 
 
@@ -21,7 +29,7 @@ typedef struct {
 // ============================================================================================================================================
 
 // @brief Initializes a dynamic string to an empty state,
-//          allocates inital memory with default capacity
+//          nothing is allocated until it grows beyond DS_INLINE_CAPACITY
 i32 ds_init(dyn_str* s);
 
 
@@ -38,6 +46,13 @@ i32 ds_from_c_str(dyn_str* s, const char* text);
 
 i32 ds_from_file(dyn_str* s, FILE* file);
 
+
+// @brief Initializes a dynamic string whose buffer comes from [arena] (see util/memory/arena.h).
+//          Growing the string does not free the old buffer and ds_free() only detaches the string,
+//          the memory is released when the arena is reset. The string must not be used after that
+// @param capacity The minimum inital capacity to allocate
+i32 ds_init_arena(dyn_str* s, struct arena* arena, const size_t capacity);
+
 // ============================================================================================================================================
 // free
 // ============================================================================================================================================
@@ -60,6 +75,12 @@ i32 ds_clear(dyn_str* s);
 i32 ds_append_str(dyn_str* s, const char* text);
 
 
+// @brief Appends [len] characters of [text] to the end of the dynamic string
+// @param text The string to append, does not need to be null-terminated
+// @param len Number of characters to append
+i32 ds_append_str_n(dyn_str* s, const char* text, const size_t len);
+
+
 // @brief Appends a single character to the dynamic string
 // @param c The character to append
 i32 ds_append_char(dyn_str* s, const char c);
@@ -0,0 +1,119 @@
+
+#include <string.h>
+
+#include "hash.h"
+
+
+// odd constants with 32 set bits (from wyhash), every input word is xor'ed with one before the multiplication
+#define SECRET_0                0xA0761D6478BD642FULL
+#define SECRET_1                0xE7037ED1A0B428DBULL
+#define SECRET_2                0x8EBC6AF09C88C6E3ULL
+#define SECRET_3                0x589965CC75374CC3ULL
+
+
+// ============================================================================================================================================
+// helpers
+// ============================================================================================================================================
+
+// 128 bit product of [a] and [b], the low half is returned in [a] and the high half in [b]
+static inline void multiply_128(u64* a, u64* b) {
+
+#if defined(__SIZEOF_INT128__)
+    const __uint128_t product = (__uint128_t)*a * *b;
+    *a = (u64)product;
+    *b = (u64)(product >> 64);
+#else
+    const u64 a_hi = *a >> 32, a_lo = (u32)*a;
+    const u64 b_hi = *b >> 32, b_lo = (u32)*b;
+    const u64 hi_hi = a_hi * b_hi, hi_lo = a_hi * b_lo;
+    const u64 lo_hi = a_lo * b_hi, lo_lo = a_lo * b_lo;
+    const u64 middle = hi_lo + (lo_lo >> 32) + (u32)lo_hi;
+    *a = (middle << 32) | (u32)lo_lo;
+    *b = hi_hi + (middle >> 32) + (lo_hi >> 32);
+#endif
+}
+
+// folds the 128 bit product, changing one input bit changes about half of the result bits
+static inline u64 mix(u64 a, u64 b) {
+
+    multiply_128(&a, &b);
+    return a ^ b;
+}
+
+// unaligned little endian reads, memcpy() compiles to a single load
+static inline u64 read_64(const u8* data) {
+
+    u64 value;
+    memcpy(&value, data, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap64(value);
+#endif
+    return value;
+}
+
+static inline u64 read_32(const u8* data) {
+
+    u32 value;
+    memcpy(&value, data, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap32(value);
+#endif
+    return value;
+}
+
+// 1 to 3 bytes: first, middle and last byte (overlapping for short inputs, the length is mixed in separately)
+static inline u64 read_small(const u8* data, const size_t len)     { return ((u64)data[0] << 16) | ((u64)data[len >> 1] << 8) | data[len - 1]; }
+
+
+// ============================================================================================================================================
+// memory
+// ============================================================================================================================================
+
+u64 hash_bytes(const void* data, const size_t len, const u64 seed) {
+
+    const u8* pos = (const u8*)data;
+    u64 state = seed ^ mix(seed ^ SECRET_0, SECRET_1);
+    u64 a, b;
+
+    if (len <= 16) {
+        if (len >= 4) {                                                 // two overlapping pairs of 4 byte reads cover 4 to 16 bytes
+            const size_t offset = (len >> 3) << 2;
+            a = (read_32(pos) << 32) | read_32(pos + offset);
+            b = (read_32(pos + len - 4) << 32) | read_32(pos + len - 4 - offset);
+        } else if (len > 0) {
+            a = read_small(pos, len);
+            b = 0;
+        } else
+            a = b = 0;
+
+    } else {
+        size_t remaining = len;
+        if (remaining > 48) {                                           // three independent lanes keep the multipliers busy
+            u64 lane_1 = state, lane_2 = state;
+            do {
+                state = mix(read_64(pos) ^ SECRET_1, read_64(pos + 8) ^ state);
+                lane_1 = mix(read_64(pos + 16) ^ SECRET_2, read_64(pos + 24) ^ lane_1);
+                lane_2 = mix(read_64(pos + 32) ^ SECRET_3, read_64(pos + 40) ^ lane_2);
+                pos += 48;
+                remaining -= 48;
+            } while (remaining > 48);
+            state ^= lane_1 ^ lane_2;
+        }
+
+        while (remaining > 16) {
+            state = mix(read_64(pos) ^ SECRET_1, read_64(pos + 8) ^ state);
+            pos += 16;
+            remaining -= 16;
+        }
+        a = read_64(pos + remaining - 16);                              // last 16 bytes, may overlap with the previous block
+        b = read_64(pos + remaining - 8);
+    }
+
+    a ^= SECRET_1;
+    b ^= state;
+    multiply_128(&a, &b);
+    return mix(a ^ SECRET_0 ^ len, b ^ SECRET_1);
+}
+
+
+u64 hash_string(const char* str, const u64 seed)                    { return hash_bytes(str, strlen(str), seed); }
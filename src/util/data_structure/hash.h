@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "util/data_structure/data_types.h"
+
+
+// Non cryptographic hash functions for hash tables and checksums of data in memory.
+// Every bit of the result depends on every bit of the input, so tables can select slots by masking the low bits
+// (power of two sizes) without additional mixing. The results are not stable across versions, do not store them in files.
+//  - hash_bytes():     wyhash style, reads 8 bytes at a time and folds them with 64x64 -> 128 bit multiplications
+//  - hash_u64():       bijective mixer for integer and pointer keys
+// A [seed] selects an independent hash function, e.g. a random seed per table makes collisions unpredictable from the outside.
+
+
+#define HASH_DEFAULT_SEED       0ULL
+
+
+// ============================================================================================================================================
+// integers
+// ============================================================================================================================================
+
+// @brief Mixes the bits of [value], two xor-shift-multiply rounds (different values always give different results for one seed)
+static inline u64 hash_u64(u64 value, const u64 seed) {
+
+    value ^= seed + 0x9E3779B97F4A7C15ULL;
+    value ^= value >> 32;
+    value *= 0xD6E8FEB86659FD93ULL;
+    value ^= value >> 32;
+    value *= 0xD6E8FEB86659FD93ULL;
+    value ^= value >> 32;
+    return value;
+}
+
+
+// @brief Hash of a pair of hashes, e.g. for keys made of several fields. The order of [first] and [second] matters
+static inline u64 hash_combine(const u64 first, const u64 second) {
+
+    return hash_u64(first ^ (second * 0x9E3779B97F4A7C15ULL), second);
+}
+
+
+// ============================================================================================================================================
+// memory
+// ============================================================================================================================================
+
+// @brief Hashes [len] bytes of [data], [data] needs no alignment
+u64 hash_bytes(const void* data, const size_t len, const u64 seed);
+
+
+// @brief Hashes a null terminated string without the terminator, equal to hash_bytes(str, strlen(str), seed)
+u64 hash_string(const char* str, const u64 seed);
@@ -0,0 +1,121 @@
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "lockfree_queue.h"
+
+
+
+#define MAGIC 0xF1F0F1F0F1F0F1F0
+
+#define VALIDATE(q) \
+    do { \
+        if (!(q) || (q)->magic != MAGIC) return AT_INVALID_ARGUMENT; \
+    } while (0)
+
+
+// sequence of a slot: equal to the position when it is free for the producer of that position,
+// position + 1 when it holds the element for the consumer of that position
+static inline atomic_size_t* slot_sequence(const lf_queue* q, const size_t pos)     { return (atomic_size_t*)(q->slots + (pos & (q->capacity - 1)) * q->slot_size); }
+
+static inline void* slot_element(const lf_queue* q, const size_t pos)               { return q->slots + (pos & (q->capacity - 1)) * q->slot_size + sizeof(atomic_size_t); }
+
+
+
+// ============================================================================================================================================
+// Initialization and cleanup
+// ============================================================================================================================================
+
+
+i32 lfq_init(lf_queue* q, const size_t element_size, const size_t capacity) {
+
+    if (!q || element_size == 0 || capacity == 0) return AT_INVALID_ARGUMENT;
+    if (q->magic == MAGIC) return AT_ALREADY_INITIALIZED;
+
+    size_t loc_capacity = 2;
+    while (loc_capacity < capacity)
+        loc_capacity *= 2;
+
+    const size_t alignment = _Alignof(max_align_t);
+    q->slot_size = (sizeof(atomic_size_t) + element_size + alignment - 1) & ~(alignment - 1);
+    q->slots = malloc(q->slot_size * loc_capacity);
+    if (!q->slots) return AT_MEMORY_ERROR;
+
+    q->capacity = loc_capacity;
+    q->element_size = element_size;
+    for (size_t x = 0; x < loc_capacity; x++)
+        atomic_init(slot_sequence(q, x), x);
+    atomic_init(&q->enqueue_pos, 0);
+    atomic_init(&q->dequeue_pos, 0);
+    q->magic = MAGIC;
+
+    return AT_SUCCESS;
+}
+
+
+i32 lfq_free(lf_queue* q) {
+
+    VALIDATE(q);
+
+    free(q->slots);
+    q->slots = NULL;
+    q->capacity = q->element_size = q->slot_size = 0;
+    q->magic = 0;
+
+    return AT_SUCCESS;
+}
+
+
+// ============================================================================================================================================
+// Queue operations
+// ============================================================================================================================================
+
+
+i32 lfq_push(lf_queue* q, const void* element) {
+
+    VALIDATE(q);
+    if (!element) return AT_INVALID_ARGUMENT;
+
+    size_t pos = atomic_load_explicit(&q->enqueue_pos, memory_order_relaxed);
+    for (;;) {
+        atomic_size_t* sequence = slot_sequence(q, pos);
+        const size_t current = atomic_load_explicit(sequence, memory_order_acquire);
+        const intptr_t difference = (intptr_t)current - (intptr_t)pos;
+
+        if (difference == 0) {              // free for this position, claim it
+            if (atomic_compare_exchange_weak_explicit(&q->enqueue_pos, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+                memcpy(slot_element(q, pos), element, q->element_size);
+                atomic_store_explicit(sequence, pos + 1, memory_order_release);
+                return AT_SUCCESS;
+            }
+        } else if (difference < 0)          // still holds the element of the previous round
+            return AT_RANGE_ERROR;
+        else                                // another producer was faster
+            pos = atomic_load_explicit(&q->enqueue_pos, memory_order_relaxed);
+    }
+}
+
+
+b8 lfq_pop(lf_queue* q, void* out_element) {
+
+    if (!q || q->magic != MAGIC || !out_element) return false;
+
+    size_t pos = atomic_load_explicit(&q->dequeue_pos, memory_order_relaxed);
+    for (;;) {
+        atomic_size_t* sequence = slot_sequence(q, pos);
+        const size_t current = atomic_load_explicit(sequence, memory_order_acquire);
+        const intptr_t difference = (intptr_t)current - (intptr_t)(pos + 1);
+
+        if (difference == 0) {              // filled for this position, claim it
+            if (atomic_compare_exchange_weak_explicit(&q->dequeue_pos, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+                memcpy(out_element, slot_element(q, pos), q->element_size);
+                atomic_store_explicit(sequence, pos + q->capacity, memory_order_release);        // free for the producer of the next round
+                return true;
+            }
+        } else if (difference < 0)          // not filled yet
+            return false;
+        else                                // another consumer was faster
+            pos = atomic_load_explicit(&q->dequeue_pos, memory_order_relaxed);
+    }
+}
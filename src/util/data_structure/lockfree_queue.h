@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "util/data_structure/data_types.h"
+
+
+// Bounded multi-producer/multi-consumer queue without locks, used to hand work from background threads to the UI thread.
+// Every slot carries a sequence number that tells producers and consumers whether it is free or filled for their turn,
+// so push and pop only need one compare-and-swap on the shared position and never wait for each other.
+// Elements are copied in and out, the capacity is rounded up to a power of two.
+
+typedef struct {
+    u8*                 slots;              // [capacity] slots of [slot_size] bytes: atomic sequence followed by the element
+    size_t              capacity;
+    size_t              element_size;
+    size_t              slot_size;
+    _Alignas(64) atomic_size_t  enqueue_pos;            // separate cache lines, producers and consumers do not share one
+    _Alignas(64) atomic_size_t  dequeue_pos;
+    u64                 magic;
+} lf_queue;
+
+
+// @brief Initializes a queue that can hold [capacity] elements of [element_size] bytes
+// @return AT_SUCCESS on success, error code on failure
+i32 lfq_init(lf_queue* q, const size_t element_size, const size_t capacity);
+
+
+// @brief Frees the memory of the queue, elements still in the queue are dropped
+// @return AT_SUCCESS on success, error code on failure
+i32 lfq_free(lf_queue* q);
+
+
+// @brief Copies [element] into the queue, safe to call from any thread
+// @return AT_SUCCESS on success, AT_RANGE_ERROR if the queue is full
+i32 lfq_push(lf_queue* q, const void* element);
+
+
+// @brief Copies the oldest element into [out_element] and removes it, safe to call from any thread
+// @return true if an element was removed, false if the queue is empty
+b8 lfq_pop(lf_queue* q, void* out_element);
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/data_structure/darray.h"
+
+
+// Array that keeps its first elements inside the struct and only allocates when it grows beyond them, for short-lived or
+// usually small collections (a few nested section headers, the diffs of one reload).
+// Elements stay in [inline_data] until [inline_capacity] is exceeded, then all of them move to [heap]. Because no pointer to
+// [inline_data] is stored, the struct can be copied or moved like a value (as long as only one copy is used afterwards).
+
+// @brief Defines the vector type [name] for elements of [type] with room for [inline_capacity] elements without allocating, e.g.
+//            SMALL_VECTOR_DEFINE(header_stack, sy_header, 4)
+//            header_stack headers;
+//            header_stack_init(&headers);
+//            sy_header* header = header_stack_emplace_back(&headers);
+//        Like DARRAY_DEFINE() access returns pointers instead of copies and nothing is validated: the vector has to be
+//        initialized before use and indices have to be in range. Pointers to elements are invalidated when the vector grows.
+#define SMALL_VECTOR_DEFINE(name, type, inline_capacity)                                                                                    \
+    STATIC_ASSERT((inline_capacity) > 0, "a small vector needs inline storage, use DARRAY_DEFINE() otherwise");                            \
+    typedef type name##_element;                /* "const type*" would not apply const to pointer types */                                  \
+    typedef struct {                                                                                                                        \
+        type*       heap;                       /* NULL while the elements fit into [inline_data] */                                        \
+        size_t      count;                                                                                                                  \
+        size_t      capacity;                                                                                                               \
+        type        inline_data[inline_capacity];                                                                                           \
+    } name;                                                                                                                                 \
+                                                                                                                                            \
+    static inline void name##_init(name* v)                                 { v->heap = NULL; v->count = 0; v->capacity = inline_capacity; }\
+    static inline void name##_free(name* v)                                 { free(v->heap); name##_init(v); }                              \
+    static inline size_t name##_size(const name* v)                         { return v->count; }                                            \
+    static inline type* name##_data(name* v)                                { return v->heap ? v->heap : v->inline_data; }                  \
+    static inline type* name##_at(name* v, const size_t index)              { return name##_data(v) + index; }                              \
+    static inline type* name##_back(name* v)                                { return name##_data(v) + v->count - 1; }                       \
+    static inline void name##_pop_back(name* v)                             { v->count--; }                                                 \
+    static inline void name##_clear(name* v)                                { v->count = 0; }                                               \
+                                                                                                                                            \
+    /* moves the elements to the heap on the first call, afterwards only reallocates */                                                    \
+    static inline i32 name##_grow(name* v, const size_t capacity) {                                                                         \
+        void* heap = v->heap;                                                                                                               \
+        size_t loc_capacity = v->capacity;                                                                                                  \
+        const i32 result = darray_grow(&heap, &loc_capacity, sizeof(type), capacity);                                                       \
+        if (result != AT_SUCCESS) return result;                                                                                            \
+        if (!v->heap)                                                                                                                       \
+            memcpy(heap, v->inline_data, v->count * sizeof(type));                                                                          \
+        v->heap = (type*)heap;                                                                                                              \
+        v->capacity = loc_capacity;                                                                                                         \
+        return AT_SUCCESS;                                                                                                                  \
+    }                                                                                                                                       \
+                                                                                                                                            \
+    static inline i32 name##_reserve(name* v, const size_t capacity) {                                                                      \
+        return (capacity <= v->capacity) ? AT_SUCCESS : name##_grow(v, capacity);                                                           \
+    }                                                                                                                                       \
+                                                                                                                                            \
+    /* uninitialized storage for a new last element, NULL if the vector could not grow */                                                   \
+    static inline type* name##_emplace_back(name* v) {                                                                                      \
+        if (v->count == v->capacity && name##_grow(v, v->capacity * 2) != AT_SUCCESS)                                                       \
+            return NULL;                                                                                                                    \
+        return name##_data(v) + v->count++;                                                                                                 \
+    }                                                                                                                                       \
+                                                                                                                                            \
+    static inline i32 name##_push_back(name* v, const name##_element* element) {                                                            \
+        type* slot = name##_emplace_back(v);                                                                                                \
+        if (!slot) return AT_MEMORY_ERROR;                                                                                                  \
+        *slot = *element;                                                                                                                   \
+        return AT_SUCCESS;                                                                                                                  \
+    }
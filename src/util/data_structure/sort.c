@@ -0,0 +1,331 @@
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sort.h"
+
+
+#define INSERTION_RUN           32                      // runs of this length are sorted by insertion before merging
+#define MIN_PER_THREAD          16384                   // elements, smaller arrays are sorted on the calling thread
+#define MAX_THREADS             16
+#define RADIX_BITS              11
+#define RADIX_BUCKETS           (1 << RADIX_BITS)
+#define RADIX_PASSES            ((64 + RADIX_BITS - 1) / RADIX_BITS)
+
+
+// ============================================================================================================================================
+// permutation
+// ============================================================================================================================================
+
+void sort_identity(u32* permutation, const size_t count) {
+
+    for (size_t x = 0; x < count; x++)
+        permutation[x] = (u32)x;
+}
+
+
+// ============================================================================================================================================
+// radix
+// ============================================================================================================================================
+
+i32 sort_radix(u32* permutation, const size_t count, const u64* keys, const b8 descending) {
+
+    if (!permutation || !keys || count > SORT_MAX_COUNT) return AT_INVALID_ARGUMENT;
+    if (count < 2) return AT_SUCCESS;
+
+    // keys are gathered in the order of the permutation and moved along with the indices, so every pass reads sequentially
+    u64* key_buffer = malloc(count * 2 * sizeof(u64));
+    u32* index_buffer = malloc(count * sizeof(u32));
+    size_t (*histogram)[RADIX_BUCKETS] = calloc(RADIX_PASSES, sizeof(*histogram));
+    if (!key_buffer || !index_buffer || !histogram) {
+        free(key_buffer);
+        free(index_buffer);
+        free(histogram);
+        return AT_MEMORY_ERROR;
+    }
+
+    const u64 flip = descending ? ~0ULL : 0;                            // inverted keys sort in descending order and stay stable
+    u64* src_keys = key_buffer;
+    u64* dst_keys = key_buffer + count;
+    for (size_t x = 0; x < count; x++) {
+        const u64 key = keys[permutation[x]] ^ flip;
+        src_keys[x] = key;
+        for (u32 pass = 0; pass < RADIX_PASSES; pass++)
+            histogram[pass][(key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)]++;
+    }
+
+    u32* src_indices = permutation;
+    u32* dst_indices = index_buffer;
+    for (u32 pass = 0; pass < RADIX_PASSES; pass++) {
+        const u32 shift = pass * RADIX_BITS;
+        size_t* offsets = histogram[pass];
+        if (offsets[(src_keys[0] >> shift) & (RADIX_BUCKETS - 1)] == count)
+            continue;                                                   // all keys share this digit (e.g. the high bits of small numbers)
+
+        size_t sum = 0;
+        for (u32 bucket = 0; bucket < RADIX_BUCKETS; bucket++) {
+            const size_t bucket_count = offsets[bucket];
+            offsets[bucket] = sum;
+            sum += bucket_count;
+        }
+
+        for (size_t x = 0; x < count; x++) {
+            const size_t target = offsets[(src_keys[x] >> shift) & (RADIX_BUCKETS - 1)]++;
+            dst_keys[target] = src_keys[x];
+            dst_indices[target] = src_indices[x];
+        }
+
+        u64* swap_keys = src_keys;
+        src_keys = dst_keys;
+        dst_keys = swap_keys;
+        u32* swap_indices = src_indices;
+        src_indices = dst_indices;
+        dst_indices = swap_indices;
+    }
+
+    if (src_indices != permutation)
+        memcpy(permutation, src_indices, count * sizeof(u32));
+
+    free(key_buffer);
+    free(index_buffer);
+    free(histogram);
+    return AT_SUCCESS;
+}
+
+
+// ============================================================================================================================================
+// merge
+// ============================================================================================================================================
+
+typedef struct {
+    sort_compare_t      compare;
+    void*               user_data;
+} comparator;
+
+static inline i32 compare_indices(const comparator* cmp, const u32 a, const u32 b)     { return cmp->compare(a, b, cmp->user_data); }
+
+
+static void insertion_sort(u32* data, const size_t count, const comparator* cmp) {
+
+    for (size_t x = 1; x < count; x++) {
+        const u32 value = data[x];
+        size_t y = x;
+        for (; y > 0 && compare_indices(cmp, value, data[y - 1]) < 0; y--)
+            data[y] = data[y - 1];
+        data[y] = value;
+    }
+}
+
+
+// stable: on equal elements the one of [left] is taken first
+static void merge(const u32* left, const size_t left_count, const u32* right, const size_t right_count, u32* out, const comparator* cmp) {
+
+    size_t l = 0, r = 0;
+    while (l < left_count && r < right_count)
+        *out++ = (compare_indices(cmp, right[r], left[l]) < 0) ? right[r++] : left[l++];
+    memcpy(out, left + l, (left_count - l) * sizeof(u32));
+    memcpy(out + (left_count - l), right + r, (right_count - r) * sizeof(u32));
+}
+
+
+// @return number of elements of [left] among the first [k] elements of merge([left], [right])
+static size_t merge_split(const u32* left, const size_t left_count, const u32* right, const size_t right_count, const size_t k, const comparator* cmp) {
+
+    size_t low = (k > right_count) ? k - right_count : 0;
+    size_t high = (k < left_count) ? k : left_count;
+    while (low < high) {
+        const size_t l = low + (high - low) / 2;
+        const size_t r = k - l;
+        if (r > 0 && compare_indices(cmp, right[r - 1], left[l]) >= 0)   // left[l] is merged before right[r - 1], take more of [left]
+            low = l + 1;
+        else
+            high = l;
+    }
+    return low;
+}
+
+
+// sorts [data] in place, bottom up with runs sorted by insertion
+static void merge_sort_range(u32* data, u32* scratch, const size_t count, const comparator* cmp) {
+
+    for (size_t start = 0; start < count; start += INSERTION_RUN)
+        insertion_sort(data + start, (count - start < INSERTION_RUN) ? count - start : INSERTION_RUN, cmp);
+
+    u32* src = data;
+    u32* dst = scratch;
+    for (size_t width = INSERTION_RUN; width < count; width *= 2) {
+        for (size_t start = 0; start < count; start += 2 * width) {
+            const size_t middle = (start + width < count) ? start + width : count;
+            const size_t end = (middle + width < count) ? middle + width : count;
+            merge(src + start, middle - start, src + middle, end - middle, dst + start, cmp);
+        }
+        u32* swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    if (src != data)
+        memcpy(data, src, count * sizeof(u32));
+}
+
+
+// the array is split into one sorted run per thread, the runs are merged pairwise in rounds.
+// Every round splits the output evenly between the threads, so the last merges use all threads as well
+typedef struct {
+    u32*                data;
+    u32*                scratch;
+    const u32*          src;                    // runs of the current round
+    u32*                dst;
+    const size_t*       bounds;                 // [run_count +1] start positions of the runs
+    size_t              run_count;
+    size_t              begin;                  // range of this worker: elements to sort, or output positions to merge
+    size_t              end;
+    const comparator*   cmp;
+} merge_job;
+
+static void* sort_worker(void* arg) {
+
+    const merge_job* job = (const merge_job*)arg;
+    merge_sort_range(job->data + job->begin, job->scratch + job->begin, job->end - job->begin, job->cmp);
+    return NULL;
+}
+
+static void* merge_worker(void* arg) {
+
+    const merge_job* job = (const merge_job*)arg;
+    for (size_t run = 0; run < job->run_count; run += 2) {
+        const size_t start = job->bounds[run];
+        const size_t middle = job->bounds[run + 1];
+        const size_t end = job->bounds[(run + 2 < job->run_count) ? run + 2 : job->run_count];
+        if (end <= job->begin || start >= job->end) continue;
+
+        // merge the part of this pair that falls into [begin, end)
+        const size_t k_begin = ((job->begin > start) ? job->begin : start) - start;
+        const size_t k_end = ((job->end < end) ? job->end : end) - start;
+        const u32* left = job->src + start;
+        const u32* right = job->src + middle;
+        const size_t left_count = middle - start;
+        const size_t right_count = end - middle;
+        const size_t l_begin = merge_split(left, left_count, right, right_count, k_begin, job->cmp);
+        const size_t l_end = merge_split(left, left_count, right, right_count, k_end, job->cmp);
+        merge(left + l_begin, l_end - l_begin, right + (k_begin - l_begin), (k_end - l_end) - (k_begin - l_begin), job->dst + start + k_begin, job->cmp);
+    }
+    return NULL;
+}
+
+static void run_jobs(void* (*worker)(void*), merge_job* jobs, const u32 thread_count) {
+
+    pthread_t threads[MAX_THREADS];
+    b8 started[MAX_THREADS] = {0};
+    for (u32 x = 1; x < thread_count; x++)
+        started[x] = (pthread_create(&threads[x], NULL, worker, &jobs[x]) == 0);
+
+    worker(&jobs[0]);
+    for (u32 x = 1; x < thread_count; x++) {
+        if (started[x])
+            pthread_join(threads[x], NULL);
+        else
+            worker(&jobs[x]);                                           // could not start a thread, do the work here
+    }
+}
+
+
+i32 sort_merge(u32* permutation, const size_t count, sort_compare_t compare, void* user_data) {
+
+    if (!permutation || !compare || count > SORT_MAX_COUNT) return AT_INVALID_ARGUMENT;
+
+    const comparator cmp = { compare, user_data };
+    if (count <= INSERTION_RUN) {
+        insertion_sort(permutation, count, &cmp);
+        return AT_SUCCESS;
+    }
+
+    u32* scratch = malloc(count * sizeof(u32));
+    if (!scratch) return AT_MEMORY_ERROR;
+
+    const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t thread_count = count / MIN_PER_THREAD;
+    if (thread_count > (size_t)((cores > 0) ? cores : 1)) thread_count = (size_t)((cores > 0) ? cores : 1);
+    if (thread_count > MAX_THREADS) thread_count = MAX_THREADS;
+    if (thread_count == 0) thread_count = 1;
+
+    size_t bounds[MAX_THREADS + 1];
+    merge_job jobs[MAX_THREADS];
+    for (size_t x = 0; x <= thread_count; x++)
+        bounds[x] = count * x / thread_count;
+    for (size_t x = 0; x < thread_count; x++)
+        jobs[x] = (merge_job){ .data = permutation, .scratch = scratch, .begin = bounds[x], .end = bounds[x + 1], .cmp = &cmp };
+    run_jobs(sort_worker, jobs, (u32)thread_count);
+
+    u32* src = permutation;
+    u32* dst = scratch;
+    for (size_t run_count = thread_count; run_count > 1; run_count = (run_count + 1) / 2) {
+        for (size_t x = 0; x < thread_count; x++)
+            jobs[x] = (merge_job){ .src = src, .dst = dst, .bounds = bounds, .run_count = run_count,
+                .begin = count * x / thread_count, .end = count * (x + 1) / thread_count, .cmp = &cmp };
+        run_jobs(merge_worker, jobs, (u32)thread_count);
+
+        for (size_t x = 0; x <= (run_count + 1) / 2; x++)               // merged pairs start at every second boundary
+            bounds[x] = bounds[(x * 2 < run_count) ? x * 2 : run_count];
+        u32* swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    if (src != permutation)
+        memcpy(permutation, src, count * sizeof(u32));
+    free(scratch);
+    return AT_SUCCESS;
+}
+
+
+// ============================================================================================================================================
+// multiple keys
+// ============================================================================================================================================
+
+static i32 compare_reversed(const u32 a, const u32 b, void* user_data) {
+
+    const comparator* cmp = (const comparator*)user_data;
+    return compare_indices(cmp, b, a);
+}
+
+
+i32 sort_multi(u32* permutation, const size_t count, const sort_key* keys, const size_t key_count) {
+
+    if (!permutation || (!keys && key_count > 0) || count > SORT_MAX_COUNT) return AT_INVALID_ARGUMENT;
+
+    // stable sorts from the least to the most significant key, each sort keeps the order of the previous ones for equal keys
+    for (size_t x = key_count; x > 0; x--) {
+        const sort_key* key = &keys[x - 1];
+        if (!key->keys && !key->compare) return AT_INVALID_ARGUMENT;
+
+        if (key->keys) {
+            const i32 result = sort_radix(permutation, count, key->keys, key->descending);
+            if (result != AT_SUCCESS) return result;
+        }
+        if (!key->compare) continue;
+
+        comparator reversed = { key->compare, key->user_data };
+        const sort_compare_t compare = key->descending ? compare_reversed : key->compare;
+        void* user_data = key->descending ? (void*)&reversed : key->user_data;
+        if (!key->keys) {
+            const i32 result = sort_merge(permutation, count, compare, user_data);
+            if (result != AT_SUCCESS) return result;
+            continue;
+        }
+
+        for (size_t start = 0; start < count; ) {                      // only runs of equal keys need the comparator
+            size_t end = start + 1;
+            while (end < count && key->keys[permutation[end]] == key->keys[permutation[start]])
+                end++;
+            if (end - start > 1) {
+                const i32 result = sort_merge(permutation + start, end - start, compare, user_data);
+                if (result != AT_SUCCESS) return result;
+            }
+            start = end;
+        }
+    }
+    return AT_SUCCESS;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "util/data_structure/data_types.h"
+
+
+// Sorting of large collections without moving their elements.
+// All functions sort a permutation: an array of u32 element indices that is reordered so that element [permutation[0]]
+// comes first. Keys are indexed by element, not by position, so a permutation can be sorted by several keys in a row.
+// Every sort is stable, elements that compare equal keep their order in the permutation.
+//  - sort_radix():  LSD radix sort by u64 keys in 11 bit digits, digits shared by all keys (e.g. the high bits of small numbers) are skipped
+//  - sort_merge():  merge sort with a comparator, sorts and merges on several threads for large arrays
+//  - sort_multi():  sorts by a list of keys, the first key decides and the following ones break ties
+// darray_permute() moves the elements into the sorted order if a collection has to be stored sorted.
+
+
+#define SORT_MAX_COUNT          0xFFFFFFFFULL           // elements are addressed by u32 indices
+
+
+// @return negative if element [a] sorts before [b], 0 if they are equal, positive otherwise.
+//         Called from several threads at once by sort_merge(), must not modify the collection
+typedef i32 (*sort_compare_t)(const u32 a, const u32 b, void* user_data);
+
+
+typedef struct {
+    const u64*          keys;                   // key of every element, NULL to only use [compare]
+    sort_compare_t      compare;                // orders elements with equal [keys], NULL if the keys decide alone
+    void*               user_data;              // passed to [compare]
+    b8                  descending;
+} sort_key;
+
+
+// ============================================================================================================================================
+// permutation
+// ============================================================================================================================================
+
+// @brief Fills [permutation] with 0 to [count] -1
+void sort_identity(u32* permutation, const size_t count);
+
+
+// ============================================================================================================================================
+// sort
+// ============================================================================================================================================
+
+// @brief Sorts [permutation] by [keys] of the elements. Needs 20 bytes of temporary memory per element
+// @return AT_SUCCESS on success, error code on failure ([permutation] is unchanged in that case)
+i32 sort_radix(u32* permutation, const size_t count, const u64* keys, const b8 descending);
+
+
+// @brief Sorts [permutation] with [compare]. Needs 4 bytes of temporary memory per element
+// @return AT_SUCCESS on success, error code on failure ([permutation] is unchanged in that case)
+i32 sort_merge(u32* permutation, const size_t count, sort_compare_t compare, void* user_data);
+
+
+// @brief Sorts [permutation] by [keys]: [keys[0]] decides, the following keys order elements that are equal in all previous ones.
+//        A key with both [keys] and [compare] is sorted by radix and only runs of equal keys are sorted with the comparator,
+//        which makes prefixes (e.g. the first 8 bytes of a string) a cheap way to sort by a comparator
+// @return AT_SUCCESS on success, error code on failure ([permutation] is sorted by some of the keys in that case)
+i32 sort_multi(u32* permutation, const size_t count, const sort_key* keys, const size_t key_count);
@@ -0,0 +1,155 @@
+
+#include "util/io/number_conversion.h"
+
+#include "str_view.h"
+
+
+static inline b8 is_whitespace(const char c)                { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+
+// ============================================================================================================================================
+// comparison
+// ============================================================================================================================================
+
+b8 sv_equal(const str_view a, const str_view b) {
+
+    return a.len == b.len && (a.len == 0 || memcmp(a.data, b.data, a.len) == 0);
+}
+
+
+b8 sv_equal_cstr(const str_view view, const char* str) {
+
+    if (!str) return view.len == 0;
+    return strnlen(str, view.len + 1) == view.len && (view.len == 0 || memcmp(view.data, str, view.len) == 0);
+}
+
+
+i32 sv_compare(const str_view a, const str_view b) {
+
+    const size_t len = (a.len < b.len) ? a.len : b.len;
+    const int result = len ? memcmp(a.data, b.data, len) : 0;
+    if (result != 0) return (result < 0) ? -1 : 1;
+    return (a.len == b.len) ? 0 : (a.len < b.len) ? -1 : 1;
+}
+
+
+b8 sv_starts_with(const str_view view, const str_view prefix) {
+
+    return view.len >= prefix.len && (prefix.len == 0 || memcmp(view.data, prefix.data, prefix.len) == 0);
+}
+
+
+b8 sv_ends_with(const str_view view, const str_view suffix) {
+
+    return view.len >= suffix.len && (suffix.len == 0 || memcmp(view.data + view.len - suffix.len, suffix.data, suffix.len) == 0);
+}
+
+
+// ============================================================================================================================================
+// search
+// ============================================================================================================================================
+
+size_t sv_find_char(const str_view view, const char c, const size_t from) {
+
+    if (from >= view.len) return SV_NPOS;
+
+    const char* found = memchr(view.data + from, c, view.len - from);
+    return found ? (size_t)(found - view.data) : SV_NPOS;
+}
+
+
+size_t sv_rfind_char(const str_view view, const char c) {
+
+    for (size_t x = view.len; x > 0; x--)
+        if (view.data[x -1] == c)
+            return x -1;
+    return SV_NPOS;
+}
+
+
+size_t sv_find(const str_view view, const str_view needle, const size_t from) {
+
+    if (from > view.len || needle.len > view.len - from) return SV_NPOS;
+    if (needle.len == 0) return from;
+
+    // memchr() skips to candidates for the first character, only those are compared
+    const char* pos = view.data + from;
+    const char* last = view.data + view.len - needle.len;
+    while (pos <= last) {
+        pos = memchr(pos, needle.data[0], (size_t)(last - pos) +1);
+        if (!pos) break;
+        if (memcmp(pos +1, needle.data +1, needle.len -1) == 0)
+            return (size_t)(pos - view.data);
+        pos++;
+    }
+    return SV_NPOS;
+}
+
+
+// ============================================================================================================================================
+// trimming and splitting
+// ============================================================================================================================================
+
+str_view sv_trim_left(const str_view view) {
+
+    size_t start = 0;
+    while (start < view.len && is_whitespace(view.data[start]))
+        start++;
+    return (str_view){ view.data + start, view.len - start };
+}
+
+
+str_view sv_trim_right(const str_view view) {
+
+    size_t len = view.len;
+    while (len > 0 && is_whitespace(view.data[len -1]))
+        len--;
+    return (str_view){ view.data, len };
+}
+
+
+str_view sv_trim(const str_view view)                       { return sv_trim_right(sv_trim_left(view)); }
+
+
+b8 sv_split_next(str_view* rest, const char delimiter, str_view* token) {
+
+    if (rest->len == 0) return false;
+
+    const size_t index = sv_find_char(*rest, delimiter, 0);
+    if (index == SV_NPOS) {
+        *token = *rest;
+        *rest = (str_view){ rest->data + rest->len, 0 };
+        return true;
+    }
+
+    *token = (str_view){ rest->data, index };
+    *rest = (str_view){ rest->data + index +1, rest->len - index -1 };
+    return true;
+}
+
+
+// ============================================================================================================================================
+// numbers
+// ============================================================================================================================================
+
+// parses into [value] with [parse_fn] and checks that only whitespace surrounds the number
+#define PARSE_WHOLE_VIEW(view, out, parse_fn)                                                                       \
+    do {                                                                                                            \
+        const str_view loc_view = sv_trim(view);                                                                    \
+        __typeof__(*(out)) loc_value;                                                                               \
+        const size_t consumed = parse_fn(loc_view.data, loc_view.len, &loc_value);                                  \
+        if (consumed == 0 || consumed != loc_view.len) return false;                                                \
+        *(out) = loc_value;                                                                                         \
+        return true;                                                                                                \
+    } while (0)
+
+
+b8 sv_parse_i64(const str_view view, i64* out)              { PARSE_WHOLE_VIEW(view, out, num_parse_i64); }
+
+b8 sv_parse_u64(const str_view view, u64* out)              { PARSE_WHOLE_VIEW(view, out, num_parse_u64); }
+
+b8 sv_parse_f32(const str_view view, f32* out)              { PARSE_WHOLE_VIEW(view, out, num_parse_f32); }
+
+b8 sv_parse_f64(const str_view view, f64* out)              { PARSE_WHOLE_VIEW(view, out, num_parse_f64); }
+
+b8 sv_parse_f128(const str_view view, f128* out)            { PARSE_WHOLE_VIEW(view, out, num_parse_f128); }
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "util/data_structure/data_types.h"
+#include "util/data_structure/dynamic_string.h"
+
+
+// Non-owning view of [len] characters at [data], for parsing text where it is (file content, log formats, ...) without copying.
+// A view is not null terminated and only valid as long as the memory it points into, print it with SV_FMT / SV_ARG:
+//      LOG(Info, "key [" SV_FMT "]", SV_ARG(key))
+// Whitespace in the trim functions means ' ', '\t', '\r' and '\n'.
+
+
+typedef struct {
+    const char*     data;
+    size_t          len;
+} str_view;
+
+
+#define SV_NPOS                 SIZE_MAX                            // returned by the find functions if nothing was found
+
+#define SV_LITERAL(literal)     ((str_view){ (literal), sizeof(literal) -1 })
+
+#define SV_FMT                  "%.*s"
+#define SV_ARG(view)            (int)(view).len, (view).data
+
+
+// ============================================================================================================================================
+// construction
+// ============================================================================================================================================
+
+static inline str_view sv_make(const char* data, const size_t len)          { return (str_view){ data, len }; }
+
+// @brief View of a null terminated string, NULL gives an empty view
+static inline str_view sv_from_cstr(const char* str)                        { return (str_view){ str ? str : "", str ? strlen(str) : 0 }; }
+
+// @brief View of the current content of [s], invalidated when [s] changes
+static inline str_view sv_from_ds(const dyn_str* s)                         { return (str_view){ s->data, s->len }; }
+
+static inline b8 sv_is_empty(const str_view view)                           { return view.len == 0; }
+
+// @brief Up to [len] characters from [pos] on, both are clamped to the view
+static inline str_view sv_substr(const str_view view, size_t pos, size_t len) {
+
+    if (pos > view.len) pos = view.len;
+    if (len > view.len - pos) len = view.len - pos;
+    return (str_view){ view.data + pos, len };
+}
+
+// @brief The view without its first [count] characters (clamped)
+static inline str_view sv_skip(const str_view view, const size_t count)     { return sv_substr(view, count, SV_NPOS); }
+
+
+// ============================================================================================================================================
+// comparison
+// ============================================================================================================================================
+
+// @return true if both views contain the same characters
+b8 sv_equal(const str_view a, const str_view b);
+
+// @return true if [view] contains exactly the null terminated [str]
+b8 sv_equal_cstr(const str_view view, const char* str);
+
+// @brief Lexicographic comparison like strcmp(), a view that is a prefix of the other is smaller
+// @return < 0, 0 or > 0
+i32 sv_compare(const str_view a, const str_view b);
+
+b8 sv_starts_with(const str_view view, const str_view prefix);
+
+b8 sv_ends_with(const str_view view, const str_view suffix);
+
+
+// ============================================================================================================================================
+// search
+// ============================================================================================================================================
+
+// @return index of the first [c] at or after [from], SV_NPOS if there is none
+size_t sv_find_char(const str_view view, const char c, const size_t from);
+
+// @return index of the last [c], SV_NPOS if there is none
+size_t sv_rfind_char(const str_view view, const char c);
+
+// @return index of the first occurrence of [needle] at or after [from], SV_NPOS if there is none (an empty needle is found at [from])
+size_t sv_find(const str_view view, const str_view needle, const size_t from);
+
+
+// ============================================================================================================================================
+// trimming and splitting
+// ============================================================================================================================================
+
+str_view sv_trim_left(const str_view view);
+
+str_view sv_trim_right(const str_view view);
+
+str_view sv_trim(const str_view view);
+
+
+// @brief Takes the next token up to [delimiter] from the front of [rest] and removes it (and the delimiter) from [rest], e.g.
+//            str_view rest = sv_from_ds(&content), line;
+//            while (sv_split_next(&rest, '\n', &line)) { ... }
+//        "a,,b" gives "a", "" and "b". A trailing delimiter does not produce an empty last token
+// @return false once [rest] is empty
+b8 sv_split_next(str_view* rest, const char delimiter, str_view* token);
+
+
+// ============================================================================================================================================
+// numbers
+// ============================================================================================================================================
+
+// The whole view has to be the number, surrounding whitespace is ignored (see util/io/number_conversion.h for the accepted forms)
+// @return true if a valid number was parsed, [out] is unchanged otherwise
+
+b8 sv_parse_i64(const str_view view, i64* out);
+
+b8 sv_parse_u64(const str_view view, u64* out);
+
+b8 sv_parse_f32(const str_view view, f32* out);
+
+b8 sv_parse_f64(const str_view view, f64* out);
+
+b8 sv_parse_f128(const str_view view, f128* out);
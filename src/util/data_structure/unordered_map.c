@@ -1,17 +1,24 @@
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#endif
+
 #include "data_types.h"
+#include "hash.h"
 #include "unordered_map.h"
 
-#define LOAD_FACTOR_THRESHOLD   0.75
 #define MAGIC                   0xDEADBEEF
+#define CTRL_EMPTY              ((i8)-128)      // full slots hold the low 7 bits of the hash, the sign bit marks empty slots
+#define NOT_FOUND               SIZE_MAX
 
 #define VALIDATE(map)                                               \
     do {                                                            \
         if (!(map)) return AT_INVALID_ARGUMENT;                     \
-        if ((map)->magic != MAGIC || !(map)->buckets || (map)->cap == 0) \
+        if ((map)->magic != MAGIC || !(map)->ctrl || (map)->cap == 0) \
             return AT_NOT_INITIALIZED;                              \
         if (!(map)->hash_fn || !(map)->key_cmp_fn)                  \
             return AT_NOT_INITIALIZED;                              \
@@ -22,33 +29,20 @@
 // Predefined hash functions
 // ------------------------------------------------------------------------------------------
 
-size_t string_hash(const void* key) {
-    const char* str = (const char*)key;
-    size_t hash = 5381;
-    int c;
-    while ((c = *str++)) {
-        hash = ((hash << 5) + hash) + c; // hash * 33 + c
-    }
-    return hash;
-}
+// every bit of a key changes about half of the hash bits, so the slot can be selected by masking (see home_slot())
+size_t string_hash(const void* key)                         { return (size_t)hash_string((const char*)key, HASH_DEFAULT_SEED); }
 
-size_t func_ptr_hash(const void* key)                       { return ((size_t)key) >> 3; }
+size_t func_ptr_hash(const void* key)                       { return (size_t)hash_u64((u64)(uintptr_t)key, HASH_DEFAULT_SEED); }
 
-size_t ptr_hash(const void* key)                            { return (size_t)key; }
+size_t ptr_hash(const void* key)                            { return (size_t)hash_u64((u64)(uintptr_t)key, HASH_DEFAULT_SEED); }
 
-size_t u32_hash(const void* key)                            { return (size_t)*(const u32*)key; }
+size_t u32_hash(const void* key)                            { return (size_t)hash_u64(*(const u32*)key, HASH_DEFAULT_SEED); }
 
-size_t u64_hash(const void* key) {
-    u64 value = *(const u64*)key;
-    return (size_t)(value ^ (value >> 32));
-}
+size_t u64_hash(const void* key)                            { return (size_t)hash_u64(*(const u64*)key, HASH_DEFAULT_SEED); }
 
-size_t i32_hash(const void* key)                            { return (size_t)*(const i32*)key; }
+size_t i32_hash(const void* key)                            { return (size_t)hash_u64((u32)*(const i32*)key, HASH_DEFAULT_SEED); }
 
-size_t i64_hash(const void* key) {
-    i64 value = *(const i64*)key;
-    return (size_t)(value ^ (value >> 32));
-}
+size_t i64_hash(const void* key)                            { return (size_t)hash_u64((u64)*(const i64*)key, HASH_DEFAULT_SEED); }
 
 
 // ------------------------------------------------------------------------------------------
@@ -86,116 +80,176 @@ int i64_compare(const void* key1, const void* key2) {
 }
 
 
+// ------------------------------------------------------------------------------------------
+// Control bytes
+// ------------------------------------------------------------------------------------------
+
+// [hash_fn] has to spread the key over all bits (see hash.h): the low 7 bits are stored in the control byte, the bits above select the home slot
+static inline size_t home_slot(const unordered_map* map, const u64 hash)   { return (size_t)(hash >> 7) & (map->cap - 1); }
+
+static inline i8 hash_bits(const u64 hash)                                  { return (i8)(hash & 0x7F); }
+
+// the control bytes of the first group are repeated after the last slot, so a group can be loaded from every slot without wrapping
+static inline void set_ctrl(unordered_map* map, const size_t index, const i8 value) {
+    map->ctrl[index] = value;
+    if (index < U_MAP_GROUP_WIDTH)
+        map->ctrl[map->cap + index] = value;
+}
+
+// bit per slot of the group starting at [ctrl] whose control byte equals [value]
+static inline u32 group_match(const i8* ctrl, const i8 value) {
+#ifdef __SSE2__
+    const __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+    return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(value)));
+#else
+    u32 mask = 0;
+    for (u32 x = 0; x < U_MAP_GROUP_WIDTH; x++)
+        mask |= (u32)(ctrl[x] == value) << x;
+    return mask;
+#endif
+}
+
+static inline u32 group_match_empty(const i8* ctrl) {
+#ifdef __SSE2__
+    return (u32)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)ctrl));      // only empty slots have the sign bit set
+#else
+    return group_match(ctrl, CTRL_EMPTY);
+#endif
+}
+
+static size_t find_index(const unordered_map* map, const void* key, const u64 hash) {
+
+    const size_t mask = map->cap - 1;
+    size_t pos = home_slot(map, hash);
+    for (size_t probed = 0; probed < map->cap; probed += U_MAP_GROUP_WIDTH) {
+        const i8* group = map->ctrl + pos;
+        for (u32 match = group_match(group, hash_bits(hash)); match; match &= match - 1) {
+            const size_t index = (pos + (size_t)__builtin_ctz(match)) & mask;
+            if (map->key_cmp_fn(map->slots[index].key, key) == 0)
+                return index;
+        }
+        if (group_match_empty(group))                                   // entries are never stored behind an empty slot of their probe sequence
+            return NOT_FOUND;
+        pos = (pos + U_MAP_GROUP_WIDTH) & mask;
+    }
+    return NOT_FOUND;
+}
+
+// the map is never full, there is always an empty slot
+static size_t find_empty(const unordered_map* map, const u64 hash) {
+
+    const size_t mask = map->cap - 1;
+    size_t pos = home_slot(map, hash);
+    for (;;) {
+        const u32 empty = group_match_empty(map->ctrl + pos);
+        if (empty)
+            return (pos + (size_t)__builtin_ctz(empty)) & mask;
+        pos = (pos + U_MAP_GROUP_WIDTH) & mask;
+    }
+}
+
+static inline size_t max_load(const size_t cap)                             { return cap - cap / 8; }
+
+
 // ------------------------------------------------------------------------------------------
 // Map implementation
 // ------------------------------------------------------------------------------------------
 
-// Map creation
-i32 u_map_init(unordered_map* map, size_t capacity, hash_func hash_fn, key_compare_func key_cmp_fn) {
-    if (capacity == 0 || !hash_fn || !key_cmp_fn) return AT_INVALID_ARGUMENT;
-    
-    map = malloc(sizeof(unordered_map));
-    if (!map) return AT_MEMORY_ERROR;
-    
-    map->buckets = calloc(capacity, sizeof(node*));
-    if (!map->buckets) {
-        free(map);
+static i32 allocate_slots(unordered_map* map, const size_t capacity) {
+
+    map->ctrl = malloc(capacity + U_MAP_GROUP_WIDTH);
+    map->slots = malloc(capacity * sizeof(u_map_slot));
+    if (!map->ctrl || !map->slots) {
+        free(map->ctrl);
+        free(map->slots);
+        map->ctrl = NULL;
+        map->slots = NULL;
         return AT_MEMORY_ERROR;
     }
-    
-    map->size = 0;
+
+    memset(map->ctrl, CTRL_EMPTY, capacity + U_MAP_GROUP_WIDTH);
     map->cap = capacity;
+    return AT_SUCCESS;
+}
+
+
+// Map creation
+i32 u_map_init(unordered_map* map, size_t capacity, hash_func hash_fn, key_compare_func key_cmp_fn) {
+    if (!map || capacity == 0 || !hash_fn || !key_cmp_fn) return AT_INVALID_ARGUMENT;
+    if (map->magic == MAGIC) return AT_ALREADY_INITIALIZED;
+
+    size_t loc_capacity = U_MAP_GROUP_WIDTH;
+    while (loc_capacity < capacity)
+        loc_capacity *= 2;
+
+    const i32 result = allocate_slots(map, loc_capacity);
+    if (result != AT_SUCCESS) return result;
+
+    map->size = 0;
     map->magic = MAGIC;
     map->hash_fn = hash_fn;
     map->key_cmp_fn = key_cmp_fn;
-    
+
     return AT_SUCCESS;
 }
 
 
+// the map struct belongs to the caller, only the slots are freed
 i32 u_map_free(unordered_map* map) {
     VALIDATE(map);
-    
-    for (size_t i = 0; i < map->cap; i++) {
-        node* current = map->buckets[i];
-        while (current != NULL) {
-            node* temp = current;
-            current = current->next;
-            free(temp);
-        }
-    }
-    
-    free(map->buckets);
-    free(map);
+
+    free(map->ctrl);
+    free(map->slots);
+    memset(map, 0, sizeof(*map));
     return AT_SUCCESS;
 }
 
 
-
-
-// Resize function
+// Resize function, doubles the capacity
 i32 u_map_resize(unordered_map* map) {
     VALIDATE(map);
-    
-    size_t new_capacity = map->cap * 2;
-    node** new_buckets = calloc(new_capacity, sizeof(node*));
-    if (!new_buckets) return AT_MEMORY_ERROR;
-    
-    // Rehash all elements
+
+    unordered_map resized = *map;
+    const i32 result = allocate_slots(&resized, map->cap * 2);
+    if (result != AT_SUCCESS) return result;
+
+    // Move all elements, the keys are known to be unique
     for (size_t i = 0; i < map->cap; i++) {
-        node* current = map->buckets[i];
-        while (current != NULL) {
-            node* next = current->next;
-            
-            // Rehash the key
-            size_t new_index = map->hash_fn(current->key) % new_capacity;
-            
-            // Insert at head of new bucket
-            current->next = new_buckets[new_index];
-            new_buckets[new_index] = current;
-            
-            current = next;
-        }
+        if (map->ctrl[i] == CTRL_EMPTY) continue;
+
+        const u64 hash = map->slots[i].hash;
+        const size_t index = find_empty(&resized, hash);
+        set_ctrl(&resized, index, hash_bits(hash));
+        resized.slots[index] = map->slots[i];
     }
-    
-    free(map->buckets);
-    map->buckets = new_buckets;
-    map->cap = new_capacity;
+
+    free(map->ctrl);
+    free(map->slots);
+    *map = resized;
     return AT_SUCCESS;
 }
 
 // Insert function
 i32 u_map_insert(unordered_map* map, void* key, void* value) {
     VALIDATE(map);
-    
-    // Check if we need to resize
-    if ((double)map->size / map->cap > LOAD_FACTOR_THRESHOLD) {
-        i32 res = u_map_resize(map);
-        if (res != AT_SUCCESS) return res;
+
+    const u64 hash = (u64)map->hash_fn(key);
+    size_t index = find_index(map, key, hash);
+    if (index != NOT_FOUND) {
+        map->slots[index].value = value;        // Update existing value
+        return AT_SUCCESS;
     }
-    
-    size_t index = map->hash_fn(key) % map->cap;
-    node* current = map->buckets[index];
-    
-    // Check if key already exists
-    while (current != NULL) {
-        if (map->key_cmp_fn(current->key, key) == 0) {
-            current->value = value; // Update existing value
-            return AT_SUCCESS;
-        }
-        current = current->next;
+
+    if (map->size + 1 > max_load(map->cap)) {
+        const i32 res = u_map_resize(map);
+        if (res != AT_SUCCESS) return res;
     }
-    
-    // Create new node
-    node* newnode = malloc(sizeof(node));
-    if (!newnode) return AT_MEMORY_ERROR;
-    
-    newnode->key = key;
-    newnode->value = value;
-    newnode->next = map->buckets[index]; // Insert at head
-    map->buckets[index] = newnode;
+
+    index = find_empty(map, hash);
+    set_ctrl(map, index, hash_bits(hash));
+    map->slots[index] = (u_map_slot){ key, value, hash };
     map->size++;
-    
+
     return AT_SUCCESS;
 }
 
@@ -203,44 +257,50 @@ i32 u_map_insert(unordered_map* map, void* key, void* value) {
 i32 u_map_find(unordered_map* map, const void* key, void** value) {
     VALIDATE(map);
     if (!value) return AT_INVALID_ARGUMENT;
-    
-    size_t index = map->hash_fn(key) % map->cap;
-    node* current = map->buckets[index];
-    
-    while (current != NULL) {
-        if (map->key_cmp_fn(current->key, key) == 0) {
-            *value = current->value;
-            return AT_SUCCESS;
-        }
-        current = current->next;
-    }
-    
-    return AT_ERROR; // Key not found
+
+    const size_t index = find_index(map, key, (u64)map->hash_fn(key));
+    if (index == NOT_FOUND) return AT_ERROR;    // Key not found
+
+    *value = map->slots[index].value;
+    return AT_SUCCESS;
 }
 
 // Erase function
 i32 u_map_erase(unordered_map* map, const void* key) {
     VALIDATE(map);
-    
-    size_t index = map->hash_fn(key) % map->cap;
-    node* current = map->buckets[index];
-    node* prev = NULL;
-    
-    while (current != NULL) {
-        if (map->key_cmp_fn(current->key, key) == 0) {
-            if (prev == NULL) {
-                map->buckets[index] = current->next;
-            } else {
-                prev->next = current->next;
-            }
-            
-            free(current);
-            map->size--;
-            return AT_SUCCESS;
+
+    size_t hole = find_index(map, key, (u64)map->hash_fn(key));
+    if (hole == NOT_FOUND) return AT_ERROR;     // Key not found
+
+    // backward shift: an entry after the hole moves into it if the hole is between its home slot and its current slot,
+    // the probe sequence of every entry stays free of empty slots
+    const size_t mask = map->cap - 1;
+    for (size_t next = (hole + 1) & mask; map->ctrl[next] != CTRL_EMPTY; next = (next + 1) & mask) {
+        const size_t home = home_slot(map, map->slots[next].hash);
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            map->slots[hole] = map->slots[next];
+            set_ctrl(map, hole, map->ctrl[next]);
+            hole = next;
         }
-        prev = current;
-        current = current->next;
     }
-    
-    return AT_ERROR; // Key not found
+
+    set_ctrl(map, hole, CTRL_EMPTY);
+    map->size--;
+    return AT_SUCCESS;
+}
+
+
+b8 u_map_next(const unordered_map* map, size_t* cursor, void** key, void** value) {
+
+    if (!map || map->magic != MAGIC || !cursor) return false;
+
+    for (; *cursor < map->cap; (*cursor)++) {
+        if (map->ctrl[*cursor] == CTRL_EMPTY) continue;
+
+        if (key)    *key = map->slots[*cursor].key;
+        if (value)  *value = map->slots[*cursor].value;
+        (*cursor)++;
+        return true;
+    }
+    return false;
 }
@@ -3,27 +3,39 @@
 #include <stddef.h>
 #include "data_types.h"
 
+// Hash map from [void*] keys to [void*] values, keys and values are stored by pointer and owned by the caller.
+// Open addressing in the style of Swiss tables: every slot has a control byte that is empty or holds 7 bits of the hash,
+// lookups compare the control bytes of 16 slots at once (SSE2) and only call [key_cmp_fn] for slots whose hash bits match.
+// Slots are probed linearly from the home slot of the hash, so erasing shifts the following entries back instead of
+// leaving tombstones, lookups never get slower after many erases.
+// The home slot is selected by masking the hash, so [hash_fn] has to mix every bit of the key into the low bits, an identity
+// function clusters aligned pointers into a few slots. Build custom hash functions with hash_bytes() / hash_u64() from hash.h.
+
 // Function pointer types for hash and comparison
 typedef size_t (*hash_func)(const void* key);
 typedef int (*key_compare_func)(const void* key1, const void* key2);
 
-typedef struct node {
+typedef struct {
     void*               key;
     void*               value;
-    struct node*        next;
-} node;
+    u64                 hash;                   // [hash_fn] of [key], resizing and erasing do not call [hash_fn]
+} u_map_slot;
 
 typedef struct {
-    node**              buckets;
+    i8*                 ctrl;                   // [cap + U_MAP_GROUP_WIDTH] control bytes, the last group mirrors the first
+    u_map_slot*         slots;
     size_t              size;
-    size_t              cap;
+    size_t              cap;                    // power of two
     u32                 magic;
     hash_func           hash_fn;
     key_compare_func    key_cmp_fn;
 } unordered_map;
 
 
-// Creation with custom hash and compare functions
+#define U_MAP_GROUP_WIDTH       16              // slots whose control bytes are compared at once
+
+
+// Creation with custom hash and compare functions, [capacity] is rounded up to a power of two (at least U_MAP_GROUP_WIDTH)
 i32 u_map_init(unordered_map* map, size_t capacity, hash_func hash_fn, key_compare_func key_cmp_fn);
 i32 u_map_free(unordered_map* map);
 
@@ -33,6 +45,10 @@ i32 u_map_insert(unordered_map* map, void* key, void* value);
 i32 u_map_find(unordered_map* map, const void* key, void** value);
 i32 u_map_erase(unordered_map* map, const void* key);
 
+// @brief Iterates the entries in no particular order, start with [*cursor] = 0. Erasing during the iteration can skip entries
+// @return false after the last entry
+b8 u_map_next(const unordered_map* map, size_t* cursor, void** key, void** value);
+
 
 // Predefined hash functions for common types
 size_t string_hash(const void* key);
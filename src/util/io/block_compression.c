@@ -0,0 +1,378 @@
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "util/io/block_compression.h"
+
+
+#define FRAME_MAGIC             0x43424D52u     // "RMBC"
+#define FRAME_VERSION           1
+
+#define HASH_LOG                14
+#define MIN_MATCH               4
+#define LAST_LITERALS           5               // the last bytes of a block are always literals
+#define MF_LIMIT                12              // the last match has to start this far before the end of a block
+#define MAX_OFFSET              65535
+#define SKIP_TRIGGER            6               // search step grows by one every 2^SKIP_TRIGGER misses, speeds up incompressible data
+
+#define READ_MIN_BLOCKS_PER_THREAD  4
+#define READ_MAX_THREADS            16
+
+
+static inline u32 read_u32(const u8* pos)  { u32 value; memcpy(&value, pos, sizeof(value)); return value; }
+static inline u64 read_u64(const u8* pos)  { u64 value; memcpy(&value, pos, sizeof(value)); return value; }
+
+static inline u32 load_le32(const u8* pos) { return (u32)pos[0] | ((u32)pos[1] << 8) | ((u32)pos[2] << 16) | ((u32)pos[3] << 24); }
+static inline u64 load_le64(const u8* pos) { return (u64)load_le32(pos) | ((u64)load_le32(pos + 4) << 32); }
+
+static inline void store_le16(u8* pos, const u16 value) { pos[0] = (u8)value; pos[1] = (u8)(value >> 8); }
+static inline void store_le32(u8* pos, const u32 value) { store_le16(pos, (u16)value); store_le16(pos + 2, (u16)(value >> 16)); }
+static inline void store_le64(u8* pos, const u64 value) { store_le32(pos, (u32)value); store_le32(pos + 4, (u32)(value >> 32)); }
+
+static inline u32 hash_sequence(const u32 sequence) { return (sequence * 2654435761u) >> (32 - HASH_LOG); }
+
+
+// ============================================================================================================================================
+// codec
+// ============================================================================================================================================
+
+// length of the common prefix of [pos] and [match], [pos] stops at [limit]
+static inline size_t match_length(const u8* pos, const u8* match, const u8* limit) {
+
+    const u8* start = pos;
+    while (pos + sizeof(u64) <= limit) {
+        const u64 diff = read_u64(pos) ^ read_u64(match);
+        if (diff)
+            return (size_t)(pos - start) + (size_t)(__builtin_ctzll(diff) >> 3);
+        pos += sizeof(u64);
+        match += sizeof(u64);
+    }
+    while (pos < limit && *pos == *match) {
+        pos++;
+        match++;
+    }
+    return (size_t)(pos - start);
+}
+
+// writes the remainder of a length that did not fit into the 4 bits of the token
+static inline u8* write_length(u8* op, size_t len) {
+
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (u8)len;
+    return op;
+}
+
+
+size_t bc_compress(const void* src, const size_t len, void* dst, const size_t capacity) {
+
+    if (len > 0x7E000000) return 0;
+
+    const u8* const begin = (const u8*)src;
+    const u8* const end = begin + len;
+    const u8* ip = begin;
+    const u8* anchor = begin;
+    u8* op = (u8*)dst;
+    u8* const op_end = op + capacity;
+
+    if (len > MF_LIMIT) {
+
+        const u8* const match_limit = end - LAST_LITERALS;
+        const u8* const last_match_start = end - MF_LIMIT;
+        u32 table[1 << HASH_LOG];
+        memset(table, 0, sizeof(table));
+
+        ip++;
+        while (true) {
+
+            // find the next match, the step grows while nothing is found
+            const u8* match;
+            u32 attempts = 1 << SKIP_TRIGGER;
+            while (true) {
+                const u8* next = ip + (attempts++ >> SKIP_TRIGGER);
+                if (next > last_match_start)
+                    goto last_literals;
+
+                const u32 hash = hash_sequence(read_u32(ip));
+                match = begin + table[hash];
+                table[hash] = (u32)(ip - begin);
+                if (match < ip && (size_t)(ip - match) <= MAX_OFFSET && read_u32(match) == read_u32(ip))
+                    break;
+                ip = next;
+            }
+
+            while (ip > anchor && match > begin && ip[-1] == match[-1]) {          // extend backwards into the pending literals
+                ip--;
+                match--;
+            }
+
+            const size_t literal_len = (size_t)(ip - anchor);
+            const size_t extra_len = match_length(ip + MIN_MATCH, match + MIN_MATCH, match_limit);
+            if ((size_t)(op_end - op) < 1 + literal_len + literal_len / 255 + 1 + 2 + extra_len / 255 + 1 + LAST_LITERALS)
+                return 0;
+
+            u8* token = op++;
+            *token = (u8)(((literal_len >= 15) ? 15 : literal_len) << 4);
+            if (literal_len >= 15)
+                op = write_length(op, literal_len - 15);
+            memcpy(op, anchor, literal_len);
+            op += literal_len;
+
+            store_le16(op, (u16)(ip - match));
+            op += 2;
+            *token |= (u8)((extra_len >= 15) ? 15 : extra_len);
+            if (extra_len >= 15)
+                op = write_length(op, extra_len - 15);
+
+            ip += MIN_MATCH + extra_len;
+            anchor = ip;
+            if (ip > last_match_start)
+                break;
+
+            table[hash_sequence(read_u32(ip - 2))] = (u32)(ip - 2 - begin);       // cheap insert to find overlapping repeats
+        }
+    }
+
+last_literals:
+    {
+        const size_t literal_len = (size_t)(end - anchor);
+        if ((size_t)(op_end - op) < 1 + literal_len + literal_len / 255 + 1)
+            return 0;
+
+        *op++ = (u8)(((literal_len >= 15) ? 15 : literal_len) << 4);
+        if (literal_len >= 15)
+            op = write_length(op, literal_len - 15);
+        memcpy(op, anchor, literal_len);
+        op += literal_len;
+    }
+    return (size_t)(op - (u8*)dst);
+}
+
+
+i32 bc_decompress(const void* src, const size_t len, void* dst, const size_t raw_len) {
+
+    const u8* ip = (const u8*)src;
+    const u8* const ip_end = ip + len;
+    u8* op = (u8*)dst;
+    u8* const op_begin = op;
+    u8* const op_end = op + raw_len;
+
+    while (ip < ip_end) {
+
+        const u8 token = *ip++;
+        size_t literal_len = token >> 4;
+        if (literal_len == 15) {
+            u8 byte;
+            do {
+                if (ip >= ip_end) return AT_FORMAT_ERROR;
+                byte = *ip++;
+                literal_len += byte;
+            } while (byte == 255);
+        }
+        if (literal_len > (size_t)(ip_end - ip) || literal_len > (size_t)(op_end - op)) return AT_FORMAT_ERROR;
+        memcpy(op, ip, literal_len);
+        op += literal_len;
+        ip += literal_len;
+
+        if (ip == ip_end)                                           // the last sequence has no match
+            break;
+
+        if (ip_end - ip < 2) return AT_FORMAT_ERROR;
+        const size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - op_begin)) return AT_FORMAT_ERROR;
+
+        size_t match_len = token & 15;
+        if (match_len == 15) {
+            u8 byte;
+            do {
+                if (ip >= ip_end) return AT_FORMAT_ERROR;
+                byte = *ip++;
+                match_len += byte;
+            } while (byte == 255);
+        }
+        match_len += MIN_MATCH;
+        if (match_len > (size_t)(op_end - op)) return AT_FORMAT_ERROR;
+
+        const u8* match = op - offset;
+        if (offset >= match_len) {
+            memcpy(op, match, match_len);
+            op += match_len;
+
+        } else if (offset >= sizeof(u64)) {                         // overlapping, but every 8 byte chunk is already written
+            u8* const copy_end = op + match_len;
+            while (op + sizeof(u64) <= copy_end) {
+                memcpy(op, match, sizeof(u64));
+                op += sizeof(u64);
+                match += sizeof(u64);
+            }
+            while (op < copy_end)
+                *op++ = *match++;
+
+        } else {                                                    // short repeating pattern
+            for (size_t x = 0; x < match_len; x++)
+                op[x] = match[x];
+            op += match_len;
+        }
+    }
+
+    return (op == op_end) ? AT_SUCCESS : AT_FORMAT_ERROR;
+}
+
+
+// ============================================================================================================================================
+// framing (writing)
+// ============================================================================================================================================
+
+void bc_encode_header(u8* out, const u32 block_size) {
+
+    memset(out, 0, BC_HEADER_SIZE);
+    store_le32(out, FRAME_MAGIC);
+    store_le16(out + 4, FRAME_VERSION);
+    store_le32(out + 8, block_size);
+}
+
+
+void bc_encode_index_entry(u8* out, const bc_block_entry* entry) {
+
+    store_le64(out, entry->offset);
+    store_le32(out + 8, entry->stored_size);
+    store_le32(out + 12, entry->raw_size);
+}
+
+
+void bc_encode_footer(u8* out, const u64 index_offset, const u32 block_count) {
+
+    store_le64(out, index_offset);
+    store_le32(out + 8, block_count);
+    store_le32(out + 12, FRAME_MAGIC);
+}
+
+
+// ============================================================================================================================================
+// framing (reading)
+// ============================================================================================================================================
+
+b8 bc_is_frame(const void* data, const size_t size) { return size >= BC_HEADER_SIZE + BC_FOOTER_SIZE && load_le32((const u8*)data) == FRAME_MAGIC; }
+
+
+i32 bc_frame_open(bc_frame* frame, const void* data, const size_t size) {
+
+    memset(frame, 0, sizeof(*frame));
+    if (!bc_is_frame(data, size)) return AT_FORMAT_ERROR;
+
+    const u8* bytes = (const u8*)data;
+    const u8* footer = bytes + size - BC_FOOTER_SIZE;
+    const u64 index_offset = load_le64(footer);
+    const u32 block_count = load_le32(footer + 8);
+    const u32 block_size = load_le32(bytes + 8);
+    if (load_le32(footer + 12) != FRAME_MAGIC || (u32)(bytes[4] | (bytes[5] << 8)) != FRAME_VERSION) return AT_FORMAT_ERROR;
+    if (block_size == 0 || block_size > BC_MAX_BLOCK_SIZE) return AT_FORMAT_ERROR;
+
+    // the index has to end at the footer, the count is limited first so the size of the index can not overflow
+    if ((u64)block_count > (u64)(size - BC_HEADER_SIZE - BC_FOOTER_SIZE) / BC_INDEX_ENTRY_SIZE) return AT_FORMAT_ERROR;
+    if (index_offset != (u64)size - BC_FOOTER_SIZE - (u64)block_count * BC_INDEX_ENTRY_SIZE) return AT_FORMAT_ERROR;
+
+    *frame = (bc_frame){ .data = bytes, .size = size, .index = bytes + index_offset, .block_size = block_size, .block_count = block_count };
+    for (u32 x = 0; x < block_count; x++) {
+        bc_block_entry entry;
+        bc_frame_get_block(frame, x, &entry);
+        if (entry.raw_size > block_size || entry.stored_size > entry.raw_size || entry.offset < BC_HEADER_SIZE
+            || entry.offset > index_offset || entry.stored_size > index_offset - entry.offset) {
+            memset(frame, 0, sizeof(*frame));
+            return AT_FORMAT_ERROR;
+        }
+        frame->raw_size += entry.raw_size;
+    }
+    return AT_SUCCESS;
+}
+
+
+void bc_frame_get_block(const bc_frame* frame, const u32 block, bc_block_entry* entry) {
+
+    const u8* pos = frame->index + (size_t)block * BC_INDEX_ENTRY_SIZE;
+    entry->offset = load_le64(pos);
+    entry->stored_size = load_le32(pos + 8);
+    entry->raw_size = load_le32(pos + 12);
+}
+
+
+i32 bc_frame_read_block(const bc_frame* frame, const u32 block, void* dst) {
+
+    if (block >= frame->block_count) return AT_RANGE_ERROR;
+
+    bc_block_entry entry;
+    bc_frame_get_block(frame, block, &entry);
+    if (entry.stored_size == entry.raw_size) {
+        memcpy(dst, frame->data + entry.offset, entry.raw_size);
+        return AT_SUCCESS;
+    }
+    return bc_decompress(frame->data + entry.offset, entry.stored_size, dst, entry.raw_size);
+}
+
+
+typedef struct {
+    const bc_frame*     frame;
+    u8*                 dst;                // raw position of [first_block]
+    u32                 first_block;
+    u32                 end_block;
+    i32                 result;
+} read_range;
+
+static void* read_worker(void* arg) {
+
+    read_range* range = (read_range*)arg;
+    u8* dst = range->dst;
+    for (u32 x = range->first_block; x < range->end_block && range->result == AT_SUCCESS; x++) {
+        bc_block_entry entry;
+        bc_frame_get_block(range->frame, x, &entry);
+        range->result = bc_frame_read_block(range->frame, x, dst);
+        dst += entry.raw_size;
+    }
+    return NULL;
+}
+
+
+i32 bc_frame_read_all(const bc_frame* frame, void* dst) {
+
+    const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    u32 thread_count = frame->block_count / READ_MIN_BLOCKS_PER_THREAD;
+    if (thread_count > (u32)((cores > 0) ? cores : 1)) thread_count = (u32)((cores > 0) ? cores : 1);
+    if (thread_count > READ_MAX_THREADS) thread_count = READ_MAX_THREADS;
+    if (thread_count == 0) thread_count = 1;
+
+    // contiguous block ranges, the raw position of a range is the sum of the raw sizes before it
+    read_range ranges[READ_MAX_THREADS];
+    u8* range_dst = (u8*)dst;
+    u32 block = 0;
+    for (u32 x = 0; x < thread_count; x++) {
+        const u32 end_block = (u32)((u64)frame->block_count * (x + 1) / thread_count);
+        ranges[x] = (read_range){ .frame = frame, .dst = range_dst, .first_block = block, .end_block = end_block, .result = AT_SUCCESS };
+        for (; block < end_block; block++) {
+            bc_block_entry entry;
+            bc_frame_get_block(frame, block, &entry);
+            range_dst += entry.raw_size;
+        }
+    }
+
+    pthread_t threads[READ_MAX_THREADS];
+    b8 started[READ_MAX_THREADS] = {0};
+    for (u32 x = 1; x < thread_count; x++)
+        started[x] = (pthread_create(&threads[x], NULL, read_worker, &ranges[x]) == 0);
+
+    read_worker(&ranges[0]);
+    i32 result = ranges[0].result;
+    for (u32 x = 1; x < thread_count; x++) {
+        if (started[x])
+            pthread_join(threads[x], NULL);
+        else
+            read_worker(&ranges[x]);                                // could not start a thread, decompress here
+        if (result == AT_SUCCESS)
+            result = ranges[x].result;
+    }
+    return result;
+}
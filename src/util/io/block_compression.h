@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "util/data_structure/data_types.h"
+
+
+// LZ4-class block compression and a framing for files that are written as a stream and read with random access.
+//
+// codec:   byte oriented LZ77 in the LZ4 block format (token, literals, 16 bit offset, match length), no entropy coding.
+//          Decompression only copies memory, so reading a compressed file is faster than reading the raw file from a slow disk.
+// framing: [header] [block 0] ... [block n-1] [index] [footer]
+//          every block is compressed independently and the index stores the position and sizes of every block,
+//          so single blocks can be read without touching the others and all blocks can be decompressed on multiple threads.
+//          All integers are little endian.
+//
+//          header  16 byte     magic "RMBC", u16 version, u16 reserved, u32 block_size, u32 reserved
+//          index   16 byte     per block: u64 offset, u32 stored_size, u32 raw_size (stored_size == raw_size: stored uncompressed)
+//          footer  16 byte     u64 index_offset, u32 block_count, magic "RMBC"
+
+
+#define BC_FILE_EXTENSION           ".rbc"
+#define BC_DEFAULT_BLOCK_SIZE       (256 * 1024)
+#define BC_MAX_BLOCK_SIZE           (64 * 1024 * 1024)
+
+#define BC_HEADER_SIZE              16
+#define BC_INDEX_ENTRY_SIZE         16
+#define BC_FOOTER_SIZE              16
+
+
+typedef struct {
+    u64         offset;             // of the stored block from the start of the file
+    u32         stored_size;
+    u32         raw_size;
+} bc_block_entry;
+
+
+// ============================================================================================================================================
+// codec
+// ============================================================================================================================================
+
+// @brief Size of the output buffer that is always enough for bc_compress() of [len] bytes
+static inline size_t bc_compress_bound(const size_t len) { return len + len / 255 + 16; }
+
+
+// @brief Compresses [len] bytes of [src] into [dst]
+// @return size of the compressed data, 0 if it does not fit into [capacity] (store the data uncompressed in that case)
+size_t bc_compress(const void* src, const size_t len, void* dst, const size_t capacity);
+
+
+// @brief Decompresses [len] bytes of [src] into exactly [raw_len] bytes at [dst]. Never reads or writes outside of the buffers
+// @return AT_SUCCESS on success, AT_FORMAT_ERROR if the data is corrupt
+i32 bc_decompress(const void* src, const size_t len, void* dst, const size_t raw_len);
+
+
+// ============================================================================================================================================
+// framing (writing)
+// ============================================================================================================================================
+
+void bc_encode_header(u8* out, const u32 block_size);
+void bc_encode_index_entry(u8* out, const bc_block_entry* entry);
+void bc_encode_footer(u8* out, const u64 index_offset, const u32 block_count);
+
+
+// ============================================================================================================================================
+// framing (reading)
+// ============================================================================================================================================
+
+// read only view of a complete frame in memory (usually a mapped file)
+typedef struct {
+    const u8*   data;
+    size_t      size;
+    const u8*   index;              // first index entry
+    u32         block_size;
+    u32         block_count;
+    u64         raw_size;           // sum of all block raw sizes
+} bc_frame;
+
+
+// @brief Checks the magic at the start of [data]
+b8 bc_is_frame(const void* data, const size_t size);
+
+
+// @brief Validates header, footer and index of the frame in [data], [data] has to stay valid while [frame] is used
+// @return AT_SUCCESS on success, AT_FORMAT_ERROR if [data] is not a valid frame
+i32 bc_frame_open(bc_frame* frame, const void* data, const size_t size);
+
+
+// @brief Reads the index entry of [block]
+void bc_frame_get_block(const bc_frame* frame, const u32 block, bc_block_entry* entry);
+
+
+// @brief Decompresses a single block into [dst], which needs space for the raw size of the block (at most [frame->block_size])
+i32 bc_frame_read_block(const bc_frame* frame, const u32 block, void* dst);
+
+
+// @brief Decompresses all blocks into [dst] ([frame->raw_size] bytes), large frames are decompressed on multiple threads
+i32 bc_frame_read_all(const bc_frame* frame, void* dst);
@@ -0,0 +1,241 @@
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "util/io/block_compression.h"
+#include "util/io/number_conversion.h"
+
+#include "util/io/buffered_writer.h"
+
+
+#define TMP_SUFFIX      ".tmp"
+
+
+// writes everything in [data], retries on partial writes and signals
+static i32 write_all(const int fd, const char* data, size_t len) {
+
+    while (len > 0) {
+        const ssize_t written = write(fd, data, len);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return AT_IO_ERROR;
+        }
+        data += written;
+        len -= (size_t)written;
+    }
+    return AT_SUCCESS;
+}
+
+static i32 write_raw(buffered_writer* w, const void* data, const size_t len) {
+
+    const i32 result = write_all(w->fd, (const char*)data, len);
+    if (result == AT_SUCCESS)
+        w->offset += len;
+    return result;
+}
+
+// compresses the buffer into one block and adds it to the index
+static i32 write_block(buffered_writer* w) {
+
+    bc_block_entry entry = { .offset = w->offset, .raw_size = (u32)w->len };
+    const size_t compressed_len = bc_compress(w->buffer, w->len, w->block, w->len);
+    const b8 stored = (compressed_len == 0 || compressed_len >= w->len);           // incompressible, keep it raw
+    entry.stored_size = stored ? (u32)w->len : (u32)compressed_len;
+
+    const i32 result = write_raw(w, stored ? w->buffer : w->block, entry.stored_size);
+    if (result != AT_SUCCESS) return result;
+    return darray_push_back(&w->blocks, &entry);
+}
+
+// writes the index and footer after the last block, everything after the blocks is written uncompressed
+static i32 write_index(buffered_writer* w) {
+
+    w->compress = false;
+    const u64 index_offset = w->offset;
+    u8 entry_data[BC_INDEX_ENTRY_SIZE];
+    for (size_t x = 0; x < darray_size(&w->blocks); x++) {
+        bc_encode_index_entry(entry_data, &darray_at(&w->blocks, bc_block_entry, x));
+        bw_write(w, entry_data, sizeof(entry_data));
+    }
+
+    u8 footer[BC_FOOTER_SIZE];
+    bc_encode_footer(footer, index_offset, (u32)darray_size(&w->blocks));
+    bw_write(w, footer, sizeof(footer));
+    return bw_flush(w);
+}
+
+// builds "<path>.tmp" into [buffer]
+static b8 get_tmp_path(const char* path, char* buffer, const size_t buffer_size) {
+
+    const int written = snprintf(buffer, buffer_size, "%s" TMP_SUFFIX, path);
+    return written >= 0 && (size_t)written < buffer_size;
+}
+
+
+// ============================================================================================================================================
+// init
+// ============================================================================================================================================
+
+i32 bw_open(buffered_writer* w, const char* path, const size_t buffer_size) {
+
+    if (!w || !path) return AT_INVALID_ARGUMENT;
+
+    memset(w, 0, sizeof(*w));
+    w->fd = -1;
+    const size_t path_len = strlen(path);
+    if (path_len >= sizeof(w->path)) return AT_RANGE_ERROR;
+    memcpy(w->path, path, path_len + 1);
+
+    char tmp_path[PATH_MAX + sizeof(TMP_SUFFIX)];
+    if (!get_tmp_path(path, tmp_path, sizeof(tmp_path))) return AT_RANGE_ERROR;
+
+    w->cap = (buffer_size > 0) ? buffer_size : BW_DEFAULT_BUFFER_SIZE;
+    w->buffer = malloc(w->cap);
+    if (!w->buffer) return AT_MEMORY_ERROR;
+
+    w->fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (w->fd < 0) {
+        free(w->buffer);
+        w->buffer = NULL;
+        return AT_IO_ERROR;
+    }
+    return AT_SUCCESS;
+}
+
+
+i32 bw_open_compressed(buffered_writer* w, const char* path, const size_t block_size) {
+
+    const size_t loc_block_size = (block_size > 0) ? block_size : BC_DEFAULT_BLOCK_SIZE;
+    if (loc_block_size > BC_MAX_BLOCK_SIZE) return AT_RANGE_ERROR;
+
+    i32 result = bw_open(w, path, loc_block_size);
+    if (result != AT_SUCCESS) return result;
+
+    w->compress = true;
+    w->block = malloc(loc_block_size);                              // blocks that do not shrink are stored raw
+    result = (w->block) ? darray_init(&w->blocks, sizeof(bc_block_entry)) : AT_MEMORY_ERROR;
+    if (result == AT_SUCCESS) {
+        u8 header[BC_HEADER_SIZE];
+        bc_encode_header(header, (u32)loc_block_size);
+        result = write_raw(w, header, sizeof(header));
+    }
+
+    if (result != AT_SUCCESS) {
+        w->error = result;
+        bw_close(w);
+    }
+    return result;
+}
+
+
+i32 bw_close(buffered_writer* w) {
+
+    if (!w || w->fd < 0) return AT_INVALID_ARGUMENT;
+
+    const b8 compressed = (w->block != NULL);
+    bw_flush(w);
+    if (compressed && w->error == AT_SUCCESS)
+        w->error = write_index(w);
+    if (w->error == AT_SUCCESS && fsync(w->fd) != 0)
+        w->error = AT_IO_ERROR;
+    if (close(w->fd) != 0 && w->error == AT_SUCCESS)
+        w->error = AT_IO_ERROR;
+    w->fd = -1;
+
+    char tmp_path[PATH_MAX + sizeof(TMP_SUFFIX)];
+    get_tmp_path(w->path, tmp_path, sizeof(tmp_path));
+    if (w->error == AT_SUCCESS) {
+        if (rename(tmp_path, w->path) != 0)
+            w->error = AT_IO_ERROR;
+    } else
+        unlink(tmp_path);
+
+    free(w->buffer);
+    w->buffer = NULL;
+    w->len = w->cap = 0;
+    if (compressed) {
+        free(w->block);
+        w->block = NULL;
+        darray_free(&w->blocks);
+        w->compress = false;
+    }
+    return w->error;
+}
+
+
+// ============================================================================================================================================
+// write
+// ============================================================================================================================================
+
+i32 bw_flush(buffered_writer* w) {
+
+    if (w->error != AT_SUCCESS) return w->error;
+    if (w->len == 0) return AT_SUCCESS;
+
+    w->error = (w->compress) ? write_block(w) : write_raw(w, w->buffer, w->len);
+    w->len = 0;
+    return w->error;
+}
+
+
+i32 bw_write(buffered_writer* w, const void* data, const size_t len) {
+
+    if (w->error != AT_SUCCESS) return w->error;
+
+    if (w->len + len <= w->cap) {                                   // common case: fits into the buffer
+        memcpy(w->buffer + w->len, data, len);
+        w->len += len;
+        return AT_SUCCESS;
+    }
+
+    if (w->compress) {                                              // every block has to go through the buffer
+        const char* pos = (const char*)data;
+        size_t remaining = len;
+        while (remaining > 0) {
+            const size_t space = w->cap - w->len;
+            const size_t copy_len = (remaining < space) ? remaining : space;
+            memcpy(w->buffer + w->len, pos, copy_len);
+            w->len += copy_len;
+            pos += copy_len;
+            remaining -= copy_len;
+            if (w->len == w->cap && bw_flush(w) != AT_SUCCESS)
+                return w->error;
+        }
+        return AT_SUCCESS;
+    }
+
+    if (bw_flush(w) != AT_SUCCESS) return w->error;
+
+    if (len >= w->cap) {                                            // would only be copied to be flushed right away
+        w->error = write_raw(w, data, len);
+        return w->error;
+    }
+
+    memcpy(w->buffer, data, len);
+    w->len = len;
+    return AT_SUCCESS;
+}
+
+
+i32 bw_write_u64(buffered_writer* w, const u64 value) {
+
+    char buffer[NUM_BUFFER_SIZE];
+    return bw_write(w, buffer, num_format_u64(buffer, value));
+}
+
+
+i32 bw_write_i64(buffered_writer* w, const i64 value) {
+
+    char buffer[NUM_BUFFER_SIZE];
+    return bw_write(w, buffer, num_format_i64(buffer, value));
+}
+
+
+i32 bw_write_f64(buffered_writer* w, const f64 value) {
+
+    char buffer[NUM_BUFFER_SIZE];
+    return bw_write(w, buffer, num_format_f64(buffer, value));
+}
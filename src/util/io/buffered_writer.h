@@ -0,0 +1,79 @@
+#pragma once
+
+#include <limits.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "util/data_structure/data_types.h"
+#include "util/data_structure/darray.h"
+
+
+// Writes a file through a fixed size buffer so large documents can be streamed without building them in memory.
+// The content is written to "<path>.tmp" and only renamed to [path] by bw_close() if every write succeeded,
+// so an existing file is never left half written.
+// Opened with bw_open_compressed() every full buffer is written as one compressed block (see block_compression.h).
+typedef struct {
+    int         fd;
+    char*       buffer;
+    size_t      len;        // bytes currently in [buffer]
+    size_t      cap;
+    i32         error;      // first error that occurred, all following writes are ignored
+    u64         offset;     // bytes written to the file so far
+    b8          compress;
+    char*       block;      // compressed content of [buffer]
+    darray      blocks;     // [bc_block_entry] of every written block, becomes the index of the file
+    char        path[PATH_MAX];
+} buffered_writer;
+
+
+#define BW_DEFAULT_BUFFER_SIZE      (64 * 1024)
+
+
+// ============================================================================================================================================
+// init
+// ============================================================================================================================================
+
+// @brief Creates the temporary file for [path] and allocates the buffer
+// @param buffer_size Size of the write buffer, 0 uses BW_DEFAULT_BUFFER_SIZE
+// @return AT_SUCCESS on success, error code on failure
+i32 bw_open(buffered_writer* w, const char* path, const size_t buffer_size);
+
+
+// @brief Same as bw_open() but writes a block compressed file, large files shrink severalfold and can be decompressed in parallel
+// @param block_size Size of the blocks before compression, 0 uses BC_DEFAULT_BLOCK_SIZE
+i32 bw_open_compressed(buffered_writer* w, const char* path, const size_t block_size);
+
+
+// @brief Flushes the buffer and replaces [path] with the written content. On any previous error the temporary file is removed instead
+// @return AT_SUCCESS if the file was written completely, otherwise the first error that occurred
+i32 bw_close(buffered_writer* w);
+
+
+// ============================================================================================================================================
+// write
+// ============================================================================================================================================
+
+// @brief Writes [len] bytes, data larger than the buffer is written directly
+i32 bw_write(buffered_writer* w, const void* data, const size_t len);
+
+
+// @brief Writes the buffer content to the file (as one block if compressed, flushing often makes blocks small)
+i32 bw_flush(buffered_writer* w);
+
+
+static inline i32 bw_write_str(buffered_writer* w, const char* str)     { return bw_write(w, str, strlen(str)); }
+
+static inline i32 bw_write_char(buffered_writer* w, const char c) {
+
+    if (w->len < w->cap) {
+        w->buffer[w->len++] = c;
+        return AT_SUCCESS;
+    }
+    return bw_write(w, &c, 1);
+}
+
+
+// @brief Formats numbers with the locale independent routines of number_conversion.h
+i32 bw_write_u64(buffered_writer* w, const u64 value);
+i32 bw_write_i64(buffered_writer* w, const i64 value);
+i32 bw_write_f64(buffered_writer* w, const f64 value);
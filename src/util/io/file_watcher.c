@@ -0,0 +1,297 @@
+
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "util/io/logger.h"
+#include "util/data_structure/darray.h"
+#include "util/data_structure/lockfree_queue.h"
+#include "util/system.h"
+
+#include "file_watcher.h"
+
+
+// editors either rewrite the file in place (close after write) or replace it by renaming a temporary file
+#define WATCH_EVENTS        (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE)
+
+typedef struct {
+    char                        dir_path[PATH_MAX];
+    char                        file_name[NAME_MAX +1];
+    int                         watch_descriptor;       // shared by all files of a directory
+    file_watcher_callback_t     callback;
+    void*                       user_data;
+    f64                         deadline;               // get_precise_time() when the change is reported, 0 if nothing is pending
+    u64                         id;                     // identifies the watch while its callback runs without the mutex
+} watched_file;
+
+typedef struct {
+    file_watcher_task_t         task;
+    file_watcher_task_t         discard;
+    void*                       data;
+} watcher_task;
+
+static struct {
+    pthread_mutex_t             mutex;                  // protects [files], [next_id] and [running_id], not held while callbacks run
+    pthread_cond_t              callback_done;          // signaled when a callback returns
+    darray                      files;                  // [watched_file]
+    u64                         next_id;
+    u64                         running_id;             // watch whose callback runs, 0 if none
+    int                         inotify_fd;
+    int                         wake_fd;                // eventfd, wakes the thread for shutdown
+    pthread_t                   thread;
+    atomic_bool                 running;
+    lf_queue                    tasks;                  // [watcher_task] for the UI thread
+} s_watcher = { .mutex = PTHREAD_MUTEX_INITIALIZER, .callback_done = PTHREAD_COND_INITIALIZER, .inotify_fd = -1, .wake_fd = -1 };
+
+
+// ============================================================================================================================================
+// watcher thread
+// ============================================================================================================================================
+
+// [s_watcher.mutex] has to be held, a change of a file restarts its debounce period
+static void mark_changed_locked(const int watch_descriptor, const char* file_name, const f64 now) {
+
+    for (size_t x = 0; x < darray_size(&s_watcher.files); x++) {
+        watched_file* file = &darray_at(&s_watcher.files, watched_file, x);
+        if ((watch_descriptor < 0 || file->watch_descriptor == watch_descriptor) && (!file_name || strcmp(file->file_name, file_name) == 0))
+            file->deadline = now + FILE_WATCHER_DEBOUNCE;
+    }
+}
+
+
+static void read_events(void) {
+
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    for (;;) {
+        const ssize_t len = read(s_watcher.inotify_fd, buffer, sizeof(buffer));
+        if (len <= 0) return;                                           // EAGAIN: all events are read
+
+        const f64 now = get_precise_time();
+        pthread_mutex_lock(&s_watcher.mutex);
+        for (const char* pos = buffer; pos < buffer + len; ) {
+            const struct inotify_event* event = (const struct inotify_event*)pos;
+            if (event->mask & IN_Q_OVERFLOW)                            // events were lost, treat every file as changed
+                mark_changed_locked(-1, NULL, now);
+            else if (event->len > 0)
+                mark_changed_locked(event->wd, event->name, now);
+            pos += sizeof(struct inotify_event) + event->len;
+        }
+        pthread_mutex_unlock(&s_watcher.mutex);
+    }
+}
+
+
+// [s_watcher.mutex] has to be held, runs the callbacks of all files whose debounce period is over.
+// Every callback runs on a copy of its watch with the mutex released, so watches can be added and removed meanwhile
+// @return time until the next pending deadline in milliseconds, -1 if nothing is pending
+static int run_due_callbacks_locked(void) {
+
+    for (;;) {
+        const f64 now = get_precise_time();
+        f64 next_deadline = 0;
+        watched_file due = {0};
+        for (size_t x = 0; x < darray_size(&s_watcher.files) && due.id == 0; x++) {
+            watched_file* file = &darray_at(&s_watcher.files, watched_file, x);
+            if (file->deadline == 0)
+                continue;
+
+            if (file->deadline <= now) {
+                file->deadline = 0;
+                due = *file;
+            } else if (next_deadline == 0 || file->deadline < next_deadline)
+                next_deadline = file->deadline;
+        }
+
+        if (due.id == 0)
+            return (next_deadline == 0) ? -1 : (int)((next_deadline - now) * 1000.0) +1;
+
+        s_watcher.running_id = due.id;
+        pthread_mutex_unlock(&s_watcher.mutex);
+        LOG(Trace, "File changed [%s/%s]", due.dir_path, due.file_name)
+        due.callback(due.dir_path, due.file_name, due.user_data);
+        pthread_mutex_lock(&s_watcher.mutex);
+        s_watcher.running_id = 0;
+        pthread_cond_broadcast(&s_watcher.callback_done);
+    }
+}
+
+
+static void* watcher_thread(__attribute_maybe_unused__ void* arg) {
+
+    LOGGER_REGISTER_THREAD_LABEL("file watcher")
+
+    int timeout_ms = -1;
+    while (atomic_load(&s_watcher.running)) {
+
+        struct pollfd fds[2] = {
+            { .fd = s_watcher.inotify_fd, .events = POLLIN },
+            { .fd = s_watcher.wake_fd, .events = POLLIN },
+        };
+        const int result = poll(fds, 2, timeout_ms);
+        if (result < 0 && errno != EINTR) {
+            LOG(Error, "Polling file events failed: %s", strerror(errno))
+            break;
+        }
+
+        if (fds[0].revents & POLLIN)
+            read_events();
+        if (fds[1].revents & POLLIN) {
+            u64 value;
+            VALIDATE(read(s_watcher.wake_fd, &value, sizeof(value)) == sizeof(value), , "", "Failed to read wake event")
+        }
+
+        pthread_mutex_lock(&s_watcher.mutex);
+        timeout_ms = run_due_callbacks_locked();
+        pthread_mutex_unlock(&s_watcher.mutex);
+    }
+
+    logger_remove_thread_label_by_id((u64)pthread_self());
+    return NULL;
+}
+
+
+// ============================================================================================================================================
+// init
+// ============================================================================================================================================
+
+b8 file_watcher_init(void) {
+
+    VALIDATE(!atomic_load(&s_watcher.running), return false, "", "File watcher is already running")
+
+    s_watcher.inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    VALIDATE(s_watcher.inotify_fd >= 0, return false, "", "Failed to initialize inotify: %s", strerror(errno))
+
+    s_watcher.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    VALIDATE(s_watcher.wake_fd >= 0, close(s_watcher.inotify_fd); s_watcher.inotify_fd = -1; return false, "", "Failed to create wake event: %s", strerror(errno))
+
+    darray_init(&s_watcher.files, sizeof(watched_file));
+    lfq_init(&s_watcher.tasks, sizeof(watcher_task), FILE_WATCHER_QUEUE_SIZE);
+
+    atomic_store(&s_watcher.running, true);
+    if (pthread_create(&s_watcher.thread, NULL, watcher_thread, NULL) != 0) {
+        LOG(Error, "Failed to start file watcher thread")
+        atomic_store(&s_watcher.running, false);
+        file_watcher_shutdown();
+        return false;
+    }
+
+    LOG_INIT
+    return true;
+}
+
+
+void file_watcher_shutdown(void) {
+
+    if (atomic_exchange(&s_watcher.running, false)) {
+        const u64 value = 1;
+        VALIDATE(write(s_watcher.wake_fd, &value, sizeof(value)) == sizeof(value), , "", "Failed to wake file watcher thread")
+        pthread_join(s_watcher.thread, NULL);
+    }
+
+    watcher_task task;
+    while (lfq_pop(&s_watcher.tasks, &task))
+        if (task.discard)
+            task.discard(task.data);
+    lfq_free(&s_watcher.tasks);
+
+    pthread_mutex_lock(&s_watcher.mutex);
+    darray_free(&s_watcher.files);
+    pthread_mutex_unlock(&s_watcher.mutex);
+
+    if (s_watcher.inotify_fd >= 0)
+        close(s_watcher.inotify_fd);                                   // also removes all watches
+    if (s_watcher.wake_fd >= 0)
+        close(s_watcher.wake_fd);
+    s_watcher.inotify_fd = s_watcher.wake_fd = -1;
+    LOG_SHUTDOWN
+}
+
+
+// ============================================================================================================================================
+// watches
+// ============================================================================================================================================
+
+b8 file_watcher_add(const char* dir_path, const char* file_name, file_watcher_callback_t callback, void* user_data) {
+
+    VALIDATE(dir_path && file_name && callback && strlen(dir_path) < PATH_MAX && strlen(file_name) <= NAME_MAX, return false, "", "Invalid file to watch")
+    VALIDATE(atomic_load(&s_watcher.running), return false, "", "File watcher is not running, [%s/%s] is not watched", dir_path, file_name)
+
+    watched_file file = {0};
+    strcpy(file.dir_path, dir_path);
+    strcpy(file.file_name, file_name);
+    file.callback = callback;
+    file.user_data = user_data;
+
+    file.watch_descriptor = inotify_add_watch(s_watcher.inotify_fd, dir_path, WATCH_EVENTS);       // returns the existing descriptor for a watched directory
+    VALIDATE(file.watch_descriptor >= 0, return false, "", "Failed to watch [%s]: %s", dir_path, strerror(errno))
+
+    pthread_mutex_lock(&s_watcher.mutex);
+    file.id = ++s_watcher.next_id;
+    const i32 result = darray_push_back(&s_watcher.files, &file);
+    pthread_mutex_unlock(&s_watcher.mutex);
+    VALIDATE(result == AT_SUCCESS, return false, "", "Failed to add watch [%s/%s]: %s", dir_path, file_name, error_to_str(result))
+
+    LOG(Trace, "Watching [%s/%s]", dir_path, file_name)
+    return true;
+}
+
+
+void file_watcher_remove(const char* dir_path, const char* file_name) {
+
+    if (!atomic_load(&s_watcher.running)) return;
+
+    pthread_mutex_lock(&s_watcher.mutex);
+    int watch_descriptor = -1;
+    u64 id = 0;
+    for (size_t x = 0; x < darray_size(&s_watcher.files); x++) {
+        const watched_file* file = &darray_at(&s_watcher.files, watched_file, x);
+        if (strcmp(file->dir_path, dir_path) == 0 && strcmp(file->file_name, file_name) == 0) {
+            watch_descriptor = file->watch_descriptor;
+            id = file->id;
+            darray_erase(&s_watcher.files, x);
+            break;
+        }
+    }
+
+    b8 descriptor_used = false;                                         // other files of the same directory
+    for (size_t x = 0; x < darray_size(&s_watcher.files); x++)
+        descriptor_used |= (darray_at(&s_watcher.files, watched_file, x).watch_descriptor == watch_descriptor);
+    if (watch_descriptor >= 0 && !descriptor_used)
+        inotify_rm_watch(s_watcher.inotify_fd, watch_descriptor);
+
+    // the watch is gone, so no new callback of it starts. Only a callback of this file that already runs is waited for
+    while (id != 0 && s_watcher.running_id == id)
+        pthread_cond_wait(&s_watcher.callback_done, &s_watcher.mutex);
+    pthread_mutex_unlock(&s_watcher.mutex);
+}
+
+
+// ============================================================================================================================================
+// tasks
+// ============================================================================================================================================
+
+b8 file_watcher_post(file_watcher_task_t task, file_watcher_task_t discard, void* data) {
+
+    if (!task || !atomic_load(&s_watcher.running)) return false;
+
+    const watcher_task loc_task = { task, discard, data };
+    return lfq_push(&s_watcher.tasks, &loc_task) == AT_SUCCESS;
+}
+
+
+u32 file_watcher_dispatch(void) {
+
+    u32 count = 0;
+    watcher_task task;
+    while (lfq_pop(&s_watcher.tasks, &task)) {
+        task.task(task.data);
+        count++;
+    }
+    return count;
+}
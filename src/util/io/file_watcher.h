@@ -0,0 +1,61 @@
+#pragma once
+
+#include "util/data_structure/data_types.h"
+
+
+// Reports modifications of files on a background thread (inotify).
+// Events are debounced per file: the callback runs once FILE_WATCHER_DEBOUNCE seconds passed without a further event,
+// so an editor that writes a file in several steps results in a single callback. Callbacks run on the watcher thread and
+// hand their results to the UI thread with file_watcher_post(), which are executed by the next file_watcher_dispatch().
+
+
+#define FILE_WATCHER_DEBOUNCE       0.2         // seconds without further events before a change is reported
+#define FILE_WATCHER_QUEUE_SIZE     256         // tasks that can wait for file_watcher_dispatch()
+
+
+// runs on the watcher thread without a lock of the file watcher, must not call file_watcher_remove() for its own file
+typedef void (*file_watcher_callback_t)(const char* dir_path, const char* file_name, void* user_data);
+
+// runs on the thread that calls file_watcher_dispatch()
+typedef void (*file_watcher_task_t)(void* data);
+
+
+// ============================================================================================================================================
+// init
+// ============================================================================================================================================
+
+// @brief Starts the watcher thread
+// @return true on success, files can not be watched otherwise
+b8 file_watcher_init(void);
+
+
+// @brief Stops the watcher thread and removes all watches, tasks that were not dispatched are discarded
+void file_watcher_shutdown(void);
+
+
+// ============================================================================================================================================
+// watches
+// ============================================================================================================================================
+
+// @brief Calls [callback] after [dir_path]/[file_name] was written, created or replaced. The directory has to exist, the file does not
+// @return true if the watch was added
+b8 file_watcher_add(const char* dir_path, const char* file_name, file_watcher_callback_t callback, void* user_data);
+
+
+// @brief Removes the watch, waits for a running callback of this file to finish (callbacks of other files are not waited for)
+void file_watcher_remove(const char* dir_path, const char* file_name);
+
+
+// ============================================================================================================================================
+// tasks
+// ============================================================================================================================================
+
+// @brief Queues [task] to be executed by file_watcher_dispatch() without blocking, safe to call from any thread
+// @param discard Called with [data] instead of [task] if the watcher shuts down before the task was dispatched, can be NULL
+// @return false if the queue is full or the watcher is not running
+b8 file_watcher_post(file_watcher_task_t task, file_watcher_task_t discard, void* data);
+
+
+// @brief Executes all queued tasks in the order they were posted, call once per frame on the UI thread
+// @return number of executed tasks
+u32 file_watcher_dispatch(void);
@@ -15,6 +15,10 @@
 
 // #include "util/data_structure/data_types.h"
 #include "util/data_structure/dynamic_string.h"
+#include "util/data_structure/str_view.h"
+#include "util/memory/arena.h"
+#include "util/memory/pool.h"
+#include "util/data_structure/concurrent_map.h"
 #include "util/system.h"
 
 #include "logger.h"
@@ -41,6 +45,14 @@ inline static const char *short_filename(const char *path) {
     return last ? last + 1 : path;
 }
 
+// copies [src] into [dest] of [size] bytes, truncated and always null terminated
+static inline void copy_name(char* dest, const size_t size, const char* src) {
+
+    const size_t len = src ? strnlen(src, size -1) : 0;
+    if (len) memcpy(dest, src, len);
+    dest[len] = '\0';
+}
+
 
 static const char* c_severity_names[] =       { "TRACE", "DEBUG", "INFO ", "WARN ", "ERROR", "FATAL" };
 
@@ -70,132 +82,92 @@ static char*                    s_format_current = NULL;
 
 
 // ============================================================================================================================================
-// thread label map (simple linked list)
+// thread label map
 // ============================================================================================================================================
 
-typedef struct thread_label_node {
-    u64                         thread_id;
-    char*                       label;
-    struct thread_label_node*   next;
-} thread_label_node;
+// labels are read for every message with [$Q] and rarely change, lookups do not take a lock
+static void label_release(void* key, void* value);
 
-static thread_label_node*       s_thread_labels = NULL;
+static concurrent_map           s_thread_labels = CMAP_INITIALIZER(ptr_hash, ptr_compare, label_release);       // key: thread id, value: label
 
 static pthread_mutex_t          s_general_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+static pool_allocator           s_label_pool = POOL_INITIALIZER;          // label strings
+
+static arena                    s_format_arena = ARENA_INITIALIZER;      // formatted messages, reset after each message (guarded by s_general_mutex)
+
+
+static char* label_create(const char* label) {
+
+    const char* loc_label = label ? label : "";
+    const size_t size = strlen(loc_label) +1;
+    char* copy = pool_alloc(&s_label_pool, size);
+    if (copy)
+        memcpy(copy, loc_label, size);
+    return copy;
+}
+
+static void label_release(void* key, void* value) {
+
+    (void)key;
+    if (value)
+        pool_dealloc(&s_label_pool, value, strlen((const char*)value) +1);
+}
+
 
 void logger_register_thread_label(pthread_t thread_id, const char* label) {
 
     // TODO: only print this to the log file
     // printf("registering thread [%ul] under [%s]\n", thread_id, label);
 
-    pthread_mutex_lock(&s_general_mutex);
-    struct thread_label_node* current = s_thread_labels;
-    while (current) {
-        if (current->thread_id == thread_id) {
-            free(current->label);
-            current->label = strdup(label ? label : "");
-            pthread_mutex_unlock(&s_general_mutex);
-            return;
-        }
-        current = current->next;
-    }
-    // not found, append
-    struct thread_label_node* node = malloc(sizeof(*node));
-    node->thread_id = thread_id;
-    node->label = strdup(label ? label : "");
-    node->next = s_thread_labels;
-    s_thread_labels = node;
-    pthread_mutex_unlock(&s_general_mutex);
+    char* copy = label_create(label);
+    if (copy && cmap_insert(&s_thread_labels, (void*)(uintptr_t)thread_id, copy) != AT_SUCCESS)
+        label_release(NULL, copy);
 }
 
 
-const char* lookup_thread_label(pthread_t thread_id) {
+// appends the label of [thread_id] or the id itself if it has none
+static void append_thread_label(dyn_str* out, pthread_t thread_id) {
 
-    struct thread_label_node* n = s_thread_labels;
-    while (n) {
-        if (n->thread_id == thread_id) {
-
-            pthread_mutex_unlock(&s_general_mutex);
-            return n->label;
-        }
-        n = n->next;
-    }
-    return NULL;
+    cmap_read_guard guard = cmap_read_lock(&s_thread_labels);
+    void* label = NULL;
+    if (cmap_find(&guard, (void*)(uintptr_t)thread_id, &label) == AT_SUCCESS)
+        ds_append_str(out, (const char*)label);
+    else
+        ds_append_fmt(out, NULL, TYPE_FORMAT(thread_id), thread_id);
+    cmap_read_unlock(&guard);
 }
 
 
 void logger_remove_thread_label_by_id(pthread_t thread_id) {
-    
-    pthread_mutex_lock(&s_general_mutex);
-    thread_label_node *current = s_thread_labels;
-    thread_label_node *prev = NULL;
-    
-    while (current) {
-        if (current->thread_id == thread_id) {
-            // Found the node to remove
-            if (prev) {
-                prev->next = current->next;
-            } else {
-                s_thread_labels = current->next;
-            }
-            
-            free(current->label);
-            free(current);
-            break;
-        }
-        
-        prev = current;
-        current = current->next;
-    }
-    
-    pthread_mutex_unlock(&s_general_mutex);
+
+    cmap_erase(&s_thread_labels, (void*)(uintptr_t)thread_id);
 }
 
 
 void logger_remove_thread_label_by_label(const char* label) {
-    
+
     if (!label) return;
-    pthread_mutex_lock(&s_general_mutex);
-    
-    thread_label_node *current = s_thread_labels;
-    thread_label_node *prev = NULL;
-    
-    while (current) {
-        if (strcmp(current->label, label) == 0) {
-            // Found the node to remove
-            if (prev) {
-                prev->next = current->next;
-            } else {
-                s_thread_labels = current->next;
-            }
-            
-            free(current->label);
-            free(current);
-            break;
-        }
-        
-        prev = current;
-        current = current->next;
-    }
-    
-    pthread_mutex_unlock(&s_general_mutex);
+
+    void* thread_id = NULL;
+    b8 found = false;
+    cmap_read_guard guard = cmap_read_lock(&s_thread_labels);
+    size_t cursor = 0;
+    void* value = NULL;
+    while (!found && cmap_next(&guard, &cursor, &thread_id, &value))
+        found = (strcmp((const char*)value, label) == 0);
+    cmap_read_unlock(&guard);
+
+    if (found)
+        cmap_erase(&s_thread_labels, thread_id);
 }
 
 
 void logger_remove_all_thread_labels() {
-    
-    pthread_mutex_lock(&s_general_mutex);
-    thread_label_node *current = s_thread_labels;
-    while (current) {
-        thread_label_node *next = current->next;
-        free(current->label);
-        free(current);
-        current = next;
-    }
-    
-    s_thread_labels = NULL;
-    pthread_mutex_unlock(&s_general_mutex);
+
+    // every label goes back to the pool through label_release(), the slabs are kept: another thread can be between
+    // label_create() and cmap_insert() in logger_register_thread_label() and still own a label of them
+    cmap_clear(&s_thread_labels);
 }
 
 
@@ -467,6 +439,8 @@ void logger_shutdown() {
     buffer_destroy(&s_log_msg_buffer);
     logger_remove_all_thread_labels();
 #endif
+    arena_free(&s_format_arena);
+    s_format_arena = (arena)ARENA_INITIALIZER;
 
 
     system_time st = get_system_time();
@@ -513,7 +487,7 @@ void logger_set_format(const char* new_format) {
     // for multithreading that uses a [log_msg] as param
     void process_log_message_v(const log_msg* message) {
         
-        if (strlen(message->message) == 0)      // skip empty messages
+        if (message->message[0] == '\0')        // skip empty messages
             return;
 
         system_time st = get_system_time();
@@ -523,48 +497,43 @@ void logger_set_format(const char* new_format) {
         const char* fmt = s_format_current ? s_format_current : c_default_format;
 
         dyn_str out;
-        ds_init(&out);
-
-        size_t fmt_len = strlen(fmt);
-        for (size_t i = 0; i < fmt_len; ++i) {
-            char c = fmt[i];
-            if (c == '$') {
-                if (i + 1 >= fmt_len) break;
-                char cmd = fmt[++i];
-                switch (cmd) {
-                    case 'B': ds_append_str(&out, c_console_color_table[(int)message->type]); break;                    // color begin
-                    case 'E': ds_append_str(&out, c_console_rest); break;                                               // color end
-                    case 'C': ds_append_str(&out, message->message); break;                                             // message content
-                    case 'L': ds_append_str(&out, log_level_to_string(message->type)); break;                           // severity
-                    case 'Z': ds_append_char(&out, '\n'); break;                                                        // newline
-                    case 'Q': {                                                                                         // thread id or label
-                        const char* label = lookup_thread_label(message->thread_id);
-                        if (label)  ds_append_str(&out, label);
-                        else        ds_append_fmt(&out, NULL, TYPE_FORMAT(message->thread_id), message->thread_id);
-                    } break;
-                    case 'F': ds_append_str(&out, message->function_name); break;                                       // function
-                    case 'A': ds_append_str(&out, message->file_name); break;                                           // file
-                    case 'I': ds_append_str(&out, short_filename(message->file_name)); break;                           // short file
-                    case 'G': ds_append_fmt(&out, NULL, "%d", message->line); break;                                    // line
-                    
-                    case 'T': ds_append_fmt(&out, NULL, "%02d:%02d:%02d", st.hour, st.minute, st.second); break;        // time component
-                    case 'H': ds_append_fmt(&out, NULL, "%02d", st.hour); break;                                        // time component
-                    case 'M': ds_append_fmt(&out, NULL, "%02d", st.minute); break;                                      // time component
-                    case 'S': ds_append_fmt(&out, NULL, "%02d", st.second); break;                                      // time component
-                    case 'J': ds_append_fmt(&out, NULL, "%03d", st.millisec); break;                                    // time component
-
-                    case 'N': ds_append_fmt(&out, NULL, "%04d/%02d/%02d", st.year, st.month, st.day); break;            // date component
-                    case 'Y': ds_append_fmt(&out, NULL, "%04d", st.year); break;                                        // date component
-                    case 'O': ds_append_fmt(&out, NULL, "%02d", st.month); break;                                       // date component
-                    case 'D': ds_append_fmt(&out, NULL, "%02d", st.day); break;                                         // date component
-
-                    default:                                                                                            // unknown %% - treat literally (append '$' and the char)
-                        ds_append_char(&out, '$');
-                        ds_append_char(&out, cmd);
-                        break;
-                }
-            } else {
-                ds_append_char(&out, c);
+        ds_init_arena(&out, &s_format_arena, 1024);
+
+        // literal text between the commands is appended in one piece, directly out of the format
+        str_view rest = sv_from_cstr(fmt), literal;
+        while (sv_split_next(&rest, '$', &literal)) {
+            ds_append_str_n(&out, literal.data, literal.len);
+            if (sv_is_empty(rest)) break;                       // end of format or a trailing '$'
+
+            const char cmd = rest.data[0];
+            rest = sv_skip(rest, 1);
+            switch (cmd) {
+                case 'B': ds_append_str(&out, c_console_color_table[(int)message->type]); break;                    // color begin
+                case 'E': ds_append_str(&out, c_console_rest); break;                                               // color end
+                case 'C': ds_append_str(&out, message->message); break;                                             // message content
+                case 'L': ds_append_str(&out, log_level_to_string(message->type)); break;                           // severity
+                case 'Z': ds_append_char(&out, '\n'); break;                                                        // newline
+                case 'Q': append_thread_label(&out, message->thread_id); break;                                     // thread id or label
+                case 'F': ds_append_str(&out, message->function_name); break;                                       // function
+                case 'A': ds_append_str(&out, message->file_name); break;                                           // file
+                case 'I': ds_append_str(&out, short_filename(message->file_name)); break;                           // short file
+                case 'G': ds_append_fmt(&out, NULL, "%d", message->line); break;                                    // line
+                
+                case 'T': ds_append_fmt(&out, NULL, "%02d:%02d:%02d", st.hour, st.minute, st.second); break;        // time component
+                case 'H': ds_append_fmt(&out, NULL, "%02d", st.hour); break;                                        // time component
+                case 'M': ds_append_fmt(&out, NULL, "%02d", st.minute); break;                                      // time component
+                case 'S': ds_append_fmt(&out, NULL, "%02d", st.second); break;                                      // time component
+                case 'J': ds_append_fmt(&out, NULL, "%03d", st.millisec); break;                                    // time component
+
+                case 'N': ds_append_fmt(&out, NULL, "%04d/%02d/%02d", st.year, st.month, st.day); break;            // date component
+                case 'Y': ds_append_fmt(&out, NULL, "%04d", st.year); break;                                        // date component
+                case 'O': ds_append_fmt(&out, NULL, "%02d", st.month); break;                                       // date component
+                case 'D': ds_append_fmt(&out, NULL, "%02d", st.day); break;                                         // date component
+
+                default:                                                                                            // unknown %% - treat literally (append '$' and the char)
+                    ds_append_char(&out, '$');
+                    ds_append_char(&out, cmd);
+                    break;
             }
         }
 
@@ -584,7 +553,7 @@ void logger_set_format(const char* new_format) {
         }
 
 
-        const size_t msg_length = strlen(out.data);
+        const size_t msg_length = out.len;
         
         pthread_mutex_lock(&s_file_buffer_mutex);       // use mutex outside here because of strlen()
         const size_t remaining_buffer_size = sizeof(s_file_buffer) - strlen(s_file_buffer) -1;
@@ -596,6 +565,7 @@ void logger_set_format(const char* new_format) {
 
 
         ds_free(&out);
+        arena_reset(&s_format_arena);
         pthread_mutex_unlock(&s_general_mutex);
     }
 
@@ -614,49 +584,44 @@ void logger_set_format(const char* new_format) {
         const char* fmt = s_format_current ? s_format_current : c_default_format;
 
         dyn_str out;
-        ds_init(&out);
-
-        size_t fmt_len = strlen(fmt);
-        for (size_t i = 0; i < fmt_len; ++i) {
-            char c = fmt[i];
-            if (c == '$') {
-                if (i + 1 >= fmt_len) break;
-                char cmd = fmt[++i];
-                switch (cmd) {
-                    case 'B': ds_append_str(&out, c_console_color_table[(int)type]); break;                           // color begin
-                    case 'E': ds_append_str(&out, c_console_rest); break;                                             // color end
-                    case 'C': ds_append_str(&out, formatted_message); break;                                        // message content
-                    case 'L': ds_append_str(&out, log_level_to_string(type)); break;                                // severity
-                    case 'Z': ds_append_char(&out, '\n'); break;                                                    // newline
-                    case 'Q': {                                                                                     // thread id or label
-                        const char* label = lookup_thread_label(thread_id);
-                        if (label)  ds_append_str(&out, label);
-                        else        ds_append_fmt(&out, "%lu", thread_id);
-                    } break;
-                    case 'F': ds_append_str(&out, function_name ? function_name : ""); break;                       // function
-                    case 'P': ds_append_str(&out, function_name); break;                                            // short function
-                    case 'A': ds_append_str(&out, file_name ? file_name : ""); break;                               // file
-                    case 'I': ds_append_str(&out, short_filename(file_name ? file_name : "")); break;               // short file
-                    case 'G': ds_append_fmt(&out, "%d", line); break;                                               // line
-                    
-                    case 'T': ds_append_fmt(&out, "%02d:%02d:%02d", st.hour, st.minute, st.second); break;          // time component
-                    case 'H': ds_append_fmt(&out, "%02d", st.hour); break;                                          // time component
-                    case 'M': ds_append_fmt(&out, "%02d", st.minute); break;                                        // time component
-                    case 'S': ds_append_fmt(&out, "%02d", st.second); break;                                        // time component
-                    case 'J': ds_append_fmt(&out, "%03d", st.millisec); break;                                      // time component
-
-                    case 'N': ds_append_fmt(&out, "%04d/%02d/%02d", st.year, st.month, st.day); break;              // date component
-                    case 'Y': ds_append_fmt(&out, "%04d", st.year); break;                                          // date component
-                    case 'O': ds_append_fmt(&out, "%02d", st.month); break;                                         // date component
-                    case 'D': ds_append_fmt(&out, "%02d", st.day); break;                                           // date component
-
-                    default:                                                                                        // unknown %% - treat literally (append '$' and the char)
-                        ds_append_char(&out, '$');
-                        ds_append_char(&out, cmd);
-                        break;
-                }
-            } else {
-                ds_append_char(&out, c);
+        ds_init_arena(&out, &s_format_arena, 1024);
+
+        // literal text between the commands is appended in one piece, directly out of the format
+        str_view rest = sv_from_cstr(fmt), literal;
+        while (sv_split_next(&rest, '$', &literal)) {
+            ds_append_str_n(&out, literal.data, literal.len);
+            if (sv_is_empty(rest)) break;                       // end of format or a trailing '$'
+
+            const char cmd = rest.data[0];
+            rest = sv_skip(rest, 1);
+            switch (cmd) {
+                case 'B': ds_append_str(&out, c_console_color_table[(int)type]); break;                           // color begin
+                case 'E': ds_append_str(&out, c_console_rest); break;                                             // color end
+                case 'C': ds_append_str(&out, formatted_message); break;                                        // message content
+                case 'L': ds_append_str(&out, log_level_to_string(type)); break;                                // severity
+                case 'Z': ds_append_char(&out, '\n'); break;                                                    // newline
+                case 'Q': append_thread_label(&out, thread_id); break;                                          // thread id or label
+                case 'F': ds_append_str(&out, function_name ? function_name : ""); break;                       // function
+                case 'P': ds_append_str(&out, function_name); break;                                            // short function
+                case 'A': ds_append_str(&out, file_name ? file_name : ""); break;                               // file
+                case 'I': ds_append_str(&out, short_filename(file_name ? file_name : "")); break;               // short file
+                case 'G': ds_append_fmt(&out, "%d", line); break;                                               // line
+                
+                case 'T': ds_append_fmt(&out, "%02d:%02d:%02d", st.hour, st.minute, st.second); break;          // time component
+                case 'H': ds_append_fmt(&out, "%02d", st.hour); break;                                          // time component
+                case 'M': ds_append_fmt(&out, "%02d", st.minute); break;                                        // time component
+                case 'S': ds_append_fmt(&out, "%02d", st.second); break;                                        // time component
+                case 'J': ds_append_fmt(&out, "%03d", st.millisec); break;                                      // time component
+
+                case 'N': ds_append_fmt(&out, "%04d/%02d/%02d", st.year, st.month, st.day); break;              // date component
+                case 'Y': ds_append_fmt(&out, "%04d", st.year); break;                                          // date component
+                case 'O': ds_append_fmt(&out, "%02d", st.month); break;                                         // date component
+                case 'D': ds_append_fmt(&out, "%02d", st.day); break;                                           // date component
+
+                default:                                                                                        // unknown %% - treat literally (append '$' and the char)
+                    ds_append_char(&out, '$');
+                    ds_append_char(&out, cmd);
+                    break;
             }
         }
 
@@ -676,7 +641,7 @@ void logger_set_format(const char* new_format) {
         }
 
 
-        const size_t msg_length = strlen(out.data);
+        const size_t msg_length = out.len;
         const size_t remaining_buffer_size = sizeof(s_file_buffer) - strlen(s_file_buffer) -1;
         if (remaining_buffer_size > msg_length)
             strcat(s_file_buffer, out.data);              // save because ensured size
@@ -685,6 +650,7 @@ void logger_set_format(const char* new_format) {
 
 
         ds_free(&out);
+        arena_reset(&s_format_arena);
         pthread_mutex_unlock(&s_general_mutex);
     }
 
@@ -693,36 +659,33 @@ void logger_set_format(const char* new_format) {
 
 void log_message(log_type type, pthread_t thread_id, const char* file_name, const char* function_name, const int line, const char* message, ...) {
 
-    if (strlen(message) == 0)
+    if (message[0] == '\0')
         return;                                             // skip all empty log messages
-    
-    // use fixed size stack buffer (this forces a max log message length, but much faster than dynamic heap allocation)
-    char loc_message[MSG_LEN];
-    memset(&loc_message, 0, sizeof(loc_message));
 
-    // Format the user message first (variable args)
     va_list ap;
     va_start(ap, message);
-    vsnprintf(loc_message, sizeof(loc_message), message, ap);
-    va_end(ap);
 
 #if USE_MULTI_THREADING                                     // give message to buffer and let logger-thread perform processing
 
+    // the user message is formatted directly into the queued message, names are copied without padding the buffers
     log_msg current_msg;
-    memset(&current_msg, 0, sizeof(current_msg));           // Initialize to zero
-
     current_msg.type = type;
     current_msg.thread_id = thread_id;
     current_msg.line = line;
-    // Use strncpy to prevent buffer overflows
-    strncpy(current_msg.file_name, file_name, sizeof(current_msg.file_name) - 1);
-    strncpy(current_msg.function_name, function_name, sizeof(current_msg.function_name) - 1);
-    strncpy(current_msg.message, loc_message, sizeof(current_msg.message) - 1);
+    copy_name(current_msg.file_name, sizeof(current_msg.file_name), file_name);
+    copy_name(current_msg.function_name, sizeof(current_msg.function_name), function_name);
+    vsnprintf(current_msg.message, sizeof(current_msg.message), message, ap);
+    va_end(ap);
 
     buffer_push(&s_log_msg_buffer, &current_msg);
 
 #else                                                       // direct processing in calling thread
 
+    // use fixed size stack buffer (this forces a max log message length, but much faster than dynamic heap allocation)
+    char loc_message[MSG_LEN];
+    vsnprintf(loc_message, sizeof(loc_message), message, ap);
+    va_end(ap);
+
     process_log_message_v(type, thread_id, file_name, function_name, line, loc_message);        // call the formatter that understands s_format_current
 
 #endif
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "util/data_structure/data_types.h"
+
+
+// Locale independent conversion between numbers and text.
+// All parse functions read at most [len] characters (no null terminator needed) and stop at the first character
+// that can not be part of the number. All format functions write into a buffer of at least NUM_BUFFER_SIZE bytes
+// and null terminate it.
+
+
+#define NUM_BUFFER_SIZE     48              // enough for every formatted value incl. sign, exponent and null terminator
+
+
+// ============================================================================================================================================
+// parse
+// ============================================================================================================================================
+
+// @brief Parses an unsigned decimal integer, no sign is accepted.
+// @return Number of characters consumed, 0 if no digits were found or the value overflows [u64]
+size_t num_parse_u64(const char* str, const size_t len, u64* out);
+
+// @brief Parses a signed decimal integer with an optional leading '-' or '+'.
+// @return Number of characters consumed, 0 if no digits were found or the value does not fit into [i64]
+size_t num_parse_i64(const char* str, const size_t len, i64* out);
+
+// @brief Parses a decimal floating point number ("-12.5e-3"), also accepts "inf", "nan" and the YAML forms ".inf", ".nan".
+//        The result is correctly rounded: simple values use the exact fast path, everything else is handed to strtod() in the "C" locale.
+// @return Number of characters consumed, 0 if no number was found
+size_t num_parse_f64(const char* str, const size_t len, f64* out);
+
+// @brief Same as num_parse_f64() but rounds directly to [f32] (parsing as [f64] first could round twice)
+size_t num_parse_f32(const char* str, const size_t len, f32* out);
+
+// @brief Same as num_parse_f64() for [f128], always uses strtold() in the "C" locale
+size_t num_parse_f128(const char* str, const size_t len, f128* out);
+
+
+// ============================================================================================================================================
+// format
+// ============================================================================================================================================
+
+// @return Number of characters written (excluding null terminator)
+size_t num_format_u64(char* buffer, const u64 value);
+size_t num_format_i64(char* buffer, const i64 value);
+
+// @brief Formats a short representation that parses back to exactly [value] (Grisu2). The digits are the shortest possible for
+//        almost all values, Grisu2 can produce one digit more than needed for a small fraction of them.
+//        Uses fixed notation for exponents in [-6, 21) ("0.001", "12.5", "24.0") and scientific notation otherwise ("1.5e+30").
+//        Non finite values are written as ".inf", "-.inf" and ".nan".
+// @return Number of characters written (excluding null terminator)
+size_t num_format_f64(char* buffer, const f64 value);
+
+// @brief Same as num_format_f64() but the digits are searched with the precision of [f32]
+size_t num_format_f32(char* buffer, const f32 value);
+
+// @brief Formats with 21 significant digits which is enough to round-trip the x87 extended format, uses the "C" locale
+size_t num_format_f128(char* buffer, const f128 value);
@@ -1,15 +1,29 @@
 
+#include <ctype.h>
 #include <errno.h>
 #include <string.h>
-#include <regex.h>
 #include <sys/types.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
 #include <unistd.h>
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
 
 #include "util/io/logger.h"
+#include "util/io/number_conversion.h"
+#include "util/io/utf8.h"
 #include "util/util.h"
+#include "util/data_structure/darray.h"
 #include "util/data_structure/data_types.h"
+#include "util/data_structure/str_view.h"
+#include "util/memory/arena.h"
+#include "util/memory/pool.h"
 #include "util/system.h"
 
 #include "util/io/serializer_yaml.h"
@@ -35,6 +49,16 @@ test_bool: 4294919032
 test_long_long: nan
 test_str: Since C doesn't support switching on strings directly, we need to use a different approach.
 
+
+sequences (sy_loop) are saved as a list of mappings one level below the loop header:
+
+general_data:
+  visual_novels:
+    - name: Eternal Sakura
+      chapters_total: 24
+    - name: Cyber Nexus Reborn
+      chapters_total: 48
+
 */
 
 
@@ -42,16 +66,13 @@ test_str: Since C doesn't support switching on strings directly, we need to use
 // helper functions
 // ============================================================================================================================================
 
-#define STR_LINE_LEN    32000               // !!! longest possible length for a line in YAML file !!!
-
-
-// will get a char array like his: [char line[STR_LINE_LEN]]
+// [line] has to end with a character that is not indentation ('\n' or the null terminator of the content)
 u32 get_indentation(const char *line) {
 
     if (!line) return 0;
     u32 count = 0;
     u32 pointer = 0;
-    
+
     while ((line[pointer] == ' ' && line[pointer +1] == ' ') || line[count] == '\t') {
 
         pointer += (line[count] == '\t') ? 1 : 2 ;          // shift pointer by 2 if spaces
@@ -61,478 +82,1266 @@ u32 get_indentation(const char *line) {
     return count;
 }
 
-// will get a char array like his: [char line[STR_LINE_LEN]]
-u32 get_indentation_reverse(const char *line) {
-
-    if (!line) return 0;
-    i32 count = -1;
-    i32 pointer = -1;
-    
-    while ((line[pointer] == ' ' && line[pointer -1] == ' ') || line[count] == '\t') {
-
-        pointer -= (line[count] == '\t') ? 1 : 2 ;          // shift pointer by 2 if spaces
-        count--;
-    }
-
-    return -(count +1);
-}
-
 //
 const char* skip_indentation(const char* line) {
-    
+
     if (!line) return NULL;
 
     size_t i = 0;
     while (line[i] == ' ' || line[i] == '\t')
         i++;
-    
+
     return line + i;  // Return pointer past indentation
 }
 
+// appends [indentation] levels (2 spaces each) to [str]
+static void append_indentation(dyn_str* str, const u32 indentation) {
+
+    static const char spaces[] = "                                                                ";
+    size_t remaining = (size_t)indentation * 2;
+    while (remaining > 0) {
+        const size_t chunk = (remaining < sizeof(spaces) -1) ? remaining : sizeof(spaces) -1;
+        ds_append_str_n(str, spaces, chunk);
+        remaining -= chunk;
+    }
+}
+
+// true if the line (without indentation) starts a sequence item: "- <...>" or a lone "-"
+static inline b8 is_sequence_item(const char* content, const size_t len) {
+
+    return len >= 1 && content[0] == '-' && (len == 1 || content[1] == ' ');
+}
+
+// splits a line "<key>: <value>" (without indentation and '\n') at its first ':', both parts point into [line]
+static inline b8 split_entry(const str_view line, str_view* key, str_view* value) {
+
+    const size_t colon = sv_find_char(line, ':', 0);
+    if (colon == SV_NPOS) return false;
+
+    *key = sv_substr(line, 0, colon);
+    *value = sv_trim_left(sv_skip(line, colon +1));
+    return true;
+}
+
+
+// ============================================================================================================================================
+// value parsing/formatting
+// ============================================================================================================================================
+
+// formats [value] according to [type] into [buffer] (at least NUM_BUFFER_SIZE bytes), strings (SY_TYPE_STR) are not handled here as they need no formatting
+// floats use a short representation (Grisu2) that loads back to the identical value
+// @return number of characters written (excluding null terminator), or -1 on failure
+static i32 format_value(char* buffer, const void* value, const sy_type type) {
+
+    switch (type) {
+        case SY_TYPE_I8:    return (i32)num_format_i64(buffer, *(const i8*)value);
+        case SY_TYPE_I16:   return (i32)num_format_i64(buffer, *(const i16*)value);
+        case SY_TYPE_I32:   return (i32)num_format_i64(buffer, *(const i32*)value);
+        case SY_TYPE_I64:   return (i32)num_format_i64(buffer, *(const i64*)value);
+        case SY_TYPE_U8:    return (i32)num_format_u64(buffer, *(const u8*)value);
+        case SY_TYPE_U16:   return (i32)num_format_u64(buffer, *(const u16*)value);
+        case SY_TYPE_U32:   return (i32)num_format_u64(buffer, *(const u32*)value);
+        case SY_TYPE_U64:   return (i32)num_format_u64(buffer, *(const u64*)value);
+        case SY_TYPE_F32:   return (i32)num_format_f32(buffer, *(const f32*)value);
+        case SY_TYPE_F64:   return (i32)num_format_f64(buffer, *(const f64*)value);
+        case SY_TYPE_F128:  return (i32)num_format_f128(buffer, *(const f128*)value);
+        case SY_TYPE_B8:    return (i32)num_format_u64(buffer, *(const b8*)value ? 1 : 0);
+        default:            return -1;
+    }
+}
+
+
+// parses [str] into [value], directly out of the content
+// numeric values are range checked against the destination type, strings are truncated to fit [size]
+// @return true if a valid value was parsed
+static b8 parse_value(const str_view str, void* value, const sy_type type, const size_t size) {
+
+    if (type == SY_TYPE_STR) {                          // truncated at a code point boundary, invalid UTF-8 is repaired
+        if (size == 0) return false;
+        if (!utf8_copy((char*)value, size, str.data, str.len))
+            LOG(Warn, "Replaced invalid UTF-8 in [%s]", (const char*)value)
+        return true;
+    }
+
+    switch (type) {
+        case SY_TYPE_I8:
+        case SY_TYPE_I16:
+        case SY_TYPE_I32:
+        case SY_TYPE_I64: {
+            i64 result = 0;
+            if (!sv_parse_i64(str, &result)) return false;
+            switch (type) {
+                case SY_TYPE_I8:    if (result < INT8_MIN || result > INT8_MAX) return false;       *(i8*)value = (i8)result;   break;
+                case SY_TYPE_I16:   if (result < INT16_MIN || result > INT16_MAX) return false;     *(i16*)value = (i16)result; break;
+                case SY_TYPE_I32:   if (result < INT32_MIN || result > INT32_MAX) return false;     *(i32*)value = (i32)result; break;
+                default:            *(i64*)value = result;                                                                      break;
+            }
+            return true;
+        }
+
+        case SY_TYPE_U8:
+        case SY_TYPE_U16:
+        case SY_TYPE_U32:
+        case SY_TYPE_U64: {
+            u64 result = 0;
+            if (!sv_parse_u64(str, &result)) return false;              // rejects a sign, negative values can not wrap
+            switch (type) {
+                case SY_TYPE_U8:    if (result > UINT8_MAX) return false;       *(u8*)value = (u8)result;   break;
+                case SY_TYPE_U16:   if (result > UINT16_MAX) return false;      *(u16*)value = (u16)result; break;
+                case SY_TYPE_U32:   if (result > UINT32_MAX) return false;      *(u32*)value = (u32)result; break;
+                default:            *(u64*)value = result;                                                  break;
+            }
+            return true;
+        }
+
+        case SY_TYPE_B8: {
+            const str_view word = sv_trim(str);
+            i64 number = 0;
+            if (sv_equal(word, SV_LITERAL("true")))             *(b8*)value = true;
+            else if (sv_equal(word, SV_LITERAL("false")))       *(b8*)value = false;
+            else if (sv_parse_i64(word, &number))               *(b8*)value = (number != 0);
+            else                                                return false;
+            return true;
+        }
+
+        case SY_TYPE_F32:   return sv_parse_f32(str, (f32*)value);
+        case SY_TYPE_F64:   return sv_parse_f64(str, (f64*)value);
+        case SY_TYPE_F128:  return sv_parse_f128(str, (f128*)value);
+        default:            return false;
+    }
+}
+
+
+// ============================================================================================================================================
+// documents
+// ============================================================================================================================================
+
+// Every file is represented by one document that is shared by all serializers of that file. Its content is held as an
+// immutable version made of reference counted top level sections (a line without indentation and everything below it).
+// Readers take a reference to the current version and parse it without holding a lock, so a long save never blocks them.
+// Saves and reloads are serialized per document: the writer streams the new content into the file (see "saving"), builds
+// the next version (unchanged sections are shared with the previous one) and publishes it with an atomic pointer swap. A version is freed when its last reader releases it.
+
+#define DOCUMENT_CACHE_COUNT        4               // documents without serializers that stay loaded
+
+typedef struct {
+    atomic_uint         ref_count;
+    size_t              len;
+    char                data[];                     // null terminated
+} sy_section;
+
+typedef struct sy_version {
+    atomic_uint         ref_count;
+    u64                 number;
+    size_t              size;                       // of the complete content
+    u32                 section_count;
+    sy_section**        sections;
+    dev_t               device;                     // state of the file after this version was read or written
+    ino_t               inode;
+    off_t               file_size;
+    struct timespec     modified;
+} sy_version;
+
+typedef struct sy_document {
+    char                    path[PATH_MAX];
+    _Atomic(sy_version*)    current;
+    atomic_uint             acquiring;              // readers between loading [current] and taking their reference
+    atomic_bool             writing;                // a save is changing the file, [current] stays valid until it publishes
+    atomic_bool             stale;                  // a write failed, the content of the file is unknown
+    atomic_ulong            file_reads;             // versions read from the file instead of written by this process
+    pthread_mutex_t         write_mutex;            // one writer (save or reload) at a time
+    u32                     users;                  // attached serializers, protected by [s_documents_mutex]
+    struct sy_document*     next;
+} sy_document;
+
+static sy_document*         s_documents = NULL;     // most recently used first
+static pthread_mutex_t      s_documents_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pool_allocator       s_document_pool = POOL_INITIALIZER;
+
+
+static sy_section* section_create(const char* data, const size_t len) {
+
+    sy_section* section = malloc(sizeof(sy_section) + len +1);
+    if (!section) return NULL;
+
+    atomic_init(&section->ref_count, 1);
+    section->len = len;
+    memcpy(section->data, data, len);
+    section->data[len] = '\0';
+    return section;
+}
+
+
+static inline void section_release(sy_section* section) {
+
+    if (section && atomic_fetch_sub(&section->ref_count, 1) == 1)
+        free(section);
+}
+
+
+static void version_release(sy_version* version) {
+
+    if (!version || atomic_fetch_sub(&version->ref_count, 1) != 1)
+        return;
+
+    for (u32 x = 0; x < version->section_count; x++)
+        section_release(version->sections[x]);
+    free(version->sections);
+    free(version);
+}
+
+
+// a top level section starts at every line that begins with a character other than whitespace
+static inline b8 is_section_start(const char* data, const size_t len, const size_t pos) {
+
+    return pos < len && data[pos] != ' ' && data[pos] != '\t' && data[pos] != '\r' && data[pos] != '\n';
+}
+
+
+// searches [base] for a section with exactly the content [data], starting at [*hint]
+static sy_section* find_equal_section(const sy_version* base, const char* data, const size_t len, u32* hint) {
+
+    if (!base) return NULL;
+
+    for (u32 x = 0; x < base->section_count; x++) {
+        const u32 index = (*hint + x) % base->section_count;
+        sy_section* section = base->sections[index];
+        if (section->len == len && memcmp(section->data, data, len) == 0) {
+            *hint = index +1;
+            return section;
+        }
+    }
+    return NULL;
+}
+
+
+// splits [data] into top level sections, sections with the same content as one in [base] are shared instead of copied
+static sy_version* version_create(const char* data, const size_t len, const sy_version* base) {
+
+    sy_version* version = calloc(1, sizeof(sy_version));
+    if (!version) return NULL;
+
+    u32 count = (len > 0) ? 1 : 0;
+    for (const char* pos = data; (pos = memchr(pos, '\n', len - (size_t)(pos - data))) != NULL; pos++)
+        if (is_section_start(data, len, (size_t)(pos - data) +1))
+            count++;
+
+    version->sections = (count > 0) ? malloc(sizeof(sy_section*) * count) : NULL;
+    if (count > 0 && !version->sections) {
+        free(version);
+        return NULL;
+    }
+
+    u32 hint = 0;
+    size_t start = 0;
+    while (start < len) {
+
+        size_t end = start;                                             // end of the section: start of the next one or end of data
+        do {
+            const char* newline = memchr(data + end, '\n', len - end);
+            end = newline ? (size_t)(newline - data) +1 : len;
+        } while (end < len && !is_section_start(data, len, end));
+
+        sy_section* section = find_equal_section(base, data + start, end - start, &hint);
+        if (section)
+            atomic_fetch_add(&section->ref_count, 1);
+        else if (!(section = section_create(data + start, end - start))) {
+            version_release(version);
+            return NULL;
+        }
+
+        version->sections[version->section_count++] = section;
+        start = end;
+    }
+
+    atomic_init(&version->ref_count, 1);
+    version->number = base ? base->number +1 : 1;
+    version->size = len;
+    return version;
+}
+
+
+static void version_set_file_state(sy_version* version, const struct stat* file_stat) {
+
+    version->device = file_stat->st_dev;
+    version->inode = file_stat->st_ino;
+    version->file_size = file_stat->st_size;
+    version->modified = file_stat->st_mtim;
+}
+
+
+static b8 version_matches_file(const sy_version* version, const struct stat* file_stat) {
+
+    return version->device == file_stat->st_dev && version->inode == file_stat->st_ino && version->file_size == file_stat->st_size
+        && version->modified.tv_sec == file_stat->st_mtim.tv_sec && version->modified.tv_nsec == file_stat->st_mtim.tv_nsec;
+}
+
+
+// appends the content of [version] in [from, to) to [content]
+static void version_append_range(const sy_version* version, size_t from, const size_t to, dyn_str* content) {
+
+    size_t offset = 0;
+    for (u32 x = 0; x < version->section_count && from < to; x++) {
+
+        const sy_section* section = version->sections[x];
+        if (from < offset + section->len) {
+            const size_t end = (to < offset + section->len) ? to : offset + section->len;
+            ds_append_str_n(content, section->data + (from - offset), end - from);
+            from = end;
+        }
+        offset += section->len;
+    }
+}
+
+
+// calls [callback] for every line of [version], like ds_iterate_lines() for its complete content (a line never continues in the next section)
+static void version_iterate_lines(const sy_version* version, b8 (*callback)(const char* line, size_t len, void* user_data), void* user_data) {
+
+    for (u32 x = 0; x < version->section_count; x++) {
+
+        const char* start = version->sections[x]->data;
+        const char* end = start + version->sections[x]->len;
+        while (start < end) {
+            const char* newline = memchr(start, '\n', (size_t)(end - start));
+            if (!newline) newline = end;
+            if (!callback(start, (size_t)(newline - start), user_data))
+                return;
+            start = newline +1;
+        }
+    }
+}
+
+
+// @brief takes a reference to the current version without any lock, NULL if the document was never loaded
+static sy_version* document_acquire(sy_document* document) {
+
+    atomic_fetch_add(&document->acquiring, 1);
+    sy_version* version = atomic_load(&document->current);
+    if (version)
+        atomic_fetch_add(&version->ref_count, 1);
+    atomic_fetch_sub(&document->acquiring, 1);
+    return version;
+}
+
+
+// @brief makes [next] the current version and drops the reference of the document on the previous one, [write_mutex] has to be held
+static void document_publish(sy_document* document, sy_version* next) {
+
+    sy_version* previous = atomic_exchange(&document->current, next);
+    while (atomic_load(&document->acquiring) != 0)                  // a reader could have loaded [previous] but not referenced it yet
+        sched_yield();
+    version_release(previous);
+}
+
+
+// @brief returns a reference to the current version, the file is read again if it was changed outside of this process. [write_mutex] has to be held
+static sy_version* document_reload_locked(sy_document* document, FILE* fp) {
+
+    sy_version* current = document_acquire(document);
+    struct stat file_stat;
+    const b8 has_stat = (fstat(fileno(fp), &file_stat) == 0);
+    if (current && has_stat && !atomic_load(&document->stale) && version_matches_file(current, &file_stat))
+        return current;
+
+    dyn_str content = {0};
+    const i32 result = ds_from_file(&content, fp);
+    VALIDATE(result == AT_SUCCESS, return current, "", "Failed to read [%s]: %s", document->path, error_to_str(result))
+
+    sy_version* next = version_create(content.data, content.len, current);
+    ds_free(&content);
+    version_release(current);
+    VALIDATE(next, return NULL, "", "Failed to allocate a version of [%s]", document->path)
+
+    if (has_stat)
+        version_set_file_state(next, &file_stat);
+    atomic_fetch_add(&document->file_reads, 1);
+    LOG(Trace, "Loaded version [%lu] of [%s] with [%u] sections", next->number, document->path, next->section_count)
+
+    atomic_store(&document->stale, false);
+    atomic_fetch_add(&next->ref_count, 1);                          // reference of the caller
+    document_publish(document, next);
+    return next;
+}
+
+
+// @brief returns a reference to the version readers should use
+static sy_version* document_get_version(sy_document* document, FILE* fp) {
+
+    sy_version* version = document_acquire(document);
+    if (version && atomic_load(&document->writing))                 // the file is being saved by this process, [version] is its last complete content
+        return version;
+
+    struct stat file_stat;
+    if (version && !atomic_load(&document->stale) && fstat(fileno(fp), &file_stat) == 0 && version_matches_file(version, &file_stat))
+        return version;
+    version_release(version);
+
+    pthread_mutex_lock(&document->write_mutex);
+    version = document_reload_locked(document, fp);
+    pthread_mutex_unlock(&document->write_mutex);
+    return version;
+}
+
+
+static void document_free(sy_document* document) {
+
+    version_release(atomic_load(&document->current));
+    pthread_mutex_destroy(&document->write_mutex);
+    pool_dealloc(&s_document_pool, document, sizeof(sy_document));
+}
+
+
+// @brief returns the document of [path], it stays valid until document_detach()
+static sy_document* document_attach(const char* path) {
+
+    pthread_mutex_lock(&s_documents_mutex);
+
+    sy_document** link = &s_documents;
+    while (*link && strcmp((*link)->path, path) != 0)
+        link = &(*link)->next;
+
+    sy_document* document = *link;
+    if (document) {
+        *link = document->next;                                     // unlink, moved to the front below
+
+    } else if ((document = pool_alloc(&s_document_pool, sizeof(sy_document)))) {
+        memset(document, 0, sizeof(sy_document));
+        snprintf(document->path, sizeof(document->path), "%s", path);
+        atomic_init(&document->current, NULL);
+        atomic_init(&document->acquiring, 0);
+        atomic_init(&document->writing, false);
+        atomic_init(&document->stale, false);
+        atomic_init(&document->file_reads, 0);
+        pthread_mutex_init(&document->write_mutex, NULL);
+    }
+
+    if (document) {
+        document->users++;
+        document->next = s_documents;
+        s_documents = document;
+    }
+
+    pthread_mutex_unlock(&s_documents_mutex);
+    return document;
+}
+
+
+// @brief only the DOCUMENT_CACHE_COUNT most recently used documents without serializers stay loaded
+static void document_detach(sy_document* document) {
+
+    pthread_mutex_lock(&s_documents_mutex);
+    document->users--;
+
+    u32 unused = 0;
+    sy_document** link = &s_documents;
+    while (*link) {
+        sy_document* loc_document = *link;
+        if (loc_document->users == 0 && ++unused > DOCUMENT_CACHE_COUNT) {
+            *link = loc_document->next;
+            document_free(loc_document);
+            continue;
+        }
+        link = &loc_document->next;
+    }
+
+    pthread_mutex_unlock(&s_documents_mutex);
+}
+
+
+// version the reading functions of [serializer] use: loading keeps the version from sy_init() for a consistent view
+// of all sections, saving always follows the latest version
+static const sy_version* serializer_version(SY* serializer) {
+
+    if (serializer->option == SERIALIZER_OPTION_SAVE || !serializer->version) {
+        version_release(serializer->version);
+        serializer->version = document_get_version(serializer->document, serializer->fp);
+    }
+    return serializer->version;
+}
+
+
+// reads the lines of a version like fgets() would read the file
+typedef struct {
+    const sy_version*   version;
+    u32                 section;
+    size_t              pos;
+} line_cursor;
+
+
+// skips exhausted sections
+// @return false if the end of the content is reached
+static inline b8 cursor_normalize(line_cursor* cursor) {
+
+    while (cursor->section < cursor->version->section_count && cursor->pos >= cursor->version->sections[cursor->section]->len) {
+        cursor->section++;
+        cursor->pos = 0;
+    }
+    return cursor->section < cursor->version->section_count;
+}
+
+
+// points [line] at the next line including its '\n', inside the version (valid as long as the version is held)
+static b8 cursor_next_line(line_cursor* cursor, str_view* line) {
+
+    if (!cursor_normalize(cursor))
+        return false;
+
+    const sy_section* section = cursor->version->sections[cursor->section];
+    const str_view rest = sv_make(section->data + cursor->pos, section->len - cursor->pos);
+    const size_t newline = sv_find_char(rest, '\n', 0);
+    *line = sv_substr(rest, 0, (newline == SV_NPOS) ? rest.len : newline +1);
+    cursor->pos += line->len;
+    return true;
+}
+
 
 // ============================================================================================================================================
 // section handling
 // ============================================================================================================================================
 
+// moves [cursor] to the line after the header of the current section while respecting the hierarchy in [serializer->section_headers]
+// @return true if the complete header hierarchy was found
+static b8 seek_section(SY* serializer, line_cursor* cursor) {
+
+    memset(cursor, 0, sizeof(*cursor));
+    cursor->version = serializer_version(serializer);
+    if (!cursor->version)
+        return false;
+
+    str_view line;
+    const size_t number_of_headers = sy_header_stack_size(&serializer->section_headers);
+    LOG(Trace, "number_of_headers %zu", number_of_headers)
+    for (size_t x = 0; x < number_of_headers; x++) {
+
+        const char* current_header = sy_header_stack_at(&serializer->section_headers, x)->name;
+        LOG(Trace, "searching for [%s]", current_header)
+
+        b8 found_header = false;
+        while (cursor_next_line(cursor, &line)) {
+
+            const u32 indent = get_indentation(line.data);
+            if (indent < x)                                 // left header hierarchy
+                return false;
+
+            //  current header                                          correct indentation (going deeper in)
+            if (sv_find(line, sv_from_cstr(current_header), 0) != SV_NPOS && indent == x) {
+                found_header = true;
+                break;      // exit search loop -> found header        continue FOR to search for next header
+            }
+        }
+
+        if (!found_header)
+            return false;
+    }
+
+    return true;
+}
+
+
+// true if [content] (a line without indentation) looks like "<key>: <value>", the key is made of [A-Za-z0-9_-] and the value is not empty
+static b8 is_key_value_line(const str_view content) {
+
+    size_t pos = 0;
+    while (pos < content.len && (isalnum((unsigned char)content.data[pos]) || content.data[pos] == '_' || content.data[pos] == '-'))
+        pos++;
+    if (pos == 0 || pos >= content.len || content.data[pos] != ':')
+        return false;
+
+    for (pos++; pos < content.len; pos++)
+        if (content.data[pos] != ' ' && content.data[pos] != '\t')
+            return content.data[pos] != '\n';
+    return false;
+}
+
+
 // get all lines that match the section and indentation and save them in [serializer->section_content]
 // lines inside [serializer->section_content] are "\n" terminated
 b8 get_content_of_section(SY* serializer) {
 
-    // reset string
-    ds_free(&serializer->section_content);
-    ds_init(&serializer->section_content);
-    rewind(serializer->fp);
+    ds_clear(&serializer->section_content);             // keep the buffer for the next section
+
+    line_cursor cursor;
+    VALIDATE(seek_section(serializer, &cursor), return false, "", "could not find section ")
+
+    // pars all lines that come after, directly out of the version
+    str_view line;
+    while (cursor_next_line(&cursor, &line)) {
+
+        const u32 indent = get_indentation(line.data);
+        if (indent < serializer->current_indentation) break;         // stop when section ends
+        if (indent > serializer->current_indentation) continue;      // skip any potential subsection
+
+        // check if line looks like this:      <leading indentation><string>: <string>
+        const str_view content = sv_trim_left(line);
+        if (is_key_value_line(content))
+            ds_append_str_n(&serializer->section_content, content.data, content.len);
+    }
+
+    LOG(Trace, "current_header [%s] serializer->section_content: \n%s", sy_header_stack_back(&serializer->section_headers)->name, serializer->section_content.data)
+
+    return true;
+}
+
+
+// finds all lines of the current section (including deeper indented lines), used for sequences
+// [raw] points into the version of the serializer and stays valid until the serializer releases it
+static b8 get_raw_content_of_section(SY* serializer, const char** raw, size_t* raw_len) {
+
+    *raw = "";
+    *raw_len = 0;
+
+    line_cursor cursor;
+    if (!seek_section(serializer, &cursor) || !cursor_normalize(&cursor))
+        return false;
+
+    // a section never continues in the next top level section
+    const sy_section* section = cursor.version->sections[cursor.section];
+    const char* start = section->data + cursor.pos;
+    const char* end = section->data + section->len;
+    const char* pos = start;
+    while (pos < end && get_indentation(pos) >= serializer->current_indentation) {          // stop when section ends
+        const char* newline = memchr(pos, '\n', (size_t)(end - pos));
+        pos = newline ? newline +1 : end;
+    }
+
+    *raw = start;
+    *raw_len = (size_t)(pos - start);
+    return true;
+}
+
+
+typedef struct {
+    SY*                 serializer;
+    dyn_str*            file_content;           // content edited by add_or_update_entry()
+    size_t              offset;                 // offset of the next line passed to find_section_start_and_end_callback()
+    size_t              start;                  // offset of the '\n' terminating the last header line
+    size_t              end;                    // offset of the first character that is not part of the section anymore
+    size_t              headers_index;
+    b8                  found_last_section;
+    b8                  found_end;
+} serializer_section_data;
+
+
+b8 find_section_start_and_end_callback(const char* line, size_t len, void* user_data) {
+
+    serializer_section_data* sec_data = (serializer_section_data*)user_data;
+    const size_t line_offset = sec_data->offset;
+    sec_data->offset += len +1;
+
+    const char* current_header = sy_header_stack_at(&sec_data->serializer->section_headers, sec_data->headers_index)->name;
+
+    const u32 indent = get_indentation(line);
+    const b8 last_section = (sy_header_stack_size(&sec_data->serializer->section_headers) -1) == sec_data->headers_index;
+    if (!sec_data->found_last_section) {                // Find start first: currect section (name and indentation)
+
+        if (indent < sec_data->headers_index) {         // exited header hierarchy
+            return false;                               // hierarchy violated -> still needs to search for subsections
+        }
+
+        //  check indentation (remove 1 for header)                     correct title
+        if (indent == (sec_data->headers_index) && str_search_range(line, current_header, len)) {
+            sec_data->start = line_offset + len;        // update start to ref last found section title
+
+            if (last_section)
+                sec_data->found_last_section = true;    // found las header start -> should start searching for the end
+            else
+                sec_data->headers_index++;              // move on to next header
+        }
+
+        return true;                                    // always return true because ds_iterate_lines still need to continue until end if found
+    }
+
+    // Find end of section
+    if (indent < sec_data->serializer->current_indentation || (line[len -1] == ':' && indent == (sec_data->serializer->current_indentation -1))) {
+        sec_data->end = line_offset -1;
+        sec_data->found_end = true;
+        return false;
+    }
+
+    return true;
+}
+
+
+// find the section described by [serializer->section_headers] in [version]
+// afterwards [sec_data->start, sec_data->end) is the range below the last header that belongs to the section. Headers that do not exist
+// yet are appended to [missing_headers], they belong at the end of the content ([start] and [end] are equal to its size in that case)
+static void locate_section(SY* serializer, const sy_version* version, serializer_section_data* sec_data, dyn_str* missing_headers) {
+
+    memset(sec_data, 0, sizeof(*sec_data));
+    sec_data->serializer = serializer;
+    version_iterate_lines(version, find_section_start_and_end_callback, (void*)sec_data);                 // find section start & end in file content
+
+    if (!sec_data->found_last_section) {
+
+        for (size_t x = sec_data->headers_index; x < sy_header_stack_size(&serializer->section_headers); x++) {   // add remaining header to file
+
+            const char* current_header = sy_header_stack_at(&serializer->section_headers, x)->name;
+
+            const int indent_spaces = (x) * 2;                                                              // Calculate the number of spaces needed for indentation
+            char indent_str[64] = {0};                                                                      // Create a string of spaces for indentation
+            if (indent_spaces > 0 && indent_spaces < (int)sizeof(indent_str))
+                memset(indent_str, ' ', indent_spaces);
+
+            char header_str[STR_SEC_LEN *2] = {0};
+            snprintf(header_str, sizeof(header_str), "\n%s%s:", indent_str, current_header);
+            ds_append_str(missing_headers, header_str);                                                     // Add the section header with proper indentation
+        }
+        sec_data->start = sec_data->end = version->size;
+        sec_data->found_last_section = true;
+    }
+
+    else if (!sec_data->found_end)          // start found but not end -> assuming section is at end file    ([start] is always found if [found_last_section] id true)
+        sec_data->end = version->size;
+}
+
+
+// searches [file_content] in range [start, end) for a line "<indentation><key>: <value>" with exactly [indentation]
+// @return offset of the first value character or -1 if not found, [value_len] is set to the length of the value
+static ssize_t find_key_in_range(const dyn_str* file_content, const size_t start, const size_t end, const char* key, const size_t key_len, const u32 indentation, size_t* value_len) {
+
+    const char* data = file_content->data;
+    size_t pos = start;
+    while (pos < end) {
+
+        const char* line = data + pos;
+        const char* line_end = memchr(line, '\n', end - pos);
+        if (!line_end) line_end = data + end;
+
+        const char* content = skip_indentation(line);
+        if (get_indentation(line) == indentation && (size_t)(line_end - content) > key_len && memcmp(content, key, key_len) == 0 && content[key_len] == ':') {
+
+            const char* value = content + key_len +1;
+            while (value < line_end && (*value == ' ' || *value == '\t'))
+                value++;
+
+            *value_len = (size_t)(line_end - value);
+            return (ssize_t)(value - data);
+        }
+        pos = (size_t)(line_end - data) +1;
+    }
+    return -1;
+}
+
+
+// new keys are collected in [appended] and added to the end of the section at once
+typedef struct {
+    serializer_section_data     section;
+    dyn_str                     appended;
+} serializer_entry_data;
+
+
+b8 add_or_update_entry(const char* line, size_t len, void* user_data) {
+
+    serializer_entry_data* entry_data = (serializer_entry_data*)user_data;
+    serializer_section_data* sec_data = &entry_data->section;
+    const u32 indentation = sec_data->serializer->current_indentation;
+
+    str_view key, value;
+    if (!split_entry(sv_make(line, len), &key, &value)) return true;
+
+    size_t file_value_len = 0;
+    const ssize_t file_value_pos = find_key_in_range(sec_data->file_content, sec_data->start, sec_data->end, key.data, key.len, indentation, &file_value_len);
+    if (file_value_pos < 0) {               // Key not found, append to end of section
+
+        ds_append_char(&entry_data->appended, '\n');
+        append_indentation(&entry_data->appended, indentation);
+        ds_append_str_n(&entry_data->appended, line, len);
+        return true;
+    }
+
+    // Key found, update the value
+    arena* scratch = arena_scratch();
+    const arena_mark mark = arena_get_mark(scratch);
+    dyn_str value_str = {0};
+    ds_init_arena(&value_str, scratch, value.len +1);
+    ds_append_str_n(&value_str, value.data, value.len);
+
+    const i32 result = ds_replace_range(sec_data->file_content, (size_t)file_value_pos, file_value_len, value_str.data);
+    if (result != AT_SUCCESS)
+        LOG(Error, "ds_replace_range failed: %d", result)
+    else
+        sec_data->end = sec_data->end + value.len - file_value_len;
+
+    ds_free(&value_str);
+    arena_reset_to_mark(scratch, mark);
+    return true;
+}
+
+
+// ============================================================================================================================================
+// saving
+// ============================================================================================================================================
+
+// A save streams the new content through a fixed size buffer into the file, starting at the top level section that contains the
+// changed section. Every full buffer is compared with the previous version and only the bytes that differ are written, so values of
+// the same width are patched in place and large sequences are never built in memory. The only content kept is the next version
+// itself: its sections are split off while they are emitted (unchanged ones are shared with the previous version).
+
+#define EMIT_BUFFER_SIZE            (64 * 1024)
+
+DARRAY_DEFINE(section_array, sy_section*)
+
+typedef struct {
+    sy_document*        document;
+    sy_version*         base;                   // version the save is based on
+    int                 fd;
+    i32                 error;                  // first error, all following writes are ignored
+    char*               buffer;                 // [EMIT_BUFFER_SIZE] bytes
+    size_t              len;                    // bytes in [buffer]
+    size_t              offset;                 // file offset of [buffer]
+    size_t              written;                // bytes that differed from [base]
+    line_cursor         compare;                // content of [base] at [offset]
+    section_array       sections;               // of the next version
+    sy_section*         section;                // top level section that is currently emitted
+    size_t              section_cap;
+    u32                 hint;                   // for find_equal_section()
+    b8                  line_start;             // the next byte starts a line
+    b8                  file_changed;           // the file was read again after sy_init(), [base] can contain changes the caller does not know
+} sy_emitter;
+
+
+static i32 pwrite_all(const int fd, const char* data, size_t len, off_t offset) {
+
+    while (len > 0) {
+        const ssize_t written = pwrite(fd, data, len, offset);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return AT_IO_ERROR;
+        }
+        data += written;
+        len -= (size_t)written;
+        offset += written;
+    }
+    return AT_SUCCESS;
+}
+
+
+// writes the part of [buffer] that differs from [base]
+static void emitter_flush(sy_emitter* e) {
+
+    size_t first = e->len;                      // differing range [first, last)
+    size_t last = 0;
+    size_t pos = 0;
+    while (pos < e->len && cursor_normalize(&e->compare)) {
+
+        const sy_section* section = e->compare.version->sections[e->compare.section];
+        const size_t available = section->len - e->compare.pos;
+        const size_t count = (available < e->len - pos) ? available : e->len - pos;
+        const char* old = section->data + e->compare.pos;
+        const char* new = e->buffer + pos;
+        if (memcmp(old, new, count) != 0) {
+
+            size_t y = 0;
+            while (old[y] == new[y]) y++;
+            if (pos + y < first) first = pos + y;
+
+            y = count;
+            while (old[y -1] == new[y -1]) y--;
+            last = pos + y;
+        }
+        pos += count;
+        e->compare.pos += count;
+    }
+
+    if (pos < e->len) {                         // behind the end of [base]
+        if (pos < first) first = pos;
+        last = e->len;
+    }
+
+    if (first < last && e->error == AT_SUCCESS) {
+        e->error = pwrite_all(e->fd, e->buffer + first, last - first, (off_t)(e->offset + first));
+        e->written += last - first;
+    }
+    e->offset += e->len;
+    e->len = 0;
+}
+
+
+// adds [section] of [base] to the next version
+static void emitter_share_section(sy_emitter* e, sy_section* section) {
+
+    atomic_fetch_add(&section->ref_count, 1);
+    if (section_array_push_back(&e->sections, &section) != AT_SUCCESS) {
+        section_release(section);
+        e->error = AT_MEMORY_ERROR;
+    }
+}
+
+
+// closes the top level section that is currently emitted, it is shared if [base] has a section with the same content
+static void emitter_finish_section(sy_emitter* e) {
+
+    if (!e->section) return;
+
+    sy_section* section = find_equal_section(e->base, e->section->data, e->section->len, &e->hint);
+    if (section) {
+        free(e->section);
+        e->section = NULL;
+        e->section_cap = 0;
+        emitter_share_section(e, section);
+        return;
+    }
+
+    e->section->data[e->section->len] = '\0';
+    sy_section* shrunk = realloc(e->section, sizeof(sy_section) + e->section->len +1);
+    section = shrunk ? shrunk : e->section;
+    e->section = NULL;
+    e->section_cap = 0;
+    if (section_array_push_back(&e->sections, &section) != AT_SUCCESS) {
+        section_release(section);
+        e->error = AT_MEMORY_ERROR;
+    }
+}
+
 
-    // search for header while respecting the hierarchy in [serializer->section_headers]
-    char line[STR_LINE_LEN] = {0};
-    b8 found_section = true;                                // if hierarchy is not violated this will remain true
-    const size_t number_of_headers = stack_size(&serializer->section_headers);
-    LOG(Trace, "number_of_headers %zu", number_of_headers)
-    for (size_t x = 0; x < number_of_headers; x++) {
-        
-        char current_header[STR_SEC_LEN] = {0};
-        stack_peek_at(&serializer->section_headers, x, &current_header);
-        LOG(Trace, "searching for [%s]", current_header)
+// splits the emitted content into the top level sections of the next version
+static void emitter_capture(sy_emitter* e, const char* data, size_t len) {
 
-        while (fgets(line, sizeof(line), serializer->fp)) {
+    while (len > 0 && e->error == AT_SUCCESS) {
 
-            LOG(Trace, "current line [%s]", line)
-            const u32 indent = get_indentation(line);
-            if (indent < x) {                               // left header hierarchy
-                found_section = false;                      // hierarchy violated -> still needs to search for subsections
-                goto break_search;
-            }
+        if (e->line_start && is_section_start(data, len, 0))
+            emitter_finish_section(e);
 
-            //  current header                  correct indentation (going deeper in)
-            if (strstr(line, current_header) && indent == x)
-                break;      // exit search loop -> found header        continue FOR to search for next header
-        }
-    }
-    break_search:
-    VALIDATE(found_section, return false, "", "could not find section ")
+        const char* newline = memchr(data, '\n', len);
+        const size_t count = newline ? (size_t)(newline - data) +1 : len;
+        e->line_start = (newline != NULL);
 
-    // Prepare regex to match key-value lines
-    static const char *pattern = "^[ \t]*[A-Za-z0-9_-]+:[ \t]*[^ \t\n]+.*$";
-    regex_t regex;
-    VALIDATE(!regcomp(&regex, pattern, REG_EXTENDED), return false, "", "Regex compilation failed")
-    
-    // pars all lines that come after
-    while (fgets(line, sizeof(line), serializer->fp)) {
+        const size_t section_len = e->section ? e->section->len : 0;
+        if (section_len + count > e->section_cap) {
 
-        const u32 indent = get_indentation(line);
-        if (indent < serializer->current_indentation) break;         // stop when section ends
-        if (indent > serializer->current_indentation) continue;      // skip any potential subsection
+            size_t cap = (e->section_cap > 0) ? e->section_cap *2 : 256;
+            while (cap < section_len + count)
+                cap *= 2;
+            sy_section* section = realloc(e->section, sizeof(sy_section) + cap +1);
+            if (!section) {
+                e->error = AT_MEMORY_ERROR;
+                return;
+            }
+            if (!e->section) {
+                atomic_init(&section->ref_count, 1);
+                section->len = 0;
+            }
+            e->section = section;
+            e->section_cap = cap;
+        }
 
-        // check if line looks like this using regex:      <leading indentation><string>: <string>
-        if (regexec(&regex, line, 0, NULL, 0) == 0)
-            ds_append_str(&serializer->section_content, skip_indentation(line));
+        memcpy(e->section->data + e->section->len, data, count);
+        e->section->len += count;
+        data += count;
+        len -= count;
     }
-    regfree(&regex); // Don't forget to free the regex
-
-    char current_header[STR_SEC_LEN] = {0};
-    stack_peek(&serializer->section_headers, &current_header);
-    LOG(Info, "current_header [%s] serializer->section_content: \n%s", current_header, serializer->section_content.data)
-
-    return true;
 }
 
 
-typedef struct {
-    SY*    serializer;
-    const char*         start;
-    const char*         end;
-    dyn_str*            file_content;
-    size_t              headers_index;
-    b8                  found_last_section;
-} serializer_section_data;
+static void emitter_write(sy_emitter* e, const char* data, size_t len) {
 
+    if (e->error != AT_SUCCESS) return;
 
-b8 find_section_start_and_end_callback(const char* line, size_t len, void* user_data) {
+    emitter_capture(e, data, len);
+    while (len > 0) {
+        const size_t count = (len < EMIT_BUFFER_SIZE - e->len) ? len : EMIT_BUFFER_SIZE - e->len;
+        memcpy(e->buffer + e->len, data, count);
+        e->len += count;
+        data += count;
+        len -= count;
+        if (e->len == EMIT_BUFFER_SIZE)
+            emitter_flush(e);
+    }
+}
 
-    serializer_section_data* sec_data = (serializer_section_data*)user_data;
 
-    char current_header[STR_SEC_LEN] = {0};
-    stack_peek_at(&sec_data->serializer->section_headers, sec_data->headers_index, &current_header);
-    // LOG(Trace, "searching for [%s] of [%s] in [%zu][%.*s]", (sec_data->found_last_section) ? "END" : "START", current_header, len, len, line)
+// emits the content of [base] in [from, to)
+static void emitter_write_base(sy_emitter* e, size_t from, const size_t to) {
 
-    const u32 indent = get_indentation(line);
-    const b8 last_section = (stack_size(&sec_data->serializer->section_headers) -1) == sec_data->headers_index;
-    if (!sec_data->found_last_section) {                // Find start first: currect section (name and indentation)
+    size_t offset = 0;
+    for (u32 x = 0; x < e->base->section_count && from < to; x++) {
 
-        if (indent < sec_data->headers_index) {         // exited header hierarchy
-            return false;                               // hierarchy violated -> still needs to search for subsections
+        const sy_section* section = e->base->sections[x];
+        if (from < offset + section->len) {
+            const size_t end = (to < offset + section->len) ? to : offset + section->len;
+            emitter_write(e, section->data + (from - offset), end - from);
+            from = end;
         }
+        offset += section->len;
+    }
+}
 
-        //  check indentation (remove 1 for header)                     correct title
-        if (indent == (sec_data->headers_index) && str_search_range(line, current_header, len)) {
-            sec_data->start = line + len;               // update start pointer to ref last found section title ()
-            
-            if (last_section)
-                sec_data->found_last_section = true;    // found las header start -> should start searching for the end
-            else
-                sec_data->headers_index++;              // move on to next header
-        }
-        
-        return true;                                    // always return true because ds_iterate_lines still need to continue until end if found
-    } 
 
-    // Find end of section
-    if (indent < sec_data->serializer->current_indentation || (line[len -1] == ':' && indent == (sec_data->serializer->current_indentation -1))) {
-        sec_data->end = line -1;
+// locks the document, finds the current section and emits everything in front of its body, missing headers are added
+// afterwards the caller emits the new body of [sec_data->start, sec_data->end) and finishes with emitter_end()
+// @return false if the file could not be loaded (the document is unlocked again in that case)
+static b8 emitter_begin(SY* serializer, sy_emitter* e, serializer_section_data* sec_data) {
+
+    memset(e, 0, sizeof(*e));
+    e->document = serializer->document;
+    e->fd = fileno(serializer->fp);
+    pthread_mutex_lock(&e->document->write_mutex);
+
+    e->base = document_reload_locked(e->document, serializer->fp);
+    e->file_changed = (atomic_load(&e->document->file_reads) != serializer->file_reads);
+    e->buffer = e->base ? malloc(EMIT_BUFFER_SIZE) : NULL;
+    if (!e->buffer) {
+        LOG(Error, "Failed to load [%s] for saving", e->document->path)
+        free(e->buffer);
+        version_release(e->base);
+        pthread_mutex_unlock(&e->document->write_mutex);
         return false;
     }
 
+    arena* scratch = arena_scratch();
+    const arena_mark mark = arena_get_mark(scratch);
+    dyn_str missing_headers = {0};
+    ds_init_arena(&missing_headers, scratch, 256);
+    locate_section(serializer, e->base, sec_data, &missing_headers);
+
+    // everything in front of the top level section that contains the change stays as it is (at the end of the content
+    // the last section is emitted again, a new top level section could follow it without a newline in between)
+    u32 index = 0;
+    while (index +1 < e->base->section_count && e->offset + e->base->sections[index]->len <= sec_data->start)
+        e->offset += e->base->sections[index++]->len;
+
+    for (u32 x = 0; x < index; x++)
+        emitter_share_section(e, e->base->sections[x]);
+    e->compare = (line_cursor){ .version = e->base, .section = index, .pos = 0 };
+    e->hint = index;
+    e->line_start = true;
+
+    atomic_store(&e->document->writing, true);                  // readers keep using [base] while the file is inconsistent
+    emitter_write_base(e, e->offset, sec_data->start);
+    emitter_write(e, missing_headers.data, missing_headers.len);
+    ds_free(&missing_headers);
+    arena_reset_to_mark(scratch, mark);
     return true;
 }
 
 
-b8 add_or_update_entry(const char* line, size_t len, void* user_data) {
-    
-    serializer_section_data* sec_data = (serializer_section_data*)user_data;
-    // const char* unindented_line = skip_indentation(line);
-    // LOG(Debug, "line: [%.*s]", (int)len, line)
-    
-    // Get key
-    char key_str[PATH_MAX] = {0};
-    size_t key_len = 0;
-    for (size_t x = 0; x < len; x++) {
-        if (line[x] == ':') {
-            
-            key_str[x] = line[x];
-            break;
-        }
+// emits the content of [base] from [from] on, publishes the next version and unlocks the document
+static void emitter_end(sy_emitter* e, const size_t from) {
 
-        key_str[x] = line[x];
-        key_len++;
-    }
-    // LOG(Trace, "key_str: %s", key_str)
-
-    // const size_t end_position = (sec_data->end - sec_data->file_content->data);                                         // Search for key in the section range
-    const char* section_start = sec_data->file_content->data + (sec_data->start - sec_data->file_content->data);        // Search only within the section bounds
-    const char* key_location_in_file = str_search_range(section_start, key_str, (sec_data->end - sec_data->file_content->data));
-    const u32 key_indent = get_indentation_reverse(key_location_in_file);
-    if (!key_location_in_file || key_indent != sec_data->serializer->current_indentation) {       // Key not found, append to end of section
-
-        const int indent_spaces = (sec_data->serializer->current_indentation) * 2;
-        char indent_str[64] = {0};
-        if (indent_spaces > 0 && indent_spaces < (int)sizeof(indent_str))
-            memset(indent_str, ' ', indent_spaces);
-        
-        char new_line[PATH_MAX];
-        snprintf(new_line, sizeof(new_line), "\n%s%.*s", indent_str, (int)len, line);
-        
-        size_t end_pos = sec_data->end - sec_data->file_content->data;      // Calculate the correct insertion position (need to add 1 for \n)
-        if (end_pos > sec_data->file_content->len)                          // Make sure we're not inserting beyond the string length
-            end_pos = sec_data->file_content->len;
-        
-        LOG(Trace, "trying to insert new line [%s] at %zu", new_line, end_pos);
-        const i32 result = ds_insert_str(sec_data->file_content, end_pos, new_line);
-        if (result != AT_SUCCESS) {
-            LOG(Error, "Failed to insert new line [%s] because [%d]", new_line, result);
-            return true;
+    sy_document* document = e->document;
+    sy_version* base = e->base;
+
+    const size_t position = e->offset + e->len;
+    if (position == from) {                                     // nothing moved: only the rest of the changed top level section is emitted
+
+        size_t offset = 0;
+        u32 index = 0;
+        while (index < base->section_count && offset + base->sections[index]->len <= from)
+            offset += base->sections[index++]->len;
+
+        if (index < base->section_count) {
+            emitter_write_base(e, from, offset + base->sections[index]->len);
+            index++;
         }
-        
-        sec_data->end = sec_data->file_content->data + end_pos + strlen(new_line);      // Update end pointer to account for the new content
-        return true;
-    }
+        emitter_flush(e);
+        emitter_finish_section(e);
 
-    // Key found, update the value
+        for (; index < base->section_count; index++)
+            emitter_share_section(e, base->sections[index]);
+        e->offset = base->size;
 
-    // Find the value position in the file
-    char* file_value_start = strchr(key_location_in_file, ':');
-    if (!file_value_start) return true;
-    file_value_start++; // Skip colon
-    
-    // Skip whitespace
-    while (*file_value_start == ' ' || *file_value_start == '\t')
-        file_value_start++;
-    
-    // Find end of current value (newline or end of string)
-    char* file_value_end = strchr(file_value_start, '\n');
-    if (!file_value_end) file_value_end = sec_data->file_content->data + sec_data->file_content->len;
-    
-    size_t file_value_pos = file_value_start - sec_data->file_content->data;
-    size_t file_value_len = file_value_end - file_value_start;
-
-    
-
-    const char* value_start = strchr(line, ':');
-    if (!value_start) return true;
-    value_start++;                                                      // Skip colon
-    while (*value_start == ' ' || *value_start == '\t') {               // Skip whitespace after colon
-        value_start++;
-        len--;
+    } else {
+        emitter_write_base(e, from, base->size);
+        emitter_flush(e);
+        emitter_finish_section(e);
     }
-    size_t value_len = len - (value_start - line) +1;
-    char value_str[PATH_MAX] = {0};
-    strncpy(value_str, value_start, value_len);
-    
-    i32 result = ds_replace_range(sec_data->file_content, file_value_pos, file_value_len, value_str);
-    if (result != AT_SUCCESS)
-        LOG(Error, "ds_replace_range failed: %d", result)
-
-    return true;
-}
 
+    const size_t size = e->offset;
+    if (e->error == AT_SUCCESS && size != base->size && ftruncate(e->fd, (off_t)size) != 0)
+        e->error = AT_IO_ERROR;
+
+    struct stat file_stat;
+    sy_version* next = NULL;
+    if (e->error != AT_SUCCESS)
+        LOG(Error, "Failed to write [%s]: %s", document->path, error_to_str(e->error))
+    else if (e->written == 0 && size == base->size)
+        LOG(Trace, "Nothing changed in [%s]", document->path)
+    else if ((next = calloc(1, sizeof(sy_version)))) {
+
+        next->sections = e->sections.data;                      // owned by [next] now
+        next->section_count = (u32)section_array_size(&e->sections);
+        section_array_init(&e->sections);
+        atomic_init(&next->ref_count, 1);
+        next->number = base->number +1;
+        next->size = size;
+        if (fstat(e->fd, &file_stat) == 0)
+            version_set_file_state(next, &file_stat);
 
-void save_section(SY* serializer) {
+    }
 
-    // load entire file content into dyn_str
-    dyn_str file_content = {0};
-    const i32 result = ds_from_file(&file_content, serializer->fp);
-    VALIDATE(!result, return, "", "Error reading file: %d", result)
+    if (next) {
+        LOG(Trace, "Wrote [%zu] of [%zu] bytes to [%s], published version [%lu]", e->written, size, document->path, next->number)
+        document_publish(document, next);
 
-    LOG(Info, "file_content: \n%s\n", file_content.data)
-    LOG(Info, "section_content: \n%s\n", serializer->section_content.data)
+    } else if (e->written > 0 || size != base->size)
+        atomic_store(&document->stale, true);                   // content on disk is unknown, the next access reloads it
 
-    serializer_section_data sec_data = {0};
-    sec_data.serializer = serializer;
-    ds_iterate_lines(&file_content, find_section_start_and_end_callback, (void*)&sec_data);                 // find section start & end in file content
+    atomic_store(&document->writing, false);
+    pthread_mutex_unlock(&document->write_mutex);
 
-    if (!sec_data.found_last_section) {
+    for (size_t x = 0; x < section_array_size(&e->sections); x++)
+        section_release(*section_array_at(&e->sections, x));
+    section_array_free(&e->sections);
+    free(e->section);
+    free(e->buffer);
+    version_release(base);
+}
 
-        if (!sec_data.end)                                          
-            sec_data.end = &file_content.data[file_content.len];
-        
-        for (size_t x = sec_data.headers_index; x < stack_size(&serializer->section_headers); x++) {        // add remaining header to file
-            
-            char current_header[STR_SEC_LEN] = {0};
-            stack_peek_at(&serializer->section_headers, x, &current_header);
-            
-            const int indent_spaces = (x) * 2;                                                              // Calculate the number of spaces needed for indentation
-            char indent_str[64] = {0};                                                                      // Create a string of spaces for indentation
-            if (indent_spaces > 0 && indent_spaces < (int)sizeof(indent_str))
-                memset(indent_str, ' ', indent_spaces);
-            
-            char header_str[STR_SEC_LEN *2] = {0};
-            snprintf(header_str, sizeof(header_str), "\n%s%s:", indent_str, current_header);
-            ds_insert_str(&file_content, sec_data.end - file_content.data, header_str);                   // Add the section header with proper indentation
-            sec_data.start = sec_data.end + strlen(header_str);
-            sec_data.end = sec_data.start;
-        }
-        sec_data.end = sec_data.start;
-    }
 
-    else if (!sec_data.end) {              // start found but not end -> assuming section is at end file    ([start] is always found if [found_last_section] id true)
-        // LOG(Trace, "start found, but NOT end")
-        sec_data.end = &file_content.data[file_content.len];
-    }
+void save_section(SY* serializer) {
 
-    // LOG(Warn, "before: %s", file_content)
-    sec_data.file_content = &file_content;
-    ds_iterate_lines(&serializer->section_content, add_or_update_entry, (void*)&sec_data);
-    // LOG(Warn, "after: %s", file_content)
+    if (serializer->section_content.len == 0)                   // nothing to add or update
+        return;
 
-    // Save data to file
-    rewind(serializer->fp); // Go to beginning of file
-    ftruncate(fileno(serializer->fp), 0); // Truncate the file to 0 length
-    fwrite(file_content.data, 1, file_content.len, serializer->fp);
-    fflush(serializer->fp); // Ensure all data is written
+    sy_emitter emitter;
+    serializer_entry_data entry_data = {0};
+    if (!emitter_begin(serializer, &emitter, &entry_data.section))
+        return;
 
-    ds_free(&file_content);
-    // LOG(Debug, "Saved section")
+    // only the section below its header is edited in memory, in the scratch arena of the thread
+    const size_t start = entry_data.section.start;
+    const size_t end = entry_data.section.end;
+    arena* scratch = arena_scratch();
+    const arena_mark mark = arena_get_mark(scratch);
+    dyn_str section = {0};
+    ds_init_arena(&section, scratch, end - start +1);
+    version_append_range(emitter.base, start, end, &section);
+    ds_init_arena(&entry_data.appended, scratch, 256);
+
+    entry_data.section.file_content = &section;
+    entry_data.section.start = 0;
+    entry_data.section.end = section.len;
+    ds_iterate_lines(&serializer->section_content, add_or_update_entry, (void*)&entry_data);
+
+    emitter_write(&emitter, section.data, section.len);
+    emitter_write(&emitter, entry_data.appended.data, entry_data.appended.len);
+    emitter_end(&emitter, end);
+
+    ds_free(&entry_data.appended);
+    ds_free(&section);
+    arena_reset_to_mark(scratch, mark);
 }
 
+
 // ============================================================================================================================================
-// value parsing
+// value lookup
 // ============================================================================================================================================
 
 typedef struct {
-    const char*     key;
-    const char*     format;
-    void*           value;
+    str_view        key;
+    str_view        value;              // points at the value inside the content if found
     b8              found;
-    dyn_str*        section_content;
 } ds_iterator_data;
 
 
-// ================================= set value =================================
-
-// Helper macro to extract the format specifier from complex format strings
-#define EXTRACT_SPECIFIER(fmt)  \
-    (strchr(fmt, 'd') ? 'd' :   \
-     strchr(fmt, 'u') ? 'u' :   \
-     strchr(fmt, 'f') ? 'f' :   \
-     strchr(fmt, 's') ? 's' :   \
-     'p')  // default
-
-// handles both simple and PRI macros
-#define FORMAT_VALUE(value_to_use)                                                                          \
-    do {                                                                                                    \
-        char specifier = EXTRACT_SPECIFIER(format);                                                         \
-        switch (specifier) {                                                                                \
-            case 'd':                                                                                       \
-                if (strstr(format, "lld") || strstr(format, PRId64))                                        \
-                    snprintf(value_str, sizeof(value_str), format, *(long long*)value_to_use);              \
-                else if (strstr(format, "ld") || strstr(format, PRId32))                                    \
-                    snprintf(value_str, sizeof(value_str), format, *(long*)value_to_use);                   \
-                else if (strstr(format, "d") || strstr(format, PRId16) || strstr(format, PRId8))            \
-                    snprintf(value_str, sizeof(value_str), format, *(int*)value_to_use);                    \
-                else                                                                                        \
-                    snprintf(value_str, sizeof(value_str), format, *(int*)value_to_use);                    \
-                break;                                                                                      \
-            case 'u':                                                                                       \
-                if (strstr(format, "llu") || strstr(format, PRIu64))                                        \
-                    snprintf(value_str, sizeof(value_str), format, *(unsigned long long*)value_to_use);     \
-                else if (strstr(format, "lu") || strstr(format, PRIu32))                                    \
-                    snprintf(value_str, sizeof(value_str), format, *(unsigned long*)value_to_use);          \
-                else if (strstr(format, "u") || strstr(format, PRIu16) || strstr(format, PRIu8))            \
-                    snprintf(value_str, sizeof(value_str), format, *(unsigned int*)value_to_use);           \
-                else                                                                                        \
-                    snprintf(value_str, sizeof(value_str), format, *(unsigned int*)value_to_use);           \
-                break;                                                                                      \
-            case 'f':                                                                                       \
-                if (strstr(format, "Lf"))                                                                   \
-                    snprintf(value_str, sizeof(value_str), format, *(long double*)value_to_use);            \
-                else if (strstr(format, "lf"))                                                              \
-                    snprintf(value_str, sizeof(value_str), format, *(double*)value_to_use);                 \
-                else                                                                                        \
-                    snprintf(value_str, sizeof(value_str), format, *(float*)value_to_use);                  \
-                break;                                                                                      \
-            case 's':                                                                                       \
-                snprintf(value_str, sizeof(value_str), format, (char*)value_to_use);                        \
-                break;                                                                                      \
-            default:                                                                                        \
-                snprintf(value_str, sizeof(value_str), format, *(handle*)value_to_use);                     \
-                break;                                                                                      \
-        }                                                                                                   \
-    } while (0)
-
-
-// 
-b8 set_value_callback(const char* line, size_t len, void *user_data) {
+b8 find_value_callback(const char* line, size_t len, void *user_data) {
 
     ds_iterator_data* loc_data = (ds_iterator_data*)user_data;
 
-    const size_t key_len = strlen(loc_data->key);
-    if (len <= key_len || memcmp(line, loc_data->key, key_len) != 0 || line[key_len] != ':')        // Check if this line starts with target key followed by a colon
+    // Check if this line is the target key followed by a colon
+    str_view key, value;
+    if (!split_entry(sv_make(line, len), &key, &value) || !sv_equal(key, loc_data->key))
         return true;
 
-    // LOG(Trace, "found [%s] in [%.*s]", loc_data->key, len, line)
+    loc_data->value = value;
+    loc_data->found = true;
+    return false;
+}
+
+// tries to find a line containing the key, if found [loc_data->value] points at the value inside [serializer->section_content]
+static b8 find_value(SY* serializer, const char* key, ds_iterator_data* loc_data) {
+
+    memset(loc_data, 0, sizeof(*loc_data));
+    loc_data->key = sv_from_cstr(key);
+    ds_iterate_lines(&serializer->section_content, find_value_callback, (void*)loc_data);
+    return loc_data->found;
+}
+
+
+// tries to find a line containing the key, if found it will update the value, if not it will append a new line at the end
+b8 set_value(SY* serializer, const char* key, const char* value_str) {
+
+    if (!serializer || !key || !value_str) return false;
 
-    size_t value_len = len - key_len;                                            // Calculate the full length of the line (including potential newline)
-    size_t offset = (line - loc_data->section_content->data) + key_len;         // Calculate the offset of this line in the dynamic string
-    while (offset < loc_data->section_content->len && (loc_data->section_content->data[offset] == ':' || loc_data->section_content->data[offset] == ' ')) {
+    ds_iterator_data loc_data;
+    if (find_value(serializer, key, &loc_data)) {              // Replace the old value string inside the line with the new one
 
-        offset++;       // Include trailing ":" and space
-        value_len--;
+        const size_t offset = (size_t)(loc_data.value.data - serializer->section_content.data);
+        ds_replace_range(&serializer->section_content, offset, loc_data.value.len, value_str);
+        return true;
     }
-    
-    // Handle different types appropriately
-    const char* format = loc_data->format;
-    
-    char value_str[STR_LINE_LEN] = {0};
-    FORMAT_VALUE(loc_data->value);
 
-    // Replace the old value strinf inside the line with the new one
-    ds_remove_range(loc_data->section_content, offset, value_len);
-    ds_insert_str(loc_data->section_content, offset, value_str);
-    
-    // LOG(Trace, "section_content [\n%s]", loc_data->section_content->data)
-    loc_data->found = true;
+    // Key not found - append a new line
+    ds_append_str(&serializer->section_content, key);
+    ds_append_str_n(&serializer->section_content, ": ", 2);
+    ds_append_str(&serializer->section_content, value_str);
+    ds_append_char(&serializer->section_content, '\n');
     return false;
 }
 
-// tries to find a line containing the key, if found it will update the value, if not it will append a new line at the end
-b8 set_value(SY* serializer, const char* key, void* value, const char* format) {
-    
-    if (!serializer || !key || !format || !value) return false;
 
-    ds_iterator_data loc_data;
-    loc_data.key = key;
-    loc_data.format = format;
-    loc_data.value = value;
-    loc_data.found = false;
-    loc_data.section_content = &serializer->section_content;
+// parses all "key: value" lines in [content] once and writes every value that matches a field of [fields] into [element]
+static void decode_fields(const char* content, const size_t content_len, void* element, const sy_field* fields, const size_t field_count) {
+
+    str_view rest = sv_make(content, content_len), line, key, value;
+    while (sv_split_next(&rest, '\n', &line)) {
 
-    // LOG(Trace, "serializer->section_content [%s]", serializer->section_content.data)
-    ds_iterate_lines(&serializer->section_content, set_value_callback, (void*)&loc_data);
-    
-    if (!loc_data.found) {                      // append new line at end if not found
-        
-        // Key not found - append a new line
-        char new_line[STR_LINE_LEN];
-        snprintf(new_line, sizeof(new_line), "%s: ", key);
-        
-        // Append the formatted value
-        char value_str[STR_LINE_LEN];
-        FORMAT_VALUE(value);
+        if (!split_entry(line, &key, &value))
+            continue;
 
-        strcat(new_line, value_str);
-        strcat(new_line, "\n");
-        ds_append_str(&serializer->section_content, new_line);
+        for (size_t x = 0; x < field_count; x++) {
+            if (!sv_equal_cstr(key, fields[x].key))
+                continue;
+
+            if (!parse_value(value, (u8*)element + fields[x].offset, fields[x].type, fields[x].size))
+                LOG(Warn, "Failed to parse value of [%s]: [" SV_FMT "]", fields[x].key, SV_ARG(value))
+            break;
+        }
     }
-    return loc_data.found;
 }
 
-#undef FORMAT_VALUE
 
-// ================================= get value =================================
+// appends "key: value\n" for every field of [element] to [content]
+static void encode_fields(dyn_str* content, const void* element, const sy_field* fields, const size_t field_count) {
 
-b8 get_value_callback(const char* line, size_t len, void *user_data) {
+    for (size_t x = 0; x < field_count; x++) {
 
-    ds_iterator_data* loc_data = (ds_iterator_data*)user_data;
+        const void* value = (const u8*)element + fields[x].offset;
+        ds_append_str(content, fields[x].key);
+        ds_append_str_n(content, ": ", 2);
+        if (fields[x].type == SY_TYPE_STR) {
+            ds_append_str_n(content, (const char*)value, strnlen((const char*)value, fields[x].size));
 
-    // LOG(Trace, "searching for [%s] in [%.*s]", loc_data->key, (int)(strchr(line, '\n') - line), line)
+        } else {
+            char value_str[NUM_BUFFER_SIZE] = {0};
+            const i32 value_len = format_value(value_str, value, fields[x].type);
+            if (value_len > 0)
+                ds_append_str_n(content, value_str, (size_t)value_len);
+        }
+        ds_append_char(content, '\n');
+    }
+}
 
-    // Check if this line starts with target key followed by a colon
-    if (len <= strlen(loc_data->key) || memcmp(line, loc_data->key, strlen(loc_data->key)) != 0 || line[strlen(loc_data->key)] != ':')
-        return true;
-        
-    const char* value_start = line + strlen(loc_data->key) + 1;                     // Find the position after the colon
-    while (value_start < line || (*value_start == ' ' || *value_start == '\t'))     // Skip any whitespace after the colon
-        value_start++;
-    
-    // Extract the value
-    char value_str[STR_LINE_LEN] = {0};
-    size_t value_len = len - (value_start - line);
-    if (value_len >= sizeof(value_str))                 // force length to be shorter than buffer
-        value_len = sizeof(value_str) - 1;
 
-    memcpy(value_str, value_start, value_len);
-    value_str[value_len] = '\0';
-    
-    // LOG(Trace, "value_len [%s]", &value_str)
-    loc_data->found = sscanf(value_str, loc_data->format, loc_data->value) == 1;          // Parse the value
-    // LOG(Trace, "format [%s] value_len [%s]", loc_data->format, loc_data->value)
+void sy_decode_fields(const char* record, const size_t record_len, void* element, const sy_field* fields, const size_t field_count) {
 
-    return !loc_data->found;
+    decode_fields(record, record_len, element, fields, field_count);
 }
 
-// tries to find a line containing the key, if found it will return true and set [char* line] to the line containing the key
-b8 get_value(SY* serializer, const char* key, handle* value, const char* format) {
 
-    if (!serializer || !key || !format || !value) return false;
+b8 sy_record_find(const char* record, const size_t record_len, const char* key, const char** value, size_t* value_len) {
 
-    ds_iterator_data loc_data;
-    loc_data.key = key;
-    loc_data.format = format;
-    loc_data.value = value;
-    loc_data.found = false;
-    loc_data.section_content = NULL;
+    const str_view target = sv_from_cstr(key);
+    str_view rest = sv_make(record, record_len), line, line_key, line_value;
+    while (sv_split_next(&rest, '\n', &line)) {
 
-    ds_iterate_lines(&serializer->section_content, get_value_callback, (void*)&loc_data);
-    return loc_data.found;
+        if (split_entry(line, &line_key, &line_value) && sv_equal(line_key, target)) {
+            *value = line_value.data;
+            *value_len = line_value.len;
+            return true;
+        }
+    }
+    return false;
 }
 
 
@@ -543,7 +1352,7 @@ b8 get_value(SY* serializer, const char* key, handle* value, const char* format)
 
 // Core functions
 b8 sy_init(SY* serializer, const char* dir_path, const char* file_name, const char* section_name, const serializer_option option) {
-    
+
     ASSERT(dir_path != NULL, "", "failed to provide a directory path");
     ASSERT(file_name != NULL, "", "failed to provide a file name");
     ASSERT(section_name != NULL, "", "failed to provide a section name");
@@ -575,15 +1384,20 @@ b8 sy_init(SY* serializer, const char* dir_path, const char* file_name, const ch
 
     system_ensure_file_exists(loc_file_path);
 
-    serializer->fp = fopen(loc_file_path, "a+");                                                                 // Open file for reading (saving will happen later in shutdown)
+    serializer->fp = fopen(loc_file_path, "r+");                                                                 // Open file for reading, saves patch it with pwrite() (not possible in append mode)
     VALIDATE(serializer->fp, return false, "opened file [%s]", "Failed to open file [%s]", loc_file_path);
 
+    strcpy(serializer->file_path, loc_file_path);
+    serializer->document = document_attach(loc_file_path);                                                      // shared with all serializers of this file
+    VALIDATE(serializer->document, fclose(serializer->fp); serializer->fp = NULL; return false, "", "Failed to allocate document of [%s]", loc_file_path);
+    serializer->version = NULL;                                                                                 // acquired on first read
+    serializer->file_reads = atomic_load(&serializer->document->file_reads);                                    // before the first read
     serializer->current_indentation = 1;                                                                        // default to 1
     serializer->option = option;                                                                                // Store serializer settings
-    stack_init(&serializer->section_headers, sizeof(char) * STR_SEC_LEN, 2);                                    // headers are char arrays with cap: STR_SEC_LEN
-    i32 result = stack_push(&serializer->section_headers, section_name);
-    if (result)
-        LOG(Error, "result: %s", strerror(result));
+    sy_header_stack_init(&serializer->section_headers);                                                         // no allocation until SY_INLINE_HEADERS nested sections
+    sy_header* header = sy_header_stack_emplace_back(&serializer->section_headers);
+    strncpy(header->name, section_name, sizeof(header->name) -1);
+    header->name[sizeof(header->name) -1] = '\0';
 
     ds_init(&serializer->section_content);                                                                      // Initialize dynamic string buffer and parse initial section
     get_content_of_section(serializer);
@@ -597,12 +1411,19 @@ void sy_shutdown(SY* serializer) {
     if (serializer->option == SERIALIZER_OPTION_SAVE)       // dump content to file
         save_section(serializer);
 
+    version_release(serializer->version);                   // readers of other serializers are not affected
+    serializer->version = NULL;
+    if (serializer->document) {
+        document_detach(serializer->document);
+        serializer->document = NULL;
+    }
+
     if (serializer->fp) {                                   // close file
         fclose(serializer->fp);
         serializer->fp = NULL;
     }
     ds_free(&serializer->section_content);
-    stack_free(&serializer->section_headers);
+    sy_header_stack_free(&serializer->section_headers);
 }
 
 
@@ -617,19 +1438,22 @@ void sy_subsection_begin(SY* serializer, const char* name) {
     if (serializer->option == SERIALIZER_OPTION_SAVE)           // dump content to file
         save_section(serializer);
 
-    stack_push(&serializer->section_headers, name);
+    sy_header* header = sy_header_stack_emplace_back(&serializer->section_headers);
+    VALIDATE(header, return, "", "Failed to add subsection [%s]", name)
+    strncpy(header->name, name, sizeof(header->name) -1);
+    header->name[sizeof(header->name) -1] = '\0';
     serializer->current_indentation++;
     get_content_of_section(serializer);
 }
 
 
 void sy_subsection_end(SY* serializer) {
-    
+
     if (serializer->option == SERIALIZER_OPTION_SAVE)           // dump content to file
         save_section(serializer);
 
     // switch name back to parent section
-    stack_pop(&serializer->section_headers, NULL);              // remove last
+    sy_header_stack_pop_back(&serializer->section_headers);     // remove last
     serializer->current_indentation--;
     get_content_of_section(serializer);
 }
@@ -639,142 +1463,506 @@ void sy_subsection_end(SY* serializer) {
 // serializer entry functions
 // ============================================================================================================================================
 
-void sy_entry(SY* serializer, const char* key, void* value, const char* format)     { 
-    if (serializer->option == SERIALIZER_OPTION_SAVE)
-        set_value(serializer, key, (void*)value, format);
-    else                                                
-        get_value(serializer, key, (void*)value, format);
+void sy_entry(SY* serializer, const char* key, void* value, const sy_type type) {
+
+    ASSERT(type != SY_TYPE_STR, "", "Use sy_entry_str() for string values [%s]", key)
+
+    if (serializer->option == SERIALIZER_OPTION_SAVE) {
+        char value_str[NUM_BUFFER_SIZE] = {0};
+        if (format_value(value_str, value, type) > 0)
+            set_value(serializer, key, value_str);
+        return;
+    }
+
+    ds_iterator_data loc_data;
+    if (find_value(serializer, key, &loc_data) && !parse_value(loc_data.value, value, type, 0))
+        LOG(Warn, "Failed to parse value of [%s]: [" SV_FMT "]", key, SV_ARG(loc_data.value))
 }
 
 
 void sy_entry_str(SY* serializer, const char* key, char* value, size_t buffer_size)   {
 
     if (serializer->option == SERIALIZER_OPTION_SAVE) {
-        set_value(serializer, key, "%s", (void*)value);
-    } else {
-        char temp[STR_LINE_LEN] = {0};
-        if (get_value(serializer, key, (handle*)&temp, "%[^\n]")) {
-            strncpy(value, temp, buffer_size);
-            value[buffer_size - 1] = '\0'; // Ensure null termination
-        }
+        set_value(serializer, key, value);
+        return;
     }
+
+    ds_iterator_data loc_data;
+    if (find_value(serializer, key, &loc_data))
+        parse_value(loc_data.value, value, SY_TYPE_STR, buffer_size);
 }
 
 
-void sy_loop(SY* serializer, const char* name, void* data_structure, size_t element_size, sy_loop_callback_t callback, sy_loop_callback_at_t accessor, sy_loop_callback_append_t append, sy_loop_DS_size_callback_t data_structure_size) {
-    
-    sy_subsection_begin(serializer, name);
-    // ASSERT(strlen(name) < STR_SEC_LEN, "", "Provided section name is to long [%s] may size [%u]", name, STR_SEC_LEN)
-    // if (serializer->option == SERIALIZER_OPTION_SAVE)           // dump old content to file
-    //     save_section(serializer);
+void sy_entry_fields(SY* serializer, void* element, const sy_field* fields, const size_t field_count) {
 
-    // stack_push(&serializer->section_headers, name);
-    // serializer->current_indentation++;
-    
-    if (serializer->option == SERIALIZER_OPTION_SAVE) {
+    if (serializer->option == SERIALIZER_OPTION_LOAD) {
+        decode_fields(serializer->section_content.data, serializer->section_content.len, element, fields, field_count);
+        return;
+    }
 
-        FILE* loc_serializer_file = serializer->fp;
-        dyn_str loop_content = {0};
+    for (size_t x = 0; x < field_count; x++) {
+
+        void* value = (u8*)element + fields[x].offset;
+        if (fields[x].type == SY_TYPE_STR)
+            sy_entry_str(serializer, fields[x].key, (char*)value, fields[x].size);
+        else
+            sy_entry(serializer, fields[x].key, value, fields[x].type);
+    }
+}
 
-        const size_t DS_size = data_structure_size(data_structure);
-        for (u64 x = 0; x < DS_size; x++) {
 
-            void* local_buffer = NULL;
-            const i32 result = accessor(data_structure, x, local_buffer);
-            VALIDATE(result == AT_SUCCESS && local_buffer, return, "", "Failed to access element at [%d] result [%s]", x, error_to_str(result))
-            callback(serializer, local_buffer);
+// ============================================================================================================================================
+// sequences
+// ============================================================================================================================================
+
+// appends the "key: value\n" lines of [content] as one sequence item to [body]
+//   "\n<indent>- <first line>"
+//   "\n<indent>  <other lines>"
+static void append_sequence_item(dyn_str* body, const dyn_str* content, const u32 indentation) {
+
+    const char* pos = content->data;
+    const char* end = content->data + content->len;
+    b8 first_line = true;
+    while (pos < end) {
+
+        const char* line_end = memchr(pos, '\n', end - pos);
+        if (!line_end) line_end = end;
+
+        ds_append_char(body, '\n');
+        append_indentation(body, indentation);
+        ds_append_str_n(body, (first_line) ? "- " : "  ", 2);
+        ds_append_str_n(body, pos, (size_t)(line_end - pos));
+
+        first_line = false;
+        pos = line_end +1;
+    }
 
-            ds_append_str(&loop_content, serializer->section_content.data);
+    if (first_line) {                                   // element without any entries
+        ds_append_char(body, '\n');
+        append_indentation(body, indentation);
+        ds_append_char(body, '-');
+    }
+}
+
+
+// true if [line] starts an item of a sequence at [indentation]: "<indentation>- <...>" or "<indentation>-"
+static inline b8 is_sequence_item_line(const char* line, const char* end, const u32 indentation) {
+
+    const char* content = skip_indentation(line);
+    return content < end && is_sequence_item(content, (content +1 < end && content[1] != '\n') ? 2 : 1) && get_indentation(line) == indentation;
+}
+
+DARRAY_DEFINE(offset_array, size_t)
+
+// collects the offsets of all items of a sequence at [indentation] in [content] into [items] and appends [len].
+// Newlines are located 16 bytes at a time, only the lines after them are inspected
+static void find_sequence_items(const char* content, const size_t len, const u32 indentation, offset_array* items) {
+
+    size_t offset = 0;
+    if (len > 0 && is_sequence_item_line(content, content + len, indentation))
+        offset_array_push_back(items, &offset);
+
+    size_t x = 0;
+#if defined(__SSE2__)
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; x + 16 <= len; x += 16) {
+        u32 mask = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(content + x)), newline));
+        while (mask) {
+            offset = x + (size_t)__builtin_ctz(mask) +1;
+            mask &= mask -1;
+            if (offset < len && is_sequence_item_line(content + offset, content + len, indentation))
+                offset_array_push_back(items, &offset);
         }
+    }
+#endif
+    for (; x < len; x++) {
+        if (content[x] != '\n') continue;
+        offset = x +1;
+        if (offset < len && is_sequence_item_line(content + offset, content + len, indentation))
+            offset_array_push_back(items, &offset);
+    }
 
-        ds_clear(&serializer->section_content);
-        ds_append_str(&serializer->section_content, loop_content.data);
+    offset = len;
+    offset_array_push_back(items, &offset);
+}
 
-        // save buffer to file
-        save_section(serializer);
+// appends the "key: value\n" lines of the item in [pos, end) to [content]: the text after "- " and all lines one level deeper
+static void sequence_item_content(const char* pos, const char* end, const u32 indentation, dyn_str* content) {
 
-        return;
+    b8 first_line = true;
+    while (pos < end) {
+
+        const char* line_end = memchr(pos, '\n', (size_t)(end - pos));
+        if (!line_end) line_end = end;
+
+        const char* line_content = skip_indentation(pos);
+        const size_t content_len = (line_content < line_end) ? (size_t)(line_end - line_content) : 0;
+        if (first_line && content_len > 2) {
+            ds_append_str_n(content, line_content +2, content_len -2);
+            ds_append_char(content, '\n');
+
+        } else if (!first_line && content_len > 0 && get_indentation(pos) == indentation +1) {
+            ds_append_str_n(content, line_content, content_len);
+            ds_append_char(content, '\n');
+        }
+
+        first_line = false;
+        pos = line_end +1;
     }
+}
 
 
-    // only loading from here
-    void* local_buffer = malloc(element_size);
-    FILE* loc_serializer_file = serializer->fp;
+// items of a sequence loaded with sy_loop_fields() are decoded by several threads. The items are split into batches, every thread
+// decodes a contiguous range of a batch into its own buffer and the buffers are appended in order. The buffers are sized in bytes,
+// so the extra memory stays below PARSE_MAX_THREADS * PARSE_BATCH_BYTES for any element size
+#define PARSE_MIN_ITEMS_PER_THREAD  512
+#define PARSE_BATCH_BYTES           (1024 * 1024)   // per thread
+#define PARSE_MAX_THREADS           16
 
-    // search for header while respecting the hierarchy in [serializer->section_headers]
-    char line[STR_LINE_LEN] = {0};
-    b8 found_section = true;                                // if hierarchy is not violated this will remain true
-    const size_t number_of_headers = stack_size(&serializer->section_headers);
-    LOG(Trace, "number_of_headers %zu", number_of_headers)
-    for (size_t x = 0; x < number_of_headers; x++) {
-        
-        char current_header[STR_SEC_LEN] = {0};
-        stack_peek_at(&serializer->section_headers, x, &current_header);
-        LOG(Trace, "searching for [%s]", current_header)
+typedef struct {
+    const char*         content;
+    const size_t*       items;
+    size_t              first_item;
+    size_t              end_item;
+    u32                 indentation;
+    size_t              element_size;
+    const sy_field*     fields;
+    size_t              field_count;
+    u8*                 elements;                   // decoded elements, PARSE_BATCH_BYTES at most
+    dyn_str             item_content;
+} parse_range;
+
+static void* parse_worker(void* arg) {
+
+    parse_range* range = (parse_range*)arg;
+    u8* element = range->elements;
+    for (size_t x = range->first_item; x < range->end_item; x++) {
+        ds_clear(&range->item_content);
+        sequence_item_content(range->content + range->items[x], range->content + range->items[x +1], range->indentation, &range->item_content);
+        memset(element, 0, range->element_size);
+        decode_fields(range->item_content.data, range->item_content.len, element, range->fields, range->field_count);
+        element += range->element_size;
+    }
+    return NULL;
+}
 
-        while (fgets(line, sizeof(line), loc_serializer_file)) {
+static u32 get_parse_thread_count(const size_t item_count) {
 
-            LOG(Trace, "current line [%s]", line)
-            const u32 indent = get_indentation(line);
-            if (indent < x) {                               // left header hierarchy
-                found_section = false;                      // hierarchy violated -> still needs to search for subsections
-                goto break_search;
-            }
+    const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t count = item_count / PARSE_MIN_ITEMS_PER_THREAD;
+    if (count > (size_t)((cores > 0) ? cores : 1)) count = (size_t)((cores > 0) ? cores : 1);
+    if (count > PARSE_MAX_THREADS) count = PARSE_MAX_THREADS;
+    return (count > 0) ? (u32)count : 1;
+}
 
-            //  current header                  correct indentation (going deeper in)
-            if (strstr(line, current_header) && indent == x)
-                break;      // exit search loop -> found header        continue FOR to search for next header
+static void parse_sequence_parallel(const char* content, const size_t* items, const size_t item_count, const u32 indentation, void* data_structure,
+    const size_t element_size, const sy_field* fields, const size_t field_count, sy_loop_callback_append_t append) {
+
+    const u32 thread_count = get_parse_thread_count(item_count);
+    const size_t batch_items = (element_size < PARSE_BATCH_BYTES) ? PARSE_BATCH_BYTES / element_size : 1;      // per thread
+    parse_range ranges[PARSE_MAX_THREADS];
+    u32 range_count = 0;
+    for (; range_count < thread_count; range_count++) {
+        parse_range* range = &ranges[range_count];
+        *range = (parse_range){ .content = content, .items = items, .indentation = indentation, .element_size = element_size, .fields = fields, .field_count = field_count };
+        range->elements = malloc(batch_items * element_size);
+        if (!range->elements) break;
+        ds_init(&range->item_content);
+    }
+    VALIDATE(range_count > 0, return, "", "Failed to allocate parse buffers of size [%zu]", batch_items * element_size)
+
+    for (size_t batch = 0; batch < item_count; batch += (size_t)range_count * batch_items) {
+
+        const size_t batch_end = (batch + (size_t)range_count * batch_items < item_count) ? batch + (size_t)range_count * batch_items : item_count;
+        for (u32 x = 0; x < range_count; x++) {
+            ranges[x].first_item = batch + (batch_end - batch) * x / range_count;
+            ranges[x].end_item = batch + (batch_end - batch) * (x +1) / range_count;
+        }
+
+        pthread_t threads[PARSE_MAX_THREADS];
+        b8 started[PARSE_MAX_THREADS] = {0};
+        for (u32 x = 1; x < range_count; x++)
+            started[x] = (pthread_create(&threads[x], NULL, parse_worker, &ranges[x]) == 0);
+
+        parse_worker(&ranges[0]);
+        for (u32 x = 0; x < range_count; x++) {
+            if (x > 0 && started[x])
+                pthread_join(threads[x], NULL);
+            else if (x > 0)
+                parse_worker(&ranges[x]);                           // could not start a thread, decode here
+
+            for (size_t y = 0; y < ranges[x].end_item - ranges[x].first_item; y++)
+                append(data_structure, ranges[x].elements + y * element_size);
         }
     }
-    break_search:
-    VALIDATE(found_section, , "", "could not find section ")
 
+    for (u32 x = 0; x < range_count; x++) {
+        free(ranges[x].elements);
+        ds_free(&ranges[x].item_content);
+    }
+}
+
+
+// appends element [x] of [data_structure] as sequence item to [item], the entries come from [fields] or [callback]
+// @return false if the element could not be accessed
+static b8 format_sequence_item(SY* serializer, void* data_structure, const u64 x, void* element, sy_loop_callback_t callback, const sy_field* fields, const size_t field_count,
+    sy_loop_callback_at_t accessor, dyn_str* item) {
+
+    const i32 result = accessor(data_structure, x, element);
+    VALIDATE(result == AT_SUCCESS, return false, "", "Failed to access element at [%lu] result [%s]", x, error_to_str(result))
 
-    bool element_found_in_file = false;
-    while(element_found_in_file) {
+    ds_clear(&serializer->section_content);
+    if (fields)
+        encode_fields(&serializer->section_content, element, fields, field_count);
+    else
+        callback(serializer, element);
 
-        memset(local_buffer, 0, element_size);
-        callback(serializer, local_buffer);
-        append(data_structure, local_buffer);           // append new element to back
+    append_sequence_item(item, &serializer->section_content, serializer->current_indentation);
+    return true;
+}
+
+
+// finds the items of the sequence body [start, end) of [version], item [x] is [items[x], items[x +1]) of the body including the '\n' in front of it
+// @return the body or NULL if it is not part of one top level section or does not have [count] items
+static const char* find_body_items(const sy_version* version, const size_t start, const size_t end, const u32 indentation, const size_t count, offset_array* items) {
+
+    size_t offset = 0;
+    u32 index = 0;
+    while (index < version->section_count && offset + version->sections[index]->len <= start)
+        offset += version->sections[index++]->len;
+    if (count == 0 || end <= start +1 || index == version->section_count || end > offset + version->sections[index]->len)
+        return NULL;
+
+    const char* body = version->sections[index]->data + (start - offset);
+    const size_t len = end - start;
+    if (body[0] != '\n') return NULL;
+
+    find_sequence_items(body +1, len -1, indentation, items);      // the line of an item starts after its '\n', so the offsets are the ones of the '\n'
+    if (offset_array_size(items) != count +1 || *offset_array_at(items, 0) != 0)
+        return NULL;
+    *offset_array_at(items, count) = len;
+    return body;
+}
 
-        bool element_found_in_file = false;
-        do {                                                                    // load content of current element in to section_content if available
-            // reset string
-            ds_free(&serializer->section_content);
-            ds_init(&serializer->section_content);
 
-            if (fgets(line, sizeof(line), loc_serializer_file)) {               // get next line and see if part of data_structure
-                size_t i = 0;
-                while (line[i] == ' ' || line[i] == '\t')
-                    i++;
-                element_found_in_file = (get_indentation(line) == serializer->current_indentation -1) &&
-                                        (line[i] == '-' && (line[i + 1]) == ' ');
+// shared implementation of sy_loop(), sy_loop_fields(), sy_loop_fields_changed() and sy_loop_records(), exactly one of [callback], [fields]
+// and [record_callback] is used. [changed] is only used with [fields]
+static void serialize_sequence(SY* serializer, const char* name, void* data_structure, size_t element_size, sy_loop_callback_t callback, const sy_field* fields, const size_t field_count,
+    sy_loop_record_callback_t record_callback, sy_loop_callback_at_t accessor, sy_loop_callback_append_t append, sy_loop_changed_callback_t changed, sy_loop_DS_size_callback_t data_structure_size) {
+
+    sy_subsection_begin(serializer, name);
+
+    void* element = malloc(element_size);
+    VALIDATE(element, sy_subsection_end(serializer); return, "", "Failed to allocate element buffer of size [%zu]", element_size)
+
+    if (serializer->option == SERIALIZER_OPTION_SAVE) {
+
+        // callbacks can use the serializer, their items are collected before the document is locked. Items of fields are
+        // formatted one at a time and streamed into the file
+        arena* scratch = arena_scratch();
+        const arena_mark mark = arena_get_mark(scratch);
+        dyn_str body = {0};
+        ds_init_arena(&body, scratch, 4096);
+        const size_t DS_size = data_structure_size(data_structure);
+        for (u64 x = 0; !fields && x < DS_size; x++)
+            if (!format_sequence_item(serializer, data_structure, x, element, callback, NULL, 0, accessor, &body))
+                break;
+
+        sy_emitter emitter;
+        serializer_section_data sec_data;
+        if (emitter_begin(serializer, &emitter, &sec_data)) {
+
+            size_t end = sec_data.end;
+            if (end == emitter.base->size && end > sec_data.start) {                     // keep the newline at end of file
+                const sy_section* last = emitter.base->sections[emitter.base->section_count -1];
+                if (last->data[last->len -1] == '\n')
+                    end--;
+            }
+
+            // unchanged elements are copied from [base] if it is the content the caller saved or loaded last and has one item per element
+            offset_array old_items;
+            offset_array_init(&old_items);
+            const char* old_body = (fields && changed && !emitter.file_changed)
+                ? find_body_items(emitter.base, sec_data.start, end, serializer->current_indentation, DS_size, &old_items) : NULL;
+
+            for (u64 x = 0; fields && x < DS_size; x++) {
+                if (old_body && !changed(data_structure, x)) {
+                    const size_t from = *offset_array_at(&old_items, x);
+                    emitter_write(&emitter, old_body + from, *offset_array_at(&old_items, x +1) - from);
+                    continue;
+                }
+
+                ds_clear(&body);
+                if (!format_sequence_item(serializer, data_structure, x, element, NULL, fields, field_count, accessor, &body))
+                    break;
+                emitter_write(&emitter, body.data, body.len);
             }
-            if (!element_found_in_file) break;
-
-            // Prepare regex to match key-value lines
-            static const char *pattern = "^[ \t]*[A-Za-z0-9_-]+:[ \t]*[^ \t\n]+.*$";
-            regex_t regex;
-            VALIDATE(!regcomp(&regex, pattern, REG_EXTENDED), break, "", "Regex compilation failed")
-            
-            while (fgets(line, sizeof(line), loc_serializer_file)) {            // pars all lines that come after
-
-                const u32 indent = get_indentation(line);
-                if (indent < serializer->current_indentation) break;            // stop when section ends
-                if (indent > serializer->current_indentation) continue;         // skip any potential subsection
-
-                // check if line looks like this using regex:      <leading indentation><string>: <string>
-                if (regexec(&regex, line, 0, NULL, 0) == 0)
-                    ds_append_str(&serializer->section_content, skip_indentation(line));
+            if (!fields)
+                emitter_write(&emitter, body.data, body.len);
+
+            offset_array_free(&old_items);
+            emitter_end(&emitter, end);
+        }
+
+        ds_clear(&serializer->section_content);             // content is already saved, prevent sy_subsection_end() from adding it again
+        ds_free(&body);
+        arena_reset_to_mark(scratch, mark);
+
+    } else {
+
+        const char* raw_content = NULL;
+        size_t raw_content_len = 0;
+        get_raw_content_of_section(serializer, &raw_content, &raw_content_len);
+
+        offset_array items;                                 // offset of every item, followed by [raw_content_len]
+        offset_array_init(&items);
+        find_sequence_items(raw_content, raw_content_len, serializer->current_indentation, &items);
+        const size_t item_count = offset_array_size(&items) -1;
+
+        // every item is loaded into [section_content] as "key: value\n" lines
+        if (fields && get_parse_thread_count(item_count) > 1)
+            parse_sequence_parallel(raw_content, items.data, item_count, serializer->current_indentation, data_structure, element_size, fields, field_count, append);
+
+        else for (size_t x = 0; x < item_count; x++) {
+            ds_clear(&serializer->section_content);
+            sequence_item_content(raw_content + *offset_array_at(&items, x), raw_content + *offset_array_at(&items, x +1), serializer->current_indentation, &serializer->section_content);
+
+            if (record_callback) {                                              // hand over the raw "key: value\n" lines
+                record_callback(data_structure, serializer->section_content.data, serializer->section_content.len);
+                continue;
             }
-            regfree(&regex); // Don't forget to free the regex
 
-            char current_header[STR_SEC_LEN] = {0};
-            stack_peek(&serializer->section_headers, &current_header);
-            LOG(Info, "current_header [%s] serializer->section_content: \n%s", current_header, serializer->section_content.data)
+            memset(element, 0, element_size);
+            if (fields)
+                decode_fields(serializer->section_content.data, serializer->section_content.len, element, fields, field_count);
+            else
+                callback(serializer, element);
+            append(data_structure, element);                                    // append new element to back
+        }
+        ds_clear(&serializer->section_content);
+        offset_array_free(&items);
+    }
+
+    free(element);
+    sy_subsection_end(serializer);
+}
+
+
+void sy_loop(SY* serializer, const char* name, void* data_structure, size_t element_size, sy_loop_callback_t callback, sy_loop_callback_at_t accessor, sy_loop_callback_append_t append, sy_loop_DS_size_callback_t data_structure_size) {
+
+    serialize_sequence(serializer, name, data_structure, element_size, callback, NULL, 0, NULL, accessor, append, NULL, data_structure_size);
+}
+
+
+void sy_loop_fields(SY* serializer, const char* name, void* data_structure, size_t element_size, const sy_field* fields, const size_t field_count, sy_loop_callback_at_t accessor, sy_loop_callback_append_t append, sy_loop_DS_size_callback_t data_structure_size) {
+
+    serialize_sequence(serializer, name, data_structure, element_size, NULL, fields, field_count, NULL, accessor, append, NULL, data_structure_size);
+}
+
+
+void sy_loop_fields_changed(SY* serializer, const char* name, void* data_structure, size_t element_size, const sy_field* fields, const size_t field_count, sy_loop_callback_at_t accessor, sy_loop_changed_callback_t changed, sy_loop_DS_size_callback_t data_structure_size) {
+
+    ASSERT(serializer->option == SERIALIZER_OPTION_SAVE, "", "sy_loop_fields_changed() can only be used to save [%s]", name)
+    serialize_sequence(serializer, name, data_structure, element_size, NULL, fields, field_count, NULL, accessor, NULL, changed, data_structure_size);
+}
+
+
+void sy_loop_records(SY* serializer, const char* name, void* data_structure, sy_loop_record_callback_t callback) {
 
-        } while (0);
+    ASSERT(serializer->option == SERIALIZER_OPTION_LOAD, "", "sy_loop_records() can only be used to load [%s]", name)
+    serialize_sequence(serializer, name, data_structure, 1, NULL, NULL, 0, callback, NULL, NULL, NULL, NULL);
+}
+
+
+// ============================================================================================================================================
+// reload
+// ============================================================================================================================================
+
+// copies the key of the first line of [section] ("name:" -> "name") into [name]
+// @return false if the section does not start with a key
+static b8 section_get_name(const sy_section* section, char* name, const size_t size) {
+
+    const char* line_end = memchr(section->data, '\n', section->len);
+    const size_t line_len = line_end ? (size_t)(line_end - section->data) : section->len;
+    const char* colon = memchr(section->data, ':', line_len);
+    if (!colon) return false;
+
+    size_t len = (size_t)(colon - section->data);
+    while (len > 0 && (section->data[len -1] == ' ' || section->data[len -1] == '\t'))
+        len--;
+    if (len == 0 || len >= size) return false;
+
+    memcpy(name, section->data, len);
+    name[len] = '\0';
+    return true;
+}
+
+
+// true if [version] contains a section with the name [name]
+static b8 version_has_section(const sy_version* version, const char* name) {
+
+    char loc_name[STR_SEC_LEN];
+    for (u32 x = 0; x < version->section_count; x++)
+        if (section_get_name(version->sections[x], loc_name, sizeof(loc_name)) && strcmp(loc_name, name) == 0)
+            return true;
+    return false;
+}
+
+
+// true if [section] itself (not only the same content) is part of [version]
+static b8 version_shares_section(const sy_version* version, const sy_section* section) {
+
+    for (u32 x = 0; x < version->section_count; x++)
+        if (version->sections[x] == section)
+            return true;
+    return false;
+}
 
+
+i32 sy_reload(const char* dir_path, const char* file_name, sy_section_changed_callback_t callback, void* user_data) {
+
+    char loc_file_path[PATH_MAX];
+    const int written = snprintf(loc_file_path, sizeof(loc_file_path), "%s/%s", dir_path, file_name);
+    VALIDATE(written >= 0 && (size_t)written < sizeof(loc_file_path), return -1, "", "Path too long: %s/%s", dir_path, file_name)
+
+    FILE* fp = fopen(loc_file_path, "r");                           // read only, closing it does not look like a modification to file watchers
+    if (!fp) return -1;
+
+    sy_document* document = document_attach(loc_file_path);
+    VALIDATE(document, fclose(fp); return -1, "", "Failed to allocate document of [%s]", loc_file_path)
+
+    pthread_mutex_lock(&document->write_mutex);
+    sy_version* previous = document_acquire(document);
+    sy_version* current = document_reload_locked(document, fp);
+    pthread_mutex_unlock(&document->write_mutex);
+    fclose(fp);
+
+    // sections are shared between versions if their content did not change, so only new section objects were modified
+    i32 reported = 0;
+    char name[STR_SEC_LEN];
+    if (current && previous != current) {
+
+        for (u32 x = 0; x < current->section_count; x++) {
+            if ((previous && version_shares_section(previous, current->sections[x])) || !section_get_name(current->sections[x], name, sizeof(name)))
+                continue;
+            if (callback) callback(name, user_data);
+            reported++;
+        }
+
+        for (u32 x = 0; previous && x < previous->section_count; x++) {                   // removed sections
+            if (version_shares_section(current, previous->sections[x]) || !section_get_name(previous->sections[x], name, sizeof(name)) || version_has_section(current, name))
+                continue;
+            if (callback) callback(name, user_data);
+            reported++;
+        }
     }
-    
+
+    if (reported > 0)
+        LOG(Trace, "Reloaded [%s] as version [%lu], [%d] sections changed", loc_file_path, current->number, reported)
+
+    const i32 result = current ? reported : -1;
+    version_release(previous);
+    version_release(current);
+    document_detach(document);
+    return result;
 }
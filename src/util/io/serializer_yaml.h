@@ -1,12 +1,13 @@
 #pragma once
 
 #include <limits.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 
 #include "util/data_structure/data_types.h"
 #include "util/data_structure/dynamic_string.h"
-#include "util/data_structure/stack.h"
+#include "util/data_structure/small_vector.h"
 #include "util/util.h"
 
 
@@ -17,6 +18,13 @@ typedef enum {
 
 
 #define STR_SEC_LEN     128
+#define SY_INLINE_HEADERS   4                       // nesting depth of sections that needs no allocation
+
+typedef struct {
+    char                name[STR_SEC_LEN];
+} sy_header;
+
+SMALL_VECTOR_DEFINE(sy_header_stack, sy_header, SY_INLINE_HEADERS)
 
 typedef struct {
 
@@ -24,30 +32,112 @@ typedef struct {
     serializer_option   option;
     u32                 current_indentation;
     dyn_str             section_content;
-    stack               section_headers;
+    sy_header_stack     section_headers;
+    char                file_path[PATH_MAX];
+    struct sy_document* document;                   // in-memory content of the file, shared by all serializers of the file
+    struct sy_version*  version;                    // snapshot this serializer reads, held until sy_shutdown() when loading
+    u64                 file_reads;                 // of the document at sy_init(), tells saves if the file was changed by someone else since
 } SY;
 
 
+// @brief Type tags used to select the parse/format routine of a value.
+//        Replaces the printf-style format strings, which could not tell apart values of the same
+//        conversion but different width (i8/i16/i32 are all "%d")
+typedef enum {
+    SY_TYPE_I8 = 0,
+    SY_TYPE_I16,
+    SY_TYPE_I32,
+    SY_TYPE_I64,
+    SY_TYPE_U8,
+    SY_TYPE_U16,
+    SY_TYPE_U32,
+    SY_TYPE_U64,
+    SY_TYPE_F32,
+    SY_TYPE_F64,
+    SY_TYPE_F128,
+    SY_TYPE_B8,
+    SY_TYPE_STR,                    // fixed size char buffer, the buffer size is needed to load it
+} sy_type;
+
+// enums are compatible with [u32] and therefore map to SY_TYPE_U32
+#define SY_TYPE_OF(x) _Generic((x),                                                 \
+    i8: SY_TYPE_I8, i16: SY_TYPE_I16, i32: SY_TYPE_I32, i64: SY_TYPE_I64,           \
+    u8: SY_TYPE_U8, u16: SY_TYPE_U16, u32: SY_TYPE_U32, u64: SY_TYPE_U64,           \
+    f32: SY_TYPE_F32, f64: SY_TYPE_F64, f128: SY_TYPE_F128,                         \
+    b8: SY_TYPE_B8, char*: SY_TYPE_STR                                              \
+)
+
+
+// @brief Describes one member of a struct so the serializer can load/save it without a user callback.
+//        Create with SY_FIELD() and group all members of a struct in a static table.
+typedef struct {
+    const char*         key;        // key used in the YAML file
+    size_t              offset;     // offsetof() the member inside the struct
+    size_t              size;       // sizeof() the member (buffer size for SY_TYPE_STR)
+    sy_type             type;
+} sy_field;
+
+#define SY_FIELD(struct_type, member)   { #member, offsetof(struct_type, member), sizeof(((struct_type*)0)->member), SY_TYPE_OF(((struct_type*)0)->member) }
+#define SY_FIELD_COUNT(table)           (sizeof(table) / sizeof((table)[0]))
+
+
 #define S_KEY(variable)                 util_extract_variable_name(#variable)
 #define S_KEY_VALUE(variable)           S_KEY(variable), &variable
-#define S_VALUE_FORMAT(variable)        &variable, TYPE_FORMAT(variable)
-#define S_KEY_VALUE_FORMAT(variable)    S_KEY_VALUE(variable), TYPE_FORMAT(variable)
+#define S_VALUE_TYPE(variable)          &variable, SY_TYPE_OF(variable)
+#define S_KEY_VALUE_TYPE(variable)      S_KEY_VALUE(variable), SY_TYPE_OF(variable)
 
 
 // Core functions
 b8 sy_init(SY* serializer, const char* dir_path, const char* file_name, const char* section_name, const serializer_option option);
 void sy_shutdown(SY* sy);
 
-void sy_entry(SY* serializer, const char* key, void* value, const char* format);    // Generic, user needs to define the format for the values
+void sy_entry(SY* serializer, const char* key, void* value, const sy_type type);   // for numeric and bool values, use sy_entry_str() for strings
 void sy_entry_str(SY* serializer, const char* key, char* value, size_t buffer_size);
 
+// @brief Loads/saves every member described in [fields] of the struct at [element] in the current section.
+//        Loading parses the section content once instead of searching it for every key.
+void sy_entry_fields(SY* serializer, void* element, const sy_field* fields, const size_t field_count);
+
+// @brief Decodes a record received by a sy_loop_record_callback_t into [element], same rules as sy_entry_fields()
+void sy_decode_fields(const char* record, const size_t record_len, void* element, const sy_field* fields, const size_t field_count);
+
+// @brief Finds the value of [key] in a record received by a sy_loop_record_callback_t
+// @return true if the key exists, [value] is not null terminated
+b8 sy_record_find(const char* record, const size_t record_len, const char* key, const char** value, size_t* value_len);
+
 // Subsection function
 void sy_subsection_begin(SY* serializer, const char* name);
 void sy_subsection_end(SY* serializer);
 
 typedef bool (*sy_loop_callback_t)(SY* serializer, void* element);
-typedef i32 (*sy_loop_callback_at_t)(void* data_structure, const u64 index, void* element);
+typedef i32 (*sy_loop_callback_at_t)(void* data_structure, const u64 index, void* element);                 // copy element at [index] into [element]
 typedef i32 (*sy_loop_callback_append_t)(void* data_structure, void* data);         // append [data] to END of [data_structure] specific to the users structure
 typedef size_t (*sy_loop_DS_size_callback_t)(void* data_structure);
+typedef void (*sy_loop_record_callback_t)(void* data_structure, const char* record, const size_t record_len);     // [record] are the "key: value\n" lines of one element
+typedef b8 (*sy_loop_changed_callback_t)(void* data_structure, const u64 index);    // true if element [index] differs from its item in the file
 
+// @brief Serializes a data structure as a YAML sequence in subsection [name]. Every element is handled by [callback]
 void sy_loop(SY* serializer, const char* name, void* data_structure, size_t element_size, sy_loop_callback_t callback, sy_loop_callback_at_t accessor, sy_loop_callback_append_t append, sy_loop_DS_size_callback_t data_structure_size);
+
+// @brief Same as sy_loop() but every element is described by a field table, this avoids the per-field callback
+//        and formats/parses the whole sequence in a single pass. Large sequences are decoded by several threads,
+//        [append] is still called on the calling thread in the order of the file
+void sy_loop_fields(SY* serializer, const char* name, void* data_structure, size_t element_size, const sy_field* fields, const size_t field_count, sy_loop_callback_at_t accessor, sy_loop_callback_append_t append, sy_loop_DS_size_callback_t data_structure_size);
+
+// @brief Saves a sequence like sy_loop_fields() but only formats the elements [changed] returns true for, the items of all others are
+//        copied from the file content at sy_init(). Everything is formatted if the file was modified by someone else after sy_init()
+//        or its sequence does not have one item per element. Only valid for SERIALIZER_OPTION_SAVE
+void sy_loop_fields_changed(SY* serializer, const char* name, void* data_structure, size_t element_size, const sy_field* fields, const size_t field_count, sy_loop_callback_at_t accessor, sy_loop_changed_callback_t changed, sy_loop_DS_size_callback_t data_structure_size);
+
+// @brief Loads a sequence without decoding it, every element is handed to [callback] as its raw "key: value\n" lines.
+//        Used to defer decoding, e.g. to migrate records of an older layout on first access. Only valid for SERIALIZER_OPTION_LOAD
+void sy_loop_records(SY* serializer, const char* name, void* data_structure, sy_loop_record_callback_t callback);
+
+
+typedef void (*sy_section_changed_callback_t)(const char* section_name, void* user_data);
+
+// @brief Brings the in-memory content of [dir_path]/[file_name] up to date after the file was modified outside of the serializer
+//        and calls [callback] with the name of every top level section that was changed, added or removed.
+//        Changes saved through the serializer are never reported, so watchers can ignore the events of their own saves
+// @return number of reported sections, -1 if the file could not be read
+i32 sy_reload(const char* dir_path, const char* file_name, sy_section_changed_callback_t callback, void* user_data);
@@ -0,0 +1,249 @@
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <tmmintrin.h>
+    #define UTF8_SSSE3
+#endif
+
+#include "util/io/utf8.h"
+
+
+#define IS_CONTINUATION(c)      (((c) & 0xC0) == 0x80)
+#define ASCII_MASK              0x8080808080808080ULL
+
+
+// ============================================================================================================================================
+// scalar
+// ============================================================================================================================================
+
+// @return length of the well formed sequence at [str], 0 if it is invalid or truncated
+static size_t sequence_length(const u8* str, const size_t len) {
+
+    const u8 lead = str[0];
+    if (lead < 0x80) return 1;
+
+    // ranges of the second byte exclude overlong encodings (E0, F0), surrogates (ED) and code points above U+10FFFF (F4)
+    size_t length;
+    u8 low = 0x80, high = 0xBF;
+    if (lead >= 0xC2 && lead <= 0xDF)       length = 2;
+    else if (lead >= 0xE0 && lead <= 0xEF) {
+        length = 3;
+        if (lead == 0xE0) low = 0xA0;
+        if (lead == 0xED) high = 0x9F;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        length = 4;
+        if (lead == 0xF0) low = 0x90;
+        if (lead == 0xF4) high = 0x8F;
+    } else
+        return 0;
+
+    if (len < length || str[1] < low || str[1] > high) return 0;
+    for (size_t x = 2; x < length; x++)
+        if (!IS_CONTINUATION(str[x])) return 0;
+    return length;
+}
+
+// @return start of the sequence that is cut in half by [pos], [pos] if no sequence crosses it
+static size_t sequence_start(const u8* str, const size_t pos) {
+
+    for (size_t x = pos; x > 0 && pos - x < 3; ) {
+        x--;
+        if (str[x] >= 0xC0) {
+            const size_t length = (str[x] >= 0xF0) ? 4 : (str[x] >= 0xE0) ? 3 : 2;
+            return (x + length > pos) ? x : pos;
+        }
+        if (!IS_CONTINUATION(str[x])) break;
+    }
+    return pos;
+}
+
+static size_t valid_length_scalar(const u8* str, const size_t len) {
+
+    size_t x = 0;
+    while (x < len) {
+
+        if (x + 8 <= len) {                                             // skip ASCII runs a word at a time
+            u64 word;
+            memcpy(&word, str + x, sizeof(word));
+            if (!(word & ASCII_MASK)) {
+                x += 8;
+                continue;
+            }
+        }
+
+        const size_t length = sequence_length(str + x, len - x);
+        if (length == 0) return x;
+        x += length;
+    }
+    return len;
+}
+
+
+// ============================================================================================================================================
+// SSSE3
+// ============================================================================================================================================
+
+#ifdef UTF8_SSSE3
+
+// Lookup algorithm of Keiser and Lemire ("Validating UTF-8 In Less Than One Instruction Per Byte"): the high nibble of the previous
+// byte, its low nibble and the high nibble of the current byte each select a bit set of the errors they could be part of,
+// a pair of bytes is invalid if all three lookups share an error bit. Sequences of 3 and 4 bytes are checked by the position of their lead.
+#define TOO_SHORT       (1 << 0)        // lead byte not followed by a continuation
+#define TOO_LONG        (1 << 1)        // ASCII followed by a continuation
+#define OVERLONG_3      (1 << 2)
+#define TOO_LARGE       (1 << 3)
+#define SURROGATE       (1 << 4)
+#define OVERLONG_2      (1 << 5)
+#define TOO_LARGE_1000  (1 << 6)
+#define OVERLONG_4      (1 << 6)
+#define TWO_CONTS       (1 << 7)        // continuation after a continuation, valid if a 3 or 4 byte lead requires it
+#define CARRY           (TOO_SHORT | TOO_LONG | TWO_CONTS)
+
+__attribute__((target("ssse3")))
+static inline __m128i prev_bytes(const __m128i input, const __m128i prev_input, const int count) {
+
+    switch (count) {
+        case 1:     return _mm_alignr_epi8(input, prev_input, 15);
+        case 2:     return _mm_alignr_epi8(input, prev_input, 14);
+        default:    return _mm_alignr_epi8(input, prev_input, 13);
+    }
+}
+
+__attribute__((target("ssse3")))
+static inline __m128i high_nibbles(const __m128i bytes)        { return _mm_and_si128(_mm_srli_epi16(bytes, 4), _mm_set1_epi8(0x0F)); }
+
+// @return bytes with an error bit set for every invalid position of [input]
+__attribute__((target("ssse3")))
+static inline __m128i check_block(const __m128i input, const __m128i prev_input) {
+
+    const __m128i byte_1_high_table = _mm_setr_epi8(
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,         // 0_______ ASCII
+        TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,                                             // 10______ continuation
+        TOO_SHORT | OVERLONG_2,                                                                 // 1100____
+        TOO_SHORT,                                                                              // 1101____
+        TOO_SHORT | OVERLONG_3 | SURROGATE,                                                     // 1110____
+        TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4);                                   // 1111____
+    const __m128i byte_1_low_table = _mm_setr_epi8(
+        CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,                                           // ____0000
+        CARRY | OVERLONG_2,                                                                     // ____0001
+        CARRY, CARRY,                                                                           // ____001_
+        CARRY | TOO_LARGE,                                                                      // ____0100
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,                 // ____0101, ____0110
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,                 // ____0111, ____1000
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,                                         // ____1101
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000);
+    const __m128i byte_2_high_table = _mm_setr_epi8(
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, // 0_______ ASCII
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,           // 1000____
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,                             // 1001____
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,                              // 101_____
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT);                                            // 11______ lead
+
+    const __m128i prev1 = prev_bytes(input, prev_input, 1);
+    const __m128i special_cases = _mm_and_si128(_mm_and_si128(
+        _mm_shuffle_epi8(byte_1_high_table, high_nibbles(prev1)),
+        _mm_shuffle_epi8(byte_1_low_table, _mm_and_si128(prev1, _mm_set1_epi8(0x0F)))),
+        _mm_shuffle_epi8(byte_2_high_table, high_nibbles(input)));
+
+    // the 3rd byte after a 3 or 4 byte lead and the 4th byte after a 4 byte lead have to be continuations
+    const __m128i is_third_byte = _mm_subs_epu8(prev_bytes(input, prev_input, 2), _mm_set1_epi8((char)(0xE0 - 0x80)));
+    const __m128i is_fourth_byte = _mm_subs_epu8(prev_bytes(input, prev_input, 3), _mm_set1_epi8((char)(0xF0 - 0x80)));
+    const __m128i must_be_continuation = _mm_and_si128(_mm_or_si128(is_third_byte, is_fourth_byte), _mm_set1_epi8((char)0x80));
+    return _mm_xor_si128(must_be_continuation, special_cases);
+}
+
+__attribute__((target("ssse3")))
+static size_t valid_length_ssse3(const u8* str, const size_t len) {
+
+    // non zero where a sequence starting in the last 3 bytes of a block continues in the next block
+    const __m128i incomplete_max = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+    const __m128i zero = _mm_setzero_si128();
+    __m128i prev_input = zero;
+    __m128i prev_incomplete = zero;
+
+    size_t x = 0;
+    for (; x + 16 <= len; x += 16) {
+
+        const __m128i input = _mm_loadu_si128((const __m128i*)(str + x));
+        __m128i error;
+        if (_mm_movemask_epi8(input) == 0) {                            // ASCII, only a sequence of the previous block can be cut off
+            error = prev_incomplete;
+            prev_incomplete = zero;
+        } else {
+            error = check_block(input, prev_input);
+            prev_incomplete = _mm_subs_epu8(input, incomplete_max);
+        }
+        prev_input = input;
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(error, zero)) != 0xFFFF)  // locate the error with the scalar check
+            break;
+    }
+
+    // everything before [x] is valid except for a sequence that crosses it, continue from its lead byte
+    const size_t start = sequence_start(str, x);
+    return start + valid_length_scalar(str + start, len - start);
+}
+
+#endif
+
+
+// ============================================================================================================================================
+// validation
+// ============================================================================================================================================
+
+size_t utf8_valid_length(const char* str, const size_t len) {
+
+#ifdef UTF8_SSSE3
+    if (len >= 16 && __builtin_cpu_supports("ssse3"))
+        return valid_length_ssse3((const u8*)str, len);
+#endif
+    return valid_length_scalar((const u8*)str, len);
+}
+
+
+// ============================================================================================================================================
+// truncation and repair
+// ============================================================================================================================================
+
+size_t utf8_truncate(const char* str, const size_t len, const size_t max_len) {
+
+    if (len <= max_len) return len;
+
+    return sequence_start((const u8*)str, max_len);                   // a stray continuation at [max_len] is not moved
+}
+
+
+size_t utf8_repair(char* str, const size_t len) {
+
+    u8* bytes = (u8*)str;
+    size_t replaced = 0;
+    size_t x = utf8_valid_length(str, len);
+    while (x < len) {
+
+        const size_t length = sequence_length(bytes + x, len - x);
+        if (length > 0) {
+            x += length;
+            continue;
+        }
+
+        bytes[x++] = '?';
+        replaced++;
+        x += valid_length_scalar(bytes + x, len - x);
+    }
+    return replaced;
+}
+
+
+b8 utf8_copy(char* dest, const size_t dest_size, const char* src, const size_t len) {
+
+    if (dest_size == 0) return true;
+
+    const size_t copy_len = utf8_truncate(src, len, dest_size -1);
+    memcpy(dest, src, copy_len);
+    dest[copy_len] = '\0';
+    return utf8_repair(dest, copy_len) == 0;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "util/data_structure/data_types.h"
+
+
+// Validation and repair of UTF-8 text loaded from files.
+// Well formed means: no stray continuation bytes, no truncated or overlong sequences, no surrogates (U+D800 - U+DFFF)
+// and no code points above U+10FFFF. Validation checks 16 bytes at a time (SSSE3 if the CPU supports it, ASCII runs
+// are skipped 8 bytes at a time otherwise), the per-sequence checks only run for invalid input.
+// All functions read at most [len] bytes, no null terminator is needed.
+
+
+// ============================================================================================================================================
+// validation
+// ============================================================================================================================================
+
+// @brief Checks that [str] is well formed UTF-8
+// @return length of the longest well formed prefix, [len] if the whole string is valid
+size_t utf8_valid_length(const char* str, const size_t len);
+
+
+static inline b8 utf8_is_valid(const char* str, const size_t len)       { return utf8_valid_length(str, len) == len; }
+
+
+// ============================================================================================================================================
+// truncation and repair
+// ============================================================================================================================================
+
+// @brief Finds the largest length <= [max_len] that does not cut a multi-byte sequence of [str] in half
+// @return [len] if the whole string fits into [max_len]
+size_t utf8_truncate(const char* str, const size_t len, const size_t max_len);
+
+
+// @brief Replaces every byte of [str] that is not part of a well formed sequence by '?', the length does not change
+// @return number of replaced bytes
+size_t utf8_repair(char* str, const size_t len);
+
+
+// @brief Copies [src] into [dest] and null terminates it. The copy is truncated at a code point boundary to fit into [dest_size]
+//        and repaired with utf8_repair() if [src] is not well formed
+// @return false if invalid bytes were replaced (truncation alone is not an error)
+b8 utf8_copy(char* dest, const size_t dest_size, const char* src, const size_t len);
@@ -0,0 +1,210 @@
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+
+#define BLOCK_HEADER            32                  // sizeof(arena_block) rounded up to keep the data aligned
+
+#define VALIDATE(a) \
+    do { \
+        if (!(a) || (a)->magic != ARENA_MAGIC) return AT_INVALID_ARGUMENT; \
+    } while (0)
+
+
+struct arena_block {
+    arena_block*        next;
+    size_t              size;                       // bytes of data after the header
+    size_t              used;
+};
+
+STATIC_ASSERT(sizeof(arena_block) <= BLOCK_HEADER, "the block header has to fit in front of the data");
+
+
+static inline size_t align_size(const size_t size)          { return (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1); }
+
+static inline u8* block_data(const arena_block* block)      { return (u8*)block + BLOCK_HEADER; }
+
+
+static arena_block* block_create(const size_t size) {
+
+    if (size > SIZE_MAX - BLOCK_HEADER) return NULL;
+
+    arena_block* block = malloc(BLOCK_HEADER + size);
+    if (block)
+        *block = (arena_block){ .next = NULL, .size = size, .used = 0 };
+    return block;
+}
+
+static void free_blocks(arena* a) {
+
+    arena_block* block = a->first;
+    while (block) {
+        arena_block* next = block->next;
+        free(block);
+        block = next;
+    }
+    a->first = a->current = NULL;
+}
+
+
+// ============================================================================================================================================
+// Initialization and cleanup
+// ============================================================================================================================================
+
+i32 arena_init(arena* a, const size_t block_size) {
+
+    if (!a) return AT_INVALID_ARGUMENT;
+    if (a->magic == ARENA_MAGIC) return AT_ALREADY_INITIALIZED;
+
+    *a = (arena){ .block_size = align_size(block_size ? block_size : ARENA_DEFAULT_BLOCK_SIZE), .magic = ARENA_MAGIC };
+    return AT_SUCCESS;
+}
+
+
+i32 arena_free(arena* a) {
+
+    VALIDATE(a);
+
+    free_blocks(a);
+    a->magic = 0;
+    return AT_SUCCESS;
+}
+
+
+// ============================================================================================================================================
+// Allocation
+// ============================================================================================================================================
+
+void* arena_alloc(arena* a, const size_t size) {
+
+    if (!a || a->magic != ARENA_MAGIC || size > SIZE_MAX - ARENA_ALIGNMENT) return NULL;
+
+    const size_t aligned = align_size(size ? size : 1);
+    arena_block* block = a->current;
+    while (block && block->size - block->used < aligned)                // following blocks are empty leftovers of earlier rounds
+        block = block->next;
+
+    if (!block) {
+        block = block_create((aligned > a->block_size) ? aligned : a->block_size);
+        if (!block) return NULL;
+
+        if (a->current) {                                               // keep the order, marks refer to the blocks before
+            block->next = a->current->next;
+            a->current->next = block;
+        } else
+            a->first = block;
+    }
+
+    a->current = block;
+    void* memory = block_data(block) + block->used;
+    block->used += aligned;
+    return memory;
+}
+
+
+void* arena_realloc(arena* a, void* block, const size_t old_size, const size_t new_size) {
+
+    if (!block) return arena_alloc(a, new_size);
+    if (!a || a->magic != ARENA_MAGIC || new_size > SIZE_MAX - ARENA_ALIGNMENT) return NULL;
+
+    // the newest allocation ends at the position of the current block and can grow or shrink there
+    arena_block* current = a->current;
+    const size_t old_aligned = align_size(old_size ? old_size : 1);
+    if (current && (u8*)block >= block_data(current) && (u8*)block + old_aligned == block_data(current) + current->used) {
+        const size_t new_used = current->used - old_aligned + align_size(new_size ? new_size : 1);
+        if (new_used <= current->size) {
+            current->used = new_used;
+            return block;
+        }
+    }
+
+    if (new_size <= old_size) return block;
+
+    void* moved = arena_alloc(a, new_size);
+    if (moved)
+        memcpy(moved, block, old_size);
+    return moved;
+}
+
+
+// ============================================================================================================================================
+// Marks and reset
+// ============================================================================================================================================
+
+arena_mark arena_get_mark(const arena* a) {
+
+    if (!a || !a->current) return (arena_mark){ NULL, 0 };
+    return (arena_mark){ a->current, a->current->used };
+}
+
+
+void arena_reset_to_mark(arena* a, const arena_mark mark) {
+
+    if (!a || a->magic != ARENA_MAGIC) return;
+
+    arena_block* block = a->first;
+    if (mark.block) {
+        mark.block->used = mark.used;
+        block = mark.block->next;
+    }
+    for (; block; block = block->next)
+        block->used = 0;
+    a->current = mark.block ? mark.block : a->first;
+}
+
+
+void arena_reset(arena* a) {
+
+    if (!a || a->magic != ARENA_MAGIC || !a->first) return;
+
+    if (!a->first->next) {
+        a->first->used = 0;
+        a->current = a->first;
+        return;
+    }
+
+    size_t total = 0;
+    for (arena_block* block = a->first; block; block = block->next)
+        total += block->size;
+
+    free_blocks(a);
+    a->block_size = total;
+    a->first = a->current = block_create(total);                       // on failure the next allocation tries again
+}
+
+
+// ============================================================================================================================================
+// Scratch arena
+// ============================================================================================================================================
+
+static pthread_key_t            s_scratch_key;
+static pthread_once_t           s_scratch_once = PTHREAD_ONCE_INIT;
+static _Thread_local arena*     s_scratch = NULL;
+
+
+static void scratch_destroy(void* data) {
+
+    arena_free((arena*)data);
+    free(data);
+}
+
+static void scratch_key_create(void)                        { pthread_key_create(&s_scratch_key, scratch_destroy); }
+
+
+arena* arena_scratch(void) {
+
+    if (s_scratch) return s_scratch;
+
+    pthread_once(&s_scratch_once, scratch_key_create);
+    arena* loc_arena = calloc(1, sizeof(arena));
+    if (!loc_arena) return NULL;
+
+    arena_init(loc_arena, 0);
+    pthread_setspecific(s_scratch_key, loc_arena);                      // freed by scratch_destroy() when the thread exits
+    s_scratch = loc_arena;
+    return s_scratch;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "util/data_structure/data_types.h"
+
+
+// Linear allocator for memory that lives for one frame or one task (formatting a log message, loading a file).
+// Allocations bump a position in the current block and are never freed one by one; everything after a mark is dropped at
+// once by arena_reset_to_mark() or arena_reset(). Blocks are kept for the next round, arena_reset() merges them into a single
+// block of their combined size, so after the first rounds an arena does not call malloc() anymore.
+// An arena is not thread safe, use one per thread (see arena_scratch()).
+
+
+#define ARENA_DEFAULT_BLOCK_SIZE    (64 * 1024)
+#define ARENA_ALIGNMENT             16
+
+#define ARENA_MAGIC                 0x4152454E
+
+
+typedef struct arena_block arena_block;
+
+typedef struct arena {
+    arena_block*        first;
+    arena_block*        current;                // allocations come from here, the blocks after it are empty
+    size_t              block_size;             // size of new blocks, grows to the memory used before arena_reset()
+    u32                 magic;
+} arena;
+
+// position of an arena, see arena_get_mark()
+typedef struct {
+    arena_block*        block;
+    size_t              used;
+} arena_mark;
+
+
+// static arenas can be initialized with this instead of arena_init()
+#define ARENA_INITIALIZER       { .block_size = ARENA_DEFAULT_BLOCK_SIZE, .magic = ARENA_MAGIC }
+
+
+// ============================================================================================================================================
+// Initialization and cleanup
+// ============================================================================================================================================
+
+// @brief Initializes an empty arena, the first block of [block_size] bytes (0 for the default) is allocated on first use
+// @return AT_SUCCESS on success, error code on failure
+i32 arena_init(arena* a, const size_t block_size);
+
+
+// @brief Frees all blocks, the arena has to be initialized again before the next use
+// @return AT_SUCCESS on success, error code on failure
+i32 arena_free(arena* a);
+
+
+// ============================================================================================================================================
+// Allocation
+// ============================================================================================================================================
+
+// @brief Allocates [size] bytes aligned to ARENA_ALIGNMENT, valid until the arena is reset to a mark taken before this call
+// @return the memory, NULL on failure
+void* arena_alloc(arena* a, const size_t size);
+
+
+// @brief Resizes a block of arena_alloc(). The newest block of the arena grows in place if the current block has room,
+//        other blocks are copied (the old memory stays allocated until the reset)
+// @return the resized memory, NULL on failure ([block] is unchanged in that case)
+void* arena_realloc(arena* a, void* block, const size_t old_size, const size_t new_size);
+
+
+// ============================================================================================================================================
+// Marks and reset
+// ============================================================================================================================================
+
+// @brief Returns the current position, all memory allocated after it can be released with arena_reset_to_mark()
+arena_mark arena_get_mark(const arena* a);
+
+
+// @brief Releases all memory allocated after [mark], the blocks are kept
+void arena_reset_to_mark(arena* a, const arena_mark mark);
+
+
+// @brief Releases all memory of the arena. If more than one block was needed, the blocks are replaced by one block of their
+//        combined size, so the next round fits into it
+void arena_reset(arena* a);
+
+
+// @brief Arena of the calling thread for temporary memory of a task, freed when the thread exits.
+//        Take a mark before using it and reset to it when done, nested tasks then share the arena
+arena* arena_scratch(void);
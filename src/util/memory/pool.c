@@ -0,0 +1,228 @@
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "pool.h"
+
+
+#define SLAB_HEADER             16                  // link to the next slab, keeps the blocks 16 byte aligned
+
+#define VALIDATE(pool) \
+    do { \
+        if (!(pool) || (pool)->magic != POOL_MAGIC) return AT_INVALID_ARGUMENT; \
+    } while (0)
+
+
+// steps of 1.5x waste at most a third of a block, all sizes are multiples of 16
+static const u32 c_class_sizes[POOL_CLASS_COUNT] = { 16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096, 6144, 8192 };
+
+STATIC_ASSERT(POOL_MAX_BLOCK_SIZE == 8192, "the last size class has to be POOL_MAX_BLOCK_SIZE");
+
+
+// @return size class of [size], POOL_CLASS_COUNT if it is too large for the pool
+static inline u32 size_class(const size_t size) {
+
+    u32 class_index = 0;
+    while (class_index < POOL_CLASS_COUNT && c_class_sizes[class_index] < size)
+        class_index++;
+    return class_index;
+}
+
+
+// [pool->mutex] has to be held
+static pool_block* take_locked(pool_allocator* pool, const u32 class_index) {
+
+    pool_class* loc_class = &pool->classes[class_index];
+    pool_block* block = loc_class->free_list;
+    if (block) {
+        loc_class->free_list = block->next;
+        return block;
+    }
+
+    const size_t block_size = c_class_sizes[class_index];
+    if ((size_t)(loc_class->bump_end - loc_class->bump) < block_size) {
+        u8* slab = malloc(POOL_SLAB_SIZE);                              // the rest of the previous slab is unused until pool_release_all()
+        if (!slab) return NULL;
+
+        *(void**)slab = pool->slabs;
+        pool->slabs = slab;
+        pool->slab_count++;
+        loc_class->bump = slab + SLAB_HEADER;
+        loc_class->bump_end = slab + POOL_SLAB_SIZE;
+    }
+
+    block = (pool_block*)loc_class->bump;
+    loc_class->bump += block_size;
+    return block;
+}
+
+
+// ============================================================================================================================================
+// Initialization and cleanup
+// ============================================================================================================================================
+
+i32 pool_init(pool_allocator* pool) {
+
+    if (!pool) return AT_INVALID_ARGUMENT;
+    if (pool->magic == POOL_MAGIC) return AT_ALREADY_INITIALIZED;
+
+    memset(pool, 0, sizeof(*pool));
+    if (pthread_mutex_init(&pool->mutex, NULL) != 0) return AT_ERROR;
+    pool->magic = POOL_MAGIC;
+    return AT_SUCCESS;
+}
+
+
+i32 pool_free(pool_allocator* pool) {
+
+    const i32 result = pool_release_all(pool);
+    if (result != AT_SUCCESS) return result;
+
+    pthread_mutex_destroy(&pool->mutex);
+    pool->magic = 0;
+    return AT_SUCCESS;
+}
+
+
+i32 pool_release_all(pool_allocator* pool) {
+
+    VALIDATE(pool);
+
+    pthread_mutex_lock(&pool->mutex);
+    void* slab = pool->slabs;
+    while (slab) {
+        void* next = *(void**)slab;
+        free(slab);
+        slab = next;
+    }
+    pool->slabs = NULL;
+    pool->slab_count = 0;
+    memset(pool->classes, 0, sizeof(pool->classes));
+    pthread_mutex_unlock(&pool->mutex);
+    return AT_SUCCESS;
+}
+
+
+// ============================================================================================================================================
+// Blocks
+// ============================================================================================================================================
+
+void* pool_alloc(pool_allocator* pool, const size_t size) {
+
+    if (!pool || pool->magic != POOL_MAGIC) return NULL;
+
+    const u32 class_index = size_class(size);
+    if (class_index == POOL_CLASS_COUNT)
+        return malloc(size);
+
+    pthread_mutex_lock(&pool->mutex);
+    pool_block* block = take_locked(pool, class_index);
+    pthread_mutex_unlock(&pool->mutex);
+    return block;
+}
+
+
+void pool_dealloc(pool_allocator* pool, void* block, const size_t size) {
+
+    if (!pool || pool->magic != POOL_MAGIC || !block) return;
+
+    const u32 class_index = size_class(size);
+    if (class_index == POOL_CLASS_COUNT) {
+        free(block);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    pool_block* loc_block = (pool_block*)block;
+    loc_block->next = pool->classes[class_index].free_list;
+    pool->classes[class_index].free_list = loc_block;
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+
+// ============================================================================================================================================
+// Thread cache
+// ============================================================================================================================================
+
+void pool_cache_init(pool_cache* cache, pool_allocator* pool) {
+
+    if (!cache) return;
+    memset(cache, 0, sizeof(*cache));
+    cache->pool = pool;
+}
+
+
+// moves up to [count] blocks of the cache to the free list of the pool
+static void cache_return(pool_cache* cache, const u32 class_index, u32 count) {
+
+    pool_block* first = cache->blocks[class_index];
+    if (!first || count == 0) return;
+
+    pool_block* last = first;
+    u32 moved = 1;
+    for (; moved < count && last->next; moved++)
+        last = last->next;
+    cache->blocks[class_index] = last->next;
+    cache->counts[class_index] -= moved;
+
+    pool_class* loc_class = &cache->pool->classes[class_index];
+    pthread_mutex_lock(&cache->pool->mutex);
+    last->next = loc_class->free_list;
+    loc_class->free_list = first;
+    pthread_mutex_unlock(&cache->pool->mutex);
+}
+
+
+void pool_cache_flush(pool_cache* cache) {
+
+    if (!cache || !cache->pool || cache->pool->magic != POOL_MAGIC) return;
+
+    for (u32 x = 0; x < POOL_CLASS_COUNT; x++)
+        cache_return(cache, x, cache->counts[x]);
+}
+
+
+void* pool_cache_alloc(pool_cache* cache, const size_t size) {
+
+    if (!cache || !cache->pool || cache->pool->magic != POOL_MAGIC) return NULL;
+
+    const u32 class_index = size_class(size);
+    if (class_index == POOL_CLASS_COUNT)
+        return malloc(size);
+
+    if (cache->counts[class_index] == 0) {                              // refill with a batch
+        pthread_mutex_lock(&cache->pool->mutex);
+        for (u32 x = 0; x < POOL_CACHE_BATCH; x++) {
+            pool_block* block = take_locked(cache->pool, class_index);
+            if (!block) break;
+            block->next = cache->blocks[class_index];
+            cache->blocks[class_index] = block;
+            cache->counts[class_index]++;
+        }
+        pthread_mutex_unlock(&cache->pool->mutex);
+        if (cache->counts[class_index] == 0) return NULL;
+    }
+
+    pool_block* block = cache->blocks[class_index];
+    cache->blocks[class_index] = block->next;
+    cache->counts[class_index]--;
+    return block;
+}
+
+
+void pool_cache_dealloc(pool_cache* cache, void* block, const size_t size) {
+
+    if (!cache || !cache->pool || cache->pool->magic != POOL_MAGIC || !block) return;
+
+    const u32 class_index = size_class(size);
+    if (class_index == POOL_CLASS_COUNT) {
+        free(block);
+        return;
+    }
+
+    pool_block* loc_block = (pool_block*)block;
+    loc_block->next = cache->blocks[class_index];
+    cache->blocks[class_index] = loc_block;
+    if (++cache->counts[class_index] >= 2 * POOL_CACHE_BATCH)        // keep a batch for the next allocations, return the rest
+        cache_return(cache, class_index, POOL_CACHE_BATCH);
+}
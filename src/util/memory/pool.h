@@ -0,0 +1,105 @@
+#pragma once
+
+#include <pthread.h>
+#include <stddef.h>
+
+#include "util/data_structure/data_types.h"
+
+
+// Allocator for many small blocks of a few fixed sizes (list nodes, short strings).
+// Blocks are carved from 64 KiB slabs, every size class keeps a free list of returned blocks, so allocations are a pointer pop
+// and blocks of one structure stay close together instead of being spread over the heap. Blocks are returned with their size
+// (no header per block), sizes above POOL_MAX_BLOCK_SIZE go to malloc().
+// The pool is thread safe. A pool_cache moves blocks in batches between a thread and the pool, it takes the lock once per
+// POOL_CACHE_BATCH allocations. All blocks are released at once by pool_release_all() without returning them one by one.
+
+
+#define POOL_SLAB_SIZE          (64 * 1024)
+#define POOL_MAX_BLOCK_SIZE     8192
+#define POOL_CLASS_COUNT        18
+#define POOL_CACHE_BATCH        32                  // blocks a cache takes from or returns to the pool at once
+
+#define POOL_MAGIC              0x504F4F4C
+
+
+typedef struct pool_block {
+    struct pool_block*  next;
+} pool_block;
+
+typedef struct {
+    pool_block*         free_list;
+    u8*                 bump;                       // unused part of the newest slab of this class
+    u8*                 bump_end;
+} pool_class;
+
+typedef struct {
+    pthread_mutex_t     mutex;
+    pool_class          classes[POOL_CLASS_COUNT];
+    void*               slabs;                      // linked by their first word
+    size_t              slab_count;
+    u32                 magic;
+} pool_allocator;
+
+// blocks of one thread that are not in the pool, see pool_cache_alloc()
+typedef struct {
+    pool_allocator*     pool;
+    pool_block*         blocks[POOL_CLASS_COUNT];
+    u32                 counts[POOL_CLASS_COUNT];
+} pool_cache;
+
+
+// static pools can be initialized with this instead of pool_init()
+#define POOL_INITIALIZER        { .mutex = PTHREAD_MUTEX_INITIALIZER, .magic = POOL_MAGIC }
+
+
+// ============================================================================================================================================
+// Initialization and cleanup
+// ============================================================================================================================================
+
+// @brief Initializes an empty pool, memory is allocated on the first pool_alloc()
+// @return AT_SUCCESS on success, error code on failure
+i32 pool_init(pool_allocator* pool);
+
+
+// @brief Releases all memory of the pool, the pool can not be used afterwards
+// @return AT_SUCCESS on success, error code on failure
+i32 pool_free(pool_allocator* pool);
+
+
+// @brief Frees every slab at once, all blocks of the pool become invalid (also the ones held by caches, reinitialize them).
+//        The pool stays usable. Blocks above POOL_MAX_BLOCK_SIZE are not tracked and still have to be returned with pool_dealloc()
+// @return AT_SUCCESS on success, error code on failure
+i32 pool_release_all(pool_allocator* pool);
+
+
+// ============================================================================================================================================
+// Blocks
+// ============================================================================================================================================
+
+// @brief Allocates a block of at least [size] bytes, aligned to 16 bytes
+// @return the block, NULL on failure
+void* pool_alloc(pool_allocator* pool, const size_t size);
+
+
+// @brief Returns a block of pool_alloc(), [size] has to be the size it was allocated with
+void pool_dealloc(pool_allocator* pool, void* block, const size_t size);
+
+
+// ============================================================================================================================================
+// Thread cache
+// ============================================================================================================================================
+
+// @brief Prepares a cache for the calling thread, typically a _Thread_local variable. A cache belongs to one thread and one pool
+void pool_cache_init(pool_cache* cache, pool_allocator* pool);
+
+
+// @brief Returns all cached blocks to the pool, call before the thread exits or the pool is freed
+void pool_cache_flush(pool_cache* cache);
+
+
+// @brief Like pool_alloc() without taking the pool lock for most allocations
+void* pool_cache_alloc(pool_cache* cache, const size_t size);
+
+
+// @brief Like pool_dealloc(), blocks can be returned to any cache of the same pool
+void pool_cache_dealloc(pool_cache* cache, void* block, const size_t size);